@@ -26,3 +26,7 @@
 AbstractMode::AbstractMode() {
 }
 
+bool AbstractMode::isBusy() {
+  return false;
+}
+
@@ -22,7 +22,12 @@
 
 /**
  * The abstract superclass of the internal operating modes of the 
- * Mrkt system.
+ * Mrkt system. The methods are not virtual: the modes are registered
+ * in ModeController.h and called through a table of functions that
+ * call the methods of the mode instances directly. Every mode has to
+ * declare and implement activate(), loop() and deactivate() - they are
+ * not implemented here, so a missing one is reported by the linker. A
+ * mode that does not declare isBusy() inherits the default implementation.
  */
 class AbstractMode {
   
@@ -36,18 +41,25 @@ class AbstractMode {
      * This method is called when the mode is activated. It is called before
      * the first call to loop().
      */
-    virtual void activate() = 0;
+    void activate();
 
     /**
      * This method is called as part of the main loop iteration.
      */
-    virtual void loop() = 0;
+    void loop();
 
     /**
      * This method is called before the mode is deactivated and another mode
      * is activated.
      */
-    virtual void deactivate() = 0;
+    void deactivate();
+
+    /**
+     * Checks whether the mode has work to do that does not wait for an event (received data,
+     * user controls or time). The main loop does not sleep while the mode is busy (see 
+     * IdleSleep). The default implementation returns false.
+     */
+    bool isBusy();
     
 };
 
@@ -0,0 +1,425 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "Arduino.h"
+
+#include "Configuration.h"
+#include "BenchmarkMode.h"
+
+#include "Communication.h"
+#include "Display.h"
+#include "HostChannel.h"
+#include "ModeController.h"
+#include "Uploader.h"
+#include "UserControls.h"
+#include "Workspace.h"
+
+/**
+ * The default number of queries of a run.
+ */
+#define BENCH_MODE_DEFAULT_QUERIES     30
+
+/**
+ * The time in ms to wait for a Grbl response.
+ */
+#define BENCH_MODE_COMM_TIMEOUT      1000
+
+/**
+ * The progress display is only updated every few queries to keep the time spent on the 
+ * LCD out of the measurement as far as possible.
+ */
+#define BENCH_MODE_PROGRESS_INTERVAL   10
+
+/**
+ * The number of queries available (see BenchmarkMode::Query).
+ */
+#define BENCH_MODE_QUERY_COUNT          4
+
+/**
+ * The results that are displayed after a run.
+ */
+#define BENCH_MODE_RESULT_COMMAND_RATE  0
+#define BENCH_MODE_RESULT_BYTE_RATE     1
+#define BENCH_MODE_RESULT_P50           2
+#define BENCH_MODE_RESULT_P90           3
+#define BENCH_MODE_RESULT_P99           4
+#define BENCH_MODE_RESULT_MAX           5
+#define BENCH_MODE_RESULT_QUERIES       6
+#define BENCH_MODE_RESULT_FAILED        7
+#define BENCH_MODE_RESULT_DURATION      8
+#define BENCH_MODE_RESULT_COUNT         9
+
+/**
+ * The names of the queries (see BenchmarkMode::Query), which are used by the host commands as
+ * well. The labels of the results are stored in the order of the results (see Strings.txt).
+ */
+const char BenchmarkMode_QueryNames[BENCH_MODE_QUERY_COUNT][5] PROGMEM = {
+  "mix",
+  "?",
+  "$G",
+  "G4P0"
+};
+
+/**
+ * The "singleton" instance of the BenchmarkMode class.
+ */
+BenchmarkMode MrktBenchmarkMode;
+
+BenchmarkMode::BenchmarkMode() : 
+  AbstractMode() {
+  this->queryCount = BENCH_MODE_DEFAULT_QUERIES;
+  this->query = Mixed;
+  this->hostRequest = false;
+}
+
+void BenchmarkMode::activate() {
+  MrktUserControls.clearEvents();
+  MrktDisplay.clear();
+  this->state = Setup;
+  this->refresh = true;
+}
+
+void BenchmarkMode::deactivate() {
+  // a response that is still pending is ignored (see handleQueryResponse())
+  this->state = Setup;
+  this->hostRequest = false;
+  MrktDisplay.clear();
+}
+
+void BenchmarkMode::requestRun(uint8_t queries, Query query) {
+  this->queryCount = constrain(queries, 1, BENCH_MODE_MAX_QUERIES);
+  this->query = query;
+  this->hostRequest = true;
+}
+
+bool BenchmarkMode::isRunning() {
+  return (this->state == Sending) || (this->state == Waiting) || (this->state == Evaluation);
+}
+
+bool BenchmarkMode::findQuery(const char * name, Query & query) {
+  for (uint8_t i = 0; i < BENCH_MODE_QUERY_COUNT; i++) {
+    if (strcmp_P(name, BenchmarkMode_QueryNames[i]) == 0) {
+      query = (Query) i;
+      return true;
+    }
+  }
+  return false;
+}
+
+void BenchmarkMode::loop() {
+  switch(this->state) {
+    case Setup:
+      loopSetup();
+      break;
+    case Sending:
+      loopSending();
+      break;
+    case Waiting:
+      loopWaiting();
+      break;
+    case Evaluation:
+      loopEvaluation();
+      break;
+    case Results:
+      loopResults();
+      break;
+  }
+}
+
+bool BenchmarkMode::isBusy() {
+  // the commands are sent back to back - sleeping in between would distort the results
+  return (this->state == Sending) || (this->state == Evaluation) || 
+         ((this->state == Setup) && this->hostRequest);
+}
+
+void BenchmarkMode::loopSetup() {
+  // a run requested by the host system is started immediately
+  if (this->hostRequest) {
+    startRun();
+    return;
+  }
+
+  while (MrktUserControls.isEventAvailable()) {
+    UserControls::Event event = MrktUserControls.getEvent();
+    switch(event.type) {
+      case UserControls::EncChanged:
+        this->queryCount = constrain(this->queryCount + event.data, 1, BENCH_MODE_MAX_QUERIES);
+        break;
+      case UserControls::KeyUp:
+        this->query = (Query) ((this->query + BENCH_MODE_QUERY_COUNT - 1) % BENCH_MODE_QUERY_COUNT);
+        break;
+      case UserControls::KeyDown:
+        this->query = (Query) ((this->query + 1) % BENCH_MODE_QUERY_COUNT);
+        break;
+      case UserControls::KeySelect:
+      case UserControls::EncButton:
+        startRun();
+        break;
+      case UserControls::KeyLeft:
+      case UserControls::ModeButton:
+        MrktModeController.switchToPreviousMode();
+        break;
+      default:
+        // ignore all other events
+        break;
+    }
+    this->refresh = true;
+  }
+
+  if (this->refresh && (this->state == Setup)) {
+    displayHeader();
+    MrktDisplay.setCursor(0, 1);
+    MrktDisplay.writeString(STRING_BENCH_QUERIES);
+    MrktDisplay.writeRightAligned(8, 1, this->queryCount);
+    this->refresh = false;
+  }
+}
+
+void BenchmarkMode::loopSending() {
+  // wait for the previous command to complete (this also covers commands of the previous mode)
+  if (!MrktCommunication.isIdle()) {
+    return;
+  }
+
+  // show the progress
+  if (this->sentCount % BENCH_MODE_PROGRESS_INTERVAL == 0) {
+    MrktDisplay.setCursor(0, 1);
+    MrktDisplay.writeString(STRING_BENCH_RUNNING);
+    MrktDisplay.writeNumber(this->sentCount);
+    MrktDisplay.write('/');
+    MrktDisplay.writeNumber(this->queryCount);
+  }
+
+  // in mixed mode, use the individual queries in turn
+  Query currentQuery = this->query;
+  if (currentQuery == Mixed) {
+    currentQuery = (Query) (1 + this->sentCount % (BENCH_MODE_QUERY_COUNT - 1));
+  }
+  this->state = Waiting;
+  this->queryStartTime = micros();
+  switch(currentQuery) {
+    case StatusReport:
+      // the status report is sent immediately, the empty line is acknowledged with ok
+      MrktCommunication.sendGrblCommand(F("?"), BENCH_MODE_COMM_TIMEOUT, &BenchmarkMode::handleQueryResponse);
+      break;
+    case ParserState:
+      MrktCommunication.sendGrblCommand(F("$G"), BENCH_MODE_COMM_TIMEOUT, &BenchmarkMode::handleQueryResponse);
+      break;
+    default:
+      MrktCommunication.sendGrblCommand(F("G4P0"), BENCH_MODE_COMM_TIMEOUT, &BenchmarkMode::handleQueryResponse);
+      break;
+  }
+  this->sentCount++;
+}
+
+void BenchmarkMode::loopWaiting() {
+  // this state is only left through the communication response handler
+}
+
+void BenchmarkMode::loopEvaluation() {
+  const Communication::Statistics & statistics = MrktCommunication.getStatistics();
+  this->runDuration = millis() - this->runStartTime;
+  this->runBytes = statistics.bytesSent + statistics.bytesReceived - this->runStartBytes;
+
+  // sort the latencies to determine the percentiles - insertion sort is good enough for this size
+  uint16_t * latencies = MrktWorkspace.latencies;
+  uint8_t count = this->sentCount - this->failedCount;
+  for (uint8_t i = 1; i < count; i++) {
+    uint16_t latency = latencies[i];
+    uint8_t j = i;
+    while ((j > 0) && (latencies[j - 1] > latency)) {
+      latencies[j] = latencies[j - 1];
+      j--;
+    }
+    latencies[j] = latency;
+  }
+  // the workspace is only available during the run
+  this->percentiles[0] = getPercentile(50);
+  this->percentiles[1] = getPercentile(90);
+  this->percentiles[2] = getPercentile(99);
+  this->percentiles[3] = getPercentile(100);
+
+  if (this->hostRequest) {
+    reportToHost();
+    this->hostRequest = false;
+  }
+
+  this->firstResult = 0;
+  this->state = Results;
+  this->refresh = true;
+}
+
+void BenchmarkMode::loopResults() {
+  // a run requested by the host system is started immediately
+  if (this->hostRequest) {
+    startRun();
+    return;
+  }
+
+  while (MrktUserControls.isEventAvailable()) {
+    UserControls::Event event = MrktUserControls.getEvent();
+    int16_t newFirstResult = this->firstResult;
+    switch(event.type) {
+      case UserControls::KeyUp:
+        newFirstResult -= event.data;
+        break;
+      case UserControls::KeyDown:
+      case UserControls::EncChanged:
+        newFirstResult += event.data;
+        break;
+      case UserControls::KeySelect:
+      case UserControls::EncButton:
+        startRun();
+        return;
+      case UserControls::KeyLeft:
+      case UserControls::ModeButton:
+        MrktModeController.switchToPreviousMode();
+        break;
+      default:
+        // ignore all other events
+        break;
+    }
+    // keep the second line inside the list
+    newFirstResult = constrain(newFirstResult, 0, BENCH_MODE_RESULT_COUNT - 2);
+    if (newFirstResult != this->firstResult) {
+      this->firstResult = newFirstResult;
+      this->refresh = true;
+    }
+  }
+
+  if (this->refresh) {
+    displayResult(this->firstResult,     0);
+    displayResult(this->firstResult + 1, 1);
+    this->refresh = false;
+  }
+}
+
+void BenchmarkMode::startRun() {
+#if SDCARD_AVAILABLE == 1
+  if (MrktUploader.isActive()) {
+    // the upload uses the memory of the latencies - a run requested by the host is started later
+    return;
+  }
+#endif
+  const Communication::Statistics & statistics = MrktCommunication.getStatistics();
+  this->sentCount = 0;
+  this->failedCount = 0;
+  this->runStartTime = millis();
+  this->runStartBytes = statistics.bytesSent + statistics.bytesReceived;
+  this->state = Sending;
+  MrktDisplay.clear();
+  displayHeader();
+}
+
+void BenchmarkMode::displayHeader() {
+  MrktDisplay.setCursor(0, 0);
+  MrktDisplay.writeString(STRING_BENCH, DISPLAY_LCD_COLUMNS - strlen_P(BenchmarkMode_QueryNames[this->query]));
+  MrktDisplay.print((const __FlashStringHelper *) BenchmarkMode_QueryNames[this->query]);
+}
+
+void BenchmarkMode::displayResult(uint8_t result, uint8_t row) {
+  MrktDisplay.setCursor(0, row);
+  uint8_t length = MrktDisplay.writeString(STRING_BENCH_CMD_RATE + result);
+  uint8_t decimals;
+  uint32_t value = getResultValue(result, decimals);
+  MrktDisplay.writeRightAligned(length + 1, row, value, decimals);
+}
+
+uint32_t BenchmarkMode::getResultValue(uint8_t result, uint8_t & decimals) {
+  // avoid divisions by zero for extremely short runs
+  uint32_t duration = max(this->runDuration, 1);
+  decimals = 0;
+  switch(result) {
+    case BENCH_MODE_RESULT_COMMAND_RATE:
+      decimals = 1;
+      return (this->sentCount * 10000UL) / duration;
+    case BENCH_MODE_RESULT_BYTE_RATE:
+      return (this->runBytes * 1000UL) / duration;
+    case BENCH_MODE_RESULT_P50:
+    case BENCH_MODE_RESULT_P90:
+    case BENCH_MODE_RESULT_P99:
+    case BENCH_MODE_RESULT_MAX:
+      decimals = 1;
+      return this->percentiles[result - BENCH_MODE_RESULT_P50];
+    case BENCH_MODE_RESULT_QUERIES:
+      return this->sentCount;
+    case BENCH_MODE_RESULT_FAILED:
+      return this->failedCount;
+    default:
+      return this->runDuration;
+  }
+}
+
+uint16_t BenchmarkMode::getPercentile(uint8_t percent) {
+  uint8_t count = this->sentCount - this->failedCount;
+  if (count == 0) {
+    return 0;
+  }
+  // nearest-rank method: the smallest value that is greater than or equal to the given
+  // percentage of all values
+  uint16_t rank = (percent * count + 99) / 100;
+  return MrktWorkspace.latencies[max(rank, 1) - 1];
+}
+
+void BenchmarkMode::reportToHost() {
+  // [BENCH:<query>,<queries>,<failed>,<duration ms>,<cmd/s>,<bytes/s>,<p50>,<p90>,<p99>,<max>]
+  // with the command rate and the latencies given with one decimal place
+  MrktHostChannel.print(F("[BENCH:"));
+  MrktHostChannel.print((const __FlashStringHelper *) BenchmarkMode_QueryNames[this->query]);
+  for (uint8_t result = BENCH_MODE_RESULT_QUERIES; result <= BENCH_MODE_RESULT_DURATION; result++) {
+    uint8_t decimals;
+    MrktHostChannel.print(',');
+    MrktHostChannel.print(getResultValue(result, decimals));
+  }
+  for (uint8_t result = BENCH_MODE_RESULT_COMMAND_RATE; result <= BENCH_MODE_RESULT_MAX; result++) {
+    uint8_t decimals;
+    uint32_t value = getResultValue(result, decimals);
+    MrktHostChannel.print(',');
+    if (decimals > 0) {
+      MrktHostChannel.print(value / 10);
+      MrktHostChannel.print('.');
+      MrktHostChannel.print(value % 10);
+    } else {
+      MrktHostChannel.print(value);
+    }
+  }
+  MrktHostChannel.println(']');
+}
+
+void BenchmarkMode::handleQueryResponse(int status, char * response) {
+  if (MrktBenchmarkMode.state != Waiting) {
+    // the mode has been left during the run - the workspace might be in use by now
+    return;
+  }
+  if (status == COMMUNICATION_STATUS_OK) {
+    uint32_t latency = (micros() - MrktBenchmarkMode.queryStartTime) / 100;
+    uint8_t index = MrktBenchmarkMode.sentCount - MrktBenchmarkMode.failedCount - 1;
+    MrktWorkspace.latencies[index] = min(latency, 0xFFFF);
+  } else {
+    MrktBenchmarkMode.failedCount++;
+  }
+
+  // send the next query or evaluate the run
+  if (MrktBenchmarkMode.sentCount < MrktBenchmarkMode.queryCount) {
+    MrktBenchmarkMode.state = Sending;
+  } else {
+    MrktBenchmarkMode.state = Evaluation;
+  }
+}
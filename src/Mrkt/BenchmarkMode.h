@@ -0,0 +1,197 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_BenchmarkMode_h
+#define MRKT_BenchmarkMode_h
+
+#include "Configuration.h"
+#include "AbstractMode.h"
+
+/**
+ * The maximum number of queries of a benchmark run. The latency of every query is stored 
+ * to compute the percentiles, so this determines the size of the shared Workspace.
+ */
+#define BENCH_MODE_MAX_QUERIES  60
+
+/**
+ * This class implements a round-trip latency benchmark. It sends a configurable number of 
+ * queries to the Grbl system using the same communication path as all other commands and
+ * displays the throughput and latency percentiles afterwards. The mode can be entered from 
+ * any other mode using the key combination MODE + RIGHT or the host command BENCH. 
+ * 
+ *   Setup               Running             Results
+ *   ┌────────────────┐  ┌────────────────┐  ┌────────────────┐
+ *   │Bench       G4P0│  │Bench       G4P0│  │Cmd/s      243.9│
+ *   │Queries       30│  │Running    12/30│  │Lat p50 ms   2.1│
+ *   └────────────────┘  └────────────────┘  └────────────────┘
+ * 
+ * In the setup state, the encoder wheel changes the number of queries, the up and down keys 
+ * select the query and the select key or the encoder button starts the run. The results are 
+ * scrolled using the encoder wheel or the up and down keys, the select key starts another run. 
+ * The mode button or the left key return to the previous mode. A run is not started while a 
+ * file is uploaded, since the latencies are stored in the memory used by the upload (see 
+ * Workspace.h).
+ */
+class BenchmarkMode : public AbstractMode {
+  
+  public:
+    /**
+     * The queries that can be used for the benchmark - either one of the individual queries
+     * or all of them in turn.
+     */
+    enum Query { Mixed, StatusReport, ParserState, Dwell };
+
+    /**
+     * The default constructor.
+     */
+    BenchmarkMode();
+
+    /**
+     * See AbstractMode for an explanation of these methods.
+     */
+    void activate();
+    void loop();
+    void deactivate();
+    bool isBusy();
+
+    /**
+     * Configures a benchmark run that is started as soon as the mode is active and idle. 
+     * The results are also reported to the host system. This is used by the host command BENCH.
+     */
+    void requestRun(uint8_t queries, Query query);
+
+    /**
+     * Checks whether a run is in progress, i.e. whether the latencies are being collected.
+     */
+    bool isRunning();
+
+    /**
+     * Returns the query with the given name ("mix", "?", "$G" or "G4P0"). Returns false
+     * if the name is unknown.
+     */
+    static bool findQuery(const char * name, Query & query);
+
+  private:
+    /**
+     * The enumeration to represent the internal state of the mode implementation.
+     */
+    enum InternalState { Setup, Sending, Waiting, Evaluation, Results };
+    InternalState state;
+
+    /**
+     * The number of queries to send and the query to use.
+     */
+    uint8_t queryCount;
+    Query query;
+
+    /**
+     * Whether the run was requested by the host system (see requestRun()).
+     */
+    bool hostRequest;
+
+    /**
+     * The number of queries sent and the number of queries that failed during the current run.
+     */
+    uint8_t sentCount;
+    uint8_t failedCount;
+
+    /**
+     * The percentiles p50, p90, p99 and p100 of the latencies in units of 0.1 ms, determined 
+     * by the evaluation. During the run, the latencies are collected in the shared Workspace.
+     */
+    uint16_t percentiles[4];
+
+    /**
+     * The system time (in µs) at which the current query was sent.
+     */
+    uint32_t queryStartTime;
+
+    /**
+     * The system time (in ms) at which the run was started and the duration of the run.
+     */
+    uint32_t runStartTime;
+    uint32_t runDuration;
+
+    /**
+     * The number of bytes transferred in both directions at the start of the run and 
+     * during the run.
+     */
+    uint32_t runStartBytes;
+    uint32_t runBytes;
+
+    /**
+     * The index of the result displayed in the first line.
+     */
+    uint8_t firstResult;
+
+    /**
+     * Set whenever the display has to be updated.
+     */
+    bool refresh;
+
+    /** 
+     * The handler method for the queries.
+     */
+    static void handleQueryResponse(int status, char * response);
+
+    /**
+     * The implementations called during the loop() processing for each internal state.
+     */
+    void loopSetup();
+    void loopSending();
+    void loopWaiting();
+    void loopEvaluation();
+    void loopResults();
+
+    /**
+     * Prepares the counters and starts a new run.
+     */
+    void startRun();
+
+    /**
+     * Displays the benchmark header and the query name in the first line.
+     */
+    void displayHeader();
+
+    /**
+     * Displays the result with the given index in the given row.
+     */
+    void displayResult(uint8_t result, uint8_t row);
+
+    /**
+     * Returns the value of a result and the number of decimal places to display.
+     */
+    uint32_t getResultValue(uint8_t result, uint8_t & decimals);
+
+    /**
+     * Returns the latency percentile (in units of 0.1 ms) of the sorted latencies of the run.
+     */
+    uint16_t getPercentile(uint8_t percent);
+
+    /**
+     * Sends the results to the host system as a [BENCH:...] message.
+     */
+    void reportToHost();
+
+};
+
+/**
+ * Access to the "singleton" instance of the BenchmarkMode class.
+ */
+extern BenchmarkMode MrktBenchmarkMode;
+
+#endif
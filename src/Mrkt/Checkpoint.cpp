@@ -0,0 +1,115 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <util/crc16.h>
+#include "Arduino.h"
+#include <EEPROM.h>
+
+#include "Configuration.h"
+#include "Checkpoint.h"
+
+/**
+ * The "singleton" instance of the Checkpoint class.
+ */
+Checkpoint MrktCheckpoint;
+
+Checkpoint::Checkpoint() {
+  this->initialized = false;
+}
+
+bool Checkpoint::load(uint16_t fileId, uint32_t & line) {
+  initialize();
+  if ((this->current.fileId != fileId) || (this->current.line == 0)) {
+    return false;
+  }
+  line = this->current.line;
+  return true;
+}
+
+void Checkpoint::save(uint16_t fileId, uint32_t line) {
+  initialize();
+  if ((this->current.fileId == fileId) && (this->current.line == line)) {
+    return;
+  }
+  this->currentIndex = (this->currentIndex + 1) % CHECKPOINT_SLOTS;
+  this->current.sequence++;
+  this->current.fileId = fileId;
+  this->current.line = line;
+  this->current.checksum = computeChecksum(&this->current, offsetof(Slot, checksum));
+  EEPROM.put(CHECKPOINT_EEPROM_ADDRESS + this->currentIndex * sizeof(Slot), this->current);
+}
+
+void Checkpoint::clear() {
+  save(0, 0);
+}
+
+uint16_t Checkpoint::getFileId(const char * fileName, uint32_t fileSize) {
+  uint16_t id = 0xFFFF;
+  while (*fileName != '\0') {
+    id = _crc16_update(id, *fileName++);
+  }
+  for (uint8_t i = 0; i < 4; i++) {
+    id = _crc16_update(id, fileSize & 0xFF);
+    fileSize >>= 8;
+  }
+  return id;
+}
+
+void Checkpoint::initialize() {
+  if (this->initialized) {
+    return;
+  }
+  this->initialized = true;
+  this->currentIndex = CHECKPOINT_SLOTS - 1;
+  this->current.sequence = 0;
+  this->current.fileId = 0;
+  this->current.line = 0;
+
+  // the slots are written in turn, so the most recent slot is the one with the highest 
+  // sequence number (taking the overflow of the sequence number into account)
+  bool found = false;
+  for (uint8_t index = 0; index < CHECKPOINT_SLOTS; index++) {
+    Slot slot;
+    if (readSlot(index, slot) && 
+        (!found || ((int16_t) (slot.sequence - this->current.sequence) > 0))) {
+      this->currentIndex = index;
+      this->current = slot;
+      found = true;
+    }
+  }
+}
+
+bool Checkpoint::readSlot(uint8_t index, Slot & slot) {
+  EEPROM.get(CHECKPOINT_EEPROM_ADDRESS + index * sizeof(Slot), slot);
+  return (slot.checksum == computeChecksum(&slot, offsetof(Slot, checksum)));
+}
+
+uint8_t Checkpoint::computeChecksum(const void * data, uint8_t size, uint16_t address, uint16_t length) {
+  // an erased EEPROM (all bytes 0xFF) must not yield a valid record, hence the initial value
+  uint8_t checksum = 0x5A;
+  for (uint8_t i = 0; i < size; i++) {
+    checksum = _crc_ibutton_update(checksum, ((const uint8_t *) data)[i]);
+  }
+  for (uint16_t i = 0; i < length; i++) {
+    checksum = _crc_ibutton_update(checksum, EEPROM.read(address + i));
+  }
+  return checksum;
+}
@@ -0,0 +1,108 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_Checkpoint_h
+#define MRKT_Checkpoint_h
+
+#include "Configuration.h"
+
+/**
+ * The EEPROM area used to store the checkpoints and the number of slots within this area.
+ * Each slot occupies sizeof(Checkpoint::Slot) bytes.
+ */
+#define CHECKPOINT_EEPROM_ADDRESS 0
+#define CHECKPOINT_SLOTS          16
+
+/**
+ * This class stores the progress of a running job in the EEPROM so that the job can be 
+ * resumed after an interruption, even if the power was lost. Each checkpoint is written to 
+ * the next of CHECKPOINT_SLOTS slots in turn (wear levelling): the slots carry a sequence 
+ * number that identifies the most recent checkpoint, and a checksum so that a slot that 
+ * was only partially written is ignored.
+ */
+class Checkpoint {
+
+  public:
+    /**
+     * The default constructor.
+     */
+    Checkpoint();
+
+    /**
+     * Retrieves the line stored in the most recent checkpoint if it belongs to the file given.
+     * Returns false if no such checkpoint exists.
+     */
+    bool load(uint16_t fileId, uint32_t & line);
+
+    /**
+     * Stores a new checkpoint. Nothing is written if the checkpoint has not changed.
+     */
+    void save(uint16_t fileId, uint32_t line);
+
+    /**
+     * Invalidates the most recent checkpoint, e.g. when a job has been finished.
+     */
+    void clear();
+
+    /**
+     * Computes the identification of a file used to match checkpoints and files.
+     */
+    static uint16_t getFileId(const char * fileName, uint32_t fileSize);
+
+    /**
+     * Computes the checksum of a record stored in the EEPROM: the first size bytes of the 
+     * data given, followed by length bytes read from the EEPROM at the address given. This
+     * is also used for the height map (see HeightMap).
+     */
+    static uint8_t computeChecksum(const void * data, uint8_t size, uint16_t address = 0, uint16_t length = 0);
+
+  private:
+    /**
+     * The contents of a single slot.
+     */
+    struct Slot {
+      uint16_t sequence;
+      uint16_t fileId;
+      uint32_t line;
+      uint8_t  checksum;
+    };
+
+    /**
+     * Whether the most recent slot has been located yet, and its contents.
+     */
+    bool initialized;
+    uint8_t currentIndex;
+    Slot current;
+
+    /**
+     * Locates the most recent slot if this has not been done yet.
+     */
+    void initialize();
+
+    /**
+     * Reads a slot from the EEPROM. Returns false if the checksum does not match.
+     */
+    bool readSlot(uint8_t index, Slot & slot);
+
+};
+
+/**
+ * Access to the "singleton" instance of the Checkpoint class.
+ */
+extern Checkpoint MrktCheckpoint;
+
+#endif
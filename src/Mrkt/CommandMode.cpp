@@ -0,0 +1,221 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "Arduino.h"
+
+#include "Configuration.h"
+#include "CommandMode.h"
+
+#include "Communication.h"
+#include "Display.h"
+#include "ModeController.h"
+#include "Telemetry.h"
+#include "UserControls.h"
+
+/**
+ * The time in ms a message is displayed.
+ */
+#define CMD_MODE_MESSAGE_TIME      3000
+
+/**
+ * The timeouts in ms of the commands sent to the Grbl system - homing takes a while.
+ */
+#define CMD_MODE_COMMAND_TIMEOUT   2000
+#define CMD_MODE_HOMING_TIMEOUT   60000
+
+/**
+ * The realtime commands of the Grbl system.
+ */
+#define CMD_MODE_CYCLE_START        '~'
+#define CMD_MODE_FEED_HOLD          '!'
+#define CMD_MODE_SOFT_RESET        0x18
+
+/**
+ * The menus. Submenus have to be defined before the menus that contain them.
+ */
+const Menu::Entry CommandMode_MachineMenu[] PROGMEM = {
+  MENU_ACTION(STRING_HOME,          CommandMode::homeMachine),
+  MENU_ACTION(STRING_UNLOCK,        CommandMode::unlockMachine),
+  MENU_ACTION(STRING_CYCLE_START,   CommandMode::startCycle),
+  MENU_ACTION(STRING_FEED_HOLD,     CommandMode::holdFeed),
+  MENU_ACTION(STRING_SOFT_RESET,    CommandMode::resetMachine)
+};
+
+const Menu::Entry CommandMode_SettingsMenu[] PROGMEM = {
+  MENU_VALUE(STRING_BACKLIGHT,      CommandMode::getBacklight, CommandMode::setBacklight,
+                                    0, DISPLAY_BACKLIGHT_LEVELS),
+  MENU_VALUE(STRING_TELEMETRY_RATE, CommandMode::getTelemetryRate, CommandMode::setTelemetryRate,
+                                    0, TELEMETRY_MAX_RATE)
+};
+
+const Menu::Entry CommandMode_MainMenu[] PROGMEM = {
+#if SDCARD_AVAILABLE == 1
+  MENU_ACTION(STRING_RUN_FILE,      CommandMode::runFile),
+#endif
+  MENU_SUBMENU(STRING_MACHINE,      CommandMode_MachineMenu),
+  MENU_ACTION(STRING_HEIGHT_MAP,    CommandMode::probeSurface),
+  MENU_ACTION(STRING_PASSTHROUGH,   CommandMode::startPassthrough),
+  MENU_SUBMENU(STRING_SETTINGS,     CommandMode_SettingsMenu),
+  MENU_ACTION(STRING_DIAGNOSTICS,   CommandMode::showDiagnostics),
+  MENU_ACTION(STRING_BENCHMARK,     CommandMode::runBenchmark)
+};
+
+/**
+ * The "singleton" instance of the CommandMode class.
+ */
+CommandMode MrktCommandMode;
+
+CommandMode::CommandMode() :
+  AbstractMode() {
+}
+
+void CommandMode::activate() {
+  this->messageTime = 0;
+  this->commandPending = false;
+  MrktUserControls.clearEvents();
+  MrktDisplay.clear();
+  this->menu.begin(CommandMode_MainMenu, sizeof(CommandMode_MainMenu) / sizeof(Menu::Entry));
+}
+
+void CommandMode::deactivate() {
+  // the response to a pending command is not displayed any more
+  this->commandPending = false;
+  MrktDisplay.clear();
+}
+
+void CommandMode::loop() {
+  while (MrktUserControls.isEventAvailable()) {
+    UserControls::Event event = MrktUserControls.getEvent();
+    // any key removes a message unless the command is still running
+    if ((this->messageTime != 0) && !this->commandPending) {
+      this->messageTime = 0;
+      this->menu.display();
+    }
+    this->menu.handleEvent(event);
+  }
+  if ((this->messageTime != 0) && !this->commandPending &&
+      (millis() - this->messageTime > CMD_MODE_MESSAGE_TIME)) {
+    this->messageTime = 0;
+    this->menu.display();
+  }
+}
+
+void CommandMode::runFile() {
+#if SDCARD_AVAILABLE == 1
+  MrktModeController.switchToMode(ModeController::Reader);
+#endif
+}
+
+void CommandMode::probeSurface() {
+  MrktModeController.switchToMode(ModeController::Probe);
+}
+
+void CommandMode::startPassthrough() {
+  MrktModeController.switchToMode(ModeController::Passthrough);
+}
+
+void CommandMode::showDiagnostics() {
+  MrktModeController.switchToMode(ModeController::Diagnostics);
+}
+
+void CommandMode::runBenchmark() {
+  MrktModeController.switchToMode(ModeController::Benchmark);
+}
+
+void CommandMode::homeMachine() {
+  MrktCommandMode.sendCommand(F("$H"), CMD_MODE_HOMING_TIMEOUT);
+}
+
+void CommandMode::unlockMachine() {
+  MrktCommandMode.sendCommand(F("$X"), CMD_MODE_COMMAND_TIMEOUT);
+}
+
+void CommandMode::startCycle() {
+  MrktCommunication.sendRealtimeCommand(CMD_MODE_CYCLE_START);
+}
+
+void CommandMode::holdFeed() {
+  MrktCommunication.sendRealtimeCommand(CMD_MODE_FEED_HOLD);
+}
+
+void CommandMode::resetMachine() {
+  MrktCommunication.sendRealtimeCommand(CMD_MODE_SOFT_RESET);
+}
+
+int16_t CommandMode::getBacklight() {
+  return MrktDisplay.getBacklight();
+}
+
+void CommandMode::setBacklight(int16_t value) {
+  MrktDisplay.setBacklight(value);
+}
+
+int16_t CommandMode::getTelemetryRate() {
+  return MrktTelemetry.getRate();
+}
+
+void CommandMode::setTelemetryRate(int16_t value) {
+  MrktTelemetry.setRate(value);
+}
+
+void CommandMode::sendCommand(const __FlashStringHelper * command, uint16_t timeout) {
+  if (this->commandPending || !MrktCommunication.isIdle()) {
+    showMessage(STRING_BUSY);
+    return;
+  }
+  MrktCommunication.sendGrblCommand(command, timeout, handleCommandResponse);
+  this->commandPending = true;
+  showMessage(STRING_WAITING);
+  MrktDisplay.writeEllipsis(7, 1);
+}
+
+void CommandMode::showMessage(uint8_t message, int status) {
+  MrktDisplay.setCursor(0, 1);
+  uint8_t length = MrktDisplay.writeString(message);
+  if (status > 0) {
+    MrktDisplay.write(' ');
+    length += 1 + MrktDisplay.writeNumber(status);
+  }
+  for (; length < DISPLAY_LCD_COLUMNS; length++) {
+    MrktDisplay.write(' ');
+  }
+  this->messageTime = millis();
+}
+
+void CommandMode::handleCommandResponse(int status, char * response) {
+  if (!MrktCommandMode.commandPending) {
+    return;
+  }
+  MrktCommandMode.commandPending = false;
+  switch(status) {
+    case COMMUNICATION_STATUS_OK:
+      MrktCommandMode.showMessage(STRING_RESPONSE_OK);
+      break;
+    case COMMUNICATION_STATUS_TIMEOUT:
+      MrktCommandMode.showMessage(STRING_TIMEOUT);
+      break;
+    case COMMUNICATION_STATUS_BUFFER_OVERFLOW:
+      MrktCommandMode.showMessage(STRING_OVERFLOW);
+      break;
+    default:
+      MrktCommandMode.showMessage(STRING_GRBL_ERROR, status);
+      break;
+  }
+}
@@ -0,0 +1,106 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_CommandMode_h
+#define MRKT_CommandMode_h
+
+#include "Configuration.h"
+#include "AbstractMode.h"
+#include "Menu.h"
+
+/**
+ * This class implements the command mode, the initial working mode of the system. It shows
+ * the main menu (see Menu.h) from which the other modes are entered, the Grbl system is homed,
+ * unlocked or reset and the settings of Mrkt are changed:
+ *
+ *   ┌────────────────┐
+ *   │>Run file       │
+ *   │ Machine       …│
+ *   └────────────────┘
+ *
+ * The menus are defined in CommandMode.cpp. The results of the commands sent to the Grbl
+ * system are shown in the second row for a few seconds.
+ */
+class CommandMode : public AbstractMode {
+
+  public:
+    /**
+     * The default constructor.
+     */
+    CommandMode();
+
+    /**
+     * See AbstractMode for an explanation of these methods.
+     */
+    void activate();
+    void loop();
+    void deactivate();
+
+    /**
+     * The actions and value accessors called by the menu entries.
+     */
+    static void runFile();
+    static void probeSurface();
+    static void startPassthrough();
+    static void showDiagnostics();
+    static void runBenchmark();
+    static void homeMachine();
+    static void unlockMachine();
+    static void startCycle();
+    static void holdFeed();
+    static void resetMachine();
+    static int16_t getBacklight();
+    static void setBacklight(int16_t value);
+    static int16_t getTelemetryRate();
+    static void setTelemetryRate(int16_t value);
+
+  private:
+    /**
+     * The menu engine.
+     */
+    Menu menu;
+
+    /**
+     * The time at which the message in the second row was displayed (0 if no message is
+     * displayed), and whether the message is the response to a pending command.
+     */
+    uint32_t messageTime;
+    bool commandPending;
+
+    /**
+     * Sends a command to the Grbl system unless the communication system is busy.
+     */
+    void sendCommand(const __FlashStringHelper * command, uint16_t timeout);
+
+    /**
+     * Displays a message (one of the STRING_* constants) in the second row.
+     */
+    void showMessage(uint8_t message, int status = 0);
+
+    /**
+     * The response handler of the commands sent to the Grbl system.
+     */
+    static void handleCommandResponse(int status, char * response);
+
+};
+
+/**
+ * Access to the "singleton" instance of the CommandMode class.
+ */
+extern CommandMode MrktCommandMode;
+
+#endif
@@ -23,6 +23,19 @@
 #include "Configuration.h"
 #include "Communication.h"
 
+#include "HostChannel.h"
+#include "HostCommands.h"
+#include "Trace.h"
+#include "Uploader.h"
+
+/**
+ * The upper limits of the latency histogram buckets in ms. There is one entry less than 
+ * there are buckets because the last bucket collects everything above the last limit.
+ */
+const uint16_t Communication_LatencyBucketLimits[COMMUNICATION_LATENCY_BUCKETS - 1] PROGMEM = {
+  2, 5, 10, 20, 50, 100, 200
+};
+
 /**
  * The "singleton" instance of the Communication class.
  */
@@ -35,31 +48,191 @@ Communication::Communication() :
   this->grblSerial.listen();
   memset(this->grblResponseBuffer, '\0', COMMUNICATION_GRBL_RESPONSE_BUFFER_SIZE + 1);
   this->grblResponseBufferPosition = 0;
+  this->grblResponseLineStart = 0;
+  this->grblResponseSkipLine = false;
+  this->grblResponseLineHandler = 0;
+  memset(this->hostCommandBuffer, '\0', COMMUNICATION_HOST_COMMAND_BUFFER_SIZE + 1);
+  this->hostCommandBufferPosition = 0;
+  this->hostCommandEscaped = false;
+  this->hostCommandPending = false;
+  this->hostCommandSkipLineFeed = false;
+  resetStatistics();
   this->state = Idle;
 }
 
 void Communication::loop() {
   switch(this->state) {
     case Idle:
-      // do nothing
+      // push messages (e.g. requested status reports) are only evaluated by the sniffer
+      while (grblSerial.available()) readGrbl();
       break;
     case GrblCommand:
       loopGrblCommand();
       break;
+    case GrblStream:
+      loopGrblStream();
+      break;
+    case Passthrough:
+      // the host data belongs to the Grbl system
+      loopPassthrough();
+      return;
   }
+  loopHost();
 }
 
-void Communication::sendGrblCommand(String command, uint16_t timeout, CommandResponseHandler handler) {
+void Communication::sendGrblCommand(String command, uint16_t timeout, CommandResponseHandler handler, 
+                                    ResponseLineHandler lineHandler) {
   if (this->state == Idle) {
     // clear the buffer
-    while (grblSerial.available()) grblSerial.read();
+    while (grblSerial.available()) readGrbl();
     this->state = GrblCommand;
     this->grblResponseHandler = handler;
-    this->grblResponseTimeout = millis() + timeout;    
+    this->grblResponseLineHandler = lineHandler;
+    this->grblCommandStartTime = millis();
+    this->grblResponseTimeout = this->grblCommandStartTime + timeout;    
     grblSerial.print(command);
     grblSerial.print("\r");
+    TRACE_RECORD_BYTES(TRACE_GRBL_TX, command.c_str(), command.length());
+    TRACE_RECORD_BYTE(TRACE_GRBL_TX, '\r');
     grblSerial.listen();
+    this->statistics.commandsSent++;
+    this->statistics.bytesSent += command.length() + 1;
+  }
+}
+
+bool Communication::isIdle() {
+  return (this->state == Idle);
+}
+
+bool Communication::startStreaming(StreamResponseHandler handler, ResponseLineHandler statusReportHandler) {
+  if (this->state != Idle) {
+    return false;
+  }
+  // clear the buffer
+  while (grblSerial.available()) readGrbl();
+  this->streamResponseHandler = handler;
+  this->streamStatusReportHandler = statusReportHandler;
+  this->streamQueueStart = 0;
+  this->streamQueueCount = 0;
+  this->streamPendingBytes = 0;
+  this->grblResponseBufferPosition = 0;
+  this->state = GrblStream;
+  return true;
+}
+
+bool Communication::canStreamLine(uint8_t length) {
+  // the line terminator occupies another byte in the receive buffer
+  return (this->state == GrblStream) && 
+         (this->streamQueueCount < COMMUNICATION_STREAM_QUEUE_SIZE) &&
+         (this->streamPendingBytes + length + 1 < COMMUNICATION_GRBL_RX_BUFFER_SIZE);
+}
+
+void Communication::streamLine(const char * line, uint8_t length) {
+  uint8_t position = (this->streamQueueStart + this->streamQueueCount) % COMMUNICATION_STREAM_QUEUE_SIZE;
+  this->streamLineLengths[position] = length + 1;
+  this->streamLineTimes[position] = millis();
+  this->streamQueueCount++;
+  this->streamPendingBytes += length + 1;
+  grblSerial.write((const uint8_t *) line, length);
+  grblSerial.write('\n');
+  TRACE_RECORD_BYTES(TRACE_GRBL_TX, line, length);
+  TRACE_RECORD_BYTE(TRACE_GRBL_TX, '\n');
+  this->statistics.commandsSent++;
+  this->statistics.bytesSent += length + 1;
+}
+
+bool Communication::startPassthrough() {
+  if (this->state != Idle) {
+    return false;
+  }
+  this->passthroughLineOpen = false;
+  this->hostCommandSkipLineFeed = false;
+  this->state = Passthrough;
+  return true;
+}
+
+bool Communication::isPassthrough() {
+  return (this->state == Passthrough);
+}
+
+bool Communication::hasPendingInput() {
+  return (Serial.available() > 0) || (this->grblSerial.available() > 0);
+}
+
+bool Communication::canSendToHost() {
+  return (this->state != Passthrough) || !this->passthroughLineOpen;
+}
+
+void Communication::stopPassthrough() {
+  if (this->state == Passthrough) {
+    // a command that is still waiting for the end of a Grbl line is discarded
+    this->hostCommandBufferPosition = 0;
+    this->hostCommandEscaped = false;
+    this->hostCommandPending = false;
+    this->state = Idle;
+  }
+}
+
+void Communication::requestStatusReport() {
+  // while a command is processed, the status report is skipped (see loopGrblCommand())
+  if (this->state != Passthrough) {
+    grblSerial.write('?');
+    TRACE_RECORD_BYTE(TRACE_GRBL_TX, '?');
+    this->statistics.bytesSent++;
+  }
+}
+
+void Communication::sendRealtimeCommand(uint8_t command) {
+  grblSerial.write(command);
+  TRACE_RECORD_BYTE(TRACE_GRBL_TX, command);
+  this->statistics.bytesSent++;
+}
+
+uint8_t Communication::getPendingLines() {
+  return this->streamQueueCount;
+}
+
+uint8_t Communication::getPendingBytes() {
+  return this->streamPendingBytes;
+}
+
+void Communication::stopStreaming() {
+  if (this->state == GrblStream) {
+    memset(this->grblResponseBuffer, '\0', COMMUNICATION_GRBL_RESPONSE_BUFFER_SIZE + 1);
+    this->grblResponseBufferPosition = 0;
+    this->streamResponseHandler = 0;
+    this->streamStatusReportHandler = 0;
+    this->streamQueueCount = 0;
+    this->streamPendingBytes = 0;
+    this->state = Idle;
+  }
+}
+
+StatusSniffer & Communication::getSniffer() {
+  return this->sniffer;
+}
+
+const Communication::Statistics & Communication::getStatistics() {
+  return this->statistics;
+}
+
+uint16_t Communication::getAverageLatency() {
+  uint32_t responses = this->statistics.okCount + this->statistics.errorCount;
+  if (responses == 0) {
+    return 0;
+  }
+  return this->statistics.latencySum / responses;
+}
+
+uint16_t Communication::getLatencyBucketLimit(uint8_t bucket) {
+  if (bucket >= COMMUNICATION_LATENCY_BUCKETS - 1) {
+    return 0;
   }
+  return pgm_read_word(&Communication_LatencyBucketLimits[bucket]);
+}
+
+void Communication::resetStatistics() {
+  memset(&this->statistics, 0, sizeof(Statistics));
 }
 
 void Communication::loopGrblCommand() {
@@ -67,19 +240,34 @@ void Communication::loopGrblCommand() {
 
   // handle serial communication if we have incoming data
   if (grblSerial.available()) {
-    // check whether the next byte would make the buffer overflow
-    if (this->grblResponseBufferPosition >= COMMUNICATION_GRBL_RESPONSE_BUFFER_SIZE - 1) {
-      // yes it would - signal the overflow to the listener and clean up
+    if (this->grblResponseSkipLine) {
+      // status reports are push messages that do not belong to the response of the command
+      // (for example if the command was "?") - skip everything up to the end of the line
+      char nextChar = readGrbl();
+      if ((nextChar == '\r') || (nextChar == '\n')) {
+        this->grblResponseSkipLine = false;
+      }
+    } else if ((grblSerial.peek() == '<') &&
+               (this->grblResponseBufferPosition == this->grblResponseLineStart)) {
+      // start of a status report
+      readGrbl();
+      this->grblResponseSkipLine = true;
+    } else if (this->grblResponseBufferPosition >= COMMUNICATION_GRBL_RESPONSE_BUFFER_SIZE - 1) {
+      // the next byte would make the buffer overflow - signal the overflow to the listener and clean up
+      this->statistics.overflowCount++;
       this->grblResponseHandler(COMMUNICATION_STATUS_BUFFER_OVERFLOW, this->grblResponseBuffer);
       cleanup = true;
     } else {
       // store the next byte read      
-      char nextChar = grblSerial.read();
+      char nextChar = readGrbl();
+      uint8_t nextPosition = this->grblResponseBufferPosition + 1;
       this->grblResponseBuffer[this->grblResponseBufferPosition] = nextChar;
       if ((nextChar == '\r') || (nextChar == '\n')) {
         // check whether the line that was just completed was an 'ok' or an 'error:X' response line
         if ((this->grblResponseBuffer[this->grblResponseLineStart]     == 'o') &&
             (this->grblResponseBuffer[this->grblResponseLineStart + 1] == 'k')) {
+          this->statistics.okCount++;
+          recordLatency(millis() - this->grblCommandStartTime);
           this->grblResponseHandler(COMMUNICATION_STATUS_OK, this->grblResponseBuffer);
           cleanup = true;
         } else if ((this->grblResponseBuffer[this->grblResponseLineStart]     == 'e') &&
@@ -89,32 +277,212 @@ void Communication::loopGrblCommand() {
                    (this->grblResponseBuffer[this->grblResponseLineStart + 4] == 'r') && 
                    (this->grblResponseBuffer[this->grblResponseLineStart + 5] == ':')) {
           int errorCode = atoi(&this->grblResponseBuffer[this->grblResponseLineStart + 6]);            
+          this->statistics.errorCount++;
+          recordLatency(millis() - this->grblCommandStartTime);
           this->grblResponseHandler(errorCode, this->grblResponseBuffer);
           cleanup = true;
+        } else if (this->grblResponseLineHandler != 0) {
+          // hand the line over (unless it is empty) and reuse the buffer space for the next line
+          this->grblResponseBuffer[this->grblResponseBufferPosition] = '\0';
+          if (this->grblResponseBufferPosition > this->grblResponseLineStart) {
+            this->grblResponseLineHandler(&this->grblResponseBuffer[this->grblResponseLineStart]);
+          }
+          nextPosition = this->grblResponseLineStart;
         } else {
           // none of the above: new line starts with the next character after the current one
           this->grblResponseLineStart = this->grblResponseBufferPosition + 1;
         }
       } 
-      this->grblResponseBufferPosition++;
+      this->grblResponseBufferPosition = nextPosition;
     }
   }
 
   // check for a timeout
   if (!cleanup && (millis() > this->grblResponseTimeout)) {
+    this->statistics.timeoutCount++;
     this->grblResponseHandler(COMMUNICATION_STATUS_TIMEOUT, this->grblResponseBuffer);
     cleanup = true;   
   }
   
   if (cleanup) {
     // swallow all of the remaining buffer contents
-    while (grblSerial.available()) grblSerial.read();
+    while (grblSerial.available()) readGrbl();
     memset(this->grblResponseBuffer, '\0', COMMUNICATION_GRBL_RESPONSE_BUFFER_SIZE + 1);
     this->grblResponseBufferPosition = 0;
     this->grblResponseLineStart = 0;
+    this->grblResponseSkipLine = false;
     this->grblResponseHandler = 0;
+    this->grblResponseLineHandler = 0;
     this->grblResponseTimeout = 0;
     this->state = Idle;
   } 
 }
 
+void Communication::loopGrblStream() {
+  while (grblSerial.available()) {
+    char nextChar = readGrbl();
+    if ((nextChar == '\r') || (nextChar == '\n')) {
+      if (this->grblResponseBufferPosition > 0) {
+        this->grblResponseBuffer[this->grblResponseBufferPosition] = '\0';
+        handleStreamResponse();
+        this->grblResponseBufferPosition = 0;
+      }
+    } else if (this->grblResponseBufferPosition < COMMUNICATION_GRBL_RESPONSE_BUFFER_SIZE) {
+      this->grblResponseBuffer[this->grblResponseBufferPosition] = nextChar;
+      this->grblResponseBufferPosition++;
+    }
+    // the rest of overly long lines is dropped - only the start of the line is evaluated
+  }
+}
+
+void Communication::handleStreamResponse() {
+  int status;
+  if (strcmp_P(this->grblResponseBuffer, PSTR("ok")) == 0) {
+    status = COMMUNICATION_STATUS_OK;
+  } else if (strncmp_P(this->grblResponseBuffer, PSTR("error:"), 6) == 0) {
+    status = atoi(&this->grblResponseBuffer[6]);
+  } else {
+    // push messages are ignored, except for the status reports if requested
+    if ((this->grblResponseBuffer[0] == '<') && (this->streamStatusReportHandler != 0)) {
+      this->streamStatusReportHandler(this->grblResponseBuffer);
+    }
+    return;
+  }
+  if (this->streamQueueCount == 0) {
+    // response to a line sent before streaming started - nothing to acknowledge
+    return;
+  }
+  if (status == COMMUNICATION_STATUS_OK) {
+    this->statistics.okCount++;
+  } else {
+    this->statistics.errorCount++;
+  }
+
+  // remove the line from the queue
+  uint16_t sendTime = this->streamLineTimes[this->streamQueueStart];
+  recordLatency((uint16_t) ((uint16_t) millis() - sendTime));
+  this->streamPendingBytes -= this->streamLineLengths[this->streamQueueStart];
+  this->streamQueueStart = (this->streamQueueStart + 1) % COMMUNICATION_STREAM_QUEUE_SIZE;
+  this->streamQueueCount--;
+  this->streamResponseHandler(status);
+}
+
+void Communication::loopPassthrough() {
+  // a command addressed to Mrkt is kept until it has been executed so that the host data 
+  // following it is not forwarded ahead of it
+  while (!this->hostCommandPending && Serial.available()) {
+    char nextChar = Serial.read();
+    TRACE_RECORD_BYTE(TRACE_HOST_RX, nextChar);
+    if (this->hostCommandSkipLineFeed) {
+      // the rest of the line ending of the last command would reach Grbl as an empty line,
+      // and the extra ok would confuse the character counting of the sender
+      this->hostCommandSkipLineFeed = false;
+      if (nextChar == '\n') {
+        continue;
+      }
+    }
+    if (this->hostCommandEscaped || (nextChar == (char) HOST_CHANNEL_ESCAPE)) {
+      this->hostCommandPending = receiveHostCommand(nextChar);
+    } else {
+      grblSerial.write(nextChar);
+      TRACE_RECORD_BYTE(TRACE_GRBL_TX, nextChar);
+      this->statistics.bytesSent++;
+    }
+  }
+  // the replies must not be mixed into a line of the Grbl output
+  if (this->hostCommandPending && !this->passthroughLineOpen) {
+    executeHostCommand();
+  }
+  // the data is forwarded as it is received - the sniffer only looks at it on the way
+  while (grblSerial.available()) {
+    char nextChar = readGrbl();
+    Serial.write(nextChar);
+    TRACE_RECORD_BYTE(TRACE_HOST_TX, nextChar);
+    this->passthroughLineOpen = (nextChar != '\n');
+    if (this->hostCommandPending && !this->passthroughLineOpen) {
+      executeHostCommand();
+    }
+  }
+}
+
+void Communication::loopHost() {
+#if SDCARD_AVAILABLE == 1
+  if (MrktUploader.isActive()) {
+    MrktUploader.loop();
+    return;
+  }
+#endif
+  while (Serial.available()) {
+    char nextChar = Serial.read();
+    TRACE_RECORD_BYTE(TRACE_HOST_RX, nextChar);
+    if (receiveHostCommand(nextChar)) {
+      executeHostCommand();
+#if SDCARD_AVAILABLE == 1
+      if (MrktUploader.isActive()) {
+        // the following data belongs to the file
+        return;
+      }
+#endif
+    }
+  }
+}
+
+bool Communication::receiveHostCommand(char nextChar) {
+  this->hostCommandSkipLineFeed = false;
+  if (nextChar == (char) HOST_CHANNEL_ESCAPE) {
+    // the escape character only marks the command, it is not part of it
+    this->hostCommandEscaped = true;
+  } else if ((nextChar == '\r') || (nextChar == '\n')) {
+    // end of line - hand over the command unless the line was empty
+    if (this->hostCommandBufferPosition > 0) {
+      this->hostCommandBuffer[this->hostCommandBufferPosition] = '\0';
+      this->hostCommandSkipLineFeed = this->hostCommandEscaped && (nextChar == '\r');
+      return true;
+    }
+    this->hostCommandEscaped = false;
+  } else if (this->hostCommandBufferPosition < COMMUNICATION_HOST_COMMAND_BUFFER_SIZE) {
+    this->hostCommandBuffer[this->hostCommandBufferPosition] = nextChar;
+    this->hostCommandBufferPosition++;
+  }
+  // characters beyond the buffer size are dropped silently - the command will be 
+  // rejected by the interpreter anyway
+  return false;
+}
+
+void Communication::executeHostCommand() {
+  MrktHostChannel.setEscaped(this->hostCommandEscaped);
+  MrktHostCommands.execute(this->hostCommandBuffer);
+  MrktHostChannel.setEscaped(false);
+  this->hostCommandBufferPosition = 0;
+  this->hostCommandEscaped = false;
+  this->hostCommandPending = false;
+}
+
+char Communication::readGrbl() {
+  char nextChar = grblSerial.read();
+  TRACE_RECORD_BYTE(TRACE_GRBL_RX, nextChar);
+  this->statistics.bytesReceived++;
+  this->sniffer.process(nextChar);
+  return nextChar;
+}
+
+void Communication::recordLatency(uint32_t latency) {
+  if (latency > 0xFFFF) {
+    latency = 0xFFFF;
+  }
+  // the response counter has already been incremented - the first response always sets the minimum
+  if ((this->statistics.okCount + this->statistics.errorCount == 1) || (latency < this->statistics.latencyMin)) {
+    this->statistics.latencyMin = latency;
+  }
+  if (latency > this->statistics.latencyMax) {
+    this->statistics.latencyMax = latency;
+  }
+  this->statistics.latencySum += latency;
+
+  // find the histogram bucket - the last one is used if no limit matches
+  uint8_t bucket = 0;
+  while ((bucket < COMMUNICATION_LATENCY_BUCKETS - 1) && (latency >= getLatencyBucketLimit(bucket))) {
+    bucket++;
+  }
+  this->statistics.latencyHistogram[bucket]++;
+}
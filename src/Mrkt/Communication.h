@@ -21,13 +21,18 @@
 #include <SoftwareSerial.h> // see https://www.arduino.cc/en/Reference/SoftwareSerial
 
 #include "Configuration.h"
+#include "StatusSniffer.h"
 
 /**
  * The size of the buffer to store responses to Grbl commands. At the moment, it 
- * is sized to hold the response to the $I command which contains the version 
- * information.
+ * is sized to hold the responses to the $I command which contains the version 
+ * information and the $G command which contains the parser state. Status reports
+ * are not stored in the buffer (see Communication::loopGrblCommand()) except while 
+ * streaming, where the buffer holds a single line - including the feed overrides at the 
+ * end of a typical status report. Longer
+ * responses have to be processed line by line (see Communication::sendGrblCommand()).
  */
-#define COMMUNICATION_GRBL_RESPONSE_BUFFER_SIZE  50
+#define COMMUNICATION_GRBL_RESPONSE_BUFFER_SIZE  96
 
 /**
  * The communication status reported to the callback methods can be 
@@ -39,6 +44,29 @@
 #define COMMUNICATION_STATUS_TIMEOUT         -1
 #define COMMUNICATION_STATUS_BUFFER_OVERFLOW -2
 
+/**
+ * The size of the serial receive buffer of the Grbl system. While streaming, the lines sent
+ * but not yet acknowledged must fit into this buffer (character-counting protocol).
+ */
+#define COMMUNICATION_GRBL_RX_BUFFER_SIZE       128
+
+/**
+ * The maximum number of lines that can be sent to the Grbl system without having been 
+ * acknowledged while streaming.
+ */
+#define COMMUNICATION_STREAM_QUEUE_SIZE          16
+
+/**
+ * The size of the buffer to store commands received from the host system.
+ */
+#define COMMUNICATION_HOST_COMMAND_BUFFER_SIZE   32
+
+/**
+ * The number of buckets of the round-trip latency histogram. The upper limits
+ * of the buckets are defined in Communication.cpp, the last bucket is open-ended.
+ */
+#define COMMUNICATION_LATENCY_BUCKETS             8
+
 /**
  * This class encapsulates the serial communication to both the host system and the 
  * Grbl installation.
@@ -51,6 +79,35 @@ class Communication {
      */
     typedef void (*CommandResponseHandler) (int status, char * response);
 
+    /**
+     * The signature of a handler for the individual lines of a response (see sendGrblCommand()).
+     */
+    typedef void (*ResponseLineHandler) (char * line);
+
+    /**
+     * The signature of a result handler for the lines sent using streamLine(). 
+     */
+    typedef void (*StreamResponseHandler) (int status);
+
+    /**
+     * The running statistics of the Grbl link. All values are collected since power-up
+     * or the last call to resetStatistics(). The latencies are given in ms and measured 
+     * from sending a command to receiving the final "ok" or "error" line.
+     */
+    struct Statistics {
+      uint32_t commandsSent;
+      uint32_t okCount;
+      uint32_t errorCount;
+      uint32_t timeoutCount;
+      uint32_t overflowCount;
+      uint32_t bytesSent;
+      uint32_t bytesReceived;
+      uint16_t latencyMin;
+      uint16_t latencyMax;
+      uint32_t latencySum;
+      uint32_t latencyHistogram[COMMUNICATION_LATENCY_BUCKETS];
+    };
+
     /**
      * The default constructor.
      */
@@ -64,14 +121,131 @@ class Communication {
     /**
      * Sends a command to the Grbl system and waits for a response that ends in an
      * "ok" or "error" message, which is then passed to a result handler method.
+     * If a line handler is given, every other line of the response is passed to the line 
+     * handler instead of being stored in the response buffer. This allows for responses that 
+     * exceed the buffer size, like the one to the $$ command.
+     */
+    void sendGrblCommand(String command, uint16_t timeout, CommandResponseHandler handler, 
+                         ResponseLineHandler lineHandler = 0);
+
+    /**
+     * Checks whether the communication system is idle, i.e. whether a new command can be
+     * sent to the Grbl system. 
+     */
+    bool isIdle();
+
+    /**
+     * Switches the communication system to streaming mode. While streaming, lines are sent
+     * without waiting for the response to the previous line as long as they fit into the 
+     * receive buffer of the Grbl system. The "ok" or "error" responses are passed to the handler
+     * in the order the lines were sent. Status reports are passed to the status report handler,
+     * if given. Returns false if the communication system is busy.
+     */
+    bool startStreaming(StreamResponseHandler handler, ResponseLineHandler statusReportHandler = 0);
+
+    /**
+     * Checks whether a line of the given length (without line terminator) can be sent now.
+     */
+    bool canStreamLine(uint8_t length);
+
+    /**
+     * Sends a line (without line terminator) while streaming. canStreamLine() has to be 
+     * checked before.
+     */
+    void streamLine(const char * line, uint8_t length);
+
+    /**
+     * Requests a status report unless the communication system is in passthrough mode. The 
+     * request is a realtime command that does not occupy the receive buffer of the Grbl 
+     * system. The report is evaluated by the status sniffer, and passed to the status report 
+     * handler while streaming.
+     */
+    void requestStatusReport();
+
+    /**
+     * Sends a realtime command (e.g. a feed override) to the Grbl system immediately, in any 
+     * state of the communication system. Realtime commands do not occupy the receive buffer
+     * of the Grbl system and are not acknowledged.
+     */
+    void sendRealtimeCommand(uint8_t command);
+
+    /**
+     * Returns the number of lines sent that have not been acknowledged yet.
+     */
+    uint8_t getPendingLines();
+
+    /**
+     * Returns the number of bytes streamed that have not been acknowledged yet.
+     */
+    uint8_t getPendingBytes();
+
+    /**
+     * Leaves the streaming mode. Responses to lines that are still pending are discarded.
+     */
+    void stopStreaming();
+
+    /**
+     * Switches the communication system to passthrough mode. All data received from the host 
+     * system is forwarded to the Grbl system and vice versa, without any buffering. Host commands
+     * can still be sent in the escaped form (see HostChannel); they are executed between two
+     * lines of the Grbl output. Returns false if the communication system is busy.
+     */
+    bool startPassthrough();
+
+    /**
+     * Checks whether the communication system is in passthrough mode.
+     */
+    bool isPassthrough();
+
+    /**
+     * Leaves the passthrough mode.
+     */
+    void stopPassthrough();
+
+    /**
+     * Checks whether data has been received from the host or the Grbl system that has not
+     * been processed yet.
+     */
+    bool hasPendingInput();
+
+    /**
+     * Checks whether Mrkt can send data of its own to the host system now, i.e. whether no
+     * line of the Grbl output is being forwarded in passthrough mode.
+     */
+    bool canSendToHost();
+
+    /**
+     * Provides access to the status sniffer that evaluates all data received from the Grbl
+     * system, in any state of the communication system.
+     */
+    StatusSniffer & getSniffer();
+
+    /**
+     * Provides access to the link statistics.
      */
-    void sendGrblCommand(String command, uint16_t timeout, CommandResponseHandler handler);
+    const Statistics & getStatistics();
+
+    /**
+     * Returns the average round-trip latency in ms, or 0 if no response has been received yet.
+     */
+    uint16_t getAverageLatency();
+
+    /**
+     * Returns the upper limit (exclusive, in ms) of a latency histogram bucket. The last 
+     * bucket has no upper limit, 0 is returned in this case.
+     */
+    static uint16_t getLatencyBucketLimit(uint8_t bucket);
+
+    /**
+     * Clears all link statistics.
+     */
+    void resetStatistics();
 
   private:
     /**
      * The representation of the state of the communication system.
      */
-    enum InternalState { Idle, GrblCommand };
+    enum InternalState { Idle, GrblCommand, GrblStream, Passthrough };
     InternalState state;
 
     /**
@@ -98,6 +272,11 @@ class Communication {
      */
     uint8_t grblResponseLineStart;
 
+    /**
+     * Set while the current line is a status report that is not stored in the buffer.
+     */
+    bool grblResponseSkipLine;
+
     /**
      * The timeout while waiting for a response.
      */
@@ -108,10 +287,122 @@ class Communication {
      */
     CommandResponseHandler grblResponseHandler;
 
+    /**
+     * The method to call for every line of the response (optional).
+     */
+    ResponseLineHandler grblResponseLineHandler;
+
+    /**
+     * The system time at which the current command was sent.
+     */
+    uint32_t grblCommandStartTime;
+
+    /**
+     * The method to call when a streamed line has been acknowledged.
+     */
+    StreamResponseHandler streamResponseHandler;
+
+    /**
+     * The method to call when a status report is received while streaming (optional).
+     */
+    ResponseLineHandler streamStatusReportHandler;
+
+    /**
+     * The lengths (including line terminator) and the send times (lower 16 bits of the 
+     * system time) of the lines that have been streamed but not yet acknowledged. The queue 
+     * is organized as a ring buffer.
+     */
+    uint8_t streamLineLengths[COMMUNICATION_STREAM_QUEUE_SIZE];
+    uint16_t streamLineTimes[COMMUNICATION_STREAM_QUEUE_SIZE];
+    uint8_t streamQueueStart;
+    uint8_t streamQueueCount;
+
+    /**
+     * The number of bytes that have been streamed but not yet acknowledged.
+     */
+    uint8_t streamPendingBytes;
+
+    /**
+     * The status sniffer that evaluates the data received from the Grbl system.
+     */
+    StatusSniffer sniffer;
+
+    /**
+     * Set while a line of the Grbl output has been forwarded partially in passthrough mode.
+     */
+    bool passthroughLineOpen;
+
+    /**
+     * The link statistics.
+     */
+    Statistics statistics;
+
+    /**
+     * The buffer to collect a command line received from the host system. As above, 
+     * the buffer is one char larger to always have a \0 character at the end.
+     */
+    char hostCommandBuffer[COMMUNICATION_HOST_COMMAND_BUFFER_SIZE + 1];
+
+    /**
+     * The position of the next char to write into the host command buffer.
+     */
+    uint8_t hostCommandBufferPosition;
+
+    /**
+     * Set if the command being received has been marked by the escape character (see 
+     * HostChannel), and set while a complete command is waiting to be executed in 
+     * passthrough mode.
+     */
+    bool hostCommandEscaped;
+    bool hostCommandPending;
+
+    /**
+     * Set if an escaped command has been terminated by \r, so that the \n of a CR LF line 
+     * ending is not forwarded to the Grbl system in passthrough mode as an empty line.
+     */
+    bool hostCommandSkipLineFeed;
+
     /**
      * The implementations called during the loop() processing for each internal state.
      */
     void loopGrblCommand();
+    void loopGrblStream();
+    void loopPassthrough();
+
+    /**
+     * Evaluates a complete response line received while streaming.
+     */
+    void handleStreamResponse();
+
+    /**
+     * Collects the commands received from the host system and hands them over to the
+     * host command interpreter. While a file is uploaded, the data is passed to the 
+     * Uploader instead.
+     */
+    void loopHost();
+
+    /**
+     * Adds a character received from the host system to the command buffer. Returns true
+     * if a complete command has been received.
+     */
+    bool receiveHostCommand(char nextChar);
+
+    /**
+     * Hands over the command received to the host command interpreter, with the replies 
+     * escaped if the command was.
+     */
+    void executeHostCommand();
+
+    /**
+     * Reads a byte from the Grbl connection, updates the statistics and passes the byte to
+     * the status sniffer.
+     */
+    char readGrbl();
+
+    /**
+     * Adds the round-trip time of a command to the latency statistics.
+     */
+    void recordLatency(uint32_t latency);
       
 };
 
@@ -23,6 +23,27 @@
 // Set this to 0 if you do not have a SD card reader installed. 
 #define SDCARD_AVAILABLE 1 // 1 = yes, 0 = no
 
+// Set this to 0 to send G-code files to Grbl as they are. By default, comments, 
+// whitespace, line numbers and unchanged modal words are removed and numbers are
+// shortened before the lines are sent (see GCodeMinifier.h).
+#define GCODE_MINIFIER_ENABLED 1 // 1 = yes, 0 = no
+
+// Set this to 1 to record the status reports, acknowledgements and errors of the jobs 
+// streamed from the SD card in the file MRKTLOG.DAT (see JobLog.h and tools/mrktlog.cpp).
+// The log requires a buffer of 512 bytes of RAM.
+#define JOB_LOG_ENABLED 0 // 1 = yes, 0 = no
+
+// Set this to 1 to record the bytes exchanged with the host and Grbl and the user control
+// events in the file MRKTTRC.DAT to examine and replay them (see Trace.h and
+// tools/mrkttrace.cpp). The trace requires a buffer of 512 bytes of RAM and can not be
+// enabled together with the job log.
+#define TRACE_ENABLED 0 // 1 = yes, 0 = no
+
+// Set this to 0 to keep the main loop running continuously. By default, the processor
+// sleeps whenever there is nothing to do until an interrupt (received data, the encoder
+// or the system timer) wakes it up, which saves power and heat (see IdleSleep.h).
+#define IDLE_SLEEP_ENABLED 1 // 1 = yes, 0 = no
+
 // The baud rates to use to connect to the host and the Grbl system. Note that 
 // it is hard to get a reliable connection using the Grbl default speed of 
 // 115.200 baud with an Arduino Uno - hence the lower default speed. 
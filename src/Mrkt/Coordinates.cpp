@@ -0,0 +1,174 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <string.h>
+#include <inttypes.h>
+
+#include "Coordinates.h"
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#else
+#define PROGMEM
+#define pgm_read_dword(address) (*(const uint32_t *) (address))
+#endif
+
+/**
+ * The powers of ten subtracted to determine the digits, starting with the highest digit of
+ * an uint32_t. The last digit is left over as the remainder.
+ */
+#define COORDINATES_POWERS  9
+const uint32_t Coordinates_Powers[COORDINATES_POWERS] PROGMEM = {
+  1000000000, 100000000, 10000000, 1000000, 100000, 10000, 1000, 100, 10
+};
+
+/**
+ * The values added to round a coordinate to fewer decimal places, indexed by the number of
+ * decimal places dropped.
+ */
+static const uint16_t Coordinates_Rounding[COORDINATES_DECIMALS + 1] = { 0, 5, 50, 500 };
+
+Coordinate Coordinates::parse(const char * text, const char ** end) {
+  bool negative = false;
+  if ((*text == '-') || (*text == '+')) {
+    negative = (*text == '-');
+    text++;
+  }
+  Coordinate value = 0;
+  while ((*text >= '0') && (*text <= '9')) {
+    value = value * 10 + (*text - '0');
+    text++;
+  }
+  uint8_t decimals = 0;
+  if (*text == '.') {
+    text++;
+    while ((*text >= '0') && (*text <= '9')) {
+      if (decimals < COORDINATES_DECIMALS) {
+        value = value * 10 + (*text - '0');
+      } else if ((decimals == COORDINATES_DECIMALS) && (*text >= '5')) {
+        // the first decimal place dropped rounds the value
+        value++;
+      }
+      if (decimals <= COORDINATES_DECIMALS) {
+        decimals++;
+      }
+      text++;
+    }
+  }
+  for (; decimals < COORDINATES_DECIMALS; decimals++) {
+    value *= 10;
+  }
+  if (end != 0) {
+    *end = text;
+  }
+  return negative ? -value : value;
+}
+
+uint8_t Coordinates::formatUnsigned(uint32_t value, char * digits) {
+  uint8_t length = 0;
+  for (uint8_t i = 0; i < COORDINATES_POWERS; i++) {
+    uint32_t power = pgm_read_dword(&Coordinates_Powers[i]);
+    char digit = '0';
+    while (value >= power) {
+      value -= power;
+      digit++;
+    }
+    // leading zeros are suppressed
+    if ((digit != '0') || (length > 0)) {
+      digits[length++] = digit;
+    }
+  }
+  digits[length++] = '0' + value;
+  digits[length] = '\0';
+  return length;
+}
+
+bool Coordinates::format(Coordinate value, uint8_t decimals, char * field, uint8_t width) {
+  if (decimals > COORDINATES_DECIMALS) {
+    decimals = COORDINATES_DECIMALS;
+  }
+  uint8_t dropped = COORDINATES_DECIMALS - decimals;
+  uint32_t magnitude = (value < 0) ? -(uint32_t) value : (uint32_t) value;
+  // round first, the decimal places dropped are simply cut off below
+  char digits[12];
+  uint8_t length = formatUnsigned(magnitude + Coordinates_Rounding[dropped], digits);
+  if (length <= COORDINATES_DECIMALS) {
+    // add leading zeros so that there is one digit before the decimal point
+    uint8_t shift = COORDINATES_DECIMALS + 1 - length;
+    memmove(digits + shift, digits, length + 1);
+    memset(digits, '0', shift);
+    length = COORDINATES_DECIMALS + 1;
+  }
+  length -= dropped;
+
+  bool negative = false;
+  if (value < 0) {
+    for (uint8_t i = 0; i < length; i++) {
+      if (digits[i] != '0') {
+        negative = true;
+        break;
+      }
+    }
+  }
+  uint8_t total = length + ((decimals > 0) ? 1 : 0) + (negative ? 1 : 0);
+  if (total > width) {
+    return false;
+  }
+
+  uint8_t position = width - total;
+  memset(field, ' ', position);
+  if (negative) {
+    field[position++] = '-';
+  }
+  for (uint8_t i = 0; i < length; i++) {
+    if ((decimals > 0) && (i == length - decimals)) {
+      field[position++] = '.';
+    }
+    field[position++] = digits[i];
+  }
+  return true;
+}
+
+uint8_t Coordinates::write(Coordinate value, char * text) {
+  uint8_t length = 0;
+  if (value < 0) {
+    text[length++] = '-';
+  }
+  char digits[12];
+  uint8_t count = formatUnsigned((value < 0) ? -(uint32_t) value : (uint32_t) value, digits);
+  if (count <= COORDINATES_DECIMALS) {
+    // add leading zeros so that there is one digit before the decimal point
+    uint8_t shift = COORDINATES_DECIMALS + 1 - count;
+    memmove(digits + shift, digits, count + 1);
+    memset(digits, '0', shift);
+    count = COORDINATES_DECIMALS + 1;
+  }
+  // trailing zeros are dropped, and the decimal point as well if no decimal place is left
+  uint8_t decimals = COORDINATES_DECIMALS;
+  while ((decimals > 0) && (digits[count - COORDINATES_DECIMALS + decimals - 1] == '0')) {
+    decimals--;
+  }
+  memcpy(text + length, digits, count - COORDINATES_DECIMALS);
+  length += count - COORDINATES_DECIMALS;
+  if (decimals > 0) {
+    text[length++] = '.';
+    memcpy(text + length, digits + count - COORDINATES_DECIMALS, decimals);
+    length += decimals;
+  }
+  text[length] = '\0';
+  return length;
+}
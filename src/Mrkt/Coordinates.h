@@ -0,0 +1,77 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_Coordinates_h
+#define MRKT_Coordinates_h
+
+#include <inttypes.h>
+
+/**
+ * The number of decimal places of a coordinate.
+ */
+#define COORDINATES_DECIMALS  3
+
+/**
+ * A position or length in fixed point with three decimal places, i.e. in µm if Grbl reports
+ * in mm (or in 1/1000 inch if it reports in inches). The range of ±2147 m is more than enough
+ * for any machine, and the values can be added and compared without any conversion.
+ */
+typedef int32_t Coordinate;
+
+/**
+ * This class provides the conversions of coordinates (and other numbers) from and to text.
+ * None of the methods uses floating point, and the formatting does not even divide: the
+ * digits are determined by subtracting powers of ten, which takes a few µs on the Arduino
+ * compared to the hundreds of µs of Print::print(double) or a division per digit in ultoa().
+ *
+ * The class does not depend on the Arduino libraries so that it can be used by the host tools.
+ */
+class Coordinates {
+
+  public:
+    /**
+     * Parses a number like "-12.5" or "500.000" starting at text. Decimal places beyond the
+     * third one are rounded. If end is given, it is set to the first character behind the
+     * number.
+     */
+    static Coordinate parse(const char * text, const char ** end = 0);
+
+    /**
+     * Writes the decimal digits of an unsigned value to the buffer given, which has to hold
+     * at least 11 characters. The digits are terminated with a \0; the number of digits is
+     * returned.
+     */
+    static uint8_t formatUnsigned(uint32_t value, char * digits);
+
+    /**
+     * Writes a coordinate right-aligned into a field of the width given, rounded to the
+     * number of decimal places given (0 to 3) and padded with blanks. The field is not
+     * terminated. Values that are rounded to zero are written without sign. Returns false
+     * (leaving the field unchanged) if the value does not fit into the field.
+     */
+    static bool format(Coordinate value, uint8_t decimals, char * field, uint8_t width);
+
+    /**
+     * Writes a coordinate in its shortest form as used in G-code (e.g. "-12.5" or "3") to the
+     * buffer given, which has to hold at least 13 characters. The text is terminated with a \0;
+     * its length is returned.
+     */
+    static uint8_t write(Coordinate value, char * text);
+
+};
+
+#endif
@@ -0,0 +1,167 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "Arduino.h"
+
+#include "Configuration.h"
+#include "DiagnosticsMode.h"
+
+#include "Communication.h"
+#include "Display.h"
+#include "ModeController.h"
+#include "UserControls.h"
+
+/**
+ * The interval in ms at which the displayed values are refreshed.
+ */
+#define DIAG_MODE_REFRESH_INTERVAL   500
+
+/**
+ * The list entries. The histogram buckets are the last entries of the list.
+ */
+#define DIAG_MODE_ITEM_SENT            0
+#define DIAG_MODE_ITEM_OK              1
+#define DIAG_MODE_ITEM_ERROR           2
+#define DIAG_MODE_ITEM_TIMEOUT         3
+#define DIAG_MODE_ITEM_OVERFLOW        4
+#define DIAG_MODE_ITEM_BYTES_SENT      5
+#define DIAG_MODE_ITEM_BYTES_RECEIVED  6
+#define DIAG_MODE_ITEM_LATENCY_MIN     7
+#define DIAG_MODE_ITEM_LATENCY_AVG     8
+#define DIAG_MODE_ITEM_LATENCY_MAX     9
+#define DIAG_MODE_ITEM_HISTOGRAM      10
+#define DIAG_MODE_ITEM_COUNT          (DIAG_MODE_ITEM_HISTOGRAM + COMMUNICATION_LATENCY_BUCKETS)
+
+/**
+ * The "singleton" instance of the DiagnosticsMode class.
+ */
+DiagnosticsMode MrktDiagnosticsMode;
+
+DiagnosticsMode::DiagnosticsMode() : 
+  AbstractMode() {
+}
+
+void DiagnosticsMode::activate() {
+  this->firstItem = 0;
+  this->lastRefreshTime = 0;
+  MrktUserControls.clearEvents();
+  MrktDisplay.clear();
+}
+
+void DiagnosticsMode::deactivate() {
+  MrktDisplay.clear();
+}
+
+void DiagnosticsMode::loop() {
+  uint32_t currentTime = millis();
+  if (handleEvents() || (currentTime - this->lastRefreshTime > DIAG_MODE_REFRESH_INTERVAL)) {
+    displayItem(this->firstItem,     0);
+    displayItem(this->firstItem + 1, 1);
+    this->lastRefreshTime = currentTime;
+  }
+}
+
+bool DiagnosticsMode::handleEvents() {
+  bool refresh = false;
+  while (MrktUserControls.isEventAvailable()) {
+    UserControls::Event event = MrktUserControls.getEvent();
+    int16_t newFirstItem = this->firstItem;
+    switch(event.type) {
+      case UserControls::KeyUp:
+        newFirstItem -= event.data;
+        break;
+      case UserControls::KeyDown:
+        newFirstItem += event.data;
+        break;
+      case UserControls::EncChanged:
+        newFirstItem += event.data;
+        break;
+      case UserControls::KeySelect:
+      case UserControls::EncButton:
+        MrktCommunication.resetStatistics();
+        refresh = true;
+        break;
+      case UserControls::KeyLeft:
+      case UserControls::ModeButton:
+        MrktModeController.switchToPreviousMode();
+        break;
+      default:
+        // ignore all other events
+        break;
+    }
+    // keep the second line inside the list
+    newFirstItem = constrain(newFirstItem, 0, DIAG_MODE_ITEM_COUNT - 2);
+    if (newFirstItem != this->firstItem) {
+      this->firstItem = newFirstItem;
+      refresh = true;
+    }
+  }
+  return refresh;
+}
+
+void DiagnosticsMode::displayItem(uint8_t item, uint8_t row) {
+  // print the label - the labels are stored in the order of the items (see Strings.txt),
+  // the histogram labels are assembled from the bucket limits
+  MrktDisplay.setCursor(0, row);
+  uint8_t length;
+  if (item < DIAG_MODE_ITEM_HISTOGRAM) {
+    length = MrktDisplay.writeString(STRING_DIAG_SENT + item);
+  } else {
+    uint16_t limit = Communication::getLatencyBucketLimit(item - DIAG_MODE_ITEM_HISTOGRAM);
+    if (limit > 0) {
+      length = MrktDisplay.writeString(STRING_DIAG_LAT_BELOW);
+      length += MrktDisplay.writeNumber(limit);
+    } else {
+      length = MrktDisplay.writeString(STRING_DIAG_LAT_ABOVE);
+      length += MrktDisplay.writeNumber(Communication::getLatencyBucketLimit(item - DIAG_MODE_ITEM_HISTOGRAM - 1));
+    }
+  }
+
+  // print the value right-aligned, leaving at least one blank after the label
+  MrktDisplay.writeRightAligned(length + 1, row, getItemValue(item));
+}
+
+uint32_t DiagnosticsMode::getItemValue(uint8_t item) {
+  const Communication::Statistics & statistics = MrktCommunication.getStatistics();
+  switch(item) {
+    case DIAG_MODE_ITEM_SENT:
+      return statistics.commandsSent;
+    case DIAG_MODE_ITEM_OK:
+      return statistics.okCount;
+    case DIAG_MODE_ITEM_ERROR:
+      return statistics.errorCount;
+    case DIAG_MODE_ITEM_TIMEOUT:
+      return statistics.timeoutCount;
+    case DIAG_MODE_ITEM_OVERFLOW:
+      return statistics.overflowCount;
+    case DIAG_MODE_ITEM_BYTES_SENT:
+      return statistics.bytesSent;
+    case DIAG_MODE_ITEM_BYTES_RECEIVED:
+      return statistics.bytesReceived;
+    case DIAG_MODE_ITEM_LATENCY_MIN:
+      return statistics.latencyMin;
+    case DIAG_MODE_ITEM_LATENCY_AVG:
+      return MrktCommunication.getAverageLatency();
+    case DIAG_MODE_ITEM_LATENCY_MAX:
+      return statistics.latencyMax;
+    default:
+      return statistics.latencyHistogram[item - DIAG_MODE_ITEM_HISTOGRAM];
+  }
+}
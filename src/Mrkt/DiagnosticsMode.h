@@ -0,0 +1,89 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_DiagnosticsMode_h
+#define MRKT_DiagnosticsMode_h
+
+#include "Configuration.h"
+#include "AbstractMode.h"
+
+/**
+ * This class implements a diagnostics page that displays the statistics of the 
+ * Grbl link (see Communication::Statistics). It can be entered from any other mode
+ * using the key combination MODE + SELECT and returns to the previous mode when the 
+ * mode button or the left key is pressed.
+ * 
+ * The statistics are displayed as a list of values, two of which are visible at a time:
+ * 
+ *   ┌────────────────┐
+ *   │Sent     1234567│
+ *   │OK       1234560│
+ *   └────────────────┘
+ * 
+ * The list is scrolled using the up and down keys or the encoder wheel. The select key 
+ * or the encoder button clears the statistics.
+ */
+class DiagnosticsMode : public AbstractMode {
+  
+  public:
+    /**
+     * The default constructor.
+     */
+    DiagnosticsMode();
+
+    /**
+     * See AbstractMode for an explanation of these methods.
+     */
+    void activate();
+    void loop();
+    void deactivate();
+
+  private:
+    /**
+     * The index of the list entry displayed in the first line.
+     */
+    uint8_t firstItem;
+
+    /**
+     * The system time at which the display was last refreshed.
+     */
+    uint32_t lastRefreshTime;
+
+    /**
+     * Processes the pending user control events. Returns true if the display 
+     * has to be refreshed immediately.
+     */
+    bool handleEvents();
+
+    /**
+     * Displays the list entry with the given index in the given row.
+     */
+    void displayItem(uint8_t item, uint8_t row);
+
+    /**
+     * Returns the value of the list entry with the given index.
+     */
+    uint32_t getItemValue(uint8_t item);
+
+};
+
+/**
+ * Access to the "singleton" instance of the DiagnosticsMode class.
+ */
+extern DiagnosticsMode MrktDiagnosticsMode;
+
+#endif
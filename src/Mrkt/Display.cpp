@@ -23,54 +23,45 @@
 #include "Configuration.h"
 #include "Display.h"
 
-/** 
- * The numbers of the custom characters. 
+/**
+ * A glyph: the bit patterns of the eight pixel rows, and a character of the LCD character set
+ * to display instead if no slot is available. For symbol generation, see 
+ * https://omerk.github.io/lcdchargen/
  */
-#define DISPLAY_CH_FEEDRATE  0 // FR
-#define DISPLAY_CH_PLUSMINUS 1 // +-
-#define DISPLAY_CH_ELLIPSIS  3 // ...
+struct DisplayGlyph {
+  byte rows[8];
+  char fallback;
+};
 
 /**
- * The size of the LCD panel. Note that if you use anything else than a 
- * 1602 panel, you will have to adapt a lot of code...
+ * The glyphs, in the order of the DISPLAY_GLYPH_* constants. 
  */
-#define DISPLAY_LCD_LINES        2
-#define DISPLAY_LCD_COLUMNS     16
+const DisplayGlyph Display_Glyphs[DISPLAY_GLYPH_COUNT] PROGMEM = {
+  // DISPLAY_GLYPH_FEEDRATE
+  { { 0b11100, 0b10000, 0b11000, 0b10110, 0b10101, 0b00110, 0b00101, 0b00101 }, 'F' },
+  // DISPLAY_GLYPH_PLUSMINUS
+  { { 0b00100, 0b00100, 0b11111, 0b00100, 0b00100, 0b00000, 0b11111, 0b00000 }, '+' },
+  // DISPLAY_GLYPH_ELLIPSIS
+  { { 0b00000, 0b00000, 0b00000, 0b00000, 0b00000, 0b00000, 0b10101, 0b00000 }, '.' },
+  // DISPLAY_GLYPH_BAR_1 to DISPLAY_GLYPH_BAR_4
+  { { 0b10000, 0b10000, 0b10000, 0b10000, 0b10000, 0b10000, 0b10000, 0b10000 }, ' ' },
+  { { 0b11000, 0b11000, 0b11000, 0b11000, 0b11000, 0b11000, 0b11000, 0b11000 }, ' ' },
+  { { 0b11100, 0b11100, 0b11100, 0b11100, 0b11100, 0b11100, 0b11100, 0b11100 }, ' ' },
+  { { 0b11110, 0b11110, 0b11110, 0b11110, 0b11110, 0b11110, 0b11110, 0b11110 }, ' ' },
+  // DISPLAY_GLYPH_SPINDLE
+  { { 0b00000, 0b01110, 0b10001, 0b10101, 0b10001, 0b01110, 0b00000, 0b00000 }, 'S' },
+  // DISPLAY_GLYPH_RUN
+  { { 0b01000, 0b01100, 0b01110, 0b01111, 0b01110, 0b01100, 0b01000, 0b00000 }, '>' },
+  // DISPLAY_GLYPH_HOLD
+  { { 0b00000, 0b11011, 0b11011, 0b11011, 0b11011, 0b11011, 0b00000, 0b00000 }, '|' },
+  // DISPLAY_GLYPH_ALARM
+  { { 0b00100, 0b01110, 0b01110, 0b01110, 0b11111, 0b00000, 0b00100, 0b00000 }, '!' }
+};
 
 /**
- * The bit patterns of the custom characters. For symbol generation, 
- * see https://omerk.github.io/lcdchargen/
+ * The character of the LCD character set that is completely filled (used for the progress bar).
  */
-const byte Display_CustomCharFR[8] PROGMEM = {
-  0b11100,
-  0b10000,
-  0b11000,
-  0b10110,
-  0b10101,
-  0b00110,
-  0b00101,
-  0b00101
-};  
-const byte Display_CustomCharPM[8] PROGMEM= {
-  0b00100,
-  0b00100,
-  0b11111,
-  0b00100,
-  0b00100,
-  0b00000,
-  0b11111,
-  0b00000
-}; 
-const byte Display_CustomCharE[8] PROGMEM = {
-  0b00000,
-  0b00000,
-  0b00000,
-  0b00000,
-  0b00000,
-  0b00000,
-  0b10101,
-  0b00000
-}; 
+#define DISPLAY_CH_FULL_BLOCK 0xFF
 
 /**
  * The "singleton" instance of the Display class.
@@ -78,23 +69,75 @@ const byte Display_CustomCharE[8] PROGMEM = {
 Display MrktDisplay;
 
 Display::Display() : LiquidCrystal(LCD_RS, LCD_EN, LCD_DB4, LCD_DB5, LCD_DB6, LCD_DB7) {
-  // setup the custom characters
-  createChar(DISPLAY_CH_FEEDRATE,  (uint8_t*)Display_CustomCharFR); // feedrate symbol
-  createChar(DISPLAY_CH_PLUSMINUS, (uint8_t*)Display_CustomCharPM); // plus-minus symbol
-  createChar(DISPLAY_CH_ELLIPSIS,  (uint8_t*)Display_CustomCharE);  // ellipsis (three dots)
+  // the glyphs are uploaded on demand
+  resetSlots();
   
   // setup the backlight and main mode LED 
   pinMode(MAIN_LED, OUTPUT); 
   pinMode(LCD_BL, OUTPUT);
   digitalWrite(LCD_BL, HIGH);  
+  this->backlight = DISPLAY_BACKLIGHT_LEVELS;
 };
 
 void Display::begin() {
   LiquidCrystal::begin(DISPLAY_LCD_LINES, DISPLAY_LCD_COLUMNS);
+  resetSlots();
+  this->cursorCol = 0;
+  this->cursorRow = 0;
+}
+
+void Display::clear() {
+  LiquidCrystal::clear();
+  for (uint8_t slot = 0; slot < DISPLAY_CGRAM_SLOTS; slot++) {
+    this->slotCells[slot] = 0;
+  }
+  this->cursorCol = 0;
+  this->cursorRow = 0;
+}
+
+void Display::home() {
+  LiquidCrystal::home();
+  this->cursorCol = 0;
+  this->cursorRow = 0;
+}
+
+void Display::setCursor(uint8_t col, uint8_t row) {
+  LiquidCrystal::setCursor(col, row);
+  this->cursorCol = col;
+  this->cursorRow = row;
+}
+
+size_t Display::write(uint8_t value) {
+  if ((this->cursorCol < DISPLAY_LCD_COLUMNS) && (this->cursorRow < DISPLAY_LCD_LINES)) {
+    uint32_t cell = (uint32_t) 1 << (this->cursorRow * DISPLAY_LCD_COLUMNS + this->cursorCol);
+    for (uint8_t slot = 0; slot < DISPLAY_CGRAM_SLOTS; slot++) {
+      this->slotCells[slot] &= ~cell;
+    }
+    // the character codes 8 to 15 show the custom characters as well
+    if (value < 2 * DISPLAY_CGRAM_SLOTS) {
+      this->slotCells[value % DISPLAY_CGRAM_SLOTS] |= cell;
+    }
+  }
+  this->cursorCol++;
+  return LiquidCrystal::write(value);
+}
+
+void Display::writeGlyph(uint8_t glyph) {
+  int8_t slot = getSlot(glyph);
+  if (slot < 0) {
+    write(pgm_read_byte(&Display_Glyphs[glyph].fallback));
+  } else {
+    write((uint8_t) slot);
+  }
+}
+
+void Display::writeGlyph(uint8_t col, uint8_t row, uint8_t glyph) {
+  setCursor(col, row);
+  writeGlyph(glyph);
 }
 
 void Display::writeFeedrate() {
-  write(byte(DISPLAY_CH_FEEDRATE));
+  writeGlyph(DISPLAY_GLYPH_FEEDRATE);
 }
 
 void Display::writeFeedrate(uint8_t col, uint8_t row) {
@@ -103,7 +146,7 @@ void Display::writeFeedrate(uint8_t col, uint8_t row) {
 }
 
 void Display::writePlusMinus() {
-  write(byte(DISPLAY_CH_PLUSMINUS));  
+  writeGlyph(DISPLAY_GLYPH_PLUSMINUS);
 }
 
 void Display::writePlusMinus(uint8_t col, uint8_t row) {
@@ -112,7 +155,7 @@ void Display::writePlusMinus(uint8_t col, uint8_t row) {
 }
 
 void Display::writeEllipsis() {
-  write(byte(DISPLAY_CH_ELLIPSIS));  
+  writeGlyph(DISPLAY_GLYPH_ELLIPSIS);
 }
 
 void Display::writeEllipsis(uint8_t col, uint8_t row) {
@@ -120,7 +163,213 @@ void Display::writeEllipsis(uint8_t col, uint8_t row) {
   writeEllipsis();
 }
 
+void Display::writeRightAligned(uint8_t col, uint8_t row, uint32_t value, uint8_t decimals) {
+  char digits[12];
+  uint8_t length = Coordinates::formatUnsigned(value, digits);
+  if ((decimals > 0) && (length <= decimals)) {
+    // add leading zeros so that there is one digit before the decimal point
+    uint8_t shift = decimals + 1 - length;
+    memmove(digits + shift, digits, length + 1);
+    memset(digits, '0', shift);
+    length = decimals + 1;
+  }
+
+  // the decimal point or the suffix take up one more character
+  uint8_t width = (decimals > 0) ? length + 1 : length;
+  char suffix = '\0';
+  if (width > DISPLAY_LCD_COLUMNS - col) {
+    // drop the fractional part and switch to thousands
+    length = Coordinates::formatUnsigned(value / 1000, digits);
+    decimals = 0;
+    width = length + 1;
+    suffix = 'k';
+  }
+
+  setCursor(col, row);
+  for (uint8_t i = col + width; i < DISPLAY_LCD_COLUMNS; i++) {
+    write(' ');
+  }
+  for (uint8_t i = 0; i < length; i++) {
+    if ((decimals > 0) && (i == length - decimals)) {
+      write('.');
+    }
+    write(digits[i]);
+  }
+  if (suffix != '\0') {
+    write(suffix);
+  }
+}
+
+void Display::writeTime(uint8_t col, uint8_t row, uint32_t seconds) {
+  uint32_t hours = seconds / 3600;
+  uint8_t minutes = (seconds / 60) % 60;
+  char digits[12];
+  uint8_t length = 0;
+  if (hours > 0) {
+    length = Coordinates::formatUnsigned(hours, digits);
+    digits[length++] = ':';
+    digits[length++] = '0' + minutes / 10;
+  } else if (minutes >= 10) {
+    digits[length++] = '0' + minutes / 10;
+  }
+  digits[length++] = '0' + minutes % 10;
+  digits[length++] = ':';
+  digits[length++] = '0' + (seconds % 60) / 10;
+  digits[length++] = '0' + seconds % 10;
+
+  setCursor(col, row);
+  for (uint8_t i = col + length; i < DISPLAY_LCD_COLUMNS; i++) {
+    write(' ');
+  }
+  for (uint8_t i = 0; i < length; i++) {
+    write(digits[i]);
+  }
+}
+
+void Display::writePercent(uint8_t col, uint8_t row, uint8_t value) {
+  uint8_t width = (value >= 100) ? 4 : ((value >= 10) ? 3 : 2);
+  setCursor(col, row);
+  for (uint8_t i = col + width; i < DISPLAY_LCD_COLUMNS; i++) {
+    write(' ');
+  }
+  writeNumber(value);
+  write('%');
+}
+
+void Display::writeCoordinate(uint8_t col, uint8_t row, uint8_t width, Coordinate value) {
+  char field[DISPLAY_LCD_COLUMNS];
+  if (width > DISPLAY_LCD_COLUMNS) {
+    width = DISPLAY_LCD_COLUMNS;
+  }
+  uint8_t decimals = 3;
+  bool fits;
+  do {
+    decimals--;
+    fits = Coordinates::format(value, decimals, field, width);
+  } while (!fits && (decimals > 0));
+  if (!fits) {
+    memset(field, '#', width);
+  }
+
+  setCursor(col, row);
+  for (uint8_t i = 0; i < width; i++) {
+    write(field[i]);
+  }
+}
+
+uint8_t Display::writeString(uint8_t string, uint8_t width) {
+  // the texts are stored one after the other - skip the ones between the anchor and the text
+  const uint8_t * text = StringTable_Data + pgm_read_word(&StringTable_Anchors[string / STRING_TABLE_ANCHOR_INTERVAL]);
+  for (uint8_t skip = string % STRING_TABLE_ANCHOR_INTERVAL; skip > 0; skip--) {
+    while (pgm_read_byte(text++) != 0);
+  }
+  uint8_t length = 0;
+  uint8_t code;
+  while ((code = pgm_read_byte(text++)) != 0) {
+    if (code < STRING_TABLE_FIRST_WORD) {
+      write(code);
+      length++;
+      continue;
+    }
+    // the last character of a word has the highest bit set - skip the words before it
+    const uint8_t * word = StringTable_Words;
+    for (uint8_t skip = code - STRING_TABLE_FIRST_WORD; skip > 0; skip--) {
+      while ((pgm_read_byte(word++) & 0x80) == 0);
+    }
+    uint8_t character;
+    do {
+      character = pgm_read_byte(word++);
+      write(character & 0x7F);
+      length++;
+    } while ((character & 0x80) == 0);
+  }
+  for (; length < width; length++) {
+    write(' ');
+  }
+  return length;
+}
+
+uint8_t Display::writeNumber(int32_t value) {
+  char digits[12];
+  uint8_t length = 0;
+  if (value < 0) {
+    write('-');
+    length++;
+  }
+  length += Coordinates::formatUnsigned((value < 0) ? -(uint32_t) value : (uint32_t) value, digits);
+  write(digits);
+  return length;
+}
+
+void Display::writeProgressBar(uint8_t col, uint8_t row, uint8_t width, uint8_t percent) {
+  if (percent > 100) {
+    percent = 100;
+  }
+  // five pixel columns per cell
+  uint16_t filled = ((uint16_t) width * 5 * percent) / 100;
+  setCursor(col, row);
+  for (uint8_t i = 0; i < width; i++) {
+    if (filled >= 5) {
+      write(DISPLAY_CH_FULL_BLOCK);
+      filled -= 5;
+    } else if (filled > 0) {
+      writeGlyph(DISPLAY_GLYPH_BAR_1 + filled - 1);
+      filled = 0;
+    } else {
+      write(' ');
+    }
+  }
+}
+
+void Display::setBacklight(uint8_t level) {
+  this->backlight = min(level, DISPLAY_BACKLIGHT_LEVELS);
+  analogWrite(LCD_BL, (uint16_t) this->backlight * 255 / DISPLAY_BACKLIGHT_LEVELS);
+}
+
+uint8_t Display::getBacklight() {
+  return this->backlight;
+}
+
 void Display::setMainLED(uint8_t level) {
   digitalWrite(MAIN_LED, level);
 }
 
+void Display::resetSlots() {
+  for (uint8_t slot = 0; slot < DISPLAY_CGRAM_SLOTS; slot++) {
+    this->slotGlyphs[slot] = DISPLAY_GLYPH_COUNT;
+    this->slotCells[slot] = 0;
+    this->slotOrder[slot] = slot;
+  }
+}
+
+int8_t Display::getSlot(uint8_t glyph) {
+  // find the glyph or the least recently used slot that is not visible
+  int8_t index = -1;
+  for (uint8_t i = 0; i < DISPLAY_CGRAM_SLOTS; i++) {
+    uint8_t slot = this->slotOrder[i];
+    if (this->slotGlyphs[slot] == glyph) {
+      index = i;
+      break;
+    }
+    if (this->slotCells[slot] == 0) {
+      index = i;
+    }
+  }
+  if (index < 0) {
+    return -1;
+  }
+  uint8_t slot = this->slotOrder[index];
+  if (this->slotGlyphs[slot] != glyph) {
+    byte rows[8];
+    memcpy_P(rows, Display_Glyphs[glyph].rows, sizeof(rows));
+    createChar(slot, rows);
+    this->slotGlyphs[slot] = glyph;
+    // uploading the glyph has moved the address counter to the character generator RAM
+    LiquidCrystal::setCursor(this->cursorCol, this->cursorRow);
+  }
+  // move the slot to the front of the list
+  memmove(&this->slotOrder[1], &this->slotOrder[0], index);
+  this->slotOrder[0] = slot;
+  return slot;
+}
+
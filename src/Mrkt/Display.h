@@ -21,6 +21,44 @@
 #include <LiquidCrystal.h> // see https://www.arduino.cc/en/Reference/LiquidCrystal
 
 #include "Configuration.h"
+#include "Coordinates.h"
+#include "StringTable.h"
+
+/**
+ * The size of the LCD panel. Note that if you use anything else than a 
+ * 1602 panel, you will have to adapt a lot of code...
+ */
+#define DISPLAY_LCD_LINES        2
+#define DISPLAY_LCD_COLUMNS     16
+
+/**
+ * The number of steps of the backlight brightness (see setBacklight()).
+ */
+#define DISPLAY_BACKLIGHT_LEVELS 10
+
+/**
+ * The number of custom characters the LCD controller can hold (CGRAM slots). The cells 
+ * referencing a slot are tracked in a bit mask, so the panel must not have more than 32 cells.
+ */
+#define DISPLAY_CGRAM_SLOTS      8
+
+/**
+ * The custom characters (glyphs) available. The bitmaps are defined in Display.cpp; any number
+ * of glyphs can be used as long as no more than DISPLAY_CGRAM_SLOTS different ones are visible 
+ * at the same time.
+ */
+#define DISPLAY_GLYPH_FEEDRATE   0 // FR
+#define DISPLAY_GLYPH_PLUSMINUS  1 // +-
+#define DISPLAY_GLYPH_ELLIPSIS   2 // ...
+#define DISPLAY_GLYPH_BAR_1      3 // progress bar cell, one to four of five columns filled
+#define DISPLAY_GLYPH_BAR_2      4
+#define DISPLAY_GLYPH_BAR_3      5
+#define DISPLAY_GLYPH_BAR_4      6
+#define DISPLAY_GLYPH_SPINDLE    7
+#define DISPLAY_GLYPH_RUN        8
+#define DISPLAY_GLYPH_HOLD       9
+#define DISPLAY_GLYPH_ALARM     10
+#define DISPLAY_GLYPH_COUNT     11
 
 /**
  * This class represents the display options used to communicate with the user. It 
@@ -40,6 +78,25 @@ class Display : public LiquidCrystal {
      */
     void begin();
 
+    /**
+     * These methods replace the ones of LiquidCrystal to keep track of the cursor position, 
+     * which is needed to know the cells referencing the custom characters.
+     */
+    void clear();
+    void home();
+    void setCursor(uint8_t col, uint8_t row);
+    virtual size_t write(uint8_t value);
+    using LiquidCrystal::write;
+
+    /**
+     * Writes a glyph to the current position or the position specified. The glyph is uploaded
+     * to the LCD controller unless it is resident already, replacing the least recently used 
+     * glyph that is not visible any more. If all slots are in use by visible glyphs, a plain
+     * character resembling the glyph is written instead.
+     */
+    void writeGlyph(uint8_t glyph);
+    void writeGlyph(uint8_t col, uint8_t row, uint8_t glyph);
+
     /**
      * Writes the Feedrate symbol (FR) to the current position or the position specified.
      */
@@ -58,12 +115,99 @@ class Display : public LiquidCrystal {
     void writeEllipsis();
     void writeEllipsis(uint8_t col, uint8_t row);
 
+    /**
+     * Writes an unsigned value right-aligned to the end of the given row, padding the space 
+     * between the column specified and the value with blanks. If decimals is not 0, the value 
+     * is displayed as a fixed-point number with the given number of decimal places. Values 
+     * that do not fit into the space available are displayed in units of 1000 with a 'k' suffix.
+     */
+    void writeRightAligned(uint8_t col, uint8_t row, uint32_t value, uint8_t decimals = 0);
+
+    /**
+     * Writes a duration given in seconds right-aligned to the end of the given row as 
+     * h:mm:ss (or m:ss for durations below one hour), padding the space between the 
+     * column specified and the value with blanks.
+     */
+    void writeTime(uint8_t col, uint8_t row, uint32_t seconds);
+
+    /**
+     * Writes a percentage right-aligned to the end of the given row, padding the space 
+     * between the column specified and the value with blanks.
+     */
+    void writePercent(uint8_t col, uint8_t row, uint8_t value);
+
+    /**
+     * Writes a coordinate (e.g. a length given in µm as mm) right-aligned into a field of the 
+     * width given, using as many decimal places (up to two) as fit into the field. Values that
+     * do not fit at all are displayed as a row of '#'.
+     */
+    void writeCoordinate(uint8_t col, uint8_t row, uint8_t width, Coordinate value);
+
+    /**
+     * Writes a signed integer to the current position and returns the number of characters
+     * written. This replaces Print::print(), which needs a division per digit.
+     */
+    uint8_t writeNumber(int32_t value);
+
+    /**
+     * Writes a string of the string table (one of the STRING_* constants, see Strings.txt) to
+     * the current position, followed by blanks up to the width given, and returns the number
+     * of characters written.
+     */
+    uint8_t writeString(uint8_t string, uint8_t width = 0);
+
+    /**
+     * Writes a horizontal bar of the width given that is filled to the percentage specified,
+     * with a resolution of one pixel column.
+     */
+    void writeProgressBar(uint8_t col, uint8_t row, uint8_t width, uint8_t percent);
+
+    /**
+     * Sets the brightness of the backlight, from 0 (off) to DISPLAY_BACKLIGHT_LEVELS (full), 
+     * and returns the current brightness.
+     */
+    void setBacklight(uint8_t level);
+    uint8_t getBacklight();
+
     /**
      * Sets the level of the main mode LED.
      */
     void setMainLED(uint8_t level);
 
   private:
+    /**
+     * The brightness of the backlight.
+     */
+    uint8_t backlight;
+
+    /**
+     * The position the next character is written to. The column may exceed the visible area.
+     */
+    uint8_t cursorCol;
+    uint8_t cursorRow;
+
+    /**
+     * The glyph held by each slot (DISPLAY_GLYPH_COUNT if none) and the cells currently 
+     * showing the slot (bit row * DISPLAY_LCD_COLUMNS + col).
+     */
+    uint8_t slotGlyphs[DISPLAY_CGRAM_SLOTS];
+    uint32_t slotCells[DISPLAY_CGRAM_SLOTS];
+
+    /**
+     * The slots in the order of their use, the most recently used one first.
+     */
+    uint8_t slotOrder[DISPLAY_CGRAM_SLOTS];
+
+    /**
+     * Forgets all glyphs uploaded.
+     */
+    void resetSlots();
+
+    /**
+     * Returns the slot holding the glyph, uploading it if necessary, or -1 if no slot is 
+     * available.
+     */
+    int8_t getSlot(uint8_t glyph);
 
 };
 
@@ -0,0 +1,227 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <util/crc16.h>
+#include "Arduino.h"
+
+#include "Configuration.h"
+#include "FileBrowser.h"
+
+#if SDCARD_AVAILABLE == 1
+
+#include "JobLogFile.h"
+#include "JobScanner.h"
+#include "TraceFile.h"
+#include "Uploader.h"
+#include "Workspace.h"
+
+/**
+ * The "singleton" instance of the FileBrowser class.
+ */
+FileBrowser MrktFileBrowser;
+
+FileBrowser::FileBrowser() {
+  this->state = Unavailable;
+  this->index = NULL;
+  this->stamp = 0;
+  this->fileCount = 0;
+  this->count = 0;
+  this->lastName[0] = '\0';
+}
+
+bool FileBrowser::begin(SdFile & index) {
+  if (index.isOpen()) {
+    index.close();
+  }
+  this->index = &index;
+  this->state = Unavailable;
+  if (!MrktStorage.begin() || !index.open(FILE_BROWSER_INDEX_NAME, O_RDWR | O_CREAT)) {
+    return false;
+  }
+  readDirectory();
+  Header header;
+  if ((index.read(&header, sizeof(Header)) == sizeof(Header)) &&
+      (memcmp(header.magic, FILE_BROWSER_INDEX_MAGIC, sizeof(header.magic)) == 0) &&
+      (header.stamp == this->stamp) && (header.count == this->fileCount)) {
+    this->count = header.count;
+    this->state = Ready;
+  } else {
+    startBuild();
+  }
+  return true;
+}
+
+void FileBrowser::loop() {
+  // the batch shares its memory with the uploader (see Workspace.h)
+  if ((this->state == Building) && !MrktUploader.isActive()) {
+    buildBatch();
+  }
+}
+
+bool FileBrowser::isReady() {
+  return (this->state == Ready);
+}
+
+bool FileBrowser::isBuilding() {
+  return (this->state == Building);
+}
+
+uint16_t FileBrowser::getCount() {
+  return this->count;
+}
+
+uint8_t FileBrowser::getProgress() {
+  if (this->state == Ready) {
+    return 100;
+  }
+  return (this->fileCount == 0) ? 0 : (uint32_t) this->count * 100 / this->fileCount;
+}
+
+bool FileBrowser::getName(uint16_t position, char * name) {
+  if ((this->state != Ready) || (position >= this->count)) {
+    return false;
+  }
+  Entry entry;
+  SdFile file;
+  bool current = this->index->seekSet(sizeof(Header) + (uint32_t) position * sizeof(Entry)) &&
+                 (this->index->read(&entry, sizeof(Entry)) == sizeof(Entry)) &&
+                 file.open(MrktStorage.getFileSystem().vwd(), entry.dirIndex, O_READ) &&
+                 file.getSFN(name) && (hashName(name) == entry.nameHash) &&
+                 (file.firstCluster() == entry.firstCluster) && (file.fileSize() == entry.size);
+  file.close();
+  if (!current) {
+    // the directory has been changed since the index was checked
+    readDirectory();
+    startBuild();
+  }
+  return current;
+}
+
+void FileBrowser::readDirectory() {
+  FatFile * directory = MrktStorage.getFileSystem().vwd();
+  SdFile file;
+  char name[FILE_BROWSER_NAME_SIZE];
+  dir_t entry;
+  this->stamp = 0xFFFF;
+  this->fileCount = 0;
+  directory->rewind();
+  while (file.openNext(directory, O_READ)) {
+    if (isListed(file, name) && file.dirEntry(&entry)) {
+      // any change of name, position, size or modification time changes the stamp
+      const uint8_t * data = (const uint8_t *) &entry;
+      for (uint8_t i = 0; i < sizeof(dir_t); i++) {
+        this->stamp = _crc16_update(this->stamp, data[i]);
+      }
+      this->stamp = _crc16_update(this->stamp, file.dirIndex() & 0xFF);
+      this->stamp = _crc16_update(this->stamp, file.dirIndex() >> 8);
+      this->fileCount++;
+    }
+    file.close();
+  }
+}
+
+void FileBrowser::startBuild() {
+  // the header is only written when the index is complete, so an interrupted build is detected
+  this->index->truncate(0);
+  Header header;
+  memset(&header, 0, sizeof(Header));
+  this->index->write(&header, sizeof(Header));
+  this->count = 0;
+  this->lastName[0] = '\0';
+  this->state = Building;
+}
+
+void FileBrowser::buildBatch() {
+  // collect the names following the last entry written, sorted by insertion
+  Candidate * batch = MrktWorkspace.batch;
+  uint8_t found = 0;
+  FatFile * directory = MrktStorage.getFileSystem().vwd();
+  SdFile file;
+  char name[FILE_BROWSER_NAME_SIZE];
+  directory->rewind();
+  while (file.openNext(directory, O_READ)) {
+    if (isListed(file, name) && (strcmp(name, this->lastName) > 0) &&
+        ((found < FILE_BROWSER_BATCH_SIZE) || (strcmp(name, batch[found - 1].name) < 0))) {
+      uint8_t i = (found < FILE_BROWSER_BATCH_SIZE) ? found++ : found - 1;
+      while ((i > 0) && (strcmp(name, batch[i - 1].name) < 0)) {
+        batch[i] = batch[i - 1];
+        i--;
+      }
+      strcpy(batch[i].name, name);
+      batch[i].dirIndex = file.dirIndex();
+    }
+    file.close();
+  }
+
+  this->index->seekSet(sizeof(Header) + (uint32_t) this->count * sizeof(Entry));
+  for (uint8_t i = 0; i < found; i++) {
+    // only the name and the position are kept in the batch - the directory entry provides the rest
+    Entry entry;
+    entry.dirIndex = batch[i].dirIndex;
+    entry.nameHash = hashName(batch[i].name);
+    bool opened = file.open(directory, entry.dirIndex, O_READ);
+    entry.firstCluster = file.firstCluster();
+    entry.size = file.fileSize();
+    file.close();
+    if (!opened || (this->index->write(&entry, sizeof(Entry)) != sizeof(Entry))) {
+      this->state = Unavailable;
+      return;
+    }
+  }
+  this->count += found;
+  if (found == FILE_BROWSER_BATCH_SIZE) {
+    strcpy(this->lastName, batch[found - 1].name);
+    return;
+  }
+
+  // all files have been sorted - the index is valid now
+  Header header;
+  memcpy(header.magic, FILE_BROWSER_INDEX_MAGIC, sizeof(header.magic));
+  header.stamp = this->stamp;
+  header.count = this->count;
+  if (!this->index->seekSet(0) || (this->index->write(&header, sizeof(Header)) != sizeof(Header)) ||
+      !this->index->sync()) {
+    this->state = Unavailable;
+    return;
+  }
+  this->fileCount = this->count;
+  this->state = Ready;
+}
+
+bool FileBrowser::isListed(SdFile & file, char * name) {
+  if (!file.isFile() || file.isHidden() || !file.getSFN(name)) {
+    return false;
+  }
+  const char * extension = strchr(name, '.');
+  return (strcmp_P(name, PSTR(FILE_BROWSER_INDEX_NAME)) != 0) &&
+         (strcmp_P(name, PSTR(JOB_LOG_FILE_NAME)) != 0) &&
+         (strcmp_P(name, PSTR(TRACE_FILE_NAME)) != 0) &&
+         ((extension == NULL) || (strcmp_P(extension + 1, PSTR(JOB_SCANNER_SIDECAR_EXTENSION)) != 0));
+}
+
+uint16_t FileBrowser::hashName(const char * name) {
+  uint16_t hash = 0xFFFF;
+  while (*name != '\0') {
+    hash = _crc16_update(hash, *name++);
+  }
+  return hash;
+}
+
+#endif // SDCARD_AVAILABLE
@@ -0,0 +1,201 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_FileBrowser_h
+#define MRKT_FileBrowser_h
+
+#include "Configuration.h"
+
+#if SDCARD_AVAILABLE == 1
+
+#include "Storage.h"
+
+/**
+ * The name of the index file in the root directory of the SD card.
+ */
+#define FILE_BROWSER_INDEX_NAME   "MRKTIDX.DAT"
+
+/**
+ * The identification at the beginning of the index file.
+ */
+#define FILE_BROWSER_INDEX_MAGIC  "MRKTIDX"
+
+/**
+ * The size of the buffer for a file name (8.3 format).
+ */
+#define FILE_BROWSER_NAME_SIZE    13
+
+/**
+ * The number of entries sorted during a single main loop iteration while the index is built.
+ */
+#define FILE_BROWSER_BATCH_SIZE    8
+
+/**
+ * This class provides the sorted list of the job files in the root directory of the SD card
+ * for the file picker of the reader mode. Walking the FAT directory for every step of the
+ * encoder would take far too long for directories with hundreds of files, so the list is
+ * kept in an index file (see FILE_BROWSER_INDEX_NAME) that contains one fixed-size entry
+ * per file, sorted by name. Each entry consists of the position of the file in the directory,
+ * a hash of its 8.3 name, its first cluster and its size. Looking up a file therefore requires
+ * one read of the index file and one read of the directory entry, regardless of the number of
+ * files, and the name hash, cluster and size confirm that the entry is still current.
+ *
+ * The index is checked when the browser is started (usually once per card insertion) against
+ * a stamp computed from the directory entries - FAT does not maintain a modification time
+ * for the root directory. If the stamp differs, the index is rebuilt in the background: every
+ * main loop iteration walks the directory once and appends the next FILE_BROWSER_BATCH_SIZE
+ * names in sort order, which keeps the memory required independent of the number of files.
+ * The batch is collected in the shared Workspace, so the index is not built while an upload 
+ * is active (the upload changes the directory anyway).
+ *
+ * The browser has no file of its own: the index file is opened in the job file of the 
+ * ReaderMode, which is not needed while another file is chosen.
+ *
+ * The index file, the job log, the trace and the sidecar files of the JobScanner are not listed.
+ */
+class FileBrowser {
+
+  public:
+    /**
+     * The default constructor.
+     */
+    FileBrowser();
+
+    /**
+     * Opens the index file in the file given and checks whether it matches the directory,
+     * starting to rebuild it if not. The file is used by the browser until it is closed or
+     * begin() is called again. Returns false if the card or the index file are not available.
+     */
+    bool begin(SdFile & index);
+
+    /**
+     * Continues to build the index, if required. This has to be called regularly while the
+     * browser is used.
+     */
+    void loop();
+
+    /**
+     * Checks whether the index is complete and up to date.
+     */
+    bool isReady();
+
+    /**
+     * Checks whether the index is being built, i.e. whether loop() has work to do.
+     */
+    bool isBuilding();
+
+    /**
+     * Returns the number of files in the index - while the index is built, this is the
+     * number of files sorted so far.
+     */
+    uint16_t getCount();
+
+    /**
+     * Returns the progress of building the index in percent.
+     */
+    uint8_t getProgress();
+
+    /**
+     * Copies the name of the file at the position given (starting with 0) to the buffer, which
+     * has to hold FILE_BROWSER_NAME_SIZE characters. Returns false if there is no such file; if
+     * the entry has become outdated, the index is rebuilt.
+     */
+    bool getName(uint16_t position, char * name);
+
+    /**
+     * A file collected while the index is built (see Workspace.h) - the remaining fields of
+     * its entry are read when the entry is written.
+     */
+    struct Candidate {
+      char name[FILE_BROWSER_NAME_SIZE];
+      uint16_t dirIndex;
+    };
+
+  private:
+    /**
+     * The enumeration to represent the internal state of the browser.
+     */
+    enum InternalState { Unavailable, Building, Ready };
+    InternalState state;
+
+    /**
+     * The contents of the index file: a header followed by the entries.
+     */
+    struct Header {
+      char magic[8];
+      uint16_t stamp;
+      uint16_t count;
+    } __attribute__((packed));
+    struct Entry {
+      uint16_t dirIndex;
+      uint16_t nameHash;
+      uint32_t firstCluster;
+      uint32_t size;
+    } __attribute__((packed));
+
+    /**
+     * The index file (see begin()).
+     */
+    SdFile * index;
+
+    /**
+     * The stamp and the number of files in the directory, and the number of entries in the index.
+     */
+    uint16_t stamp;
+    uint16_t fileCount;
+    uint16_t count;
+
+    /**
+     * The name of the last entry written while the index is built.
+     */
+    char lastName[FILE_BROWSER_NAME_SIZE];
+
+    /**
+     * Walks the directory to determine the stamp and the number of files.
+     */
+    void readDirectory();
+
+    /**
+     * Discards the contents of the index file and starts to build it.
+     */
+    void startBuild();
+
+    /**
+     * Appends the next batch of entries to the index.
+     */
+    void buildBatch();
+
+    /**
+     * Checks whether the file is to be listed and copies its name to the buffer if so.
+     */
+    bool isListed(SdFile & file, char * name);
+
+    /**
+     * Calculates the hash of a file name.
+     */
+    static uint16_t hashName(const char * name);
+
+};
+
+/**
+ * Access to the "singleton" instance of the FileBrowser class.
+ */
+extern FileBrowser MrktFileBrowser;
+
+#endif // SDCARD_AVAILABLE
+
+#endif
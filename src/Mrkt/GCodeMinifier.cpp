@@ -0,0 +1,411 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "GCodeMinifier.h"
+
+/**
+ * The representation of an unknown modal state.
+ */
+#define GCODE_MINIFIER_UNKNOWN 0xFFFF
+#define GCODE_MINIFIER_UNKNOWN_M 0xFF
+
+/**
+ * The bits of the coolant state.
+ */
+#define GCODE_MINIFIER_COOLANT_MIST  1
+#define GCODE_MINIFIER_COOLANT_FLOOD 2
+
+GCodeMinifier::GCodeMinifier() {
+  reset();
+}
+
+void GCodeMinifier::reset() {
+  for (uint8_t group = 0; group < ModalGroupCount; group++) {
+    this->modalState[group] = GCODE_MINIFIER_UNKNOWN;
+  }
+  this->feedRate[0] = '\0';
+  this->spindleSpeed[0] = '\0';
+  this->spindleState = GCODE_MINIFIER_UNKNOWN_M;
+  this->coolantState = GCODE_MINIFIER_UNKNOWN_M;
+}
+
+uint8_t GCodeMinifier::minify(char * line) {
+  // skip leading whitespace
+  char * start = line;
+  while ((*start == ' ') || (*start == '\t')) {
+    start++;
+  }
+
+  // lines addressed to Grbl itself are only trimmed
+  if (*start == '$') {
+    uint8_t length = strlen(start);
+    while ((length > 0) && ((start[length - 1] == ' ') || (start[length - 1] == '\t') || (start[length - 1] == '\r'))) {
+      length--;
+    }
+    memmove(line, start, length);
+    line[length] = '\0';
+    return length;
+  }
+
+  if (compact(line) == 0) {
+    return 0;
+  }
+  return dropUnchangedWords(line);
+}
+
+uint8_t GCodeMinifier::compact(char * line) {
+  // first pass: remove comments and whitespace and convert to upper case
+  // (Grbl ignores whitespace even inside of numbers, so this has to be done first)
+  const char * input = line;
+  char * output = line;
+  while (*input != '\0') {
+    char c = *input;
+    if (c == '(') {
+      // skip the comment including the closing bracket
+      while ((*input != '\0') && (*input != ')')) {
+        input++;
+      }
+      if (*input == ')') {
+        input++;
+      }
+      continue;
+    }
+    if (c == ';') {
+      // the rest of the line is a comment
+      break;
+    }
+    if ((c >= 'a') && (c <= 'z')) {
+      c -= 'a' - 'A';
+    }
+    if ((c != ' ') && (c != '\t') && (c != '\r') && (c != '%')) {
+      *output++ = c;
+    }
+    input++;
+  }
+  *output = '\0';
+
+  // second pass: remove line numbers and shorten the numbers of all words
+  input = line;
+  output = line;
+  while (*input != '\0') {
+    char letter = *input++;
+    char * wordStart = output;
+    *output++ = letter;
+    if ((letter >= 'A') && (letter <= 'Z')) {
+      input = shortenNumber(input, output);
+    }
+    if (letter == 'N') {
+      // drop the line number
+      output = wordStart;
+    }
+  }
+  *output = '\0';
+  return output - line;
+}
+
+uint8_t GCodeMinifier::dropUnchangedWords(char * line) {
+  // first pass: find the words that influence the decisions for other words of the same line
+  bool nonModalCommand = false;
+  bool programEnd = false;
+  bool feedRateReset = false;
+  const char * input = line;
+  while (*input != '\0') {
+    char letter = *input++;
+    const char * number = input;
+    while ((*input != '\0') && ((*input < 'A') || (*input > 'Z'))) {
+      input++;
+    }
+    uint16_t code = parseCode(number, input - number);
+    if (letter == 'G') {
+      ModalGroup group = getModalGroup(code);
+      if ((code == 40) || (code == 100) || (code == 280) || (code == 281) || (code == 300) || 
+          (code == 301) || (code == 530) || (code == 920) || (code == 921)) {
+        // G4, G10, G28, G28.1, G30, G30.1, G53, G92 and G92.1 use the axis words or are
+        // modifiers of the motion - keep the motion mode just to be safe
+        nonModalCommand = true;
+      } else if (((group == Units) || (group == FeedRateMode)) && (code != this->modalState[group])) {
+        // the feed rate has to be specified again after a change of the units or the feed rate mode
+        feedRateReset = true;
+      }
+    } else if (letter == 'M') {
+      switch(code) {
+        case 20:
+        case 300:
+          programEnd = true;
+          break;
+        case 30:
+        case 40:
+        case 50:
+          this->spindleState = code / 10;
+          break;
+        case 70:
+        case 80:
+          if (this->coolantState == GCODE_MINIFIER_UNKNOWN_M) {
+            // the coolant commands of the job itself are tracked from here on
+            this->coolantState = 0;
+          }
+          this->coolantState |= (code == 70) ? GCODE_MINIFIER_COOLANT_MIST : GCODE_MINIFIER_COOLANT_FLOOD;
+          break;
+        case 90:
+          this->coolantState = 0;
+          break;
+      }
+    }
+  }
+
+  // second pass: drop the unchanged words and update the modal state
+  input = line;
+  char * output = line;
+  while (*input != '\0') {
+    char letter = *input;
+    const char * number = input + 1;
+    const char * wordEnd = number;
+    while ((*wordEnd != '\0') && ((*wordEnd < 'A') || (*wordEnd > 'Z'))) {
+      wordEnd++;
+    }
+    uint8_t numberLength = wordEnd - number;
+    bool drop = false;
+
+    if (letter == 'G') {
+      uint16_t code = parseCode(number, numberLength);
+      ModalGroup group = getModalGroup(code);
+      if (group == Motion) {
+        if ((code >= 380) && (code < 390)) {
+          // probing cycles are always kept, and the motion mode afterwards is not tracked
+          code = GCODE_MINIFIER_UNKNOWN;
+        } else {
+          drop = (code == this->modalState[Motion]) && !nonModalCommand && (code != 800);
+        }
+        this->modalState[Motion] = code;
+      } else if (group != ModalGroupCount) {
+        drop = (code == this->modalState[group]);
+        this->modalState[group] = code;
+      }
+    } else if (letter == 'F') {
+      drop = !feedRateReset && (this->feedRate[0] != '\0') &&
+             (numberLength == strlen(this->feedRate)) && (strncmp(number, this->feedRate, numberLength) == 0);
+      if (numberLength <= GCODE_MINIFIER_VALUE_SIZE) {
+        memcpy(this->feedRate, number, numberLength);
+        this->feedRate[numberLength] = '\0';
+      } else {
+        this->feedRate[0] = '\0';
+      }
+      // a feed rate on this line overrides the reset caused by a mode change
+      feedRateReset = false;
+    } else if (letter == 'S') {
+      drop = (this->spindleSpeed[0] != '\0') &&
+             (numberLength == strlen(this->spindleSpeed)) && (strncmp(number, this->spindleSpeed, numberLength) == 0);
+      if (numberLength <= GCODE_MINIFIER_VALUE_SIZE) {
+        memcpy(this->spindleSpeed, number, numberLength);
+        this->spindleSpeed[numberLength] = '\0';
+      } else {
+        this->spindleSpeed[0] = '\0';
+      }
+    }
+
+    if (!drop) {
+      memmove(output, input, wordEnd - input);
+      output += wordEnd - input;
+    }
+    input = wordEnd;
+  }
+  *output = '\0';
+
+  // in inverse time mode, the feed rate has to be given with every motion, and after a change
+  // of the units or the feed rate mode without a new feed rate, the feed rate is undefined
+  if (feedRateReset || (this->modalState[FeedRateMode] != 940)) {
+    this->feedRate[0] = '\0';
+  }
+
+  // the program end resets most of the modal state
+  if (programEnd) {
+    reset();
+  }
+
+  return output - line;
+}
+
+uint8_t GCodeMinifier::writeModalState(char * line) {
+  char * output = line;
+  static const ModalGroup groups[] = { Plane, Units, Distance, FeedRateMode, CoordinateSystem, Motion };
+  for (uint8_t i = 0; i < sizeof(groups) / sizeof(groups[0]); i++) {
+    uint16_t code = this->modalState[groups[i]];
+    if ((code == GCODE_MINIFIER_UNKNOWN) || ((groups[i] == Motion) && (code != 0) && (code != 10))) {
+      continue;
+    }
+    // all codes written are integers below 100
+    *output++ = 'G';
+    if (code >= 100) {
+      *output++ = '0' + code / 100;
+    }
+    *output++ = '0' + (code / 10) % 10;
+  }
+  if (this->spindleState != GCODE_MINIFIER_UNKNOWN_M) {
+    *output++ = 'M';
+    *output++ = '0' + this->spindleState;
+  }
+  if (this->spindleSpeed[0] != '\0') {
+    *output++ = 'S';
+    output = stpcpy(output, this->spindleSpeed);
+  }
+  if (this->coolantState != GCODE_MINIFIER_UNKNOWN_M) {
+    // M7 and M8 belong to the same modal group and cannot be combined in a single line
+    *output++ = 'M';
+    *output++ = ((this->coolantState & GCODE_MINIFIER_COOLANT_FLOOD) != 0) ? '8' : 
+                (((this->coolantState & GCODE_MINIFIER_COOLANT_MIST) != 0) ? '7' : '9');
+  }
+  if (this->feedRate[0] != '\0') {
+    *output++ = 'F';
+    output = stpcpy(output, this->feedRate);
+  }
+  *output = '\0';
+  return output - line;
+}
+
+uint8_t GCodeMinifier::getArcMode() {
+  switch(this->modalState[Motion]) {
+    case 20:
+      return 2;
+    case 30:
+      return 3;
+    default:
+      return 0;
+  }
+}
+
+GCodeMinifier::ModalGroup GCodeMinifier::getModalGroup(uint16_t code) {
+  switch(code) {
+    case   0:
+    case  10:
+    case  20:
+    case  30:
+    case 382:
+    case 383:
+    case 384:
+    case 385:
+    case 800:
+      return Motion;
+    case 170:
+    case 180:
+    case 190:
+      return Plane;
+    case 900:
+    case 910:
+      return Distance;
+    case 200:
+    case 210:
+      return Units;
+    case 930:
+    case 940:
+      return FeedRateMode;
+    case 540:
+    case 550:
+    case 560:
+    case 570:
+    case 580:
+    case 590:
+      return CoordinateSystem;
+    default:
+      return ModalGroupCount;
+  }
+}
+
+uint16_t GCodeMinifier::parseCode(const char * number, uint8_t length) {
+  uint16_t code = 0;
+  bool fraction = false;
+  for (uint8_t i = 0; i < length; i++) {
+    char c = number[i];
+    if ((c >= '0') && (c <= '9')) {
+      code = code * 10 + (c - '0');
+      if (fraction) {
+        // only the first decimal place is relevant for G and M codes
+        return code;
+      }
+    } else if (c == '.') {
+      fraction = true;
+    } else {
+      return GCODE_MINIFIER_UNKNOWN;
+    }
+  }
+  return fraction ? code : code * 10;
+}
+
+const char * GCodeMinifier::shortenNumber(const char * input, char * & output) {
+  const char * start = input;
+  bool negative = false;
+  if ((*input == '+') || (*input == '-')) {
+    negative = (*input == '-');
+    input++;
+  }
+  const char * integerStart = input;
+  while ((*input >= '0') && (*input <= '9')) {
+    input++;
+  }
+  const char * integerEnd = input;
+  const char * fractionStart = input;
+  const char * fractionEnd = input;
+  if (*input == '.') {
+    input++;
+    fractionStart = input;
+    while ((*input >= '0') && (*input <= '9')) {
+      input++;
+    }
+    fractionEnd = input;
+  }
+
+  if (((*input != '\0') && ((*input < 'A') || (*input > 'Z'))) || (input == start)) {
+    // this is not a plain number - copy everything up to the next letter unchanged
+    while ((*input != '\0') && ((*input < 'A') || (*input > 'Z'))) {
+      input++;
+    }
+    while (start < input) {
+      *output++ = *start++;
+    }
+    return input;
+  }
+
+  // remove leading zeros of the integer part and trailing zeros of the fraction
+  while ((integerStart < integerEnd) && (*integerStart == '0')) {
+    integerStart++;
+  }
+  while ((fractionEnd > fractionStart) && (*(fractionEnd - 1) == '0')) {
+    fractionEnd--;
+  }
+
+  if ((integerStart == integerEnd) && (fractionStart == fractionEnd)) {
+    // the value is zero, regardless of the sign
+    *output++ = '0';
+  } else {
+    if (negative) {
+      *output++ = '-';
+    }
+    while (integerStart < integerEnd) {
+      *output++ = *integerStart++;
+    }
+    if (fractionStart < fractionEnd) {
+      *output++ = '.';
+      while (fractionStart < fractionEnd) {
+        *output++ = *fractionStart++;
+      }
+    }
+  }
+  return input;
+}
@@ -0,0 +1,142 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_GCodeMinifier_h
+#define MRKT_GCodeMinifier_h
+
+#include <inttypes.h>
+
+/**
+ * The maximum length of the F and S values that are tracked to drop unchanged words.
+ * Longer values are never dropped.
+ */
+#define GCODE_MINIFIER_VALUE_SIZE 10
+
+/**
+ * The size of the buffer required to hold the modal state written by writeModalState().
+ */
+#define GCODE_MINIFIER_STATE_SIZE (20 + 2 * (GCODE_MINIFIER_VALUE_SIZE + 1) + 8)
+
+/**
+ * This class shortens G-code lines before they are sent to the Grbl system. It
+ * - removes comments, whitespace and line numbers,
+ * - shortens numbers without changing their value (X010.500 becomes X10.5, G01 becomes G1),
+ * - drops modal G words (motion, plane, distance, units, feed rate mode and work coordinate
+ *   system) as well as F and S words that do not change the current modal state.
+ * 
+ * In order to do this safely, the minifier keeps track of the modal state established by the
+ * lines it has processed (including the spindle and coolant state, which is not used to drop
+ * words but to re-establish the state, see writeModalState()). Everything that is not known for sure (e.g. the state at the start
+ * of a job or after a program end) is treated as unknown, and unknown state is never dropped.
+ * Lines addressed to Grbl itself (starting with $) are only trimmed.
+ * 
+ * Note that the tracked state is only correct as long as Grbl accepts all lines - if Grbl 
+ * reports an error, reset() has to be called before processing any further lines.
+ * 
+ * This class does not depend on the Arduino libraries so that it can be used by the host 
+ * tools as well.
+ */
+class GCodeMinifier {
+
+  public:
+    /**
+     * The default constructor.
+     */
+    GCodeMinifier();
+
+    /**
+     * Forgets the modal state, e.g. when starting a new job.
+     */
+    void reset();
+
+    /**
+     * Minifies a single line in place. The line must be terminated by a \0 character and 
+     * must not contain the line terminator. Returns the new length of the line - 0 if the
+     * line can be dropped completely.
+     */
+    uint8_t minify(char * line);
+
+    /**
+     * Writes a line that re-establishes the known modal state (e.g. when a job is resumed in 
+     * the middle) to the buffer given, which has to hold at least GCODE_MINIFIER_STATE_SIZE 
+     * characters. The arc motion modes are not included because Grbl does not accept them
+     * without axis words (see getArcMode()). If both mist and flood coolant are active, only 
+     * flood coolant is restored. Returns the length of the line - 0 if no state is known.
+     */
+    uint8_t writeModalState(char * line);
+
+    /**
+     * Returns the active arc motion mode (2 for G2, 3 for G3) or 0 if no arc mode is active.
+     */
+    uint8_t getArcMode();
+
+  private:
+    /**
+     * The modal groups that are tracked. The values are stored as G number times 10 
+     * (e.g. 0 for G0, 382 for G38.2), with GCODE_MINIFIER_UNKNOWN representing an unknown state.
+     */
+    enum ModalGroup { Motion, Plane, Distance, Units, FeedRateMode, CoordinateSystem, ModalGroupCount };
+    uint16_t modalState[ModalGroupCount];
+
+    /**
+     * The current feed rate and spindle speed in their minified representation 
+     * (empty if unknown).
+     */
+    char feedRate[GCODE_MINIFIER_VALUE_SIZE + 1];
+    char spindleSpeed[GCODE_MINIFIER_VALUE_SIZE + 1];
+
+    /**
+     * The current spindle state and coolant state, stored as the M number of the last command
+     * (e.g. 3 for M3), or GCODE_MINIFIER_UNKNOWN_M if unknown. The coolant state is stored as a 
+     * bit mask of GCODE_MINIFIER_COOLANT_* (see GCodeMinifier.cpp).
+     */
+    uint8_t spindleState;
+    uint8_t coolantState;
+
+    /**
+     * Removes comments, whitespace and line numbers and shortens the numbers. Returns the 
+     * new length of the line.
+     */
+    uint8_t compact(char * line);
+
+    /**
+     * Drops the words of a compacted line that do not change the modal state and updates 
+     * the modal state. Returns the new length of the line.
+     */
+    uint8_t dropUnchangedWords(char * line);
+
+    /**
+     * Determines the modal group of a G word (given as G number times 10). Returns 
+     * ModalGroupCount if the word does not belong to one of the tracked groups.
+     */
+    static ModalGroup getModalGroup(uint16_t code);
+
+    /**
+     * Parses the number of a compacted G word and returns it as G number times 10.
+     */
+    static uint16_t parseCode(const char * number, uint8_t length);
+
+    /**
+     * Writes the number starting at input (and ending before the next letter) in its shortest
+     * form to output and advances output behind it. Returns the position after the number in 
+     * the input. The output position must not be behind the input position.
+     */
+    static const char * shortenNumber(const char * input, char * & output);
+
+};
+
+#endif
@@ -0,0 +1,71 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "Arduino.h"
+
+#include "Configuration.h"
+#include "Coordinates.h"
+#include "GrblSettings.h"
+
+/**
+ * The number of the setting that contains the maximum rate of the X axis.
+ */
+#define GRBL_SETTINGS_MAX_RATE_X 110
+
+/**
+ * The "singleton" instance of the GrblSettings class.
+ */
+GrblSettings MrktGrblSettings;
+
+GrblSettings::GrblSettings() {
+  this->available = false;
+  for (uint8_t axis = 0; axis < GRBL_SETTINGS_AXES; axis++) {
+    this->maxRates[axis] = GRBL_SETTINGS_DEFAULT_RATE;
+  }
+}
+
+bool GrblSettings::isAvailable() {
+  return this->available;
+}
+
+uint16_t GrblSettings::getMaxRate(uint8_t axis) {
+  return this->maxRates[axis];
+}
+
+void GrblSettings::handleSettingLine(char * line) {
+  // the settings are reported as $<number>=<value>, e.g. $110=500.000
+  if (line[0] != '$') {
+    return;
+  }
+  char * value = strchr(line, '=');
+  if (value == NULL) {
+    return;
+  }
+  int setting = atoi(line + 1);
+  if ((setting >= GRBL_SETTINGS_MAX_RATE_X) && (setting < GRBL_SETTINGS_MAX_RATE_X + GRBL_SETTINGS_AXES)) {
+    // the rate is rounded to full mm/min
+    Coordinate rate = (Coordinates::parse(value + 1) + 500) / 1000;
+    if ((rate > 0) && (rate <= 0xFFFF)) {
+      MrktGrblSettings.maxRates[setting - GRBL_SETTINGS_MAX_RATE_X] = rate;
+      MrktGrblSettings.available = true;
+    }
+  }
+}
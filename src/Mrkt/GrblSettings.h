@@ -0,0 +1,81 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_GrblSettings_h
+#define MRKT_GrblSettings_h
+
+#include "Configuration.h"
+
+/**
+ * The number of axes supported by Grbl.
+ */
+#define GRBL_SETTINGS_AXES          3
+
+/**
+ * The maximum rate in mm/min that is assumed for every axis if the settings could not be 
+ * read (this is the default value of Grbl).
+ */
+#define GRBL_SETTINGS_DEFAULT_RATE  500
+
+/**
+ * This class keeps the settings of the Grbl system that are required by Mrkt itself, e.g. to 
+ * estimate the runtime of a job. The settings are read during the initialization by sending
+ * the $$ command (see InitializationMode) and passing every line of the response to 
+ * handleSettingLine().
+ */
+class GrblSettings {
+
+  public:
+    /**
+     * The default constructor.
+     */
+    GrblSettings();
+
+    /**
+     * Checks whether the settings have been read from the Grbl system.
+     */
+    bool isAvailable();
+
+    /**
+     * Returns the maximum rate of an axis (0 = X, 1 = Y, 2 = Z) in mm/min ($110 to $112).
+     */
+    uint16_t getMaxRate(uint8_t axis);
+
+    /**
+     * The line handler for the response to the $$ command (see Communication::sendGrblCommand()).
+     */
+    static void handleSettingLine(char * line);
+
+  private:
+    /**
+     * Whether the settings have been read.
+     */
+    bool available;
+
+    /**
+     * The maximum rates of the axes in mm/min.
+     */
+    uint16_t maxRates[GRBL_SETTINGS_AXES];
+
+};
+
+/**
+ * Access to the "singleton" instance of the GrblSettings class.
+ */
+extern GrblSettings MrktGrblSettings;
+
+#endif
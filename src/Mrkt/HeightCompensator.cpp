@@ -0,0 +1,188 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "Arduino.h"
+
+#include "Configuration.h"
+#include "HeightCompensator.h"
+
+#if SDCARD_AVAILABLE == 1
+
+#include "HeightMap.h"
+
+/**
+ * The maximum number of segments of a single motion. Longer segments are used for longer motions.
+ */
+#define HEIGHT_COMPENSATOR_MAX_SEGMENTS 255
+
+HeightCompensator::HeightCompensator() {
+  reset(false);
+  memset(this->target, 0, sizeof(this->target));
+}
+
+void HeightCompensator::reset(bool active) {
+  this->active = active;
+  this->incremental = false;
+  this->inches = false;
+  this->known = false;
+  this->segments = 0;
+  this->segment = 0;
+}
+
+bool HeightCompensator::isActive() {
+  return this->active;
+}
+
+uint8_t HeightCompensator::process(char * line, uint8_t size, MotionEstimator & estimator) {
+  uint8_t length = strlen(line);
+  if (!this->active) {
+    return length;
+  }
+  // the axes programmed by the line - lines addressed to Grbl itself do not contain G-code
+  this->axes = 0;
+  if (*line != '$') {
+    for (const char * input = line; *input != '\0'; input++) {
+      if ((*input >= 'X') && (*input <= 'Z')) {
+        this->axes |= 1 << (*input - 'X');
+      }
+    }
+  }
+  if (!follow(estimator) || (this->axes == 0)) {
+    return length;
+  }
+  // remove the axis words, the remaining words are sent with the first segment
+  char * output = line;
+  for (const char * input = line; *input != '\0';) {
+    bool axis = (*input == 'X') || (*input == 'Y') || (*input == 'Z');
+    do {
+      if (!axis) {
+        *output++ = *input;
+      }
+      input++;
+    } while ((*input != '\0') && ((*input < 'A') || (*input > 'Z')));
+  }
+  length = output - line;
+
+  // split straight feed motions so that no segment is longer than half a grid spacing along
+  // X or Y - the longer of both distances determines the number of segments (no square root)
+  this->segments = 1;
+  if ((estimator.getMotionMode() == MotionEstimator::Linear) && !estimator.isInverseTime()) {
+    uint32_t distanceX = abs(this->target[X] - this->start[X]);
+    uint32_t distanceY = abs(this->target[Y] - this->start[Y]);
+    uint32_t distance = (distanceX > distanceY) ? distanceX : distanceY;
+    uint32_t segmentLength = MrktHeightMap.getSegmentLength();
+    if (segmentLength == 0) {
+      segmentLength = 1;
+    }
+    uint32_t segments = (distance + segmentLength - 1) / segmentLength;
+    this->segments = constrain(segments, 1, HEIGHT_COMPENSATOR_MAX_SEGMENTS);
+  }
+  this->segment = 0;
+  this->sent[X] = this->start[X];
+  this->sent[Y] = this->start[Y];
+  this->sent[Z] = this->start[Z] + MrktHeightMap.getOffset(this->start[X], this->start[Y]);
+  return writeSegment(line, length, size);
+}
+
+void HeightCompensator::track(MotionEstimator & estimator) {
+  if (this->active) {
+    follow(estimator);
+  }
+}
+
+bool HeightCompensator::hasSegments() {
+  return this->segment < this->segments;
+}
+
+uint8_t HeightCompensator::getSegmentCount() {
+  return (this->segments > 0) ? this->segments : 1;
+}
+
+uint8_t HeightCompensator::nextSegment(char * line, uint8_t size) {
+  // only the first segment needs the axes that do not change
+  this->axes = 0;
+  return writeSegment(line, 0, size);
+}
+
+bool HeightCompensator::follow(MotionEstimator & estimator) {
+  this->segments = 0;
+  this->segment = 0;
+  bool known = this->known;
+  this->known = estimator.isPositionKnown();
+  for (uint8_t axis = 0; axis < AxisCount; axis++) {
+    this->start[axis] = this->target[axis];
+    this->target[axis] = estimator.getPosition(axis);
+  }
+  this->incremental = !estimator.isAbsolute();
+  this->inches = estimator.isInches();
+  MotionEstimator::MotionMode motion = estimator.getMotionMode();
+  bool arc = (motion == MotionEstimator::ArcClockwise) || (motion == MotionEstimator::ArcCounterClockwise);
+  return known && this->known && 
+         ((motion == MotionEstimator::Rapid) || (motion == MotionEstimator::Linear) || 
+          (arc && estimator.isPlaneXY()));
+}
+
+uint8_t HeightCompensator::writeSegment(char * line, uint8_t length, uint8_t size) {
+  this->segment++;
+  Coordinate point[AxisCount];
+  for (uint8_t axis = 0; axis < AxisCount; axis++) {
+    if (this->segment == this->segments) {
+      point[axis] = this->target[axis];
+    } else {
+      point[axis] = this->start[axis] + 
+        (this->target[axis] - this->start[axis]) * this->segment / this->segments;
+    }
+  }
+  point[Z] += MrktHeightMap.getOffset(point[X], point[Y]);
+
+  for (uint8_t axis = 0; axis < AxisCount; axis++) {
+    // the compensated Z value is always sent, the other axes only if they move (or have been
+    // programmed, which is required for arcs)
+    if ((axis != Z) && (point[axis] == this->sent[axis]) && ((this->axes & (1 << axis)) == 0)) {
+      continue;
+    }
+    // the positions are converted separately so that the increments add up to the target
+    Coordinate position = toJobUnits(point[axis]);
+    if (this->incremental) {
+      position -= toJobUnits(this->sent[axis]);
+    }
+    char value[13];
+    uint8_t valueLength = Coordinates::write(position, value);
+    if (length + 1 + valueLength > size) {
+      return 0;
+    }
+    line[length++] = 'X' + axis;
+    memcpy(line + length, value, valueLength);
+    length += valueLength;
+    this->sent[axis] = point[axis];
+  }
+  line[length] = '\0';
+  return length;
+}
+
+Coordinate HeightCompensator::toJobUnits(Coordinate value) {
+  if (!this->inches) {
+    return value;
+  }
+  // 1/1000 inch = 25.4 µm, rounded to the nearest value
+  return (value * 10 + ((value < 0) ? -127 : 127)) / 254;
+}
+
+#endif // SDCARD_AVAILABLE
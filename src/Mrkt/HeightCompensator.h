@@ -0,0 +1,165 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_HeightCompensator_h
+#define MRKT_HeightCompensator_h
+
+#include "Configuration.h"
+
+#if SDCARD_AVAILABLE == 1
+
+#include "Coordinates.h"
+#include "MotionEstimator.h"
+
+/**
+ * This class adapts the lines of a job to the height map (see HeightMap.h) while they are 
+ * streamed, so that the tool follows the surface of warped stock: the height offset of the 
+ * end position of every motion is added to its Z value. Straight feed motions (G1) are split
+ * into segments no longer than half a grid spacing along X and Y so that the motion follows 
+ * the interpolated surface between the grid points:
+ * 
+ *   G1X40Y10F300   becomes   G1F300X5Y10Z-0.132
+ *                            X10Z-0.148
+ *                            ...
+ *                            X40Z-0.061
+ * 
+ * Rapid motions and arcs (in the XY plane only) are compensated at their end position. In 
+ * incremental distance mode (G91), the differences of the offsets are added instead, and 
+ * in inch mode (G20) the positions are converted to inches. Feed motions in inverse time mode
+ * (G93) are not split because every segment would take the time of the whole motion.
+ *
+ * The compensator does not interpret the lines itself: the modal state and the programmed
+ * position are taken from the MotionEstimator that has processed the line before (see 
+ * MotionEstimator.h). The compensation requires the position at the start of the motion; it
+ * starts as soon as the job has moved all three axes to absolute positions. Lines that move 
+ * the tool in a way that is not tracked (G10, G28, G30, G38.x, G53, G92 or a change of the 
+ * work coordinate system) are sent unchanged, and the compensation stops until the position
+ * is known again.
+ * 
+ * The lines have to be compacted (see GCodeMinifier.h), i.e. upper case without whitespace
+ * and comments. All calculations are done in fixed point (see Coordinates.h); splitting a
+ * motion takes a division per axis and segment.
+ */
+class HeightCompensator {
+
+  public:
+    /**
+     * The default constructor.
+     */
+    HeightCompensator();
+
+    /**
+     * Forgets the position and the modal state, e.g. when starting a new job, and determines 
+     * whether the lines are to be compensated.
+     */
+    void reset(bool active);
+
+    /**
+     * Checks whether the lines are compensated.
+     */
+    bool isActive();
+
+    /**
+     * Processes the next line of the job in place, after it has been processed by the estimator
+     * given. If the line is a motion that is compensated, it is replaced with the first segment
+     * of the motion, and the remaining segments are provided by nextSegment(). Returns the new 
+     * length of the line, which must not exceed the size given - 0 if the segment does not fit
+     * into the buffer.
+     */
+    uint8_t process(char * line, uint8_t size, MotionEstimator & estimator);
+
+    /**
+     * Follows the position without changing the line, e.g. for the lines that are skipped when 
+     * a job is resumed. The line has to be processed by the estimator given first.
+     */
+    void track(MotionEstimator & estimator);
+
+    /**
+     * Checks whether the motion processed last has further segments.
+     */
+    bool hasSegments();
+
+    /**
+     * Returns the number of segments the line processed last has been split into (1 if the
+     * line has not been changed).
+     */
+    uint8_t getSegmentCount();
+
+    /**
+     * Writes the next segment of the motion to the buffer given. Returns the length of the 
+     * segment - 0 if the segment does not fit into the buffer.
+     */
+    uint8_t nextSegment(char * line, uint8_t size);
+
+  private:
+    /**
+     * The axes that are compensated. Positions are stored in µm.
+     */
+    enum Axis { X, Y, Z, AxisCount };
+
+    /**
+     * Whether the lines are compensated.
+     */
+    bool active;
+
+    /**
+     * The modal state of the motion being split: whether the incremental distance mode and 
+     * inch mode are active.
+     */
+    bool incremental;
+    bool inches;
+
+    /**
+     * Whether the position at the end of the line processed last is known.
+     */
+    bool known;
+
+    /**
+     * The motion being split: the start and end position as programmed, the position that
+     * has been sent last (including the offset), the axes programmed by the line, the number 
+     * of segments and the number of segments written.
+     */
+    Coordinate start[AxisCount];
+    Coordinate target[AxisCount];
+    Coordinate sent[AxisCount];
+    uint8_t axes;
+    uint8_t segments;
+    uint8_t segment;
+
+    /**
+     * Takes the position and the modal state after the line processed last from the estimator.
+     * Returns true if the motion of the line can be compensated - start and target then 
+     * describe the motion.
+     */
+    bool follow(MotionEstimator & estimator);
+
+    /**
+     * Writes the next segment behind the length characters of the line given. Returns the
+     * new length of the line - 0 if the segment does not fit into the buffer.
+     */
+    uint8_t writeSegment(char * line, uint8_t length, uint8_t size);
+
+    /**
+     * Converts a value in µm to the units of the job.
+     */
+    Coordinate toJobUnits(Coordinate value);
+
+};
+
+#endif // SDCARD_AVAILABLE
+
+#endif
@@ -0,0 +1,185 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "Arduino.h"
+#include <EEPROM.h>
+
+#include "Configuration.h"
+#include "HeightMap.h"
+
+#include "Checkpoint.h"
+
+/**
+ * The value that marks a stored map.
+ */
+#define HEIGHT_MAP_MAGIC        0x4D48
+
+/**
+ * The EEPROM address of the first grid point. The points are stored row by row.
+ */
+#define HEIGHT_MAP_POINTS_ADDRESS (HEIGHT_MAP_EEPROM_ADDRESS + sizeof(HeightMap::Header))
+
+/**
+ * The "singleton" instance of the HeightMap class.
+ */
+HeightMap MrktHeightMap;
+
+HeightMap::HeightMap() {
+  this->initialized = false;
+  this->valid = false;
+}
+
+bool HeightMap::isAvailable() {
+  initialize();
+  return this->valid;
+}
+
+bool HeightMap::isActive() {
+  initialize();
+  return this->valid && (this->header.active != 0);
+}
+
+void HeightMap::setActive(bool active) {
+  initialize();
+  if (this->valid && ((this->header.active != 0) != active)) {
+    this->header.active = active ? 1 : 0;
+    writeHeader();
+  }
+}
+
+uint8_t HeightMap::getColumns() {
+  initialize();
+  return this->header.columns;
+}
+
+uint8_t HeightMap::getRows() {
+  initialize();
+  return this->header.rows;
+}
+
+Coordinate HeightMap::getPointX(uint8_t column) {
+  return this->header.sizeX * column / (this->header.columns - 1);
+}
+
+Coordinate HeightMap::getPointY(uint8_t row) {
+  return this->header.sizeY * row / (this->header.rows - 1);
+}
+
+Coordinate HeightMap::getSegmentLength() {
+  initialize();
+  Coordinate spacingX = this->header.sizeX / (this->header.columns - 1);
+  Coordinate spacingY = this->header.sizeY / (this->header.rows - 1);
+  return ((spacingX < spacingY) ? spacingX : spacingY) / 2;
+}
+
+void HeightMap::begin(uint8_t columns, uint8_t rows, Coordinate sizeX, Coordinate sizeY) {
+  this->initialized = true;
+  this->valid = false;
+  this->header.magic = 0;
+  this->header.columns = constrain(columns, 2, HEIGHT_MAP_MAX_POINTS);
+  this->header.rows = constrain(rows, 2, HEIGHT_MAP_MAX_POINTS);
+  this->header.sizeX = sizeX;
+  this->header.sizeY = sizeY;
+  this->header.active = 0;
+  writeHeader();
+}
+
+void HeightMap::setPoint(uint8_t column, uint8_t row, int16_t offset) {
+  EEPROM.put(HEIGHT_MAP_POINTS_ADDRESS + (row * this->header.columns + column) * sizeof(offset), offset);
+}
+
+void HeightMap::finish() {
+  this->header.magic = HEIGHT_MAP_MAGIC;
+  this->header.active = 1;
+  writeHeader();
+  this->valid = true;
+}
+
+Coordinate HeightMap::getOffset(Coordinate x, Coordinate y) {
+  uint8_t fractionX, fractionY;
+  uint8_t column = locate(x, this->header.sizeX, this->header.columns, fractionX);
+  uint8_t row = locate(y, this->header.sizeY, this->header.rows, fractionY);
+  // interpolate along X in the rows below and above the position, then along Y between them
+  int32_t offset = interpolateRow(column, row, fractionX);
+  if (fractionY > 0) {
+    int32_t upper = interpolateRow(column, row + 1, fractionX);
+    offset += (upper - offset) * fractionY / 256;
+  }
+  return offset;
+}
+
+void HeightMap::initialize() {
+  if (this->initialized) {
+    return;
+  }
+  this->initialized = true;
+  EEPROM.get(HEIGHT_MAP_EEPROM_ADDRESS, this->header);
+  this->valid = (this->header.magic == HEIGHT_MAP_MAGIC) && 
+                (this->header.columns >= 2) && (this->header.columns <= HEIGHT_MAP_MAX_POINTS) &&
+                (this->header.rows >= 2) && (this->header.rows <= HEIGHT_MAP_MAX_POINTS) &&
+                (this->header.sizeX > 0) && (this->header.sizeY > 0) &&
+                (this->header.checksum == computeChecksum());
+}
+
+int32_t HeightMap::interpolateRow(uint8_t column, uint8_t row, uint8_t fraction) {
+  int32_t offset = readPoint(column, row);
+  if (fraction > 0) {
+    // the fractions are 1/256 steps, so the division is merely a shift
+    offset += (readPoint(column + 1, row) - offset) * fraction / 256;
+  }
+  return offset;
+}
+
+int16_t HeightMap::readPoint(uint8_t column, uint8_t row) {
+  int16_t offset;
+  EEPROM.get(HEIGHT_MAP_POINTS_ADDRESS + (row * this->header.columns + column) * sizeof(offset), offset);
+  return offset;
+}
+
+void HeightMap::writeHeader() {
+  this->header.checksum = computeChecksum();
+  EEPROM.put(HEIGHT_MAP_EEPROM_ADDRESS, this->header);
+}
+
+uint8_t HeightMap::computeChecksum() {
+  uint16_t size = 0;
+  if ((this->header.columns <= HEIGHT_MAP_MAX_POINTS) && (this->header.rows <= HEIGHT_MAP_MAX_POINTS)) {
+    size = this->header.columns * this->header.rows * sizeof(int16_t);
+  }
+  return Checkpoint::computeChecksum(&this->header, offsetof(Header, checksum),
+                                    HEIGHT_MAP_POINTS_ADDRESS, size);
+}
+
+uint8_t HeightMap::locate(Coordinate position, Coordinate size, uint8_t points, uint8_t & fraction) {
+  if (position <= 0) {
+    fraction = 0;
+    return 0;
+  }
+  if (position >= size) {
+    // the last point is reached from the last cell
+    fraction = 0;
+    return points - 1;
+  }
+  // a single division yields the cell and the position within the cell in 1/256 steps
+  uint32_t scaled = (uint32_t) position * ((points - 1) << 8) / (uint32_t) size;
+  fraction = scaled & 0xFF;
+  return scaled >> 8;
+}
@@ -0,0 +1,175 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_HeightMap_h
+#define MRKT_HeightMap_h
+
+#include "Configuration.h"
+#include "Coordinates.h"
+
+/**
+ * The EEPROM area used to store the height map. The area follows the checkpoints (see 
+ * Checkpoint.h) and occupies sizeof(HeightMap::Header) + 2 * HEIGHT_MAP_MAX_POINTS^2 bytes.
+ */
+#define HEIGHT_MAP_EEPROM_ADDRESS 256
+
+/**
+ * The maximum number of grid points per axis.
+ */
+#define HEIGHT_MAP_MAX_POINTS      10
+
+/**
+ * This class stores the height map determined by the probe mode (see ProbeMode.h) in the 
+ * EEPROM and provides the height offset of any position within the map. The map is a grid
+ * of columns x rows points that spans the work coordinates from (0, 0) to (sizeX, sizeY). 
+ * Each point holds the height of the surface in µm relative to the first point probed, 
+ * stored as an int16_t (±32 mm). 
+ *
+ * The grid itself is never held in RAM: getOffset() reads the four points surrounding the 
+ * position from the EEPROM (which takes about a µs per byte) and interpolates between them
+ * bilinearly using integer arithmetic only. Positions outside of the map use the offset of
+ * the nearest position at the edge of the map.
+ *
+ * The map is only used to compensate a job if it is active (see HeightCompensator.h). The 
+ * active flag is stored with the map so that a job that has been interrupted is resumed with
+ * the same compensation.
+ */
+class HeightMap {
+
+  public:
+    /**
+     * The default constructor.
+     */
+    HeightMap();
+
+    /**
+     * Checks whether a valid height map is stored.
+     */
+    bool isAvailable();
+
+    /**
+     * Checks whether a valid height map is stored and activated for the compensation.
+     */
+    bool isActive();
+
+    /**
+     * Activates or deactivates the compensation. Nothing happens without a valid map.
+     */
+    void setActive(bool active);
+
+    /**
+     * The dimensions of the stored map.
+     */
+    uint8_t getColumns();
+    uint8_t getRows();
+
+    /**
+     * Returns the work coordinates (in µm) of a grid point of the map. These are valid for a 
+     * map that is being recorded as well.
+     */
+    Coordinate getPointX(uint8_t column);
+    Coordinate getPointY(uint8_t row);
+
+    /**
+     * Returns the largest distance (in µm) a straight motion may cover along each axis without
+     * missing a change of the slope of the map, i.e. half the smaller spacing of the grid.
+     */
+    Coordinate getSegmentLength();
+
+    /**
+     * Starts to record a new map of columns x rows points (2 to HEIGHT_MAP_MAX_POINTS each) that 
+     * covers the size given in µm (up to 1.8 m per axis). The stored map is invalidated.
+     */
+    void begin(uint8_t columns, uint8_t rows, Coordinate sizeX, Coordinate sizeY);
+
+    /**
+     * Stores the offset (in µm) of a grid point of the map being recorded.
+     */
+    void setPoint(uint8_t column, uint8_t row, int16_t offset);
+
+    /**
+     * Completes the map being recorded. The new map is active.
+     */
+    void finish();
+
+    /**
+     * Returns the interpolated offset (in µm) of the position given in µm. The map has to be
+     * available.
+     */
+    Coordinate getOffset(Coordinate x, Coordinate y);
+
+  private:
+    /**
+     * The header that precedes the grid points in the EEPROM. The checksum covers the header
+     * and the points.
+     */
+    struct Header {
+      uint16_t magic;
+      uint8_t  columns;
+      uint8_t  rows;
+      int32_t  sizeX;
+      int32_t  sizeY;
+      uint8_t  active;
+      uint8_t  checksum;
+    };
+
+    /**
+     * Whether the header has been read yet, the header and whether the map is valid.
+     */
+    bool initialized;
+    Header header;
+    bool valid;
+
+    /**
+     * Reads and checks the stored map if this has not been done yet.
+     */
+    void initialize();
+
+    /**
+     * Interpolates between a grid point and its right neighbour (the fraction is 0 to 255).
+     */
+    int32_t interpolateRow(uint8_t column, uint8_t row, uint8_t fraction);
+
+    /**
+     * Reads a grid point from the EEPROM.
+     */
+    int16_t readPoint(uint8_t column, uint8_t row);
+
+    /**
+     * Writes the header including a new checksum to the EEPROM.
+     */
+    void writeHeader();
+
+    /**
+     * Computes the checksum of the header and the stored points (see Checkpoint).
+     */
+    uint8_t computeChecksum();
+
+    /**
+     * Determines the grid cell and the position within the cell (0 to 255) along one axis.
+     * Positions beyond the map are moved to its edge.
+     */
+    static uint8_t locate(Coordinate position, Coordinate size, uint8_t points, uint8_t & fraction);
+
+};
+
+/**
+ * Access to the "singleton" instance of the HeightMap class.
+ */
+extern HeightMap MrktHeightMap;
+
+#endif
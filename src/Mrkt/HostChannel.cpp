@@ -0,0 +1,50 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "Arduino.h"
+
+#include "Configuration.h"
+#include "HostChannel.h"
+#include "Trace.h"
+
+/**
+ * The "singleton" instance of the HostChannel class.
+ */
+HostChannel MrktHostChannel;
+
+HostChannel::HostChannel() {
+  this->escaped = false;
+  this->lineStart = true;
+}
+
+void HostChannel::setEscaped(bool escaped) {
+  this->escaped = escaped;
+  this->lineStart = true;
+}
+
+size_t HostChannel::write(uint8_t data) {
+  if (this->escaped && this->lineStart) {
+    Serial.write(HOST_CHANNEL_ESCAPE);
+    TRACE_RECORD_BYTE(TRACE_HOST_TX, HOST_CHANNEL_ESCAPE);
+  }
+  TRACE_RECORD_BYTE(TRACE_HOST_TX, data);
+  this->lineStart = (data == '\n');
+  return Serial.write(data);
+}
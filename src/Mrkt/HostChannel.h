@@ -0,0 +1,82 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_HostChannel_h
+#define MRKT_HostChannel_h
+
+#include "Arduino.h"
+
+#include "Configuration.h"
+
+/**
+ * The byte that marks the data addressed to Mrkt itself on the host connection. It is 
+ * neither a printable character nor one of the realtime commands of Grbl (0x18, 0x80 to 0xA4).
+ */
+#define HOST_CHANNEL_ESCAPE  0xFE
+
+/**
+ * This class carries the replies to host commands. Usually, the host connection belongs to
+ * Mrkt alone and the replies are passed to the serial port unchanged. In passthrough mode
+ * (see Communication::startPassthrough()), the connection is shared with the Grbl system:
+ * the host addresses Mrkt by prefixing a command line with HOST_CHANNEL_ESCAPE, and
+ * while the escaped mode is enabled, every line of the reply is prefixed the same way so 
+ * that the host can tell it from the output of the Grbl system:
+ *
+ *   host -> Mrkt:  <ESC>STAT\n
+ *   Mrkt -> host:  <ESC>[LINK:...]\r\n ... <ESC>ok\r\n
+ *
+ * A command line may end with \n, \r or \r\n. The \n following the \r of an escaped command
+ * is part of the command and is not forwarded to the Grbl system.
+ *
+ * Escaped command lines are also accepted (and answered in the escaped form) while Mrkt
+ * is not in passthrough mode, so a monitoring tool does not need to know the current mode.
+ */
+class HostChannel : public Print {
+
+  public:
+    /**
+     * The default constructor.
+     */
+    HostChannel();
+
+    /**
+     * Enables or disables the escaped form of the replies. The escaped form has to be 
+     * enabled at the start of a line.
+     */
+    void setEscaped(bool escaped);
+
+    /**
+     * Writes a single byte to the host connection (see Print).
+     */
+    virtual size_t write(uint8_t data);
+    using Print::write;
+
+  private:
+    /**
+     * Whether the replies are escaped, and whether the next byte starts a new line.
+     */
+    bool escaped;
+    bool lineStart;
+
+};
+
+/**
+ * Access to the "singleton" instance of the HostChannel class.
+ */
+extern HostChannel MrktHostChannel;
+
+#endif
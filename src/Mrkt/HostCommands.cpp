@@ -0,0 +1,192 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "Arduino.h"
+
+#include "Configuration.h"
+#include "HostCommands.h"
+
+#include "BenchmarkMode.h"
+#include "Communication.h"
+#include "HostChannel.h"
+#include "ModeController.h"
+#include "ReaderMode.h"
+#include "Telemetry.h"
+#include "Uploader.h"
+
+/**
+ * The "singleton" instance of the HostCommands class.
+ */
+HostCommands MrktHostCommands;
+
+HostCommands::HostCommands() {
+}
+
+void HostCommands::execute(char * command) {
+  if (strcmp_P(command, PSTR("STAT")) == 0) {
+    executeStatistics(false);
+  } else if (strcmp_P(command, PSTR("STAT RESET")) == 0) {
+    executeStatistics(true);
+  } else if (strncmp_P(command, PSTR("BENCH"), 5) == 0) {
+    executeBenchmark(command + 5);
+  } else if (strncmp_P(command, PSTR("TELE "), 5) == 0) {
+    executeTelemetry(command + 5);
+  } else if (strncmp_P(command, PSTR("RUN "), 4) == 0) {
+    executeRun(command + 4);
+  } else if (strncmp_P(command, PSTR("PUT "), 4) == 0) {
+    executePut(command + 4);
+  } else {
+    replyError(F("Unknown command"));
+  }
+}
+
+void HostCommands::executeStatistics(bool reset) {
+  const Communication::Statistics & statistics = MrktCommunication.getStatistics();
+
+  // [LINK:<commands sent>,<ok>,<error>,<timeouts>,<overflows>]
+  MrktHostChannel.print(F("[LINK:"));
+  MrktHostChannel.print(statistics.commandsSent);
+  MrktHostChannel.print(',');
+  MrktHostChannel.print(statistics.okCount);
+  MrktHostChannel.print(',');
+  MrktHostChannel.print(statistics.errorCount);
+  MrktHostChannel.print(',');
+  MrktHostChannel.print(statistics.timeoutCount);
+  MrktHostChannel.print(',');
+  MrktHostChannel.print(statistics.overflowCount);
+  MrktHostChannel.println(']');
+
+  // [BYTES:<sent>,<received>]
+  MrktHostChannel.print(F("[BYTES:"));
+  MrktHostChannel.print(statistics.bytesSent);
+  MrktHostChannel.print(',');
+  MrktHostChannel.print(statistics.bytesReceived);
+  MrktHostChannel.println(']');
+
+  // [LAT:<min>,<avg>,<max>] in ms
+  MrktHostChannel.print(F("[LAT:"));
+  MrktHostChannel.print(statistics.latencyMin);
+  MrktHostChannel.print(',');
+  MrktHostChannel.print(MrktCommunication.getAverageLatency());
+  MrktHostChannel.print(',');
+  MrktHostChannel.print(statistics.latencyMax);
+  MrktHostChannel.println(']');
+
+  // [HIST:<limit>:<count>,...,+:<count>] - one entry per latency bucket
+  MrktHostChannel.print(F("[HIST:"));
+  for (uint8_t bucket = 0; bucket < COMMUNICATION_LATENCY_BUCKETS; bucket++) {
+    if (bucket > 0) {
+      MrktHostChannel.print(',');
+    }
+    uint16_t limit = Communication::getLatencyBucketLimit(bucket);
+    if (limit > 0) {
+      MrktHostChannel.print(limit);
+    } else {
+      MrktHostChannel.print('+');
+    }
+    MrktHostChannel.print(':');
+    MrktHostChannel.print(statistics.latencyHistogram[bucket]);
+  }
+  MrktHostChannel.println(']');
+
+  if (reset) {
+    MrktCommunication.resetStatistics();
+  }
+  replyOK();
+}
+
+void HostCommands::executeBenchmark(char * arguments) {
+  uint8_t queries = 30;
+  BenchmarkMode::Query query = BenchmarkMode::Mixed;
+  char * argument = strtok(arguments, " ");
+  if (argument != NULL) {
+    queries = constrain(atoi(argument), 1, BENCH_MODE_MAX_QUERIES);
+    argument = strtok(NULL, " ");
+    if ((argument != NULL) && !BenchmarkMode::findQuery(argument, query)) {
+      replyError(F("Unknown query"));
+      return;
+    }
+  }
+  MrktBenchmarkMode.requestRun(queries, query);
+  MrktModeController.switchToMode(ModeController::Benchmark);
+  replyOK();
+}
+
+void HostCommands::executeRun(char * arguments) {
+#if SDCARD_AVAILABLE == 1
+  if (!MrktReaderMode.selectFile(arguments, true)) {
+    replyError(F("Cannot open file"));
+    return;
+  }
+  MrktModeController.switchToMode(ModeController::Reader);
+  replyOK();
+#else
+  replyError(F("No SD card reader"));
+#endif
+}
+
+void HostCommands::executePut(char * arguments) {
+#if SDCARD_AVAILABLE == 1
+  char * fileName = strtok(arguments, " ");
+  char * size = strtok(NULL, " ");
+  char * option = strtok(NULL, " ");
+  if ((fileName == NULL) || (size == NULL)) {
+    replyError(F("Missing arguments"));
+    return;
+  }
+  if (MrktCommunication.isPassthrough()) {
+    // the binary transfer cannot share the connection with the Grbl system
+    replyError(F("Not available in passthrough mode"));
+    return;
+  }
+  if (MrktReaderMode.isRunning()) {
+    // the upload might truncate the file being streamed and would delay the streaming
+    replyError(F("Not available while a job is running"));
+    return;
+  }
+  if (MrktBenchmarkMode.isRunning()) {
+    // the upload would distort the latencies and uses their memory (see Workspace.h)
+    replyError(F("Not available during a benchmark"));
+    return;
+  }
+  bool resume = (option != NULL) && (strcmp_P(option, PSTR("R")) == 0);
+  // the upload might replace the selected job file, so the reader mode lends its file - the
+  // final reply is sent by the uploader when the transfer is complete
+  if (!MrktUploader.start(MrktReaderMode.releaseFile(), fileName, strtoul(size, NULL, 10), resume)) {
+    replyError(F("Cannot open file"));
+  }
+#else
+  replyError(F("No SD card reader"));
+#endif
+}
+
+void HostCommands::executeTelemetry(char * arguments) {
+  MrktTelemetry.setRate(constrain(atoi(arguments), 0, TELEMETRY_MAX_RATE));
+  replyOK();
+}
+
+void HostCommands::replyOK() {
+  MrktHostChannel.println(F("ok"));
+}
+
+void HostCommands::replyError(const __FlashStringHelper * message) {
+  MrktHostChannel.print(F("error:"));
+  MrktHostChannel.println(message);
+}
@@ -0,0 +1,82 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_HostCommands_h
+#define MRKT_HostCommands_h
+
+#include "Configuration.h"
+
+/**
+ * This class interprets the commands that can be sent to Mrkt itself from the host 
+ * system. Commands are single lines of text; the replies follow the Grbl conventions:
+ * any number of [...] message lines, followed by either "ok" or "error:<message>".
+ * The replies are sent through the HostChannel, which marks them if the command was
+ * marked by the escape character (always the case in passthrough mode).
+ * 
+ * The following commands are supported:
+ *   STAT         - report the Grbl link statistics (see Communication::Statistics)
+ *   STAT RESET   - report and then clear the Grbl link statistics
+ *   BENCH [<n> [<query>]]
+ *                - run the latency benchmark with n queries (default 30) of the given 
+ *                  type (mix, ?, $G or G4P0; default mix), see BenchmarkMode
+ *   TELE <rate>  - send the binary telemetry frames with the given number of frames per 
+ *                  second, 0 stops the telemetry, see Telemetry
+ *   RUN <file>   - stream the file from the SD card to Grbl, see ReaderMode
+ *   PUT <file> <size> [R]
+ *                - upload a file of the given size to the SD card, resuming an interrupted
+ *                  upload if R is given; replies [PUT:<block>], followed by the binary 
+ *                  transfer and the final reply, see Uploader (not available in 
+ *                  passthrough mode and while a job is running)
+ */
+class HostCommands {
+
+  public:
+    /**
+     * The default constructor.
+     */
+    HostCommands();
+
+    /**
+     * Interprets and executes a single command line. The line must not contain 
+     * the line terminator.
+     */
+    void execute(char * command);
+
+  private:
+    /**
+     * The implementations of the individual commands.
+     */
+    void executeStatistics(bool reset);
+    void executeBenchmark(char * arguments);
+    void executeRun(char * arguments);
+    void executePut(char * arguments);
+    void executeTelemetry(char * arguments);
+
+    /**
+     * Sends the final "ok" line or an error message to the host system.
+     */
+    void replyOK();
+    void replyError(const __FlashStringHelper * message);
+    
+};
+
+/**
+ * Access to the "singleton" instance of the HostCommands class.
+ */
+extern HostCommands MrktHostCommands;
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include "Arduino.h"
+
+#include "Configuration.h"
+#include "IdleSleep.h"
+
+#if IDLE_SLEEP_ENABLED == 1
+
+#include "Communication.h"
+
+/**
+ * The "singleton" instance of the IdleSleep class.
+ */
+IdleSleep MrktIdleSleep;
+
+IdleSleep::IdleSleep() {
+  this->sleepTime = 0;
+}
+
+void IdleSleep::sleep() {
+  uint32_t startTime = micros();
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  // the data is checked with the interrupts disabled - the instruction following sei() is 
+  // executed before any pending interrupt, so a byte received after the check wakes us up
+  cli();
+  if (MrktCommunication.hasPendingInput()) {
+    sei();
+    return;
+  }
+  sleep_enable();
+  sei();
+  sleep_cpu();
+  sleep_disable();
+  this->sleepTime += micros() - startTime;
+}
+
+uint32_t IdleSleep::getSleepTime() {
+  return this->sleepTime;
+}
+
+#endif // IDLE_SLEEP_ENABLED
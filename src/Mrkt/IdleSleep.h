@@ -0,0 +1,70 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_IdleSleep_h
+#define MRKT_IdleSleep_h
+
+#include "Configuration.h"
+
+#if IDLE_SLEEP_ENABLED == 1
+
+/**
+ * This class puts the processor to sleep (SLEEP_MODE_IDLE) at the end of a main loop iteration
+ * in which no subsystem has any work left to do. Any interrupt wakes the processor up again:
+ * data received from the host system (USART) or the Grbl system (pin change), the encoder
+ * (external interrupts) or the system timer, which ticks every 1.024 ms and thus bounds the
+ * delay of the timeouts, refresh intervals and the polling of the keypad. All peripherals keep
+ * running in this sleep mode, so serial transmissions continue while the processor sleeps.
+ *
+ * The main loop does not sleep while the current mode is busy (see AbstractMode::isBusy()), 
+ * a mode switch is pending, an event of the user controls is queued or data has been received.
+ */
+class IdleSleep {
+
+  public:
+    /**
+     * The default constructor.
+     */
+    IdleSleep();
+
+    /**
+     * Sleeps until the next interrupt, unless data has been received from the host or the
+     * Grbl system. 
+     */
+    void sleep();
+
+    /**
+     * Returns the total time spent sleeping in µs (wrapping around like micros()).
+     */
+    uint32_t getSleepTime();
+
+  private:
+    /**
+     * The total time spent sleeping.
+     */
+    uint32_t sleepTime;
+
+};
+
+/**
+ * Access to the "singleton" instance of the IdleSleep class.
+ */
+extern IdleSleep MrktIdleSleep;
+
+#endif // IDLE_SLEEP_ENABLED
+
+#endif
@@ -25,6 +25,7 @@
 
 #include "Communication.h"
 #include "Display.h"
+#include "GrblSettings.h"
 #include "ModeController.h"
 #include "UserControls.h"
 
@@ -60,20 +61,36 @@
  */
 #define INIT_MODE_COMM_RETRY_DELAY     250
 
+/**
+ * The internal states, in the order of InitializationMode::InternalState (see StateMachine.h).
+ */
+const InitializationMode::InternalStateMachine::State InitializationMode_States[] PROGMEM = {
+  // enter                                     tick                                 delay                         next
+  { InitializationMode::enterInitial,          0,                                   0,                            InitializationMode::GrblSearchStart },
+  { InitializationMode::enterEventDisplay,     0,                                   INIT_MODE_EVENT_DISPLAY_TIME, InitializationMode::GrblWaiting },
+  { InitializationMode::enterGrblSearchStart,  0,                                   0,                            InitializationMode::GrblWaiting },
+  { 0,                                         InitializationMode::tickGrblWaiting, 0,                            STATE_MACHINE_NONE },
+  { InitializationMode::enterGrblCommError,    0,                                   INIT_MODE_COMM_RETRY_DELAY,   InitializationMode::GrblSearchStart },
+  { InitializationMode::enterGrblVersionFound, 0,                                   0,                            STATE_MACHINE_NONE },
+  { InitializationMode::enterGrblVersionError, 0,                                   0,                            STATE_MACHINE_NONE },
+  { InitializationMode::enterGrblVersionOK,    0,                                   INIT_MODE_GRBL_DISPLAY_TIME,  InitializationMode::Final },
+  { 0,                                         InitializationMode::tickFinal,       0,                            STATE_MACHINE_NONE }
+};
+
 /**
  * The "singleton" instance of the InitializationMode class.
  */
 InitializationMode MrktInitializationMode;
 
 InitializationMode::InitializationMode() : 
-  AbstractMode() {
+  AbstractMode(),
+  machine(InitializationMode_States) {
     // clear the version buffer
     memset(this->grblVersion, '\0', GRBL_VERSION_SIZE);
 }
 
 void InitializationMode::activate() {
-  this->state = Initial;
-  this->stateChangeTime = 0;
+  this->machine.switchTo(Initial);
   this->prevBlinkTime = 0;
   this->mainLEDStatus = LOW; 
 }
@@ -93,177 +110,99 @@ void InitializationMode::loop() {
     this->prevBlinkTime = currentTime;
   }
 
-  // check whether we can re-evaluate the current state
-  if (currentTime >= this->stateChangeTime) {
-    switch(this->state) {
-      case Initial:
-        loopInitial();
-        break;
-      case EventDisplay:
-        loopEventDisplay();
-        break;
-      case GrblSearchStart:
-        loopGrblSearchStart();
-        break;
-      case GrblWaiting:
-        loopGrblWaiting();
-        break;
-      case GrblCommError:
-        loopGrblCommError();
-        break;
-      case GrblVersionFound:
-        loopGrblVersionFound();
-        break;
-      case GrblVersionError:
-        loopGrblVersionError();
-        break;
-      case GrblVersionOK:
-        loopGrblVersionOK();
-        break;
-      case Final:
-        loopFinal();
-        break;     
-    }
-  }
+  this->machine.loop();
 }
 
-void InitializationMode::loopInitial() {
+void InitializationMode::enterInitial() {
   // set the main status LED to slow blinking mode
-  this->blinkInterval = INIT_MODE_BLINK_INTERVAL_INIT;
+  MrktInitializationMode.blinkInterval = INIT_MODE_BLINK_INTERVAL_INIT;
         
   // set the display contents - first line displays banner with version info
   MrktDisplay.clear();
-  MrktDisplay.print(F("Mrkt "));
+  MrktDisplay.writeString(STRING_MRKT);
   MrktDisplay.print(MRKT_VERSION);
-      
-  // next state: start GrblSearch without any delay
-  this->state = GrblSearchStart;
-  this->stateChangeTime = 0;
 }
 
-void InitializationMode::loopEventDisplay() {
-  // display the user control event
+void InitializationMode::enterEventDisplay() {
+  // display the user control event - the names of the events are stored in the order of 
+  // UserControls::EventType
   UserControls::Event event = MrktUserControls.getEvent();
   MrktDisplay.setCursor(0, 1);
-  switch(event.type) {
-    case UserControls::None:
-      // should never happen
-      break;        
-    case UserControls::KeyLeft:
-      MrktDisplay.print(F("KP Left         "));
-      break;
-    case UserControls::KeyRight:
-      MrktDisplay.print(F("KP Right        "));
-      break;
-    case UserControls::KeyUp:
-      MrktDisplay.print(F("KP Up           "));
-      break;
-    case UserControls::KeyDown:
-      MrktDisplay.print(F("KP Down         "));
-      break;
-    case UserControls::KeySelect:
-      MrktDisplay.print(F("KP Select       "));
-      break;
-    case UserControls::EncChanged:
-      MrktDisplay.print(F("E Wheel         "));
-      break;
-    case UserControls::EncButton:
-      MrktDisplay.print(F("E Button        "));
-      break;
-    case UserControls::ModeButton:
-      MrktDisplay.print(F("M Button        "));
-      break;
-  }
+  MrktDisplay.writeString(STRING_EVENT_NONE + event.type, DISPLAY_LCD_COLUMNS);
   MrktDisplay.setCursor(10, 1);
-  MrktDisplay.print(event.data);
-  
-  // next state: waiting mode after the message display delay
-  this->state = GrblWaiting;
-  this->stateChangeTime = millis() + INIT_MODE_EVENT_DISPLAY_TIME;
+  MrktDisplay.writeNumber(event.data);
 }
 
-void InitializationMode::loopGrblSearchStart() {
+void InitializationMode::enterGrblSearchStart() {
   // show a message that we're attempting to contact the Grbl system
   MrktDisplay.setCursor(0, 1);
-  MrktDisplay.print(F("Grbl            "));
+  MrktDisplay.writeString(STRING_GRBL, DISPLAY_LCD_COLUMNS);
   MrktDisplay.writeEllipsis(5, 1);
 
   // send the $I command to query the version identification 
   MrktCommunication.sendGrblCommand("$I", INIT_MODE_COMM_TIMEOUT, &InitializationMode::handleVersionQueryResponse);
-
-  // next state: waiting mode without any delay
-  this->state = GrblWaiting;
-  this->stateChangeTime = 0;
 }
 
-void InitializationMode::loopGrblWaiting() {
+void InitializationMode::tickGrblWaiting() {
   // if a user control event is encountered while waiting for a communication reply, 
   // switch to event display mode immediately
   if (MrktUserControls.isEventAvailable()) {
-    this->state = EventDisplay;
-    this->stateChangeTime = 0;
+    MrktInitializationMode.machine.switchTo(EventDisplay);
   }
-  // this state is only left through the communication response handler 
+  // otherwise, this state is only left through the communication response handler 
 }
 
-void InitializationMode::loopGrblCommError() {
-  // show the communication status received
+void InitializationMode::enterGrblCommError() {
+  // show the communication status received, the search is re-started after a brief delay
   MrktDisplay.setCursor(0, 1);
-  if (this->grblCommStatus < 0) {
-    MrktDisplay.print(F("Grbl Com Err    "));
+  if (MrktInitializationMode.grblCommStatus < 0) {
+    MrktDisplay.writeString(STRING_GRBL_COM_ERR, DISPLAY_LCD_COLUMNS);
   } else {
-    MrktDisplay.print(F("Grbl Cmd Err    "));
+    MrktDisplay.writeString(STRING_GRBL_CMD_ERR, DISPLAY_LCD_COLUMNS);
   }
   MrktDisplay.setCursor(13, 1);
-  MrktDisplay.print(this->grblCommStatus);
-
-  // re-start seach after a brief delay
-  this->state = GrblSearchStart;
-  this->stateChangeTime = millis() + INIT_MODE_COMM_RETRY_DELAY;
+  MrktDisplay.writeNumber(MrktInitializationMode.grblCommStatus);
 }
 
-void InitializationMode::loopGrblVersionFound() {
+void InitializationMode::enterGrblVersionFound() {
   // show the version information extracted
   MrktDisplay.setCursor(0, 1);
-  MrktDisplay.print(F("Grbl            "));
+  MrktDisplay.writeString(STRING_GRBL, DISPLAY_LCD_COLUMNS);
   MrktDisplay.setCursor(5, 1);
-  MrktDisplay.print(this->grblVersion);
+  MrktDisplay.print(MrktInitializationMode.grblVersion);
 
   // check the version and set the subsequent status
-  if (this->grblVersion[0] == '1') {
-    this->state = GrblVersionOK;
+  if (MrktInitializationMode.grblVersion[0] == '1') {
+    MrktInitializationMode.machine.switchTo(GrblVersionOK);
   } else {
-    this->state = GrblVersionError;
+    MrktInitializationMode.machine.switchTo(GrblVersionError);
   }
-  this->stateChangeTime = 0;  
 }
 
-void InitializationMode::loopGrblVersionError() {
+void InitializationMode::enterGrblVersionError() {
   // set the main status LED to fast blinking mode
-  this->blinkInterval = INIT_MODE_BLINK_INTERVAL_ERROR;
+  MrktInitializationMode.blinkInterval = INIT_MODE_BLINK_INTERVAL_ERROR;
 
-  // show the error status
+  // show the error status - this state can only be left through a system reset
   MrktDisplay.setCursor(12, 1);
-  MrktDisplay.print(F("ERR"));
-
-  // this state can only be left through a system reset
-  // set the state time high enough to prevent the display from flickering
-  this->stateChangeTime = millis() + INIT_MODE_GRBL_DISPLAY_TIME;
+  MrktDisplay.writeString(STRING_VERSION_ERR);
 }
 
-void InitializationMode::loopGrblVersionOK() {
+void InitializationMode::enterGrblVersionOK() {
   // show the status
   MrktDisplay.setCursor(12, 1);
-  MrktDisplay.print(F("OK"));
+  MrktDisplay.writeString(STRING_VERSION_OK);
 
-  // after a certain delay, hand over to the mode controller to swith to another mode
-  this->state = Final;
-  this->stateChangeTime = millis() + INIT_MODE_GRBL_DISPLAY_TIME;  
+  // read the settings required to estimate the runtime of jobs while the version is displayed
+  MrktCommunication.sendGrblCommand("$$", INIT_MODE_COMM_TIMEOUT, &InitializationMode::handleSettingsQueryResponse,
+                                    &GrblSettings::handleSettingLine);
 }
 
-void InitializationMode::loopFinal() {
-  // hand over to the actual working mode
-  MrktModeController.switchToInitialWorkingMode();
+void InitializationMode::tickFinal() {
+  // hand over to the actual working mode as soon as the settings have been received
+  if (MrktCommunication.isIdle()) {
+    MrktModeController.switchToInitialWorkingMode();
+  }
 }
 
 void InitializationMode::handleVersionQueryResponse(int status, char * response) {
@@ -277,13 +216,16 @@ void InitializationMode::handleVersionQueryResponse(int status, char * response)
     strncpy(MrktInitializationMode.grblVersion, version, (secondDot - version)); 
 
     // immediately switch state to evaluate version
-    MrktInitializationMode.state = GrblVersionFound;
-    MrktInitializationMode.stateChangeTime = 0;
+    MrktInitializationMode.machine.switchTo(GrblVersionFound);
   } else {
     // store error and switch state to display code
     MrktInitializationMode.grblCommStatus = status;
-    MrktInitializationMode.state = GrblCommError;
-    MrktInitializationMode.stateChangeTime = 0;
+    MrktInitializationMode.machine.switchTo(GrblCommError);
   }
 }
 
+void InitializationMode::handleSettingsQueryResponse(int status, char * response) {
+  // the settings have already been stored line by line - if they could not be read, 
+  // the defaults are used (see GrblSettings.h)
+}
+
@@ -20,6 +20,7 @@
 
 #include "Configuration.h"
 #include "AbstractMode.h"
+#include "StateMachine.h"
 
 /**
  * The number of characters to reserve for the Grbl version number.
@@ -85,7 +86,7 @@
  *                           │Grbl_1.1d___OK__ │      │Grbl_0.9f___ERR_ │                           
  *                           └─────────────────┘      └─────────────────┘                           
  *                                    │                                                             
- *                                    │                                                             
+ *                                    │ $$                                                          
  *                       INIT_MODE_GRBL_DISPLAY_TIME                                                
  *                                    │                                                             
  *                                    ▼                                                             
@@ -100,6 +101,10 @@
  *                   .─────────────────────────────────.                                            
  *                  ( hand over to initial working mode )                                           
  *                   `─────────────────────────────────'                                            
+ *
+ * The states are defined by a table (see StateMachine.h and InitializationMode.cpp): most of
+ * them show a message when they are entered and move on after a delay, GrblWaiting and Final
+ * poll for the user controls and the communication system.
  */
 class InitializationMode : public AbstractMode {
   
@@ -112,11 +117,10 @@ class InitializationMode : public AbstractMode {
     /**
      * See AbstractMode for an explanation of these methods.
      */
-    virtual void activate();
-    virtual void loop();
-    virtual void deactivate();
+    void activate();
+    void loop();
+    void deactivate();
 
-  private:
     /**
      * The enumeration to represent the internal state of the mode implementation.                                         
      */ 
@@ -131,12 +135,27 @@ class InitializationMode : public AbstractMode {
       GrblVersionOK, 
       Final 
     };
-    InternalState state;
+    typedef StateMachine<InternalState, Final + 1> InternalStateMachine;
 
     /**
-     * The system time to wait for before performing the next state check.
+     * The handlers of the internal states, called by the state machine (see 
+     * InitializationMode_States).
      */
-    uint32_t stateChangeTime;
+    static void enterInitial();
+    static void enterEventDisplay();
+    static void enterGrblSearchStart();
+    static void tickGrblWaiting();
+    static void enterGrblCommError();
+    static void enterGrblVersionFound();
+    static void enterGrblVersionError();
+    static void enterGrblVersionOK();
+    static void tickFinal();
+
+  private:
+    /**
+     * The state machine that keeps track of the internal state.
+     */
+    InternalStateMachine machine;
 
     /**
      * The value of the mode LED (used for blinking).
@@ -168,18 +187,10 @@ class InitializationMode : public AbstractMode {
      */
     static void handleVersionQueryResponse(int status, char * response);
 
-    /**
-     * The implementations called during the loop() processing for each internal state.
+    /** 
+     * The handler method for the $$ command (see GrblSettings).
      */
-    void loopInitial();
-    void loopEventDisplay();
-    void loopGrblSearchStart();
-    void loopGrblWaiting();
-    void loopGrblCommError();
-    void loopGrblVersionFound();
-    void loopGrblVersionError();
-    void loopGrblVersionOK();
-    void loopFinal();
+    static void handleSettingsQueryResponse(int status, char * response);
 };
 
 /**
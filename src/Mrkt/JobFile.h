@@ -0,0 +1,87 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_JobFile_h
+#define MRKT_JobFile_h
+
+#include <inttypes.h>
+
+/**
+ * The definition of the precompiled job file format. Job files are created from G-code files
+ * by the host tool mrktc (see tools/mrktc.cpp) and can be streamed by the reader mode without
+ * any processing of the lines on the device. This file does not depend on the Arduino libraries
+ * because it is shared with the host tools. All values are stored little-endian, which is the 
+ * native byte order of both the AVR and the x86 host systems.
+ * 
+ * A job file consists of blocks of JOB_FILE_BLOCK_SIZE bytes, matching the sectors of the SD card:
+ * 
+ *   block 0         the header (JobFileHeader), padded with zeros
+ *   index blocks    the sparse line index: an uint32_t byte offset for every 
+ *                   indexStride-th line, i.e. the offset of line n * indexStride in entry n
+ *   data blocks     the lines, stored as records consisting of an uint8_t length followed 
+ *                   by the minified line without line terminator
+ * 
+ * A record never crosses a block boundary. A length of zero marks the end of the records 
+ * within a block, the next record starts at the next block. Line numbers are zero-based
+ * and refer to the lines stored in the job file (lines that only contained comments are
+ * not stored at all).
+ */
+
+/**
+ * The identification at the start of every job file, including the \0 character, 
+ * and the current format version.
+ */
+#define JOB_FILE_MAGIC          "MRKTJOB"
+#define JOB_FILE_MAGIC_SIZE     8
+#define JOB_FILE_VERSION        1
+
+/**
+ * The size of the blocks of a job file.
+ */
+#define JOB_FILE_BLOCK_SIZE     512
+
+/**
+ * The maximum length of a line, matching the line buffer of Grbl.
+ */
+#define JOB_FILE_MAX_LINE_LENGTH 79
+
+/**
+ * The default number of lines between two index entries.
+ */
+#define JOB_FILE_INDEX_STRIDE   32
+
+/**
+ * The header at the start of the job file. The coordinates of the bounding box are given 
+ * in µm (work coordinates), the estimated runtime is based on the maximum rates of the 
+ * machine given to the host tool.
+ */
+struct JobFileHeader {
+  char     magic[JOB_FILE_MAGIC_SIZE];
+  uint16_t version;
+  uint16_t indexStride;
+  uint32_t lineCount;
+  uint32_t indexOffset;
+  uint32_t indexEntries;
+  uint32_t dataOffset;
+  uint32_t dataSize;
+  int32_t  boundsMin[3];
+  int32_t  boundsMax[3];
+  uint32_t estimatedTime;
+  uint32_t sourceSize;
+} __attribute__((packed));
+
+#endif
@@ -0,0 +1,149 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "Arduino.h"
+
+#include "Configuration.h"
+#include "JobLog.h"
+
+#if (SDCARD_AVAILABLE == 1) && (JOB_LOG_ENABLED == 1)
+
+#include "Communication.h"
+#include "Telemetry.h"
+
+#if (JOB_LOG_MAGIC_SIZE != STORAGE_RING_MAGIC_SIZE) || (JOB_LOG_BLOCK_SIZE != STORAGE_BLOCK_SIZE)
+#error "The header of the job log does not match the header of a block ring (see Storage.h)."
+#endif
+
+/**
+ * The "singleton" instance of the JobLog class.
+ */
+JobLog MrktJobLog;
+
+JobLog::JobLog() {
+  this->active = false;
+  this->dropped = 0;
+}
+
+bool JobLog::start(uint16_t fileId, uint32_t firstLine, bool resumed) {
+  if (!this->active) {
+    this->active = open();
+    if (!this->active) {
+      return false;
+    }
+  }
+  JobLogRecord * record = addRecord(JOB_LOG_START, resumed ? 1 : 0, firstLine);
+  if (record != 0) {
+    record->feedRate = fileId;
+  }
+  return true;
+}
+
+void JobLog::logStatus(uint32_t linesAcknowledged) {
+  StatusSniffer & sniffer = MrktCommunication.getSniffer();
+  const StatusSniffer::Status & status = sniffer.getStatus();
+  JobLogRecord * record = addRecord(JOB_LOG_STATUS, Telemetry::getStateCode(status.state), 
+                                    linesAcknowledged);
+  if (record != 0) {
+    record->feedRate = min(status.feedRate, 0xFFFF);
+    for (uint8_t axis = 0; axis < 3; axis++) {
+      record->position[axis] = sniffer.getMachinePosition(axis);
+    }
+  }
+}
+
+void JobLog::logResponse(int status, uint32_t line) {
+  if (status == COMMUNICATION_STATUS_OK) {
+    addRecord(JOB_LOG_OK, 0, line);
+  } else {
+    addRecord(JOB_LOG_ERROR, status, line);
+  }
+}
+
+void JobLog::stop(int status) {
+  addRecord(JOB_LOG_END, status, 0);
+  if (this->active && (this->block.count > 0)) {
+    // the job has ended, so there is no need to wait for an idle moment
+    writeBlock();
+  }
+}
+
+void JobLog::loop() {
+  if (!this->active || (this->block.count == 0)) {
+    return;
+  }
+  if ((this->block.count == JOB_LOG_RECORDS_PER_BLOCK) || 
+      (millis() - this->lastWriteTime > JOB_LOG_FLUSH_INTERVAL)) {
+    writeBlock();
+  }
+}
+
+bool JobLog::open() {
+  // the block buffer is not in use yet - it holds the header while the run number is updated
+  if (!MrktStorage.openBlockRing(JOB_LOG_FILE_NAME, PSTR(JOB_LOG_MAGIC), JOB_LOG_VERSION,
+                                 JOB_LOG_DATA_BLOCKS, (uint8_t *) &this->block,
+                                 this->firstBlock, this->run)) {
+    return false;
+  }
+  memset(&this->block, 0, sizeof(JobLogBlock));
+  this->block.run = this->run;
+  this->dropped = 0;
+  this->lastWriteTime = millis();
+  return true;
+}
+
+JobLogRecord * JobLog::addRecord(uint8_t type, int8_t code, uint32_t line) {
+  if (!this->active) {
+    return 0;
+  }
+  if (this->block.count == JOB_LOG_RECORDS_PER_BLOCK) {
+    // the block has not been written yet
+    if (this->dropped < 0xFF) {
+      this->dropped++;
+    }
+    return 0;
+  }
+  JobLogRecord * record = &this->block.records[this->block.count++];
+  memset(record, 0, sizeof(JobLogRecord));
+  record->time = millis();
+  record->line = line;
+  record->type = type;
+  record->code = code;
+  return record;
+}
+
+void JobLog::writeBlock() {
+  uint32_t position = this->firstBlock + 1 + this->block.number % JOB_LOG_DATA_BLOCKS;
+  if (!MrktStorage.getFileSystem().card()->writeBlock(position, (const uint8_t *) &this->block)) {
+    // the card has probably been removed - the log is opened again when the next job starts
+    this->active = false;
+    return;
+  }
+  this->lastWriteTime = millis();
+  if (this->block.count == JOB_LOG_RECORDS_PER_BLOCK) {
+    // a partially filled block is written again when it has been filled up
+    this->block.number++;
+    this->block.count = 0;
+    this->block.dropped = this->dropped;
+    this->dropped = 0;
+  }
+}
+
+#endif // SDCARD_AVAILABLE && JOB_LOG_ENABLED
@@ -0,0 +1,130 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_JobLog_h
+#define MRKT_JobLog_h
+
+#include "Configuration.h"
+
+#if (SDCARD_AVAILABLE == 1) && (JOB_LOG_ENABLED == 1)
+
+#include "JobLogFile.h"
+#include "Storage.h"
+
+/**
+ * The number of data blocks of the log file (the file is one block larger).
+ */
+#define JOB_LOG_DATA_BLOCKS    2047
+
+/**
+ * The time in ms after which a block that is only partially filled is written, so that 
+ * the log is reasonably complete if the power is lost.
+ */
+#define JOB_LOG_FLUSH_INTERVAL 5000
+
+/**
+ * This class records the status reports, the acknowledgements and the errors received 
+ * while a job is streamed in a file on the SD card (see JobLogFile.h). 
+ *
+ * The records are collected in a buffer that holds a complete block and only the full block
+ * is written to the card. To keep the streaming path free of any delays, the records are only
+ * copied to the buffer when they are received - the block is written by loop(), which the
+ * reader mode calls while no line can be sent. The file is allocated in one contiguous piece
+ * when the first job is started and the blocks are written directly to the card, bypassing 
+ * the file system: there is no cluster allocation or directory update while a job is running.
+ * Records that are received while the buffer is full are dropped and counted.
+ */
+class JobLog {
+
+  public:
+    /**
+     * The default constructor.
+     */
+    JobLog();
+
+    /**
+     * Records the start of a job, allocating the log file if necessary. Returns false if 
+     * the file cannot be used - no records are stored in this case.
+     */
+    bool start(uint16_t fileId, uint32_t firstLine, bool resumed);
+
+    /**
+     * Records a status report (taken from the status sniffer of the communication system).
+     */
+    void logStatus(uint32_t linesAcknowledged);
+
+    /**
+     * Records the acknowledgement of a line or an error.
+     */
+    void logResponse(int status, uint32_t line);
+
+    /**
+     * Records the end of a job and writes the records collected.
+     */
+    void stop(int status);
+
+    /**
+     * Writes the buffer if it is full or the flush interval has elapsed. This method may 
+     * take a few milliseconds and is only called while the Grbl system is busy.
+     */
+    void loop();
+
+  private:
+    /**
+     * Whether the log file is in use, the first block of the file on the card and the run
+     * number.
+     */
+    bool active;
+    uint32_t firstBlock;
+    uint16_t run;
+
+    /**
+     * The block being filled and the time it was last written.
+     */
+    JobLogBlock block;
+    uint32_t lastWriteTime;
+
+    /**
+     * The number of records dropped since the buffer has been filled up.
+     */
+    uint8_t dropped;
+
+    /**
+     * Opens or allocates the log file and starts a new run.
+     */
+    bool open();
+
+    /**
+     * Returns a new record in the buffer, or 0 if the buffer is full.
+     */
+    JobLogRecord * addRecord(uint8_t type, int8_t code, uint32_t line);
+
+    /**
+     * Writes the buffer to the card and starts the next block if it was full.
+     */
+    void writeBlock();
+
+};
+
+/**
+ * Access to the "singleton" instance of the JobLog class.
+ */
+extern JobLog MrktJobLog;
+
+#endif // SDCARD_AVAILABLE && JOB_LOG_ENABLED
+
+#endif
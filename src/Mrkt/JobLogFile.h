@@ -0,0 +1,114 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_JobLogFile_h
+#define MRKT_JobLogFile_h
+
+#include <inttypes.h>
+
+/**
+ * The definition of the job log file written to the SD card (see JobLog) and evaluated by
+ * the host tool mrktlog (see tools/mrktlog.cpp). This file does not depend on the Arduino 
+ * libraries because it is shared with the host tools. All values are stored little-endian.
+ *
+ * The log file is allocated in one piece before the first job is logged and consists of 
+ * blocks of JOB_LOG_BLOCK_SIZE bytes, matching the sectors of the SD card:
+ *
+ *   block 0         the header (JobLogHeader), padded with zeros
+ *   blocks 1 to n   a ring of data blocks (JobLogBlock)
+ *
+ * The data blocks are numbered consecutively; block number b is stored in block 
+ * 1 + (b % n) of the file, so the most recent blocks are kept once the ring is full. Every 
+ * power-up of Mrkt starts a new run: the blocks of older runs can be told apart by their
+ * run number.
+ */
+
+/**
+ * The identification at the start of the log file, including the \0 character, and the
+ * current format version.
+ */
+#define JOB_LOG_MAGIC              "MRKTLOG"
+#define JOB_LOG_MAGIC_SIZE         8
+#define JOB_LOG_VERSION            1
+
+/**
+ * The name of the log file on the SD card.
+ */
+#define JOB_LOG_FILE_NAME          "MRKTLOG.DAT"
+
+/**
+ * The size of the blocks and the number of records per data block.
+ */
+#define JOB_LOG_BLOCK_SIZE         512
+#define JOB_LOG_RECORDS_PER_BLOCK  21
+
+/**
+ * The types of the records:
+ *   JOB_LOG_START   a job has been started; the code is 1 if the job has been resumed,
+ *                   the line is the first line sent and the feed rate holds the file ID
+ *   JOB_LOG_STATUS  a status report; the code is the state (see TELEMETRY_STATE_* in 
+ *                   TelemetryFrame.h), the line is the number of lines acknowledged
+ *   JOB_LOG_OK      a line has been acknowledged; the line is its number
+ *   JOB_LOG_ERROR   a line has been rejected; the code is the Grbl error code or a negative 
+ *                   communication status (see Communication.h)
+ *   JOB_LOG_END     the job has ended; the code is 0 if it has been completed, or the
+ *                   error code of the reader mode (the jobs of a playlist that follow each 
+ *                   other without a pause are only separated by the start record)
+ * Only status records contain the position and the feed rate.
+ */
+#define JOB_LOG_START              1
+#define JOB_LOG_STATUS             2
+#define JOB_LOG_OK                 3
+#define JOB_LOG_ERROR              4
+#define JOB_LOG_END                5
+
+/**
+ * The header in block 0. The run number is incremented with every run.
+ */
+struct JobLogHeader {
+  char     magic[JOB_LOG_MAGIC_SIZE];
+  uint16_t version;
+  uint16_t run;
+  uint32_t dataBlocks;
+} __attribute__((packed));
+
+/**
+ * A single record. The time is given in ms since the power-up, the position is the machine 
+ * position in µm (or 1/1000 inch if Grbl reports in inches) and the feed rate in mm/min.
+ */
+struct JobLogRecord {
+  uint32_t time;
+  uint32_t line;
+  uint8_t  type;
+  int8_t   code;
+  uint16_t feedRate;
+  int32_t  position[3];
+} __attribute__((packed));
+
+/**
+ * A data block. The number of records dropped is the number of records that could not be
+ * stored before this block because the previous block had not been written yet.
+ */
+struct JobLogBlock {
+  uint16_t     run;
+  uint8_t      count;
+  uint8_t      dropped;
+  uint32_t     number;
+  JobLogRecord records[JOB_LOG_RECORDS_PER_BLOCK];
+} __attribute__((packed));
+
+#endif
@@ -0,0 +1,203 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "Arduino.h"
+
+#include "Configuration.h"
+#include "JobScanner.h"
+
+#if SDCARD_AVAILABLE == 1
+
+#include "GrblSettings.h"
+#include "JobFile.h"
+
+/**
+ * The "singleton" instance of the JobScanner class.
+ */
+JobScanner MrktJobScanner;
+
+JobScanner::JobScanner() {
+  this->state = Idle;
+  this->file = NULL;
+  memset(&this->key, 0, sizeof(Sidecar));
+}
+
+void JobScanner::loop() {
+  if (this->state != Scanning) {
+    return;
+  }
+  uint32_t startTime = millis();
+  while (millis() - startTime < JOB_SCANNER_TIME_BUDGET) {
+    int nextChar = this->file->read();
+    if (nextChar < 0) {
+      // end of file - process the last line unless it was terminated
+      if (this->lineLength > 0) {
+        processLine();
+      }
+      finishScan();
+      return;
+    }
+    if (nextChar == '\n') {
+      processLine();
+    } else if ((nextChar != '\r') && (this->lineLength < JOB_SCANNER_LINE_BUFFER_SIZE)) {
+      this->lineBuffer[this->lineLength] = nextChar;
+      this->lineLength++;
+    }
+  }
+}
+
+void JobScanner::request(const char * fileName, SdFile & file, char * lineBuffer,
+                         GCodeMinifier & minifier, MotionEstimator & estimator) {
+  this->state = Idle;
+  this->file = &file;
+  this->lineBuffer = lineBuffer;
+  this->minifier = &minifier;
+  this->estimator = &estimator;
+  memset(&this->key, 0, sizeof(Sidecar));
+  if (!file.isOpen() || !file.seekSet(0)) {
+    return;
+  }
+  if (readJobFileHeader()) {
+    this->state = Complete;
+    return;
+  }
+
+  // the sidecar file has the name of the job file with a different extension
+  strncpy(this->sidecarName, fileName, 8);
+  this->sidecarName[8] = '\0';
+  char * extension = strchr(this->sidecarName, '.');
+  if (extension == NULL) {
+    extension = this->sidecarName + strlen(this->sidecarName);
+  }
+  strcpy_P(extension, PSTR("." JOB_SCANNER_SIDECAR_EXTENSION));
+
+  this->key.fileSize = file.fileSize();
+  file.getModifyDateTime(&this->key.modifyDate, &this->key.modifyTime);
+  for (uint8_t axis = 0; axis < MOTION_ESTIMATOR_AXES; axis++) {
+    this->key.maxRates[axis] = MrktGrblSettings.getMaxRate(axis);
+  }
+  if (readSidecar()) {
+    this->state = Complete;
+    return;
+  }
+
+  // scan the file
+  minifier.reset();
+  estimator.reset();
+  for (uint8_t axis = 0; axis < MOTION_ESTIMATOR_AXES; axis++) {
+    estimator.setMaxRate(axis, this->key.maxRates[axis]);
+  }
+  this->lineLength = 0;
+  this->state = Scanning;
+}
+
+void JobScanner::cancel() {
+  if (this->state == Scanning) {
+    this->state = Idle;
+  }
+}
+
+bool JobScanner::isComplete() {
+  return (this->state == Complete);
+}
+
+bool JobScanner::isScanning() {
+  return (this->state == Scanning);
+}
+
+uint8_t JobScanner::getProgress() {
+  if (this->state == Complete) {
+    return 100;
+  }
+  if ((this->state != Scanning) || (this->key.fileSize == 0)) {
+    return 0;
+  }
+  // the position is reduced first to prevent an overflow for large files
+  return (this->file->curPosition() / 256) * 100 / (this->key.fileSize / 256 + 1);
+}
+
+const JobScanner::Result & JobScanner::getResult() {
+  return this->key.result;
+}
+
+void JobScanner::processLine() {
+  this->lineBuffer[this->lineLength] = '\0';
+  this->lineLength = 0;
+  if (this->minifier->minify(this->lineBuffer) > 0) {
+    this->estimator->process(this->lineBuffer);
+  }
+}
+
+void JobScanner::finishScan() {
+  Result & result = this->key.result;
+  for (uint8_t axis = 0; axis < MOTION_ESTIMATOR_AXES; axis++) {
+    result.boundsMin[axis] = this->estimator->getBoundsMin(axis);
+    result.boundsMax[axis] = this->estimator->getBoundsMax(axis);
+  }
+  result.feedDistance = this->estimator->getFeedDistance();
+  result.rapidDistance = this->estimator->getRapidDistance();
+  result.estimatedTime = (this->estimator->getTotalTime() + 500) / 1000;
+  this->state = Complete;
+
+  // store the result - if this fails, the file will simply be scanned again next time
+  SdFile sidecar;
+  if (sidecar.open(this->sidecarName, O_WRITE | O_CREAT | O_TRUNC)) {
+    sidecar.write(&this->key, sizeof(Sidecar));
+    sidecar.close();
+  }
+}
+
+bool JobScanner::readJobFileHeader() {
+  JobFileHeader header;
+  if ((this->file->read(&header, sizeof(header)) != sizeof(header)) ||
+      (memcmp(header.magic, JOB_FILE_MAGIC, JOB_FILE_MAGIC_SIZE) != 0) ||
+      (header.version != JOB_FILE_VERSION)) {
+    this->file->seekSet(0);
+    return false;
+  }
+  Result & result = this->key.result;
+  for (uint8_t axis = 0; axis < MOTION_ESTIMATOR_AXES; axis++) {
+    result.boundsMin[axis] = header.boundsMin[axis];
+    result.boundsMax[axis] = header.boundsMax[axis];
+  }
+  // the distances are not part of the header
+  result.feedDistance = 0;
+  result.rapidDistance = 0;
+  result.estimatedTime = header.estimatedTime;
+  return true;
+}
+
+bool JobScanner::readSidecar() {
+  SdFile sidecar;
+  if (!sidecar.open(this->sidecarName, O_READ)) {
+    return false;
+  }
+  Sidecar contents;
+  bool valid = (sidecar.read(&contents, sizeof(Sidecar)) == sizeof(Sidecar)) &&
+               (memcmp(&contents, &this->key, offsetof(Sidecar, result)) == 0);
+  sidecar.close();
+  if (valid) {
+    this->key.result = contents.result;
+  }
+  return valid;
+}
+
+#endif // SDCARD_AVAILABLE
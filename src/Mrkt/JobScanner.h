@@ -0,0 +1,192 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_JobScanner_h
+#define MRKT_JobScanner_h
+
+#include "Configuration.h"
+
+#if SDCARD_AVAILABLE == 1
+
+#include "GCodeMinifier.h"
+#include "MotionEstimator.h"
+#include "Storage.h"
+
+/**
+ * The time in ms the scanner may spend during a single main loop iteration.
+ */
+#define JOB_SCANNER_TIME_BUDGET       4
+
+/**
+ * The number of characters of a line that are scanned. The remainder of longer lines is ignored.
+ */
+#define JOB_SCANNER_LINE_BUFFER_SIZE 80
+
+/**
+ * The extension of the sidecar files that hold the results of a scan.
+ */
+#define JOB_SCANNER_SIDECAR_EXTENSION "MSC"
+
+/**
+ * This class determines the extents, the distances and the estimated runtime of a job file 
+ * before it is run. The file is scanned in the background, during the main loop iterations 
+ * in which the Grbl connection is idle, and each iteration is limited to JOB_SCANNER_TIME_BUDGET 
+ * ms so that even large files do not block the user interface. The lines are interpreted by
+ * the MotionEstimator, using the maximum rates read from Grbl (see GrblSettings).
+ * 
+ * The scanner has no buffers of its own: it reads the job file opened by the ReaderMode and
+ * uses its line buffer, minifier and estimator, which the ReaderMode does not need until the
+ * job is started. The ReaderMode cancels the scan before it uses them again.
+ * 
+ * The results are stored in a sidecar file next to the job file (e.g. JOB.MSC for JOB.NC) 
+ * together with the size and modification time of the job file and the rates used, so that 
+ * every file is only scanned once. Precompiled job files are not scanned at all - their 
+ * header already contains the bounding box and the estimated runtime.
+ */
+class JobScanner {
+
+  public:
+    /**
+     * The information determined by the scan. Coordinates are given in µm, distances in mm
+     * (0 if unknown) and the time in s.
+     */
+    struct Result {
+      Coordinate boundsMin[MOTION_ESTIMATOR_AXES];
+      Coordinate boundsMax[MOTION_ESTIMATOR_AXES];
+      uint32_t feedDistance;
+      uint32_t rapidDistance;
+      uint32_t estimatedTime;
+    };
+
+    /**
+     * The default constructor.
+     */
+    JobScanner();
+
+    /**
+     * This method has to be called from the main loop while the Grbl connection is idle.
+     */
+    void loop();
+
+    /**
+     * Requests the information about the job file given, either from its sidecar file, the
+     * header of a precompiled job file or by scanning the file. The file has to be open; it 
+     * is scanned using the line buffer (at least JOB_SCANNER_LINE_BUFFER_SIZE + 1 characters),
+     * the minifier and the estimator given, which must not be used otherwise until the scan 
+     * is complete or cancelled. A scan that is still running is cancelled.
+     */
+    void request(const char * fileName, SdFile & file, char * lineBuffer,
+                 GCodeMinifier & minifier, MotionEstimator & estimator);
+
+    /**
+     * Cancels a running scan, releasing the file and the buffers passed to request(). The 
+     * information about the file remains unavailable unless it has been determined already.
+     */
+    void cancel();
+
+    /**
+     * Checks whether the information about the requested file is available.
+     */
+    bool isComplete();
+
+    /**
+     * Checks whether a file is being scanned, i.e. whether loop() has work to do.
+     */
+    bool isScanning();
+
+    /**
+     * Returns the progress of the scan in percent.
+     */
+    uint8_t getProgress();
+
+    /**
+     * Provides access to the information about the requested file (see isComplete()).
+     */
+    const Result & getResult();
+
+  private:
+    /**
+     * The enumeration to represent the internal state of the scanner.
+     */
+    enum InternalState { Idle, Scanning, Complete };
+    InternalState state;
+
+    /**
+     * The contents of a sidecar file: the identification of the job file and the rates 
+     * the estimate is based on, followed by the result.
+     */
+    struct Sidecar {
+      uint32_t fileSize;
+      uint16_t modifyDate;
+      uint16_t modifyTime;
+      uint16_t maxRates[MOTION_ESTIMATOR_AXES];
+      Result   result;
+    };
+
+    /**
+     * The file being scanned and the name of the sidecar file.
+     */
+    SdFile * file;
+    char sidecarName[13];
+
+    /**
+     * The identification of the file being scanned, followed by the result of the last scan.
+     */
+    Sidecar key;
+
+    /**
+     * The buffer holding the line currently being read.
+     */
+    char * lineBuffer;
+    uint8_t lineLength;
+
+    /**
+     * The minifier is used to compact the lines for the motion estimator.
+     */
+    GCodeMinifier * minifier;
+    MotionEstimator * estimator;
+
+    /**
+     * Processes the line in the line buffer.
+     */
+    void processLine();
+
+    /**
+     * Completes the scan and stores the result in the sidecar file.
+     */
+    void finishScan();
+
+    /**
+     * Checks whether the file is a precompiled job file and takes the information from the header.
+     */
+    bool readJobFileHeader();
+
+    /**
+     * Attempts to read the result from the sidecar file.
+     */
+    bool readSidecar();
+
+};
+
+/**
+ * Access to the "singleton" instance of the JobScanner class.
+ */
+extern JobScanner MrktJobScanner;
+
+#endif // SDCARD_AVAILABLE
+
+#endif
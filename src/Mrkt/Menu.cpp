@@ -0,0 +1,240 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "Arduino.h"
+
+#include "Configuration.h"
+#include "Menu.h"
+
+#include "Coordinates.h"
+#include "Display.h"
+
+Menu::Menu() {
+  this->root = 0;
+  this->rootSize = 0;
+  this->depth = 0;
+  this->path[0] = 0;
+  this->firstVisible = 0;
+  this->editing = false;
+}
+
+void Menu::begin(const Entry * root, uint8_t rootSize) {
+  this->root = root;
+  this->rootSize = rootSize;
+  this->depth = 0;
+  this->path[0] = 0;
+  this->firstVisible = 0;
+  this->editing = false;
+  display();
+}
+
+bool Menu::handleEvent(UserControls::Event event) {
+  switch(event.type) {
+    case UserControls::KeyUp:
+      if (this->editing) {
+        changeValue(event.data);
+      } else {
+        moveCursor(-event.data);
+      }
+      break;
+    case UserControls::KeyDown:
+      if (this->editing) {
+        changeValue(-event.data);
+      } else {
+        moveCursor(event.data);
+      }
+      break;
+    case UserControls::EncChanged:
+      if (this->editing) {
+        changeValue(event.data);
+      } else {
+        moveCursor(event.data);
+      }
+      break;
+    case UserControls::KeyRight:
+      if (this->editing) {
+        return false;
+      }
+      selectEntry();
+      break;
+    case UserControls::KeySelect:
+    case UserControls::EncButton:
+      selectEntry();
+      break;
+    case UserControls::KeyLeft:
+    case UserControls::ModeButton:
+      return goBack();
+    default:
+      return false;
+  }
+  return true;
+}
+
+void Menu::display() {
+  displayRow(0);
+  displayRow(1);
+}
+
+const Menu::Entry * Menu::getCurrentMenu(uint8_t & size) {
+  const Entry * entries = this->root;
+  size = this->rootSize;
+  for (uint8_t level = 0; level < this->depth; level++) {
+    const Entry * entry = &entries[this->path[level]];
+    entries = (const Entry *) pgm_read_ptr(&entry->submenu);
+    size = pgm_read_byte(&entry->submenuSize);
+  }
+  return entries;
+}
+
+void Menu::readEntry(uint8_t index, Entry & entry) {
+  uint8_t size;
+  memcpy_P(&entry, &getCurrentMenu(size)[index], sizeof(Entry));
+}
+
+void Menu::moveCursor(int8_t steps) {
+  uint8_t current = this->path[this->depth];
+  uint8_t size;
+  getCurrentMenu(size);
+  int16_t index = constrain(current + steps, 0, size - 1);
+  if (index == current) {
+    return;
+  }
+  this->path[this->depth] = index;
+  if (index < this->firstVisible) {
+    this->firstVisible = index;
+    display();
+  } else if (index > this->firstVisible + 1) {
+    this->firstVisible = index - 1;
+    display();
+  } else {
+    // both entries stay visible - only the marks move
+    displayMark(current - this->firstVisible);
+    displayMark(index - this->firstVisible);
+  }
+}
+
+void Menu::changeValue(int8_t steps) {
+  uint8_t current = this->path[this->depth];
+  Entry entry;
+  readEntry(current, entry);
+  int16_t value = constrain((int32_t) this->editValue + steps, entry.minimum, entry.maximum);
+  if (value != this->editValue) {
+    this->editValue = value;
+    displayRow(current - this->firstVisible);
+  }
+}
+
+void Menu::selectEntry() {
+  uint8_t current = this->path[this->depth];
+  Entry entry;
+  readEntry(current, entry);
+  switch(entry.type) {
+    case MENU_ENTRY_SUBMENU:
+      if ((this->depth < MENU_MAX_DEPTH - 1) && (entry.submenuSize > 0)) {
+        this->depth++;
+        this->path[this->depth] = 0;
+        this->firstVisible = 0;
+        display();
+      }
+      break;
+    case MENU_ENTRY_ACTION:
+      entry.action();
+      break;
+    case MENU_ENTRY_VALUE:
+      if (this->editing) {
+        entry.setter(this->editValue);
+        this->editing = false;
+      } else {
+        this->editValue = entry.getter();
+        this->editing = true;
+      }
+      displayRow(current - this->firstVisible);
+      break;
+  }
+}
+
+bool Menu::goBack() {
+  if (this->editing) {
+    // discard the new value
+    this->editing = false;
+    displayRow(this->path[this->depth] - this->firstVisible);
+    return true;
+  }
+  if (this->depth == 0) {
+    return false;
+  }
+  this->depth--;
+  // show the entry of the submenu in the second row, unless it is the first one
+  uint8_t current = this->path[this->depth];
+  this->firstVisible = (current > 0) ? current - 1 : 0;
+  display();
+  return true;
+}
+
+void Menu::displayRow(uint8_t row) {
+  uint8_t size;
+  getCurrentMenu(size);
+  uint8_t index = this->firstVisible + row;
+  if (index >= size) {
+    MrktDisplay.setCursor(0, row);
+    MrktDisplay.writeString(STRING_EMPTY, DISPLAY_LCD_COLUMNS);
+    return;
+  }
+  Entry entry;
+  readEntry(index, entry);
+  displayMark(row);
+  uint8_t length = 1 + MrktDisplay.writeString(entry.label);
+
+  // the submenus are marked by an ellipsis, the values are shown right-aligned
+  uint8_t valueLength = 0;
+  char digits[12];
+  int16_t value = 0;
+  if (entry.type == MENU_ENTRY_SUBMENU) {
+    valueLength = 1;
+  } else if (entry.type == MENU_ENTRY_VALUE) {
+    value = (this->editing && (index == this->path[this->depth])) ? this->editValue : entry.getter();
+    valueLength = Coordinates::formatUnsigned((value < 0) ? -(int32_t) value : value, digits);
+    if (value < 0) {
+      valueLength++;
+    }
+  }
+  for (; length < DISPLAY_LCD_COLUMNS - valueLength; length++) {
+    MrktDisplay.write(' ');
+  }
+  if (entry.type == MENU_ENTRY_SUBMENU) {
+    MrktDisplay.writeEllipsis();
+  } else if (entry.type == MENU_ENTRY_VALUE) {
+    if (value < 0) {
+      MrktDisplay.write('-');
+    }
+    MrktDisplay.print(digits);
+  }
+}
+
+void Menu::displayMark(uint8_t row) {
+  MrktDisplay.setCursor(0, row);
+  if (this->firstVisible + row != this->path[this->depth]) {
+    MrktDisplay.write(' ');
+  } else if (this->editing) {
+    MrktDisplay.writePlusMinus();
+  } else {
+    MrktDisplay.write('>');
+  }
+}
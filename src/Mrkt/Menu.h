@@ -0,0 +1,186 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_Menu_h
+#define MRKT_Menu_h
+
+#include "Configuration.h"
+#include "StringTable.h"
+#include "UserControls.h"
+
+/**
+ * The maximum nesting depth of the menus, including the root menu.
+ */
+#define MENU_MAX_DEPTH       4
+
+/**
+ * The types of the menu entries: an entry either opens a submenu, calls an action or
+ * shows a value that can be changed within a range.
+ */
+#define MENU_ENTRY_SUBMENU   0
+#define MENU_ENTRY_ACTION    1
+#define MENU_ENTRY_VALUE     2
+
+/**
+ * These macros define the menu entries, e.g.
+ *
+ *   const Menu::Entry Example_Menu[] PROGMEM = {
+ *     MENU_SUBMENU(STRING_MACHINE,     Example_MachineMenu),
+ *     MENU_ACTION(STRING_UNLOCK,       unlock),
+ *     MENU_VALUE(STRING_BACKLIGHT,     getBacklight, setBacklight, 0, 10)
+ *   };
+ *
+ * where the submenu is another array of entries defined before. The labels are strings of the
+ * string table (see Strings.txt) of up to 12 characters.
+ */
+#define MENU_SUBMENU(label, entries) \
+  { label, MENU_ENTRY_SUBMENU, entries, sizeof(entries) / sizeof(Menu::Entry), 0, 0, 0, 0, 0 }
+#define MENU_ACTION(label, action) \
+  { label, MENU_ENTRY_ACTION, 0, 0, action, 0, 0, 0, 0 }
+#define MENU_VALUE(label, getter, setter, minimum, maximum) \
+  { label, MENU_ENTRY_VALUE, 0, 0, 0, getter, setter, minimum, maximum }
+
+/**
+ * This class implements a menu system that is entirely driven by tables in the program memory:
+ * the menu trees, the labels (in the string table), the value ranges and the callbacks of the entries are stored in
+ * PROGMEM (see the macros above). Only the path to the selected entry and the entry shown in
+ * the first row are kept in RAM, so additional menus do not cost any RAM at all. Two entries
+ * are visible at a time:
+ *
+ *   ┌────────────────┐
+ *   │>Machine       …│
+ *   │ Backlight    10│
+ *   └────────────────┘
+ *
+ * The up and down keys or the encoder move the cursor. The select key, the encoder button or
+ * the right key open a submenu, call an action or start to change a value, which is then
+ * marked with a plus/minus sign and changed using the encoder or the up and down keys. The
+ * value is set by the select key or the encoder button and discarded by the left key or the
+ * mode button. The left key and the mode button also return to the parent menu.
+ *
+ * Only the cells that change are written to the display: moving the cursor between the rows
+ * rewrites the cursor marks, changing a value rewrites the row of the value.
+ */
+class Menu {
+
+  public:
+    /**
+     * The signatures of the callbacks of the entries.
+     */
+    typedef void (*Action) ();
+    typedef int16_t (*ValueGetter) ();
+    typedef void (*ValueSetter) (int16_t value);
+
+    /**
+     * A menu entry. Only the fields corresponding to the type of the entry are used.
+     */
+    struct Entry {
+      uint8_t label;
+      uint8_t type;
+      const Entry * submenu;
+      uint8_t submenuSize;
+      Action action;
+      ValueGetter getter;
+      ValueSetter setter;
+      int16_t minimum;
+      int16_t maximum;
+    };
+
+    /**
+     * The default constructor.
+     */
+    Menu();
+
+    /**
+     * Selects the first entry of the root menu given and displays the menu.
+     */
+    void begin(const Entry * root, uint8_t rootSize);
+
+    /**
+     * Processes a user control event. Returns false if the event has not been used, e.g.
+     * if the left key has been pressed in the root menu.
+     */
+    bool handleEvent(UserControls::Event event);
+
+    /**
+     * Displays both rows of the menu.
+     */
+    void display();
+
+  private:
+    /**
+     * The root menu in the program memory.
+     */
+    const Entry * root;
+    uint8_t rootSize;
+
+    /**
+     * The index of the selected entry on every level of the menu tree down to the current one.
+     */
+    uint8_t path[MENU_MAX_DEPTH];
+    uint8_t depth;
+
+    /**
+     * The index of the entry displayed in the first row.
+     */
+    uint8_t firstVisible;
+
+    /**
+     * Whether the value of the selected entry is being changed, and the new value.
+     */
+    bool editing;
+    int16_t editValue;
+
+    /**
+     * Returns the entries of the current menu and its size by following the path.
+     */
+    const Entry * getCurrentMenu(uint8_t & size);
+
+    /**
+     * Copies the entry with the given index of the current menu to the RAM.
+     */
+    void readEntry(uint8_t index, Entry & entry);
+
+    /**
+     * Moves the cursor within the current menu, scrolling if necessary.
+     */
+    void moveCursor(int8_t steps);
+
+    /**
+     * Changes the value being edited within the range of the selected entry.
+     */
+    void changeValue(int8_t steps);
+
+    /**
+     * Opens the submenu, calls the action or starts to change the value of the selected entry.
+     */
+    void selectEntry();
+
+    /**
+     * Leaves the change of a value or returns to the parent menu. Returns false in the root menu.
+     */
+    bool goBack();
+
+    /**
+     * Displays the entry of the given row, or only the cursor mark in the first column.
+     */
+    void displayRow(uint8_t row);
+    void displayMark(uint8_t row);
+
+};
+
+#endif
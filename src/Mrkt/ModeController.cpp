@@ -23,11 +23,51 @@
 #include "Configuration.h"
 #include "ModeController.h"
 
+#include "BenchmarkMode.h"
+#include "CommandMode.h"
 #include "Communication.h"
+#include "DiagnosticsMode.h"
 #include "Display.h"
+#include "IdleSleep.h"
 #include "InitializationMode.h"
+#include "JobScanner.h"
+#include "PassthroughMode.h"
+#include "ProbeMode.h"
+#include "ReaderMode.h"
+#include "Telemetry.h"
+#include "Trace.h"
 #include "UserControls.h"
 
+/**
+ * The functions that call the methods of a mode, generated for each mode registered in 
+ * ModeController.h.
+ */
+#define MODE_CONTROLLER_FUNCTIONS(name, type, instance) \
+  static void activate##name()   { instance.activate(); } \
+  static void loop##name()       { instance.loop(); } \
+  static void deactivate##name() { instance.deactivate(); } \
+  static bool isBusy##name()     { return instance.isBusy(); }
+MODE_CONTROLLER_MODES(MODE_CONTROLLER_FUNCTIONS)
+
+/**
+ * The table of these functions, in the order of ModeController::Mode.
+ */
+typedef void (*ModeControllerAction) ();
+typedef bool (*ModeControllerCheck) ();
+
+struct ModeControllerEntry {
+  ModeControllerAction activate;
+  ModeControllerAction loop;
+  ModeControllerAction deactivate;
+  ModeControllerCheck isBusy;
+};
+
+#define MODE_CONTROLLER_ENTRY(name, type, instance) \
+  { activate##name, loop##name, deactivate##name, isBusy##name },
+const ModeControllerEntry ModeController_Modes[ModeController::ModeCount] PROGMEM = {
+  MODE_CONTROLLER_MODES(MODE_CONTROLLER_ENTRY)
+};
+
 /**
  * The "singleton" instance of the ModeController class.
  */
@@ -46,40 +86,72 @@ ModeController::ModeController() {
   MrktUserControls = UserControls();
 
   // initialize the individual modes
-  MrktInitializationMode = InitializationMode();
-
-  // TODO initialize other modes
+#define MODE_CONTROLLER_INITIALIZE(name, type, instance) instance = type();
+  MODE_CONTROLLER_MODES(MODE_CONTROLLER_INITIALIZE)
 
   // set the initialization mode on system startup
-  MrktInitializationMode.activate();
   this->currentMode = Initialization;
-  this->currentModeInstance = & MrktInitializationMode;
+  activateMode(this->currentMode);
   this->targetMode = currentMode;
+  this->previousMode = currentMode;
 }
 
 void ModeController::loop() {
+#if (SDCARD_AVAILABLE == 1) && (TRACE_ENABLED == 1)
+  // the trace is written first so that the records of this iteration fit into the buffer
+  MrktTrace.loop();
+#endif
   // delegate to the various sub-controllers and the current mode implementation
   MrktCommunication.loop();
+  MrktTelemetry.loop();
   MrktUserControls.loop();
-  this->currentModeInstance->loop();
+  handleCombinations();
+  ((ModeControllerAction) pgm_read_ptr(&ModeController_Modes[this->currentMode].loop))();
+#if SDCARD_AVAILABLE == 1
+  // scan job files in the background while the Grbl connection is not in use
+  if (MrktCommunication.isIdle()) {
+    MrktJobScanner.loop();
+  }
+#endif
 
   // handle a mode switch if requested
   if (this->targetMode != this->currentMode) {
-    this->currentModeInstance->deactivate();
+    ((ModeControllerAction) pgm_read_ptr(&ModeController_Modes[this->currentMode].deactivate))();
+    this->previousMode = this->currentMode;
     this->currentMode = targetMode;
-    switch(currentMode) {
-      case Initialization:
-        this->currentModeInstance = & MrktInitializationMode;
-        break;
-      case Command:
-// TODO       this->currentModeInstance = & MrktCommandMode;
-        break;
-      case Passthrough:
-// TODO       this->currentModeInstance = & MrktPassthroughMode;
-        break;
-    }
-    this->currentModeInstance->activate();
+    activateMode(this->currentMode);
+  }
+
+#if IDLE_SLEEP_ENABLED == 1
+  // sleep until the next interrupt if there is nothing left to do
+  if (!isBusy()) {
+    MrktIdleSleep.sleep();
   }
+#endif
+}
+
+bool ModeController::isBusy() {
+  ModeControllerCheck isModeBusy = (ModeControllerCheck) pgm_read_ptr(&ModeController_Modes[this->currentMode].isBusy);
+  if ((this->targetMode != this->currentMode) || isModeBusy() || MrktUserControls.isEventAvailable()) {
+    return true;
+  }
+#if SDCARD_AVAILABLE == 1
+  // the background scan only runs while the Grbl connection is not in use
+  if (MrktJobScanner.isScanning() && MrktCommunication.isIdle()) {
+    return true;
+  }
+#endif
+#if (SDCARD_AVAILABLE == 1) && (TRACE_ENABLED == 1)
+  // a full trace buffer has to be written before further data can be recorded
+  if (MrktTrace.isFull()) {
+    return true;
+  }
+#endif
+  return false;
+}
+
+void ModeController::activateMode(Mode mode) {
+  ((ModeControllerAction) pgm_read_ptr(&ModeController_Modes[mode].activate))();
 }
 
 void ModeController::switchToInitialWorkingMode() {
@@ -91,4 +163,36 @@ void ModeController::switchToMode(Mode newMode) {
   this->targetMode = newMode;
 }
 
+void ModeController::switchToPreviousMode() {
+  switchToMode(this->previousMode);
+}
 
+void ModeController::handleCombinations() {
+  UserControls::EventType combination = MrktUserControls.getCombination();
+#if SDCARD_AVAILABLE == 1
+  if (MrktReaderMode.isRunning() && (combination != UserControls::KeyDown)) {
+    // like the mode button, the combinations must not leave a running job - Grbl would 
+    // drain its planner and the stream would never be finished
+    return;
+  }
+#endif
+  switch(combination) {
+    case UserControls::KeySelect:
+      switchToMode(Diagnostics);
+      break;
+    case UserControls::KeyRight:
+      switchToMode(Benchmark);
+      break;
+    case UserControls::KeyUp:
+      switchToMode(Passthrough);
+      break;
+#if SDCARD_AVAILABLE == 1
+    case UserControls::KeyDown:
+      switchToMode(Reader);
+      break;
+#endif
+    default:
+      // no combination entered or combination not assigned
+      break;
+  }
+}
@@ -21,10 +21,34 @@
 #include "Configuration.h"
 #include "AbstractMode.h"
 
+/**
+ * The registry of the modes: MODE(name, class, instance) for each mode. The Mode enum and the
+ * dispatch table in ModeController.cpp are generated from this list, so a new mode only has to
+ * be added here (and its header included in ModeController.cpp). The modes that require the
+ * SD card reader are only registered if it is available.
+ */
+#if SDCARD_AVAILABLE == 1
+#define MODE_CONTROLLER_SDCARD_MODES(MODE) \
+  MODE(Reader,          ReaderMode,         MrktReaderMode)
+#else
+#define MODE_CONTROLLER_SDCARD_MODES(MODE)
+#endif
+
+#define MODE_CONTROLLER_MODES(MODE) \
+  MODE(Initialization,  InitializationMode, MrktInitializationMode) \
+  MODE(Command,         CommandMode,        MrktCommandMode) \
+  MODE(Passthrough,     PassthroughMode,    MrktPassthroughMode) \
+  MODE(Diagnostics,     DiagnosticsMode,    MrktDiagnosticsMode) \
+  MODE(Benchmark,       BenchmarkMode,      MrktBenchmarkMode) \
+  MODE(Probe,           ProbeMode,          MrktProbeMode) \
+  MODE_CONTROLLER_SDCARD_MODES(MODE)
+
 /**
  * This is the main controller object that handles the modes that the 
  * Mrkt system can be in. The actual logic is encapsulated in the various
- * mode implementations that are derived from the AbstractMode class.
+ * mode implementations that are derived from the AbstractMode class. The
+ * modes are called through a table of functions in the program memory 
+ * instead of virtual methods, whose tables would occupy RAM.
  */
 class ModeController {
 
@@ -32,11 +56,9 @@ class ModeController {
     /**
      * This enum represents the various modes that the system can be in.
      */
-#if SDCARD_AVAILABLE == 1
-    enum Mode { Initialization, Command, Passthrough, Reader };
-#else
-    enum Mode { Initialization, Command, Passthrough };
-#endif
+#define MODE_CONTROLLER_ENUM(name, type, instance) name,
+    enum Mode { MODE_CONTROLLER_MODES(MODE_CONTROLLER_ENUM) ModeCount };
+#undef MODE_CONTROLLER_ENUM
 
     /**
      * The default constructor.
@@ -61,6 +83,12 @@ class ModeController {
      */
     void switchToMode(Mode newMode);
 
+    /**
+     * Switches the system back to the mode that was active before the current one. 
+     * This is used by auxiliary modes like the diagnostics display.
+     */
+    void switchToPreviousMode();
+
   private:
     /**
      * The mode the system is currently in.
@@ -73,9 +101,27 @@ class ModeController {
     Mode targetMode;
 
     /**
-     * A pointer to the current mode to make the method calls a bit faster.
+     * The mode the system was in before the current mode was activated.
+     */
+    Mode previousMode;
+
+    /**
+     * Calls the activate() method of the mode given.
+     */
+    void activateMode(Mode mode);
+
+    /**
+     * Checks for the system-wide key combinations (see UserControls::getCombination())
+     * and switches to the corresponding mode. While a job is streamed from the SD card, 
+     * only the combination of the reader mode is accepted (see ReaderMode::isRunning()).
+     */
+    void handleCombinations();
+
+    /**
+     * Checks whether any subsystem has work to do in the next main loop iteration without 
+     * waiting for an interrupt (see IdleSleep).
      */
-    AbstractMode * currentModeInstance;
+    bool isBusy();
 
 };
 
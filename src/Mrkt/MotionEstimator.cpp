@@ -0,0 +1,510 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "MotionEstimator.h"
+
+/**
+ * The axes that span the planes selected by G17, G18 and G19, followed by the linear axis
+ * (the indexes of the offset words I, J and K correspond to the axes).
+ */
+static const uint8_t MotionEstimator_PlaneAxes[3][3] = {
+  { 0, 1, 2 },  // G17: X, Y, helix along Z
+  { 2, 0, 1 },  // G18: Z, X, helix along Y
+  { 1, 2, 0 }   // G19: Y, Z, helix along X
+};
+
+MotionEstimator::MotionEstimator() {
+  for (uint8_t axis = 0; axis < MOTION_ESTIMATOR_AXES; axis++) {
+    this->maxRates[axis] = 500;
+  }
+  reset();
+}
+
+void MotionEstimator::reset() {
+  // this is the state Grbl assumes after a reset
+  this->motionMode = Rapid;
+  this->plane = 0;
+  this->absolute = true;
+  this->inches = false;
+  this->inverseTime = false;
+  this->feedRate = 0;
+  for (uint8_t axis = 0; axis < MOTION_ESTIMATOR_AXES; axis++) {
+    this->position[axis] = 0;
+    this->boundsMin[axis] = 0;
+    this->boundsMax[axis] = 0;
+  }
+  this->knownAxes = 0;
+  this->moved = false;
+  this->feedDistance = 0;
+  this->feedRemainder = 0;
+  this->rapidDistance = 0;
+  this->rapidRemainder = 0;
+  this->totalTime = 0;
+}
+
+void MotionEstimator::setMaxRate(uint8_t axis, uint16_t rate) {
+  this->maxRates[axis] = (rate > 0) ? rate : 1;
+}
+
+uint32_t MotionEstimator::process(const char * line) {
+  if (*line == '$') {
+    // lines addressed to Grbl itself
+    return 0;
+  }
+
+  // collect the words of the line - G words are applied immediately because the modal state 
+  // (e.g. the units) is required to interpret the other words
+  int32_t words[WordCount];
+  uint16_t present = 0;
+  uint16_t nonModal = 0;
+  bool untracked = false;
+  const char * input = line;
+  while (*input != '\0') {
+    char letter = *input++;
+    if ((letter < 'A') || (letter > 'Z') || 
+        !(((*input >= '0') && (*input <= '9')) || (*input == '.') || (*input == '-') || (*input == '+'))) {
+      // not a valid word - the line will be rejected by Grbl anyway
+      return 0;
+    }
+    int32_t value = parseValue(input);
+    if (letter == 'M') {
+      uint16_t code = value / 1000;
+      if ((code == 20) || (code == 300)) {
+        // the program end resets some of the modal state
+        this->motionMode = Linear;
+        this->plane = 0;
+        this->absolute = true;
+        this->inverseTime = false;
+      }
+      continue;
+    }
+    if (letter == 'G') {
+      // G number times 10, e.g. 382 for G38.2
+      uint16_t code = value / 1000;
+      switch(code) {
+        case   0: this->motionMode = Rapid;               break;
+        case  10: this->motionMode = Linear;              break;
+        case  20: this->motionMode = ArcClockwise;        break;
+        case  30: this->motionMode = ArcCounterClockwise; break;
+        case 382:
+        case 383:
+        case 384:
+        case 385:
+          // probing stops at an unknown position
+          this->motionMode = Probe;
+          untracked = true;
+          break;
+        case 800: this->motionMode = NoMotion;            break;
+        case 170: this->plane = 0;                        break;
+        case 180: this->plane = 1;                        break;
+        case 190: this->plane = 2;                        break;
+        case 200: this->inches = true;                    break;
+        case 210: this->inches = false;                   break;
+        case 900: this->absolute = true;                  break;
+        case 910: this->absolute = false;                 break;
+        case 930: this->inverseTime = true;               break;
+        case 940: this->inverseTime = false;              break;
+        case  40: nonModal = code;                        break;
+        case 100:
+        case 280:
+        case 281:
+        case 300:
+        case 301:
+        case 920:
+        case 921:
+          // the position is changed or the axis words have a different meaning
+          nonModal = code;
+          untracked = true;
+          break;
+        case 530:
+        case 540: case 550: case 560: case 570: case 580: case 590:
+        case 591: case 592: case 593:
+        case 922:
+        case 923:
+          // the axis words refer to machine coordinates or the work coordinate system changes
+          untracked = true;
+          break;
+        default:                                          break;
+      }
+      continue;
+    }
+    int8_t word = -1;
+    switch(letter) {
+      case 'X': word = WordX; break;
+      case 'Y': word = WordY; break;
+      case 'Z': word = WordZ; break;
+      case 'I': word = WordI; break;
+      case 'J': word = WordJ; break;
+      case 'K': word = WordK; break;
+      case 'R': word = WordR; break;
+      case 'F': word = WordF; break;
+      case 'P': word = WordP; break;
+      default:                break;
+    }
+    if (word >= 0) {
+      words[word] = value;
+      present |= (1 << word);
+    }
+  }
+
+  if ((present & (1 << WordF)) != 0) {
+    this->feedRate = this->inverseTime ? words[WordF] : toMicrometers(words[WordF]);
+  }
+  if (untracked) {
+    this->knownAxes = 0;
+  }
+  if (nonModal == 40) {
+    // dwell - P is given in seconds
+    uint32_t time = ((present & (1 << WordP)) != 0) ? words[WordP] / 10 : 0;
+    this->totalTime += time;
+    return time;
+  }
+  if ((nonModal == 100) || (nonModal == 281) || (nonModal == 301) || (nonModal == 920) || (nonModal == 921)) {
+    // the axis words define coordinates or offsets - no motion
+    return 0;
+  }
+
+  // determine the target position
+  int32_t target[MOTION_ESTIMATOR_AXES];
+  uint8_t axes = 0;
+  for (uint8_t axis = 0; axis < MOTION_ESTIMATOR_AXES; axis++) {
+    target[axis] = this->position[axis];
+    if ((present & (1 << (WordX + axis))) != 0) {
+      int32_t value = toMicrometers(words[WordX + axis]);
+      target[axis] = this->absolute ? value : this->position[axis] + value;
+      axes |= 1 << axis;
+    }
+  }
+  if ((axes == 0) || (this->motionMode == NoMotion)) {
+    return 0;
+  }
+  if (this->absolute && !untracked) {
+    this->knownAxes |= axes;
+  }
+
+  uint32_t time;
+  if ((nonModal == 280) || (nonModal == 300) || (this->motionMode == Rapid)) {
+    // for G28 and G30, only the move to the intermediate position is known
+    uint32_t length = magnitude(target[0] - this->position[0], target[1] - this->position[1], 
+                                target[2] - this->position[2]);
+    addDistance(this->rapidDistance, this->rapidRemainder, length);
+    time = getRapidTime(target);
+    setPosition(target);
+  } else if ((this->motionMode == Linear) || (this->motionMode == Probe)) {
+    time = moveLinear(target);
+  } else {
+    time = moveArc(target, words, present);
+  }
+  this->totalTime += time;
+  return time;
+}
+
+bool MotionEstimator::hasMoved() {
+  return this->moved;
+}
+
+Coordinate MotionEstimator::getBoundsMin(uint8_t axis) {
+  return this->boundsMin[axis];
+}
+
+Coordinate MotionEstimator::getBoundsMax(uint8_t axis) {
+  return this->boundsMax[axis];
+}
+
+uint32_t MotionEstimator::getFeedDistance() {
+  return this->feedDistance;
+}
+
+uint32_t MotionEstimator::getRapidDistance() {
+  return this->rapidDistance;
+}
+
+uint32_t MotionEstimator::getTotalTime() {
+  return this->totalTime;
+}
+
+MotionEstimator::MotionMode MotionEstimator::getMotionMode() {
+  return this->motionMode;
+}
+
+bool MotionEstimator::isPlaneXY() {
+  return (this->plane == 0);
+}
+
+bool MotionEstimator::isAbsolute() {
+  return this->absolute;
+}
+
+bool MotionEstimator::isInches() {
+  return this->inches;
+}
+
+bool MotionEstimator::isInverseTime() {
+  return this->inverseTime;
+}
+
+Coordinate MotionEstimator::getPosition(uint8_t axis) {
+  return this->position[axis];
+}
+
+bool MotionEstimator::isPositionKnown() {
+  return (this->knownAxes == (1 << MOTION_ESTIMATOR_AXES) - 1);
+}
+
+uint32_t MotionEstimator::moveLinear(const int32_t target[MOTION_ESTIMATOR_AXES]) {
+  uint32_t length = magnitude(target[0] - this->position[0], target[1] - this->position[1], 
+                              target[2] - this->position[2]);
+  addDistance(this->feedDistance, this->feedRemainder, length);
+  uint32_t feedTime = getFeedTime(length);
+  uint32_t rapidTime = getRapidTime(target);
+  setPosition(target);
+  return (feedTime > rapidTime) ? feedTime : rapidTime;
+}
+
+uint32_t MotionEstimator::moveArc(const int32_t target[MOTION_ESTIMATOR_AXES], const int32_t words[WordCount], uint16_t present) {
+  uint8_t axis0 = MotionEstimator_PlaneAxes[this->plane][0];
+  uint8_t axis1 = MotionEstimator_PlaneAxes[this->plane][1];
+  uint8_t axisLinear = MotionEstimator_PlaneAxes[this->plane][2];
+  int32_t start0 = this->position[axis0];
+  int32_t start1 = this->position[axis1];
+  bool clockwise = (this->motionMode == ArcClockwise);
+
+  // determine the center of the arc
+  int32_t center0, center1;
+  if ((present & (1 << WordR)) != 0) {
+    // radius format: the center lies on the perpendicular bisector of the chord
+    int32_t radius = toMicrometers(words[WordR]);
+    int32_t delta0 = target[axis0] - start0;
+    int32_t delta1 = target[axis1] - start1;
+    uint32_t chord = magnitude(delta0, delta1, 0);
+    uint32_t absRadius = (radius < 0) ? -radius : radius;
+    // scale the values so that the products below cannot overflow
+    uint8_t shift = 0;
+    while (((absRadius >> shift) > 32767) || ((chord >> shift) > 65535)) {
+      shift++;
+    }
+    int32_t r = absRadius >> shift;
+    int32_t d = chord >> shift;
+    int32_t halfChord = d / 2;
+    // the distance of the center from the middle of the chord (0 for half circles)
+    int32_t distance = 0;
+    if (r > halfChord) {
+      distance = squareRoot((uint32_t) r * r - (uint32_t) halfChord * halfChord);
+    }
+    // same orientation as in Grbl: clockwise arcs with a positive radius have their center
+    // to the right of the direction of travel
+    if (clockwise != (radius < 0)) {
+      distance = -distance;
+    }
+    int32_t offset0 = 0, offset1 = 0;
+    if (d > 0) {
+      offset0 = ((int32_t) (delta1 >> shift) * -distance / d) << shift;
+      offset1 = ((int32_t) (delta0 >> shift) * distance / d) << shift;
+    }
+    center0 = start0 + delta0 / 2 + offset0;
+    center1 = start1 + delta1 / 2 + offset1;
+  } else {
+    center0 = start0 + (((present & (1 << (WordI + axis0))) != 0) ? toMicrometers(words[WordI + axis0]) : 0);
+    center1 = start1 + (((present & (1 << (WordI + axis1))) != 0) ? toMicrometers(words[WordI + axis1]) : 0);
+  }
+
+  // determine the angle covered - identical start and end points designate a full circle
+  uint32_t radius = magnitude(start0 - center0, start1 - center1, 0);
+  uint16_t startAngle = angle(start0 - center0, start1 - center1);
+  uint16_t endAngle = angle(target[axis0] - center0, target[axis1] - center1);
+  uint32_t sweep = (uint16_t) (clockwise ? startAngle - endAngle : endAngle - startAngle);
+  if (sweep == 0) {
+    sweep = 0x10000UL;
+  }
+
+  // the arc reaches its extreme values at the multiples of a quarter turn
+  for (uint8_t quarter = 0; quarter < 4; quarter++) {
+    uint16_t quarterAngle = (uint16_t) quarter << 14;
+    uint16_t distance = clockwise ? startAngle - quarterAngle : quarterAngle - startAngle;
+    if (distance < sweep) {
+      switch(quarter) {
+        case 0: extendBounds(axis0, center0 + radius); break;
+        case 1: extendBounds(axis1, center1 + radius); break;
+        case 2: extendBounds(axis0, center0 - radius); break;
+        case 3: extendBounds(axis1, center1 - radius); break;
+      }
+    }
+  }
+
+  // length of the arc: radius * sweep * 2 * pi / 65536, with the radius in units of 64 µm 
+  // to prevent an overflow (2 * pi * 64 / 65536 = 1 / 162.97)
+  uint32_t length = ((radius >> 6) * sweep) / 163;
+  length = magnitude(length, target[axisLinear] - this->position[axisLinear], 0);
+  addDistance(this->feedDistance, this->feedRemainder, length);
+  uint32_t feedTime = getFeedTime(length);
+  uint32_t rapidTime = getRapidTime(target);
+  setPosition(target);
+  return (feedTime > rapidTime) ? feedTime : rapidTime;
+}
+
+uint32_t MotionEstimator::getFeedTime(uint32_t length) {
+  if (this->feedRate == 0) {
+    return 0;
+  }
+  if (this->inverseTime) {
+    // the feed rate is the inverse of the time in minutes (times 10000)
+    return 600000000UL / this->feedRate;
+  }
+  // length in µm, feed rate in µm/min - the feed rate is reduced to mm/min to prevent an overflow
+  uint32_t rate = (this->feedRate + 500) / 1000;
+  return (length * 60) / ((rate > 0) ? rate : 1);
+}
+
+uint32_t MotionEstimator::getRapidTime(const int32_t target[MOTION_ESTIMATOR_AXES]) {
+  // every axis moves at its maximum rate, the slowest axis determines the time
+  uint32_t time = 0;
+  for (uint8_t axis = 0; axis < MOTION_ESTIMATOR_AXES; axis++) {
+    int32_t delta = target[axis] - this->position[axis];
+    uint32_t axisTime = ((uint32_t) ((delta < 0) ? -delta : delta) * 60) / this->maxRates[axis];
+    if (axisTime > time) {
+      time = axisTime;
+    }
+  }
+  return time;
+}
+
+void MotionEstimator::setPosition(const int32_t target[MOTION_ESTIMATOR_AXES]) {
+  for (uint8_t axis = 0; axis < MOTION_ESTIMATOR_AXES; axis++) {
+    this->position[axis] = target[axis];
+    extendBounds(axis, target[axis]);
+  }
+  this->moved = true;
+}
+
+void MotionEstimator::extendBounds(uint8_t axis, Coordinate value) {
+  if (!this->moved) {
+    // the first move determines the initial bounding box
+    this->boundsMin[axis] = value;
+    this->boundsMax[axis] = value;
+  } else if (value < this->boundsMin[axis]) {
+    this->boundsMin[axis] = value;
+  } else if (value > this->boundsMax[axis]) {
+    this->boundsMax[axis] = value;
+  }
+}
+
+int32_t MotionEstimator::toMicrometers(int32_t value) {
+  if (this->inches) {
+    // 1/10000 inch = 2.54 µm - split up to prevent an overflow
+    return (value / 100) * 254 + ((value % 100) * 254) / 100;
+  }
+  return (value + ((value < 0) ? -5 : 5)) / 10;
+}
+
+int32_t MotionEstimator::parseValue(const char * & input) {
+  bool negative = false;
+  if ((*input == '-') || (*input == '+')) {
+    negative = (*input == '-');
+    input++;
+  }
+  int32_t value = 0;
+  int8_t decimals = -1;
+  while (((*input >= '0') && (*input <= '9')) || (*input == '.')) {
+    if (*input == '.') {
+      decimals = 0;
+    } else if (decimals < 0) {
+      // the integer part is limited to keep the value within the range of int32_t
+      if (value < 21474) {
+        value = value * 10 + (*input - '0');
+      }
+    } else if (decimals < 4) {
+      value = value * 10 + (*input - '0');
+      decimals++;
+    }
+    input++;
+  }
+  // skip everything else up to the next word
+  while ((*input != '\0') && ((*input < 'A') || (*input > 'Z'))) {
+    input++;
+  }
+  for (int8_t i = (decimals < 0) ? 0 : decimals; i < 4; i++) {
+    value *= 10;
+  }
+  return negative ? -value : value;
+}
+
+uint32_t MotionEstimator::magnitude(int32_t a, int32_t b, int32_t c) {
+  uint32_t values[3] = { 
+    (uint32_t) ((a < 0) ? -a : a), (uint32_t) ((b < 0) ? -b : b), (uint32_t) ((c < 0) ? -c : c) 
+  };
+  // scale the values so that the sum of the squares fits into 32 bits
+  uint8_t shift = 0;
+  while (((values[0] >> shift) > 32767) || ((values[1] >> shift) > 32767) || ((values[2] >> shift) > 32767)) {
+    shift++;
+  }
+  uint32_t square = 0;
+  for (uint8_t i = 0; i < 3; i++) {
+    uint32_t scaled = values[i] >> shift;
+    square += scaled * scaled;
+  }
+  return squareRoot(square) << shift;
+}
+
+uint32_t MotionEstimator::squareRoot(uint32_t value) {
+  uint32_t root = 0;
+  for (uint32_t bit = 1UL << 30; bit > 0; bit >>= 2) {
+    if (value >= root + bit) {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+  }
+  return root;
+}
+
+uint16_t MotionEstimator::angle(int32_t x, int32_t y) {
+  uint32_t absX = (x < 0) ? -x : x;
+  uint32_t absY = (y < 0) ? -y : y;
+  if ((absX == 0) && (absY == 0)) {
+    return 0;
+  }
+  while ((absX > 65535) || (absY > 65535)) {
+    absX >>= 1;
+    absY >>= 1;
+  }
+  // reduce to the first octant: t = tan(angle) in Q15 with 0 <= t <= 1
+  bool swapped = (absY > absX);
+  uint32_t t = swapped ? (absX << 15) / absY : (absY << 15) / absX;
+  // atan(t) = pi/4 * t + 0.273 * t * (1 - t) in radians, converted to 1/65536 turns
+  uint16_t result = (t >> 2) + (((t * (32768 - t)) >> 15) * 2847 >> 15);
+  if (swapped) {
+    result = 16384 - result;
+  }
+  if (x < 0) {
+    result = 32768 - result;
+  }
+  if (y < 0) {
+    result = -result;
+  }
+  return result;
+}
+
+void MotionEstimator::addDistance(uint32_t & distance, uint32_t & remainder, uint32_t length) {
+  remainder += length;
+  distance += remainder / 1000;
+  remainder %= 1000;
+}
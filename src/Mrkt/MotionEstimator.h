@@ -0,0 +1,219 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_MotionEstimator_h
+#define MRKT_MotionEstimator_h
+
+#include <inttypes.h>
+
+#include "Coordinates.h"
+
+/**
+ * The number of axes that are tracked.
+ */
+#define MOTION_ESTIMATOR_AXES 3
+
+/**
+ * This class follows the motion of the machine line by line to determine the extents of a job,
+ * the distances travelled and the time the motion takes. The motion is modelled without 
+ * acceleration: feed moves take the distance divided by the feed rate, rapid moves are limited 
+ * by the maximum rates of the axes. All calculations are done in fixed-point arithmetics - 
+ * positions and distances are given in µm, times in ms. Arcs are supported in all planes,
+ * coordinate system changes (G10, G92) and the predefined positions (G28, G30) are ignored.
+ * 
+ * The estimator also serves as the modal state tracker of the height compensation (see
+ * HeightCompensator.h): it provides the modal state and the position after each line, and 
+ * whether the position is actually known - the position is assumed to be 0 at the start, but
+ * it is only known once all axes have been programmed to absolute positions, and it becomes
+ * unknown again when a line moves the tool to a position that is not tracked (G28, G30, 
+ * G38.x, G53) or changes the coordinate system (G10, G54 to G59, G92).
+ * 
+ * The lines have to be compacted (upper case, without whitespace and comments), for example
+ * by the GCodeMinifier. This class does not depend on the Arduino libraries so that it can 
+ * be used by the host tools as well.
+ */
+class MotionEstimator {
+
+  public:
+    /**
+     * The motion modes that are distinguished. Probing cycles take the time of linear moves.
+     */
+    enum MotionMode { Rapid, Linear, ArcClockwise, ArcCounterClockwise, Probe, NoMotion };
+
+    /**
+     * The default constructor.
+     */
+    MotionEstimator();
+
+    /**
+     * Forgets the modal state and the position and clears the totals.
+     */
+    void reset();
+
+    /**
+     * Sets the maximum rate of an axis in mm/min, as configured in Grbl ($110 to $112).
+     */
+    void setMaxRate(uint8_t axis, uint16_t rate);
+
+    /**
+     * Processes a single line and returns the time the motion (or the dwell) takes in ms.
+     */
+    uint32_t process(const char * line);
+
+    /**
+     * Checks whether any motion has been encountered - the bounding box is only valid if so.
+     */
+    bool hasMoved();
+
+    /**
+     * Returns the bounding box of the positions reached, in µm.
+     */
+    Coordinate getBoundsMin(uint8_t axis);
+    Coordinate getBoundsMax(uint8_t axis);
+
+    /**
+     * Returns the total distance of the feed moves and the rapid moves in mm.
+     */
+    uint32_t getFeedDistance();
+    uint32_t getRapidDistance();
+
+    /**
+     * Returns the total time of all lines processed in ms.
+     */
+    uint32_t getTotalTime();
+
+    /**
+     * Returns the modal state established by the lines processed.
+     */
+    MotionMode getMotionMode();
+    bool isPlaneXY();
+    bool isAbsolute();
+    bool isInches();
+    bool isInverseTime();
+
+    /**
+     * Returns the current position of an axis in µm.
+     */
+    Coordinate getPosition(uint8_t axis);
+
+    /**
+     * Checks whether the position of all axes is known (see above).
+     */
+    bool isPositionKnown();
+
+  private:
+
+    /**
+     * The indexes of the words a line can contain that are relevant for the motion.
+     */
+    enum Word { WordX, WordY, WordZ, WordI, WordJ, WordK, WordR, WordF, WordP, WordCount };
+
+    /**
+     * The modal state.
+     */
+    MotionMode motionMode;
+    uint8_t plane;
+    bool absolute;
+    bool inches;
+    bool inverseTime;
+
+    /**
+     * The current feed rate in µm/min, or in 1/10000 per min in inverse time mode.
+     */
+    uint32_t feedRate;
+
+    /**
+     * The maximum rates of the axes in mm/min.
+     */
+    uint16_t maxRates[MOTION_ESTIMATOR_AXES];
+
+    /**
+     * The current position and the bounding box in µm, and the axes whose position is known
+     * (bit mask of 1 << axis).
+     */
+    int32_t position[MOTION_ESTIMATOR_AXES];
+    uint8_t knownAxes;
+    Coordinate boundsMin[MOTION_ESTIMATOR_AXES];
+    Coordinate boundsMax[MOTION_ESTIMATOR_AXES];
+    bool moved;
+
+    /**
+     * The totals: distances in mm (plus the remaining µm) and the time in ms.
+     */
+    uint32_t feedDistance;
+    uint32_t feedRemainder;
+    uint32_t rapidDistance;
+    uint32_t rapidRemainder;
+    uint32_t totalTime;
+
+    /**
+     * Performs a linear or arc move to the target given and returns its time.
+     */
+    uint32_t moveLinear(const int32_t target[MOTION_ESTIMATOR_AXES]);
+    uint32_t moveArc(const int32_t target[MOTION_ESTIMATOR_AXES], const int32_t words[WordCount], uint16_t present);
+
+    /**
+     * Returns the time a move of the given length takes at the current feed rate, and the time
+     * the move to the target takes at the maximum rates of the axes.
+     */
+    uint32_t getFeedTime(uint32_t length);
+    uint32_t getRapidTime(const int32_t target[MOTION_ESTIMATOR_AXES]);
+
+    /**
+     * Moves to the target position and updates the bounding box.
+     */
+    void setPosition(const int32_t target[MOTION_ESTIMATOR_AXES]);
+
+    /**
+     * Extends the bounding box of an axis to include the value given.
+     */
+    void extendBounds(uint8_t axis, Coordinate value);
+
+    /**
+     * Converts a value given in the current units (see parseValue()) to µm.
+     */
+    int32_t toMicrometers(int32_t value);
+
+    /**
+     * Parses the number starting at input as a fixed-point value with four decimal places
+     * and advances input behind it.
+     */
+    static int32_t parseValue(const char * & input);
+
+    /**
+     * Computes the length of a vector in µm.
+     */
+    static uint32_t magnitude(int32_t a, int32_t b, int32_t c);
+
+    /**
+     * Computes the integer square root.
+     */
+    static uint32_t squareRoot(uint32_t value);
+
+    /**
+     * Computes the angle of a vector in 1/65536 of a full turn.
+     */
+    static uint16_t angle(int32_t x, int32_t y);
+
+    /**
+     * Adds a distance in µm to the total distance and remainder given.
+     */
+    static void addDistance(uint32_t & distance, uint32_t & remainder, uint32_t length);
+
+};
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "Arduino.h"
+
+#include "Configuration.h"
+#include "OverrideControl.h"
+
+#include "Communication.h"
+#include "Display.h"
+
+/**
+ * The "singleton" instance of the OverrideControl class.
+ */
+OverrideControl MrktOverrideControl;
+
+OverrideControl::OverrideControl() {
+  this->selected = Feed;
+  for (uint8_t i = 0; i < 3; i++) {
+    this->values[i] = 100;
+  }
+  this->confirmPending = false;
+  this->displayed = false;
+}
+
+void OverrideControl::adjust(int8_t steps) {
+  if (this->selected == Rapid) {
+    // the rapid override only has three levels: 25% (0), 50% (1) and 100% (2)
+    int8_t level = (this->values[Rapid] >= 100) ? 2 : ((this->values[Rapid] >= 50) ? 1 : 0);
+    level = constrain(level + steps, 0, 2);
+    this->values[Rapid] = 25 << level;
+    send(OVERRIDE_CONTROL_RAPID + 2 - level);
+  } else {
+    uint8_t base = (this->selected == Feed) ? OVERRIDE_CONTROL_FEED : OVERRIDE_CONTROL_SPINDLE;
+    int16_t value = this->values[this->selected];
+    int16_t target = constrain(value + steps, OVERRIDE_CONTROL_MIN, OVERRIDE_CONTROL_MAX);
+    // the steps of 10% are rounded to the nearest multiple of 10, the rest is made up by steps 
+    // of 1% - taking into account that Grbl limits the intermediate value to the range
+    int16_t delta = target - value;
+    int8_t tens = (abs(delta) + 4) / 10;
+    if (delta < 0) {
+      tens = -tens;
+    }
+    int8_t ones = target - constrain(value + tens * 10, OVERRIDE_CONTROL_MIN, OVERRIDE_CONTROL_MAX);
+    send(base + ((tens > 0) ? OVERRIDE_CONTROL_PLUS_10 : OVERRIDE_CONTROL_MINUS_10), abs(tens));
+    send(base + ((ones > 0) ? OVERRIDE_CONTROL_PLUS_1 : OVERRIDE_CONTROL_MINUS_1), abs(ones));
+    this->values[this->selected] = target;
+  }
+  changed();
+}
+
+void OverrideControl::selectNext() {
+  this->selected = (Override) ((this->selected + 1) % 3);
+  this->changeTime = millis();
+  this->displayed = true;
+}
+
+void OverrideControl::reset() {
+  switch(this->selected) {
+    case Feed:
+      send(OVERRIDE_CONTROL_FEED);
+      break;
+    case Rapid:
+      send(OVERRIDE_CONTROL_RAPID);
+      break;
+    case Spindle:
+      send(OVERRIDE_CONTROL_SPINDLE);
+      break;
+  }
+  this->values[this->selected] = 100;
+  changed();
+}
+
+void OverrideControl::loop() {
+  const uint8_t * reported = MrktCommunication.getSniffer().getStatus().overrides;
+  uint32_t elapsed = millis() - this->changeTime;
+  if (!this->confirmPending) {
+    // follow the changes made by other means
+    memcpy(this->values, reported, 3);
+  } else if (memcmp(this->values, reported, 3) == 0) {
+    this->confirmPending = false;
+  } else if (!this->reportRequested && (elapsed > OVERRIDE_CONTROL_CONFIRM_DELAY)) {
+    // Grbl includes the overrides in the first status report after a change
+    MrktCommunication.requestStatusReport();
+    this->reportRequested = true;
+  } else if (elapsed > OVERRIDE_CONTROL_CONFIRM_TIMEOUT) {
+    // the change has not been applied (or no status reports are received) - display the
+    // values reported
+    this->confirmPending = false;
+  }
+  if (elapsed > OVERRIDE_CONTROL_DISPLAY_TIME) {
+    this->displayed = false;
+  }
+}
+
+bool OverrideControl::isDisplayed() {
+  return this->displayed;
+}
+
+void OverrideControl::display(uint8_t row) {
+  MrktDisplay.setCursor(0, row);
+  // the names are stored in the order of OverrideControl::Override (see Strings.txt)
+  uint8_t length = MrktDisplay.writeString(STRING_OVERRIDE_FEED + this->selected);
+  if (this->confirmPending) {
+    MrktDisplay.writeEllipsis();
+    length++;
+  }
+  MrktDisplay.writePercent(length, row, this->values[this->selected]);
+}
+
+void OverrideControl::send(uint8_t command, uint8_t count) {
+  for (uint8_t i = 0; i < count; i++) {
+    MrktCommunication.sendRealtimeCommand(command);
+  }
+}
+
+void OverrideControl::changed() {
+  this->confirmPending = true;
+  this->reportRequested = false;
+  this->changeTime = millis();
+  this->displayed = true;
+}
@@ -0,0 +1,160 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_OverrideControl_h
+#define MRKT_OverrideControl_h
+
+#include "Configuration.h"
+
+/**
+ * The realtime commands of Grbl 1.1 that change the overrides. The feed and the spindle 
+ * override are reset to 100% by the first command, the following ones change them by +10%,
+ * -10%, +1% and -1%. The rapid override is set to 100%, 50% and 25% by the three commands
+ * starting at OVERRIDE_CONTROL_RAPID.
+ */
+#define OVERRIDE_CONTROL_FEED            0x90
+#define OVERRIDE_CONTROL_RAPID           0x95
+#define OVERRIDE_CONTROL_SPINDLE         0x99
+#define OVERRIDE_CONTROL_PLUS_10            1
+#define OVERRIDE_CONTROL_MINUS_10           2
+#define OVERRIDE_CONTROL_PLUS_1             3
+#define OVERRIDE_CONTROL_MINUS_1            4
+
+/**
+ * The range of the feed and spindle overrides supported by Grbl (in percent).
+ */
+#define OVERRIDE_CONTROL_MIN              10
+#define OVERRIDE_CONTROL_MAX             200
+
+/**
+ * The time in ms after a change at which a status report is requested to confirm the change,
+ * and the time in ms after which the value reported by Grbl is accepted if it differs.
+ */
+#define OVERRIDE_CONTROL_CONFIRM_DELAY    50
+#define OVERRIDE_CONTROL_CONFIRM_TIMEOUT 1000
+
+/**
+ * The time in ms the override is displayed after it has been changed or selected.
+ */
+#define OVERRIDE_CONTROL_DISPLAY_TIME    3000
+
+/**
+ * This class changes the feed, rapid and spindle overrides of the Grbl system using the
+ * rotary encoder while a job is running, both in the reader mode and in the passthrough mode:
+ * 
+ *   encoder      change the selected override by 1% per step (rapid: 25%, 50%, 100%)
+ *   right key    select the next override (feed, rapid, spindle)
+ *   left key     reset the selected override to 100%
+ * 
+ * The changes are sent as realtime commands immediately, bypassing any lines waiting to be 
+ * sent. The steps of the encoder are coalesced into as few commands as possible: a change 
+ * of 19% is sent as +10% +10% -1%. The values sent are confirmed using the overrides 
+ * reported by Grbl (see StatusSniffer); while a change has not been confirmed, it is 
+ * displayed with an ellipsis. Values changed by other means (e.g. by the sender program 
+ * in passthrough mode) are taken over from the status reports.
+ *
+ * The overrides have no mode of their own: the reader mode can not be left while a job is 
+ * running (see ModeController::handleCombinations()), and the passthrough mode has to keep
+ * forwarding the data of the sender, so the control is part of both modes.
+ */
+class OverrideControl {
+
+  public:
+    /**
+     * The overrides in the order of the status report field Ov.
+     */
+    enum Override { Feed, Rapid, Spindle };
+
+    /**
+     * The default constructor.
+     */
+    OverrideControl();
+
+    /**
+     * Changes the selected override by the number of encoder steps given.
+     */
+    void adjust(int8_t steps);
+
+    /**
+     * Selects the next override.
+     */
+    void selectNext();
+
+    /**
+     * Resets the selected override to 100%.
+     */
+    void reset();
+
+    /**
+     * This method has to be called from the loop of the modes that use the override control.
+     */
+    void loop();
+
+    /**
+     * Checks whether the override should be displayed because it has been changed or
+     * selected recently.
+     */
+    bool isDisplayed();
+
+    /**
+     * Displays the selected override in the row given.
+     */
+    void display(uint8_t row);
+
+  private:
+    /**
+     * The override that is selected.
+     */
+    Override selected;
+
+    /**
+     * The values of the overrides in percent, including the changes that have not been 
+     * confirmed yet.
+     */
+    uint8_t values[3];
+
+    /**
+     * Whether a change is waiting for its confirmation, whether a status report has been
+     * requested for it, and the time of the last change or selection.
+     */
+    bool confirmPending;
+    bool reportRequested;
+    uint32_t changeTime;
+
+    /**
+     * Whether the override is displayed (see isDisplayed()).
+     */
+    bool displayed;
+
+    /**
+     * Sends a realtime command to the Grbl system a number of times.
+     */
+    void send(uint8_t command, uint8_t count = 1);
+
+    /**
+     * Marks the selected override as changed.
+     */
+    void changed();
+
+};
+
+/**
+ * Access to the "singleton" instance of the OverrideControl class.
+ */
+extern OverrideControl MrktOverrideControl;
+
+#endif
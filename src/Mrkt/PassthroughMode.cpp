@@ -0,0 +1,170 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "Arduino.h"
+
+#include "Configuration.h"
+#include "PassthroughMode.h"
+
+#include "Communication.h"
+#include "Display.h"
+#include "ModeController.h"
+#include "OverrideControl.h"
+#include "UserControls.h"
+
+/**
+ * The minimum interval in ms between two display updates. The display is only updated
+ * when new status reports have been received.
+ */
+#define PASSTHROUGH_MODE_REFRESH_INTERVAL  200
+
+/**
+ * The interval in ms between two display updates while the position is extrapolated. 
+ */
+#define PASSTHROUGH_MODE_PREDICTION_INTERVAL 50
+
+/**
+ * The "singleton" instance of the PassthroughMode class.
+ */
+PassthroughMode MrktPassthroughMode;
+
+PassthroughMode::PassthroughMode() : 
+  AbstractMode() {
+  this->started = false;
+  this->machinePosition = false;
+  this->overrideDisplayed = false;
+}
+
+void PassthroughMode::activate() {
+  MrktUserControls.clearEvents();
+  MrktDisplay.clear();
+  this->started = MrktCommunication.startPassthrough();
+  this->lastReports = 0;
+  // the position of the last report is displayed until the next one arrives
+  this->predictor.reset();
+  this->predictor.update(MrktCommunication.getSniffer(), millis());
+  this->predictedReports = MrktCommunication.getSniffer().getStatus().reports;
+  display();
+}
+
+void PassthroughMode::deactivate() {
+  MrktCommunication.stopPassthrough();
+  this->started = false;
+  MrktDisplay.clear();
+}
+
+void PassthroughMode::loop() {
+  if (!this->started) {
+    // wait for the command that is still being processed
+    this->started = MrktCommunication.startPassthrough();
+  }
+  bool refresh = handleEvents();
+  MrktOverrideControl.loop();
+  uint16_t reports = MrktCommunication.getSniffer().getStatus().reports;
+  if (reports != this->predictedReports) {
+    // the report has been received during this loop iteration
+    this->predictor.update(MrktCommunication.getSniffer(), millis());
+    this->predictedReports = reports;
+  }
+  if (refresh || (MrktOverrideControl.isDisplayed() != this->overrideDisplayed) || 
+      ((reports != this->lastReports) && (millis() - this->lastRefreshTime > PASSTHROUGH_MODE_REFRESH_INTERVAL)) ||
+      (this->predictor.isMoving() && (millis() - this->lastRefreshTime > PASSTHROUGH_MODE_PREDICTION_INTERVAL))) {
+    display();
+  }
+}
+
+bool PassthroughMode::handleEvents() {
+  bool refresh = false;
+  while (MrktUserControls.isEventAvailable()) {
+    UserControls::Event event = MrktUserControls.getEvent();
+    switch(event.type) {
+      case UserControls::KeyUp:
+      case UserControls::KeyDown:
+        this->machinePosition = !this->machinePosition;
+        refresh = true;
+        break;
+      case UserControls::EncChanged:
+        MrktOverrideControl.adjust(event.data);
+        refresh = true;
+        break;
+      case UserControls::KeyRight:
+        MrktOverrideControl.selectNext();
+        refresh = true;
+        break;
+      case UserControls::KeyLeft:
+        MrktOverrideControl.reset();
+        refresh = true;
+        break;
+      case UserControls::ModeButton:
+        MrktModeController.switchToPreviousMode();
+        break;
+      default:
+        // ignore all other events
+        break;
+    }
+  }
+  return refresh;
+}
+
+void PassthroughMode::display() {
+  const StatusSniffer::Status & status = MrktCommunication.getSniffer().getStatus();
+  this->lastReports = status.reports;
+  this->lastRefreshTime = millis();
+  if (status.reports == 0) {
+    MrktDisplay.setCursor(0, 0);
+    MrktDisplay.writeString(STRING_PASSTHROUGH, DISPLAY_LCD_COLUMNS);
+    MrktDisplay.setCursor(0, 1);
+    MrktDisplay.writeString(STRING_EMPTY, DISPLAY_LCD_COLUMNS);
+    return;
+  }
+
+  // the state takes up the first half of the first row
+  MrktDisplay.setCursor(0, 0);
+  uint8_t length = MrktDisplay.print(status.state);
+  if ((status.alarm > 0) && (strncmp_P(status.state, PSTR("Alarm"), 5) == 0)) {
+    length += MrktDisplay.print(' ');
+    length += MrktDisplay.writeNumber(status.alarm);
+  }
+  while (length < DISPLAY_LCD_COLUMNS / 2) {
+    MrktDisplay.write(' ');
+    length++;
+  }
+  displayAxis(2, 8, 0);
+  // the override replaces the X and Y axes while it is being changed
+  this->overrideDisplayed = MrktOverrideControl.isDisplayed();
+  if (this->overrideDisplayed) {
+    MrktOverrideControl.display(1);
+    return;
+  }
+  displayAxis(0, 0, 1);
+  displayAxis(1, 8, 1);
+}
+
+void PassthroughMode::displayAxis(uint8_t axis, uint8_t col, uint8_t row) {
+  StatusSniffer & sniffer = MrktCommunication.getSniffer();
+  Coordinate position = this->predictor.getMachinePosition(axis, millis());
+  if (!this->machinePosition) {
+    // the work coordinate offset does not change while the machine is moving
+    position -= sniffer.getMachinePosition(axis) - sniffer.getWorkPosition(axis);
+  }
+  MrktDisplay.setCursor(col, row);
+  MrktDisplay.write((this->machinePosition ? 'x' : 'X') + axis);
+  MrktDisplay.writeCoordinate(col + 1, row, 7, position);
+}
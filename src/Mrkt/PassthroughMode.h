@@ -0,0 +1,117 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_PassthroughMode_h
+#define MRKT_PassthroughMode_h
+
+#include "Configuration.h"
+#include "AbstractMode.h"
+#include "PositionPredictor.h"
+#include "StatusSniffer.h"
+
+/**
+ * This class implements the passthrough mode that connects a sender program on the host 
+ * system directly to the Grbl system (see Communication::startPassthrough()). The mode can 
+ * be entered from any other mode using the key combination MODE + UP and returns to the 
+ * previous mode when the mode button is pressed.
+ * 
+ * Mrkt does not send any lines to the Grbl system in this mode, so it cannot interfere with
+ * the character counting of the sender. Instead, the status reports requested by the sender,
+ * the parser state and the alarms are evaluated while they are forwarded (see StatusSniffer),
+ * and the machine state and the position are displayed:
+ * 
+ *   ┌────────────────┐
+ *   │Run     Z  -1.50│
+ *   │X 123.45Y  67.80│
+ *   └────────────────┘
+ * 
+ * The sender usually requests only a few status reports per second. While the machine is 
+ * moving, the position is extrapolated between the reports (see PositionPredictor.h) and
+ * displayed every PASSTHROUGH_MODE_PREDICTION_INTERVAL ms, so that it follows the machine
+ * smoothly. The work position is displayed by default; the up and down keys switch to the machine 
+ * position, which is shown with lower-case axis letters. The encoder and the left and right 
+ * keys change the overrides (see OverrideControl.h) - the overrides are realtime commands
+ * that do not occupy the receive buffer of the Grbl system.
+ */
+class PassthroughMode : public AbstractMode {
+  
+  public:
+    /**
+     * The default constructor.
+     */
+    PassthroughMode();
+
+    /**
+     * See AbstractMode for an explanation of these methods.
+     */
+    void activate();
+    void loop();
+    void deactivate();
+
+  private:
+    /**
+     * Whether the communication system has been switched to passthrough mode.
+     */
+    bool started;
+
+    /**
+     * Whether the machine position is displayed instead of the work position.
+     */
+    bool machinePosition;
+
+    /**
+     * Whether the override was displayed during the last refresh.
+     */
+    bool overrideDisplayed;
+
+    /**
+     * The number of status reports at the time of the last refresh, and the time of the last refresh.
+     */
+    uint16_t lastReports;
+    uint32_t lastRefreshTime;
+
+    /**
+     * The extrapolation of the position between the status reports, and the number of status 
+     * reports passed to it.
+     */
+    PositionPredictor predictor;
+    uint16_t predictedReports;
+
+    /**
+     * Processes the pending user control events. Returns true if the display 
+     * has to be refreshed immediately.
+     */
+    bool handleEvents();
+
+    /**
+     * Updates the display.
+     */
+    void display();
+
+    /**
+     * Displays the position of an axis at the position given.
+     */
+    void displayAxis(uint8_t axis, uint8_t col, uint8_t row);
+
+};
+
+/**
+ * Access to the "singleton" instance of the PassthroughMode class.
+ */
+extern PassthroughMode MrktPassthroughMode;
+
+#endif
@@ -0,0 +1,86 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "PositionPredictor.h"
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#else
+#define PSTR(text) (text)
+#define strncmp_P(text, flashText, length) strncmp(text, flashText, length)
+#endif
+
+/**
+ * The longest interval in ms between two reports that is used to determine the velocity.
+ */
+#define POSITION_PREDICTOR_MAX_INTERVAL 2000
+
+PositionPredictor::PositionPredictor() {
+  reset();
+}
+
+void PositionPredictor::reset() {
+  this->valid = false;
+  this->moving = false;
+}
+
+void PositionPredictor::update(StatusSniffer & sniffer, uint32_t time) {
+  const StatusSniffer::Status & status = sniffer.getStatus();
+  uint32_t interval = time - this->time;
+  // the position only changes by itself while the machine is running or jogging
+  bool running = (strncmp_P(status.state, PSTR("Run"), 3) == 0) ||
+                 (strncmp_P(status.state, PSTR("Jog"), 3) == 0);
+  this->moving = this->valid && running && (status.feedRate > 0) && 
+                 (interval > 0) && (interval <= POSITION_PREDICTOR_MAX_INTERVAL);
+  if (this->moving) {
+    // the distance covered yields the mean velocity since the last report - the velocity at 
+    // the time of the report is larger (or smaller) by the ratio of the current feed rate 
+    // to the mean feed rate, taken with 8 fractional bits
+    uint32_t scale = (status.feedRate << 9) / (status.feedRate + this->feedRate);
+    for (uint8_t axis = 0; axis < STATUS_SNIFFER_AXES; axis++) {
+      int32_t distance = sniffer.getMachinePosition(axis) - this->position[axis];
+      this->velocity[axis] = ((distance * 256) / (int32_t) interval) * (int32_t) scale / 256;
+    }
+    uint32_t horizon = interval + interval / 2;
+    this->horizon = (horizon < POSITION_PREDICTOR_MAX_HORIZON) ? horizon : POSITION_PREDICTOR_MAX_HORIZON;
+  }
+  for (uint8_t axis = 0; axis < STATUS_SNIFFER_AXES; axis++) {
+    this->position[axis] = sniffer.getMachinePosition(axis);
+  }
+  this->feedRate = status.feedRate;
+  this->time = time;
+  this->valid = true;
+}
+
+bool PositionPredictor::isMoving() {
+  return this->moving;
+}
+
+Coordinate PositionPredictor::getMachinePosition(uint8_t axis, uint32_t time) {
+  if (!this->moving) {
+    return this->position[axis];
+  }
+  uint32_t elapsed = time - this->time;
+  if (elapsed > this->horizon) {
+    elapsed = this->horizon;
+  }
+  return this->position[axis] + this->velocity[axis] * (int32_t) elapsed / 256;
+}
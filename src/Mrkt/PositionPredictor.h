@@ -0,0 +1,101 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_PositionPredictor_h
+#define MRKT_PositionPredictor_h
+
+#include <inttypes.h>
+
+#include "Coordinates.h"
+#include "StatusSniffer.h"
+
+/**
+ * The longest time in ms the position is extrapolated beyond the last status report. If no
+ * further report arrives, the position stops there.
+ */
+#define POSITION_PREDICTOR_MAX_HORIZON  1000
+
+/**
+ * This class extrapolates the position of the machine between status reports (dead 
+ * reckoning), so that the position can be displayed smoothly while status reports are 
+ * requested a few times per second only, leaving the bandwidth of the link to the lines 
+ * streamed.
+ * 
+ * The velocity of each axis is derived from the positions of the last two reports. Because
+ * this is the mean velocity between the reports, it is scaled by the realtime feed rate 
+ * (FS) of the last report relative to the mean of the feed rates of both reports, which 
+ * follows the acceleration and deceleration. The position is only extrapolated while the 
+ * machine is running or jogging, for at most one and a half report intervals (and 
+ * POSITION_PREDICTOR_MAX_HORIZON), and every new report replaces the prediction.
+ * 
+ * Velocities are stored in µm/ms with 8 fractional bits; a prediction takes a multiplication
+ * and a division by 256 per axis. The class does not depend on the Arduino libraries so that
+ * it can be used by the host tools as well.
+ */
+class PositionPredictor {
+
+  public:
+    /**
+     * The default constructor.
+     */
+    PositionPredictor();
+
+    /**
+     * Forgets the reports received, e.g. when the display of the position starts.
+     */
+    void reset();
+
+    /**
+     * Takes the last status report of the sniffer into account. The time is the time the
+     * report has been received in ms.
+     */
+    void update(StatusSniffer & sniffer, uint32_t time);
+
+    /**
+     * Checks whether the position is extrapolated, i.e. whether it changes over time.
+     */
+    bool isMoving();
+
+    /**
+     * Returns the predicted machine position of an axis in µm at the time given in ms.
+     */
+    Coordinate getMachinePosition(uint8_t axis, uint32_t time);
+
+  private:
+    /**
+     * Whether a report has been received, and whether the machine is moving.
+     */
+    bool valid;
+    bool moving;
+
+    /**
+     * The machine position, the feed rate and the time of the last report.
+     */
+    Coordinate position[STATUS_SNIFFER_AXES];
+    uint32_t feedRate;
+    uint32_t time;
+
+    /**
+     * The velocity of each axis in µm/ms with 8 fractional bits, and the time in ms after
+     * the last report at which the extrapolation stops.
+     */
+    int32_t velocity[STATUS_SNIFFER_AXES];
+    uint16_t horizon;
+
+};
+
+#endif
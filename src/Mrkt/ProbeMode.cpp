@@ -0,0 +1,376 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "Arduino.h"
+
+#include "Configuration.h"
+#include "ProbeMode.h"
+
+#include "Communication.h"
+#include "Display.h"
+#include "HeightMap.h"
+#include "ModeController.h"
+#include "UserControls.h"
+
+/**
+ * The timeouts in ms of the commands sent to the Grbl system. The probe command waits for 
+ * the preceding motions and the probing motion itself.
+ */
+#define PROBE_MODE_COMMAND_TIMEOUT   2000
+#define PROBE_MODE_PROBE_TIMEOUT    60000
+
+/**
+ * The size of the buffer for the commands sent to the Grbl system.
+ */
+#define PROBE_MODE_COMMAND_SIZE        40
+
+/**
+ * The maximum size of the grid in mm.
+ */
+#define PROBE_MODE_MAX_SIZE          1000
+
+/**
+ * The error detected by the probe mode itself if the probe did not touch the surface. This
+ * is negative to distinguish it from the Grbl error codes, and it must not overlap with 
+ * COMMUNICATION_STATUS_*.
+ */
+#define PROBE_MODE_ERROR_NO_CONTACT   -10
+
+/**
+ * The menu of the parameters.
+ */
+const Menu::Entry ProbeMode_Menu[] PROGMEM = {
+  MENU_ACTION(STRING_PROBE_START,     ProbeMode::startProbing),
+  MENU_VALUE(STRING_PROBE_SIZE_X,     ProbeMode::getSizeX, ProbeMode::setSizeX, 1, PROBE_MODE_MAX_SIZE),
+  MENU_VALUE(STRING_PROBE_SIZE_Y,     ProbeMode::getSizeY, ProbeMode::setSizeY, 1, PROBE_MODE_MAX_SIZE),
+  MENU_VALUE(STRING_PROBE_POINTS_X,   ProbeMode::getPointsX, ProbeMode::setPointsX, 2, HEIGHT_MAP_MAX_POINTS),
+  MENU_VALUE(STRING_PROBE_POINTS_Y,   ProbeMode::getPointsY, ProbeMode::setPointsY, 2, HEIGHT_MAP_MAX_POINTS),
+  MENU_VALUE(STRING_PROBE_CLEARANCE,  ProbeMode::getClearance, ProbeMode::setClearance, 1, 20),
+  MENU_VALUE(STRING_PROBE_DEPTH,      ProbeMode::getDepth, ProbeMode::setDepth, 1, 20),
+  MENU_VALUE(STRING_PROBE_FEED,       ProbeMode::getFeed, ProbeMode::setFeed, 10, 1000),
+  MENU_VALUE(STRING_PROBE_COMPENSATE, ProbeMode::getCompensation, ProbeMode::setCompensation, 0, 1)
+};
+
+/**
+ * The "singleton" instance of the ProbeMode class.
+ */
+ProbeMode MrktProbeMode;
+
+ProbeMode::ProbeMode() :
+  AbstractMode() {
+  this->state = Setup;
+  this->sizeX = 100;
+  this->sizeY = 80;
+  this->pointsX = 5;
+  this->pointsY = 4;
+  this->clearance = 2;
+  this->depth = 2;
+  this->feed = 100;
+  this->commandPending = false;
+}
+
+void ProbeMode::activate() {
+  this->state = Setup;
+  this->commandPending = false;
+  MrktUserControls.clearEvents();
+  MrktDisplay.clear();
+  this->menu.begin(ProbeMode_Menu, sizeof(ProbeMode_Menu) / sizeof(Menu::Entry));
+}
+
+void ProbeMode::deactivate() {
+  // the run cannot be continued - the map remains invalid
+  this->state = Setup;
+  this->commandPending = false;
+  MrktDisplay.clear();
+}
+
+void ProbeMode::loop() {
+  while (MrktUserControls.isEventAvailable()) {
+    UserControls::Event event = MrktUserControls.getEvent();
+    switch(this->state) {
+      case Setup:
+        if (!this->menu.handleEvent(event)) {
+          MrktModeController.switchToPreviousMode();
+        }
+        break;
+      case Raising:
+      case Moving:
+      case Probing:
+        if ((event.type == UserControls::ModeButton) || (event.type == UserControls::KeyLeft)) {
+          this->stopRequested = true;
+          display();
+        }
+        break;
+      default:
+        // any key returns to the menu
+        this->state = Setup;
+        MrktDisplay.clear();
+        this->menu.display();
+        break;
+    }
+  }
+  if (((this->state == Raising) || (this->state == Moving) || (this->state == Probing)) && 
+      !this->commandPending && MrktCommunication.isIdle()) {
+    // the run stops before moving to the next point, so the probe is never left on the surface
+    if (this->stopRequested && (this->state == Moving)) {
+      this->state = Stopped;
+      display();
+    } else {
+      sendCommand();
+    }
+  }
+}
+
+bool ProbeMode::isBusy() {
+  // the next command can be sent at once
+  return ((this->state == Raising) || (this->state == Moving) || (this->state == Probing)) && 
+         !this->commandPending && MrktCommunication.isIdle();
+}
+
+void ProbeMode::startProbing() {
+  MrktProbeMode.start();
+}
+
+int16_t ProbeMode::getSizeX() {
+  return MrktProbeMode.sizeX;
+}
+
+void ProbeMode::setSizeX(int16_t value) {
+  MrktProbeMode.sizeX = value;
+}
+
+int16_t ProbeMode::getSizeY() {
+  return MrktProbeMode.sizeY;
+}
+
+void ProbeMode::setSizeY(int16_t value) {
+  MrktProbeMode.sizeY = value;
+}
+
+int16_t ProbeMode::getPointsX() {
+  return MrktProbeMode.pointsX;
+}
+
+void ProbeMode::setPointsX(int16_t value) {
+  MrktProbeMode.pointsX = value;
+}
+
+int16_t ProbeMode::getPointsY() {
+  return MrktProbeMode.pointsY;
+}
+
+void ProbeMode::setPointsY(int16_t value) {
+  MrktProbeMode.pointsY = value;
+}
+
+int16_t ProbeMode::getClearance() {
+  return MrktProbeMode.clearance;
+}
+
+void ProbeMode::setClearance(int16_t value) {
+  MrktProbeMode.clearance = value;
+}
+
+int16_t ProbeMode::getDepth() {
+  return MrktProbeMode.depth;
+}
+
+void ProbeMode::setDepth(int16_t value) {
+  MrktProbeMode.depth = value;
+}
+
+int16_t ProbeMode::getFeed() {
+  return MrktProbeMode.feed;
+}
+
+void ProbeMode::setFeed(int16_t value) {
+  MrktProbeMode.feed = value;
+}
+
+int16_t ProbeMode::getCompensation() {
+  return MrktHeightMap.isActive() ? 1 : 0;
+}
+
+void ProbeMode::setCompensation(int16_t value) {
+  MrktHeightMap.setActive(value != 0);
+}
+
+void ProbeMode::start() {
+  MrktHeightMap.begin(this->pointsX, this->pointsY, (Coordinate) this->sizeX * 1000, (Coordinate) this->sizeY * 1000);
+  this->point = 0;
+  this->lastOffset = 0;
+  this->stopRequested = false;
+  this->state = Raising;
+  MrktDisplay.clear();
+  display();
+}
+
+void ProbeMode::sendCommand() {
+  char command[PROBE_MODE_COMMAND_SIZE];
+  uint8_t length;
+  uint16_t timeout = PROBE_MODE_COMMAND_TIMEOUT;
+  if (this->state == Raising) {
+    // the units and the distance mode are set each time in case the operator has changed them
+    strcpy_P(command, PSTR("G21G90G0Z"));
+    length = strlen(command);
+    Coordinates::write((Coordinate) this->clearance * 1000, command + length);
+  } else if (this->state == Moving) {
+    uint8_t column, row;
+    getGridPoint(this->point, column, row);
+    strcpy_P(command, PSTR("G0X"));
+    length = strlen(command);
+    length += Coordinates::write(MrktHeightMap.getPointX(column), command + length);
+    command[length++] = 'Y';
+    Coordinates::write(MrktHeightMap.getPointY(row), command + length);
+  } else {
+    strcpy_P(command, PSTR("G38.2Z"));
+    length = strlen(command);
+    length += Coordinates::write((Coordinate) this->depth * -1000, command + length);
+    command[length++] = 'F';
+    Coordinates::write((Coordinate) this->feed * 1000, command + length);
+    this->probeValid = false;
+    timeout = PROBE_MODE_PROBE_TIMEOUT;
+  }
+  MrktCommunication.sendGrblCommand(command, timeout, &ProbeMode::handleCommandResponse, 
+                                    &ProbeMode::handleResponseLine);
+  this->commandPending = true;
+}
+
+void ProbeMode::advance() {
+  switch(this->state) {
+    case Raising:
+      if (this->point >= this->pointsX * this->pointsY) {
+        MrktHeightMap.finish();
+        this->state = Finished;
+      } else {
+        this->state = Moving;
+      }
+      break;
+    case Moving:
+      this->state = Probing;
+      break;
+    case Probing:
+      if (!this->probeValid) {
+        this->errorStatus = PROBE_MODE_ERROR_NO_CONTACT;
+        this->state = Error;
+        break;
+      }
+      if (this->point == 0) {
+        this->referenceHeight = this->probeHeight;
+      }
+      this->lastOffset = constrain(this->probeHeight - this->referenceHeight, INT16_MIN, INT16_MAX);
+      uint8_t column, row;
+      getGridPoint(this->point, column, row);
+      MrktHeightMap.setPoint(column, row, this->lastOffset);
+      this->point++;
+      this->state = Raising;
+      break;
+    default:
+      break;
+  }
+  display();
+}
+
+void ProbeMode::getGridPoint(uint8_t point, uint8_t & column, uint8_t & row) {
+  // the rows are probed in alternating directions to avoid travelling back
+  row = point / this->pointsX;
+  column = point % this->pointsX;
+  if ((row & 1) != 0) {
+    column = this->pointsX - 1 - column;
+  }
+}
+
+void ProbeMode::display() {
+  uint8_t total = this->pointsX * this->pointsY;
+  MrktDisplay.setCursor(0, 0);
+  switch(this->state) {
+    case Finished:
+      MrktDisplay.writeString(STRING_PROBE_MAP_SAVED, DISPLAY_LCD_COLUMNS);
+      MrktDisplay.setCursor(0, 1);
+      MrktDisplay.writeString(STRING_PROBE_POINTS);
+      MrktDisplay.writeRightAligned(6, 1, total);
+      break;
+    case Stopped:
+      MrktDisplay.writeString(STRING_PROBE_STOPPED, DISPLAY_LCD_COLUMNS);
+      MrktDisplay.setCursor(0, 1);
+      MrktDisplay.writeString(STRING_EMPTY, DISPLAY_LCD_COLUMNS);
+      break;
+    case Error:
+      MrktDisplay.writeString(STRING_PROBE_FAILED, DISPLAY_LCD_COLUMNS);
+      MrktDisplay.setCursor(0, 1);
+      switch(this->errorStatus) {
+        case PROBE_MODE_ERROR_NO_CONTACT:
+          MrktDisplay.writeString(STRING_PROBE_NO_CONTACT, DISPLAY_LCD_COLUMNS);
+          break;
+        case COMMUNICATION_STATUS_TIMEOUT:
+          MrktDisplay.writeString(STRING_TIMEOUT, DISPLAY_LCD_COLUMNS);
+          break;
+        default:
+          MrktDisplay.writeString(STRING_GRBL_ERROR, DISPLAY_LCD_COLUMNS);
+          MrktDisplay.setCursor(11, 1);
+          MrktDisplay.writeNumber(this->errorStatus);
+          break;
+      }
+      break;
+    default:
+      MrktDisplay.writeString(STRING_PROBE);
+      MrktDisplay.writeProgressBar(6, 0, 6, this->point * 100 / total);
+      MrktDisplay.writePercent(12, 0, this->point * 100 / total);
+      MrktDisplay.setCursor(0, 1);
+      if (this->stopRequested) {
+        MrktDisplay.writeString(STRING_PROBE_STOPPING, DISPLAY_LCD_COLUMNS);
+        MrktDisplay.writeEllipsis(8, 1);
+      } else {
+        MrktDisplay.write('Z');
+        MrktDisplay.writeCoordinate(1, 1, DISPLAY_LCD_COLUMNS - 1, this->lastOffset);
+      }
+      break;
+  }
+}
+
+void ProbeMode::handleCommandResponse(int status, char * response) {
+  if (!MrktProbeMode.commandPending) {
+    return;
+  }
+  MrktProbeMode.commandPending = false;
+  if (status == COMMUNICATION_STATUS_OK) {
+    MrktProbeMode.advance();
+  } else {
+    MrktProbeMode.errorStatus = status;
+    MrktProbeMode.state = Error;
+    MrktProbeMode.display();
+  }
+}
+
+void ProbeMode::handleResponseLine(char * line) {
+  // [PRB:x,y,z:1] - the last value tells whether the probe has touched the surface
+  if (strncmp_P(line, PSTR("[PRB:"), 5) != 0) {
+    return;
+  }
+  const char * position = strchr(line, ',');
+  if (position != NULL) {
+    position = strchr(position + 1, ',');
+  }
+  if (position == NULL) {
+    return;
+  }
+  MrktProbeMode.probeHeight = Coordinates::parse(position + 1, &position);
+  MrktProbeMode.probeValid = (position[0] == ':') && (position[1] == '1');
+}
@@ -0,0 +1,178 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_ProbeMode_h
+#define MRKT_ProbeMode_h
+
+#include "Configuration.h"
+#include "AbstractMode.h"
+#include "Coordinates.h"
+#include "Menu.h"
+
+/**
+ * This class implements the probe mode that records the height map of the stock (see 
+ * HeightMap.h), e.g. to engrave or mill PCBs on a warped blank. The mode is entered from
+ * the main menu and shows a menu (see Menu.h) with the parameters of the grid: 
+ * 
+ *   ┌────────────────┐
+ *   │>Start          │
+ *   │ Size X mm   100│
+ *   └────────────────┘
+ * 
+ * The grid covers the work coordinates from (0, 0) to the size given, so the work coordinate 
+ * system has to be set up before probing, with the work Z zero close to the surface. For 
+ * each grid point, the probe is raised to the clearance height, moved to the point and 
+ * lowered using G38.2 until it touches the surface or reaches the depth given below the 
+ * work Z zero. The points are probed row by row in alternating directions:
+ * 
+ *   ┌────────────────┐
+ *   │Probe      12/25│
+ *   │Z         -0.132│
+ *   └────────────────┘
+ * 
+ * The heights are taken from the probe results reported by Grbl ([PRB:x,y,z:1]) and stored
+ * relative to the first point, so the first point has to be probed at the height the job 
+ * has been set up for. Grbl has to report the positions in mm ($13=0). A failed probe stops
+ * the run. The mode button or the left key stops probing after the current point. 
+ * 
+ * A new map is active at once; the entry "Compensate" of the menu activates or deactivates 
+ * the compensation of the jobs streamed from the SD card (see HeightCompensator.h).
+ */
+class ProbeMode : public AbstractMode {
+
+  public:
+    /**
+     * The default constructor.
+     */
+    ProbeMode();
+
+    /**
+     * See AbstractMode for an explanation of these methods.
+     */
+    void activate();
+    void loop();
+    void deactivate();
+    bool isBusy();
+
+    /**
+     * The actions and value accessors called by the menu entries.
+     */
+    static void startProbing();
+    static int16_t getSizeX();
+    static void setSizeX(int16_t value);
+    static int16_t getSizeY();
+    static void setSizeY(int16_t value);
+    static int16_t getPointsX();
+    static void setPointsX(int16_t value);
+    static int16_t getPointsY();
+    static void setPointsY(int16_t value);
+    static int16_t getClearance();
+    static void setClearance(int16_t value);
+    static int16_t getDepth();
+    static void setDepth(int16_t value);
+    static int16_t getFeed();
+    static void setFeed(int16_t value);
+    static int16_t getCompensation();
+    static void setCompensation(int16_t value);
+
+  private:
+    /**
+     * The enumeration to represent the internal state of the mode implementation: the menu is
+     * displayed (Setup), the probe is raised, moved to the next point or lowered, or the run
+     * has ended.
+     */
+    enum InternalState { Setup, Raising, Moving, Probing, Finished, Stopped, Error };
+    InternalState state;
+
+    /**
+     * The menu engine.
+     */
+    Menu menu;
+
+    /**
+     * The parameters of the grid: the size in mm, the number of points, the clearance height
+     * and the maximum probe depth in mm and the probe feed rate in mm/min.
+     */
+    int16_t sizeX;
+    int16_t sizeY;
+    int16_t pointsX;
+    int16_t pointsY;
+    int16_t clearance;
+    int16_t depth;
+    int16_t feed;
+
+    /**
+     * The number of the point being probed (in the order of probing), whether the response to
+     * a command is pending and whether stopping has been requested.
+     */
+    uint8_t point;
+    bool commandPending;
+    bool stopRequested;
+
+    /**
+     * The Z position reported for the current point and whether the probe has touched the 
+     * surface, the height of the first point and the offset of the last point.
+     */
+    Coordinate probeHeight;
+    bool probeValid;
+    Coordinate referenceHeight;
+    Coordinate lastOffset;
+
+    /**
+     * The status code of the error that stopped the run (see Communication.h).
+     */
+    int errorStatus;
+
+    /**
+     * Starts the run: the new map is recorded and the first command is sent.
+     */
+    void start();
+
+    /**
+     * Sends the command that corresponds to the current state.
+     */
+    void sendCommand();
+
+    /**
+     * Continues with the next state after the command has been acknowledged.
+     */
+    void advance();
+
+    /**
+     * Determines the grid point probed at the given position in the order of probing.
+     */
+    void getGridPoint(uint8_t point, uint8_t & column, uint8_t & row);
+
+    /**
+     * Displays the progress or the result of the run.
+     */
+    void display();
+
+    /**
+     * The response handler of the commands and the handler for the probe results.
+     */
+    static void handleCommandResponse(int status, char * response);
+    static void handleResponseLine(char * line);
+
+};
+
+/**
+ * Access to the "singleton" instance of the ProbeMode class.
+ */
+extern ProbeMode MrktProbeMode;
+
+#endif
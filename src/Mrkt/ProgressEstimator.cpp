@@ -0,0 +1,107 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "ProgressEstimator.h"
+
+ProgressEstimator::ProgressEstimator() {
+  start(0, 0, 0);
+}
+
+void ProgressEstimator::start(uint32_t totalTime, uint32_t completedTime, uint32_t now) {
+  this->totalTime = totalTime;
+  this->completedTime = completedTime;
+  this->scaledTime = 0;
+  this->elapsedTime = 0;
+  this->startTime = now;
+  this->feedOverride = 100;
+  this->queueStart = 0;
+  this->queueCount = 0;
+}
+
+void ProgressEstimator::addLine(uint32_t time) {
+  if (this->queueCount >= PROGRESS_ESTIMATOR_QUEUE_SIZE) {
+    // cannot happen as long as the queue is as large as the one of the communication system
+    return;
+  }
+  // the time is stored in units of 10 ms - rounding errors even out over many lines
+  time = (time + 5) / 10;
+  uint8_t position = (this->queueStart + this->queueCount) % PROGRESS_ESTIMATOR_QUEUE_SIZE;
+  this->lineTimes[position] = (time > 0xFFFF) ? 0xFFFF : time;
+  this->queueCount++;
+}
+
+void ProgressEstimator::acknowledgeLine(uint32_t now) {
+  if (this->queueCount == 0) {
+    return;
+  }
+  uint32_t time = (uint32_t) this->lineTimes[this->queueStart] * 10;
+  this->queueStart = (this->queueStart + 1) % PROGRESS_ESTIMATOR_QUEUE_SIZE;
+  this->queueCount--;
+  this->completedTime += time;
+  this->scaledTime += time * 100 / this->feedOverride;
+  this->elapsedTime = now - this->startTime;
+}
+
+void ProgressEstimator::pause(uint32_t now) {
+  this->pauseTime = now;
+}
+
+void ProgressEstimator::resume(uint32_t now) {
+  // the time spent paused does not count as elapsed time
+  this->startTime += now - this->pauseTime;
+}
+
+void ProgressEstimator::setFeedOverride(uint8_t percent) {
+  if (percent > 0) {
+    this->feedOverride = percent;
+  }
+}
+
+bool ProgressEstimator::isTotalKnown() {
+  return (this->totalTime > 0);
+}
+
+uint8_t ProgressEstimator::getPercent() {
+  if ((this->totalTime == 0) || (this->completedTime >= this->totalTime)) {
+    return (this->totalTime == 0) ? 0 : 100;
+  }
+  // the total is reduced first to prevent an overflow
+  return this->completedTime / (this->totalTime / 100 + 1);
+}
+
+uint32_t ProgressEstimator::getRemainingTime() {
+  if (this->completedTime >= this->totalTime) {
+    return 0;
+  }
+  uint32_t remaining = (this->totalTime - this->completedTime) / this->feedOverride * 100;
+  if (this->scaledTime < PROGRESS_ESTIMATOR_MIN_SAMPLE) {
+    // not enough data yet to correct the estimate
+    return remaining;
+  }
+  // the correction factor (real time / estimated time) in units of 1/256, limited to 1/4 .. 4
+  uint32_t factor = this->elapsedTime / (this->scaledTime >> 8);
+  if (factor < 64) {
+    factor = 64;
+  } else if (factor > 1024) {
+    factor = 1024;
+  }
+  return (remaining >> 8) * factor;
+}
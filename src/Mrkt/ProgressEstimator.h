@@ -0,0 +1,128 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_ProgressEstimator_h
+#define MRKT_ProgressEstimator_h
+
+#include <inttypes.h>
+
+/**
+ * The maximum number of lines that can be pending (see COMMUNICATION_STREAM_QUEUE_SIZE).
+ */
+#define PROGRESS_ESTIMATOR_QUEUE_SIZE 16
+
+/**
+ * The amount of estimated time (in ms) that has to be completed before the estimate of the
+ * remaining time is corrected using the real time elapsed.
+ */
+#define PROGRESS_ESTIMATOR_MIN_SAMPLE 10000
+
+/**
+ * This class estimates the progress and the remaining time of a running job. The estimated
+ * time of every line sent (see MotionEstimator) is queued and added to the completed time 
+ * as soon as Grbl acknowledges the line. The remaining time is derived from the estimated 
+ * total time of the job, scaled by the current feed override and corrected by the ratio of 
+ * the real time elapsed to the estimated time completed (which accounts for acceleration and
+ * for the lines buffered by Grbl). All operations take constant time, and all values are 
+ * integers - times are given in ms.
+ * 
+ * This class does not depend on the Arduino libraries so that it can be used by the host 
+ * tools as well - the current time is passed in by the caller.
+ */
+class ProgressEstimator {
+
+  public:
+    /**
+     * The default constructor.
+     */
+    ProgressEstimator();
+
+    /**
+     * Starts the estimate of a job with the total time given (0 if unknown). If a job is 
+     * resumed, the time of the lines that have been completed before is passed as well.
+     */
+    void start(uint32_t totalTime, uint32_t completedTime, uint32_t now);
+
+    /**
+     * Records a line that has been sent, together with its estimated time.
+     */
+    void addLine(uint32_t time);
+
+    /**
+     * Records the acknowledgement of the oldest line sent.
+     */
+    void acknowledgeLine(uint32_t now);
+
+    /**
+     * Stops and restarts the measurement of the real time while the job is paused.
+     */
+    void pause(uint32_t now);
+    void resume(uint32_t now);
+
+    /**
+     * Sets the feed override in percent, as reported by Grbl.
+     */
+    void setFeedOverride(uint8_t percent);
+
+    /**
+     * Checks whether the total time of the job is known - otherwise, only the completed 
+     * time is available.
+     */
+    bool isTotalKnown();
+
+    /**
+     * Returns the progress in percent.
+     */
+    uint8_t getPercent();
+
+    /**
+     * Returns the estimated remaining time in ms.
+     */
+    uint32_t getRemainingTime();
+
+  private:
+    /**
+     * The estimated total time of the job and the estimated time of the lines acknowledged.
+     */
+    uint32_t totalTime;
+    uint32_t completedTime;
+
+    /**
+     * The estimated time of the lines acknowledged since the start, scaled by the feed
+     * override at that time, and the real time elapsed at the last acknowledgement.
+     */
+    uint32_t scaledTime;
+    uint32_t elapsedTime;
+    uint32_t startTime;
+    uint32_t pauseTime;
+
+    /**
+     * The current feed override in percent.
+     */
+    uint8_t feedOverride;
+
+    /**
+     * The estimated times of the lines that have been sent but not yet acknowledged, in 
+     * units of 10 ms. The queue is organized as a ring buffer.
+     */
+    uint16_t lineTimes[PROGRESS_ESTIMATOR_QUEUE_SIZE];
+    uint8_t queueStart;
+    uint8_t queueCount;
+
+};
+
+#endif
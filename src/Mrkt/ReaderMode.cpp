@@ -0,0 +1,945 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "Arduino.h"
+
+#include "Configuration.h"
+#include "ReaderMode.h"
+
+#if SDCARD_AVAILABLE == 1
+
+#include "Checkpoint.h"
+#include "Communication.h"
+#include "Display.h"
+#include "FileBrowser.h"
+#include "GrblSettings.h"
+#include "HeightMap.h"
+#include "JobLog.h"
+#include "JobScanner.h"
+#include "ModeController.h"
+#include "OverrideControl.h"
+#include "Uploader.h"
+#include "UserControls.h"
+
+/**
+ * The interval in ms at which the display is refreshed while a job is running.
+ */
+#define READER_MODE_REFRESH_INTERVAL    500
+
+/**
+ * The interval in ms at which the progress of a running job is stored in the EEPROM.
+ */
+#define READER_MODE_CHECKPOINT_INTERVAL 5000
+
+/**
+ * The interval in ms at which status reports are requested while a job is running.
+ */
+#define READER_MODE_STATUS_INTERVAL     1000
+
+/**
+ * The extension of playlist files.
+ */
+#define READER_MODE_PLAYLIST_EXTENSION  "MPL"
+
+/**
+ * The number of lines that are scanned during a single loop iteration when resuming a job.
+ */
+#define READER_MODE_SCAN_LINES          16
+
+/**
+ * The pages of job information displayed while the job is ready to be started.
+ */
+#define READER_MODE_INFO_PAGES           6
+
+/**
+ * The errors detected by the reader mode itself. These are negative to distinguish 
+ * them from the Grbl error codes, and they must not overlap with COMMUNICATION_STATUS_*.
+ */
+#define READER_MODE_ERROR_LINE_TOO_LONG -10
+#define READER_MODE_ERROR_READ          -11
+#define READER_MODE_ERROR_NOT_COMPACT   -12
+
+#if READER_MODE_LINE_BUFFER_SIZE < JOB_SCANNER_LINE_BUFFER_SIZE
+#error "The JobScanner requires a larger line buffer of the reader mode."
+#endif
+
+/**
+ * The "singleton" instance of the ReaderMode class.
+ */
+ReaderMode MrktReaderMode;
+
+ReaderMode::ReaderMode() : 
+  AbstractMode() {
+  memset(this->fileName, '\0', READER_MODE_FILE_NAME_SIZE);
+  this->state = NoFile;
+  this->startRequested = false;
+  this->compiled = false;
+  this->resumeLine = 0;
+  this->browsePosition = 0;
+  this->nextAvailable = false;
+  this->previousPending = 0;
+}
+
+void ReaderMode::activate() {
+  MrktUserControls.clearEvents();
+  MrktDisplay.clear();
+  if (this->state == NoFile) {
+    startBrowsing();
+  }
+  this->refresh = true;
+}
+
+void ReaderMode::deactivate() {
+  MrktDisplay.clear();
+}
+
+bool ReaderMode::selectFile(const char * fileName, bool start) {
+  if (isRunning()) {
+    return false;
+  }
+  if (!MrktStorage.begin()) {
+    return false;
+  }
+  if (this->playlist.isOpen()) {
+    this->playlist.close();
+  }
+  this->nextAvailable = false;
+  if (isPlaylist(fileName)) {
+    // the playlist provides the name of the first job and is then read one job ahead
+    if (!this->playlist.open(fileName, O_READ) || !readPlaylistEntry()) {
+      this->playlist.close();
+      this->state = NoFile;
+      return false;
+    }
+    fileName = this->nextName;
+  }
+  if (!openJob(fileName)) {
+    this->playlist.close();
+    this->state = NoFile;
+    return false;
+  }
+  if (this->playlist.isOpen()) {
+    this->nextAvailable = readPlaylistEntry();
+  }
+  this->resumeLine = 0;
+  this->startRequested = start;
+  if (!start && MrktCheckpoint.load(this->fileId, this->checkpointLine)) {
+    // the job has been interrupted - offer to resume it
+    this->resumeLine = this->checkpointLine;
+    this->state = ResumeOffer;
+    loadPreview();
+  } else {
+    this->state = Ready;
+  }
+  this->refresh = true;
+  return true;
+}
+
+bool ReaderMode::openJob(const char * fileName) {
+  if (this->file.isOpen()) {
+    this->file.close();
+  }
+  if (!this->file.open(fileName, O_READ)) {
+    return false;
+  }
+  strncpy(this->fileName, fileName, READER_MODE_FILE_NAME_SIZE - 1);
+  this->fileName[READER_MODE_FILE_NAME_SIZE - 1] = '\0';
+  readHeader();
+  requestScan();
+  this->infoPage = 0;
+  this->fileId = Checkpoint::getFileId(this->fileName, this->file.fileSize());
+  return true;
+}
+
+bool ReaderMode::isPlaylist(const char * fileName) {
+  const char * extension = strchr(fileName, '.');
+  return (extension != NULL) && (strcasecmp_P(extension + 1, PSTR(READER_MODE_PLAYLIST_EXTENSION)) == 0);
+}
+
+bool ReaderMode::readPlaylistEntry() {
+  this->nextPause = false;
+  while (true) {
+    // read the next line, skipping blanks and comments
+    uint8_t length = 0;
+    bool comment = false;
+    int nextChar = this->playlist.read();
+    if (nextChar < 0) {
+      return false;
+    }
+    while ((nextChar >= 0) && (nextChar != '\n')) {
+      if (nextChar == ';') {
+        comment = true;
+      } else if (!comment && (nextChar > ' ') && (length < READER_MODE_FILE_NAME_SIZE - 1)) {
+        this->nextName[length++] = nextChar;
+      }
+      nextChar = this->playlist.read();
+    }
+    this->nextName[length] = '\0';
+    if (strcasecmp_P(this->nextName, PSTR("PAUSE")) == 0) {
+      this->nextPause = true;
+    } else if (length > 0) {
+      return true;
+    }
+  }
+}
+
+void ReaderMode::startNextJob() {
+  // the lines of the previous job that are still pending are not counted for the next one
+  this->previousPending = MrktCommunication.getPendingLines();
+#if JOB_LOG_ENABLED == 1
+  // the previous job ends here as far as the log is concerned - its last lines are still executed
+  MrktJobLog.stop(0);
+#endif
+  if (!openJob(this->nextName)) {
+    stopJob(READER_MODE_ERROR_READ);
+    return;
+  }
+  // the file and the buffers are needed for streaming now - only a result that is already 
+  // known (from the header or the sidecar file) can be used
+  MrktJobScanner.cancel();
+  if (!this->file.seekSet(this->compiled ? this->dataOffset : 0)) {
+    stopJob(READER_MODE_ERROR_READ);
+    return;
+  }
+  this->nextAvailable = readPlaylistEntry();
+  resetJob();
+#if JOB_LOG_ENABLED == 1
+  MrktJobLog.start(this->fileId, 0, false);
+#endif
+  this->refresh = true;
+}
+
+void ReaderMode::startBrowsing() {
+  this->refresh = true;
+  if (MrktUploader.isActive()) {
+    // the uploader uses the file (see releaseFile())
+    return;
+  }
+  // the job file is no longer selected, so the browser can use it for the index, which is 
+  // checked and rebuilt if necessary each time the browser is entered
+  MrktJobScanner.cancel();
+  this->state = MrktFileBrowser.begin(this->file) ? Browsing : NoFile;
+}
+
+SdFile & ReaderMode::releaseFile() {
+  MrktJobScanner.cancel();
+  if (this->file.isOpen()) {
+    this->file.close();
+  }
+  if (this->playlist.isOpen()) {
+    this->playlist.close();
+  }
+  this->nextAvailable = false;
+  this->startRequested = false;
+  this->state = NoFile;
+  this->refresh = true;
+  return this->file;
+}
+
+void ReaderMode::requestScan() {
+  // the file and the buffers are lent to the scanner until the job is started
+  MrktJobScanner.request(this->fileName, this->file, this->lineBuffer, this->minifier, this->estimator);
+}
+
+bool ReaderMode::isRunning() {
+  return (this->state == Rebuilding) || (this->state == Streaming) || 
+         (this->state == Paused) || (this->state == Draining);
+}
+
+bool ReaderMode::isOverrideAvailable() {
+  return (this->state == Streaming) || (this->state == Paused) || (this->state == Draining);
+}
+
+void ReaderMode::loop() {
+  handleEvents();
+  switch(this->state) {
+    case NoFile:
+    case Finished:
+    case Paused:
+      // nothing to do but wait for the user
+      break;
+    case Browsing:
+      MrktFileBrowser.loop();
+      break;
+    case Ready:
+    case ResumeOffer:
+      if (this->startRequested) {
+        startJob();
+      }
+      break;
+    case Rebuilding:
+      loopRebuilding();
+      break;
+    case Streaming:
+      loopStreaming();
+      break;
+    case Draining:
+      loopDraining();
+      break;
+    case Error:
+      loopError();
+      break;
+  }
+  if (((this->state == Streaming) || (this->state == Draining)) && 
+      (millis() - this->lastCheckpointTime > READER_MODE_CHECKPOINT_INTERVAL)) {
+    MrktCheckpoint.save(this->fileId, this->linesAcknowledged);
+    this->lastCheckpointTime = millis();
+  }
+  if (((this->state == Streaming) || (this->state == Draining)) && 
+      (millis() - this->lastStatusTime > READER_MODE_STATUS_INTERVAL)) {
+    // the status reports provide the feed override for the progress estimation
+    MrktCommunication.requestStatusReport();
+    this->lastStatusTime = millis();
+  }
+  if (isOverrideAvailable()) {
+    MrktOverrideControl.loop();
+  }
+#if JOB_LOG_ENABLED == 1
+  // the log is only written while no line can be sent
+  if ((this->state != Streaming) || 
+      (this->linePrepared && !MrktCommunication.canStreamLine(this->lineLength))) {
+    MrktJobLog.loop();
+  }
+#endif
+  if (this->refresh || (millis() - this->lastRefreshTime > READER_MODE_REFRESH_INTERVAL)) {
+    display();
+  }
+}
+
+bool ReaderMode::isBusy() {
+  if (this->refresh) {
+    return true;
+  }
+  switch(this->state) {
+    case Browsing:
+      return MrktFileBrowser.isBuilding();
+    case Ready:
+    case ResumeOffer:
+      return this->startRequested;
+    case Rebuilding:
+      return true;
+    case Streaming:
+      // a line has to be read, or it can be sent
+      return !this->linePrepared || MrktCommunication.canStreamLine(this->lineLength);
+    default:
+      // waiting for the user or the responses of the Grbl system
+      return false;
+  }
+}
+
+void ReaderMode::loopRebuilding() {
+  // only a limited number of lines is scanned at a time to keep the user controls responsive
+  for (uint8_t i = 0; i < READER_MODE_SCAN_LINES; i++) {
+    if (this->linesAcknowledged >= this->resumeLine) {
+      // re-establish the modal state before the first line is sent
+      this->lineLength = this->minifier.writeModalState(this->lineBuffer);
+      this->linePrepared = (this->lineLength > 0);
+      this->preamblePending = this->linePrepared;
+      // the estimator already knows the modal state
+      this->lineTime = 0;
+      this->arcMode = this->minifier.getArcMode();
+      startProgress();
+      this->state = Streaming;
+      this->refresh = true;
+      return;
+    }
+    if (!readLine()) {
+      if (this->state == Rebuilding) {
+        // the file has changed or is shorter than expected
+        stopJob(READER_MODE_ERROR_READ);
+      }
+      return;
+    }
+    if (this->linePrepared) {
+      // the line has been sent and acknowledged before the job was interrupted - only 
+      // its effect on the modal state is required now
+      this->linesAcknowledged++;
+      this->linePrepared = false;
+      if (this->compiled || (GCODE_MINIFIER_ENABLED == 0)) {
+        this->minifier.minify(this->lineBuffer);
+      }
+      this->estimator.process(this->lineBuffer);
+      this->compensator.track(this->estimator);
+    }
+  }
+}
+
+void ReaderMode::loopStreaming() {
+  if (!this->linePrepared) {
+    if (!readLine()) {
+      if ((this->state == Streaming) && this->nextAvailable && !this->nextPause) {
+        // continue with the next job of the playlist while the end of this one is executed - 
+        // its first line is prepared during the next iteration
+        startNextJob();
+      } else if (this->state == Streaming) {
+        // end of file - wait for the remaining lines to be acknowledged
+        this->state = Draining;
+        this->refresh = true;
+      }
+      return;
+    }
+    if (this->arcMode != 0) {
+      restoreArcMode();
+    }
+    if (this->linePrepared && (this->compiled || (GCODE_MINIFIER_ENABLED == 1))) {
+      // the line is already minified, so the estimator can follow it before it is sent
+      this->lineTime = this->estimator.process(this->lineBuffer);
+      if (this->compensator.isActive()) {
+        // the line is replaced by its first segment - the segments share the time of the line
+        this->lineLength = this->compensator.process(this->lineBuffer, READER_MODE_LINE_BUFFER_SIZE,
+                                                     this->estimator);
+        if (this->lineLength == 0) {
+          stopJob(READER_MODE_ERROR_LINE_TOO_LONG);
+          return;
+        }
+        this->lineTime /= this->compensator.getSegmentCount();
+      }
+    }
+  }
+  if (this->linePrepared && MrktCommunication.canStreamLine(this->lineLength)) {
+    // the acknowledgement of a segment that does not complete its line is not counted
+    bool segment = this->compensator.hasSegments();
+    if (segment) {
+      this->segmentMask |= (uint16_t) 1 << (MrktCommunication.getPendingLines() - this->previousPending);
+    }
+    MrktCommunication.streamLine(this->lineBuffer, this->lineLength);
+    this->linePrepared = false;
+    if (!this->compiled && (GCODE_MINIFIER_ENABLED == 0)) {
+      // the estimator requires the minified line - the buffer is no longer needed for sending it
+      this->minifier.minify(this->lineBuffer);
+      this->lineTime = this->estimator.process(this->lineBuffer);
+    }
+    this->progress.addLine(this->lineTime);
+    if (segment) {
+      this->lineLength = this->compensator.nextSegment(this->lineBuffer, READER_MODE_LINE_BUFFER_SIZE);
+      this->linePrepared = (this->lineLength > 0);
+    }
+  }
+}
+
+void ReaderMode::loopDraining() {
+  if (MrktCommunication.getPendingLines() == 0) {
+    MrktCommunication.stopStreaming();
+    MrktCheckpoint.clear();
+#if JOB_LOG_ENABLED == 1
+    MrktJobLog.stop(0);
+#endif
+    this->state = Finished;
+    if (this->nextAvailable) {
+      // the playlist requests a pause (e.g. for a tool change) - the next job is started by the user
+      if (openJob(this->nextName)) {
+        this->nextAvailable = readPlaylistEntry();
+        this->resumeLine = 0;
+        this->state = Ready;
+      } else {
+        stopJob(READER_MODE_ERROR_READ);
+      }
+    }
+    this->refresh = true;
+  }
+}
+
+void ReaderMode::loopError() {
+  // wait for the lines that have already been sent to be acknowledged or dropped by Grbl
+  if (MrktCommunication.getPendingLines() == 0) {
+    MrktCommunication.stopStreaming();
+  }
+}
+
+void ReaderMode::handleEvents() {
+  while (MrktUserControls.isEventAvailable()) {
+    UserControls::Event event = MrktUserControls.getEvent();
+    switch(event.type) {
+      case UserControls::KeySelect:
+      case UserControls::EncButton:
+        if (this->state == Browsing) {
+          char name[FILE_BROWSER_NAME_SIZE];
+          if (MrktFileBrowser.getName(this->browsePosition, name)) {
+            selectFile(name, false);
+          }
+        } else if ((this->state == Ready) || (this->state == Finished)) {
+          this->resumeLine = 0;
+          startJob();
+        } else if (this->state == ResumeOffer) {
+          startJob();
+        } else if (this->state == Streaming) {
+          this->state = Paused;
+          this->progress.pause(millis());
+          MrktCheckpoint.save(this->fileId, this->linesAcknowledged);
+        } else if (this->state == Paused) {
+          this->state = Streaming;
+          this->progress.resume(millis());
+        } else if ((this->state == Error) && MrktCommunication.isIdle()) {
+          // the scan might have been cancelled when the job was started
+          requestScan();
+          this->state = Ready;
+        }
+        this->refresh = true;
+        break;
+      case UserControls::EncChanged:
+        if (this->state == Browsing) {
+          browse(event.data);
+        } else if (isOverrideAvailable()) {
+          MrktOverrideControl.adjust(event.data);
+          this->refresh = true;
+        } else if (this->state == ResumeOffer) {
+          // the job can be resumed from an earlier line, but not from a later one
+          int32_t line = (int32_t) this->resumeLine + event.data;
+          this->resumeLine = (line < 0) ? 0 : ((line > (int32_t) this->checkpointLine) ? this->checkpointLine : line);
+          loadPreview();
+          this->refresh = true;
+        }
+        break;
+      case UserControls::KeyUp:
+      case UserControls::KeyDown:
+        if (this->state == Browsing) {
+          browse((event.type == UserControls::KeyDown) ? 1 : -1);
+        } else if (this->state == Ready) {
+          // the distances are not known for precompiled job files 
+          uint8_t pages = this->compiled ? READER_MODE_INFO_PAGES - 2 : READER_MODE_INFO_PAGES;
+          this->infoPage = (event.type == UserControls::KeyDown) ? this->infoPage + 1 : this->infoPage + pages - 1;
+          this->infoPage %= pages;
+          this->refresh = true;
+        }
+        break;
+      case UserControls::KeyLeft:
+        if (this->state == ResumeOffer) {
+          // start the job from the beginning instead
+          this->resumeLine = 0;
+          this->state = Ready;
+          this->refresh = true;
+        } else if ((this->state == NoFile) || (this->state == Ready) || (this->state == Finished) ||
+                   ((this->state == Error) && MrktCommunication.isIdle())) {
+          // choose another file
+          startBrowsing();
+        } else if (isOverrideAvailable()) {
+          MrktOverrideControl.reset();
+          this->refresh = true;
+        }
+        break;
+      case UserControls::KeyRight:
+        if (isOverrideAvailable()) {
+          MrktOverrideControl.selectNext();
+          this->refresh = true;
+        }
+        break;
+      case UserControls::ModeButton:
+        if (!isRunning()) {
+          MrktModeController.switchToPreviousMode();
+        }
+        break;
+      default:
+        // ignore all other events
+        break;
+    }
+  }
+}
+
+void ReaderMode::startJob() {
+  this->startRequested = false;
+#if GCODE_MINIFIER_ENABLED == 0
+  if (MrktHeightMap.isActive() && !this->compiled) {
+    // the height compensation requires compacted lines
+    stopJob(READER_MODE_ERROR_NOT_COMPACT);
+    return;
+  }
+#endif
+  // the file and the buffers are needed for the job now
+  MrktJobScanner.cancel();
+  if (!this->file.isOpen() || !this->file.seekSet(this->compiled ? this->dataOffset : 0)) {
+    stopJob(READER_MODE_ERROR_READ);
+    return;
+  }
+  if (!MrktCommunication.startStreaming(&ReaderMode::handleStreamResponse, &ReaderMode::handleStatusReport)) {
+    // the communication system is still busy - try again during the next iteration
+    this->startRequested = true;
+    return;
+  }
+  this->previousPending = 0;
+  resetJob();
+  this->lastStatusTime = millis();
+#if JOB_LOG_ENABLED == 1
+  MrktJobLog.start(this->fileId, this->resumeLine, this->resumeLine > 0);
+#endif
+  // when resuming, the lines before the resume line are scanned first (see loopRebuilding())
+  this->state = (this->resumeLine > 0) ? Rebuilding : Streaming;
+  this->refresh = true;
+}
+
+void ReaderMode::resetJob() {
+  this->minifier.reset();
+  // the compensation requires minified lines
+  this->compensator.reset(MrktHeightMap.isActive() && (this->compiled || (GCODE_MINIFIER_ENABLED == 1)));
+  this->segmentMask = 0;
+  this->estimator.reset();
+  for (uint8_t axis = 0; axis < GRBL_SETTINGS_AXES; axis++) {
+    this->estimator.setMaxRate(axis, MrktGrblSettings.getMaxRate(axis));
+  }
+  startProgress();
+  this->linePrepared = false;
+  this->preamblePending = false;
+  this->arcMode = 0;
+  this->linesRead = 0;
+  this->linesAcknowledged = 0;
+  this->lastCheckpointTime = millis();
+}
+
+void ReaderMode::stopJob(int status) {
+  if ((this->state == Streaming) || (this->state == Paused) || (this->state == Draining)) {
+    // keep the lines that have been executed so that the job can be resumed
+    MrktCheckpoint.save(this->fileId, this->linesAcknowledged);
+#if JOB_LOG_ENABLED == 1
+    MrktJobLog.stop(status);
+#endif
+  }
+  this->errorStatus = status;
+  this->linePrepared = false;
+  this->state = Error;
+  this->refresh = true;
+}
+
+void ReaderMode::startProgress() {
+  // without the runtime of the job, only the number of lines can be displayed
+  uint32_t totalTime = MrktJobScanner.isComplete() ? MrktJobScanner.getResult().estimatedTime * 1000 : 0;
+  this->progress.start(totalTime, this->estimator.getTotalTime(), millis());
+}
+
+void ReaderMode::readHeader() {
+  JobFileHeader header;
+  this->compiled = (this->file.read(&header, sizeof(header)) == sizeof(header)) &&
+                   (memcmp(header.magic, JOB_FILE_MAGIC, JOB_FILE_MAGIC_SIZE) == 0) &&
+                   (header.version == JOB_FILE_VERSION) && (header.indexStride > 0);
+  if (this->compiled) {
+    this->lineCount = header.lineCount;
+    this->indexStride = header.indexStride;
+    this->indexOffset = header.indexOffset;
+    this->indexEntries = header.indexEntries;
+    this->dataOffset = header.dataOffset;
+  }
+}
+
+bool ReaderMode::readLine() {
+  if (this->compiled) {
+    return readRecord();
+  }
+  this->lineLength = 0;
+  int nextChar = this->file.read();
+  if (nextChar < 0) {
+    return false;
+  }
+  while ((nextChar >= 0) && (nextChar != '\n')) {
+    if (nextChar != '\r') {
+      if (this->lineLength >= READER_MODE_LINE_BUFFER_SIZE) {
+        // the line cannot be sent as a whole - sending a part would be dangerous
+        stopJob(READER_MODE_ERROR_LINE_TOO_LONG);
+        return false;
+      }
+      this->lineBuffer[this->lineLength] = nextChar;
+      this->lineLength++;
+    }
+    nextChar = this->file.read();
+  }
+  this->lineBuffer[this->lineLength] = '\0';
+  this->linesRead++;
+
+#if GCODE_MINIFIER_ENABLED == 1
+  this->lineLength = this->minifier.minify(this->lineBuffer);
+#endif
+  // empty lines (or lines that only contained comments) are not sent at all
+  this->linePrepared = (this->lineLength > 0);
+  return true;
+}
+
+bool ReaderMode::readRecord() {
+  if (this->linesRead >= this->lineCount) {
+    return false;
+  }
+  int length = this->file.read();
+  if (length == 0) {
+    // end of the records in this block - continue with the next block
+    uint32_t position = this->file.curPosition() - 1;
+    if (!this->file.seekSet(position - (position % JOB_FILE_BLOCK_SIZE) + JOB_FILE_BLOCK_SIZE)) {
+      stopJob(READER_MODE_ERROR_READ);
+      return false;
+    }
+    length = this->file.read();
+  }
+  if ((length <= 0) || (length > JOB_FILE_MAX_LINE_LENGTH) ||
+      (this->file.read(this->lineBuffer, length) != length)) {
+    stopJob(READER_MODE_ERROR_READ);
+    return false;
+  }
+  this->lineBuffer[length] = '\0';
+  this->lineLength = length;
+  this->linesRead++;
+  this->linePrepared = true;
+  return true;
+}
+
+bool ReaderMode::seekLine(uint32_t line) {
+  // the index provides the position of every indexStride-th line, the remaining lines are skipped
+  uint32_t entry = line / this->indexStride;
+  uint32_t offset;
+  if ((entry >= this->indexEntries) || 
+      !this->file.seekSet(this->indexOffset + entry * sizeof(offset)) ||
+      (this->file.read(&offset, sizeof(offset)) != sizeof(offset)) ||
+      !this->file.seekSet(offset)) {
+    return false;
+  }
+  this->linesRead = entry * this->indexStride;
+  while (this->linesRead < line) {
+    if (!readRecord()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ReaderMode::loadPreview() {
+  // only precompiled job files can be positioned quickly enough to display the line
+  this->lineLength = 0;
+  if (this->compiled && seekLine(this->resumeLine)) {
+    readRecord();
+  }
+  this->linePrepared = false;
+}
+
+void ReaderMode::restoreArcMode() {
+  // the first line with axis words continues the arc motion mode that was active when the job 
+  // was interrupted - the G word has to be added because the modal state line cannot contain it
+  if (strpbrk(this->lineBuffer, "XYZ") == NULL) {
+    return;
+  }
+  if ((strchr(this->lineBuffer, 'G') == NULL) && (this->lineLength + 2 <= READER_MODE_LINE_BUFFER_SIZE)) {
+    memmove(this->lineBuffer + 2, this->lineBuffer, this->lineLength + 1);
+    this->lineBuffer[0] = 'G';
+    this->lineBuffer[1] = '0' + this->arcMode;
+    this->lineLength += 2;
+  }
+  this->arcMode = 0;
+}
+
+void ReaderMode::browse(int16_t steps) {
+  int32_t position = (int32_t) this->browsePosition + steps;
+  int32_t last = (int32_t) MrktFileBrowser.getCount() - 1;
+  this->browsePosition = (position > last) ? ((last < 0) ? 0 : last) : ((position < 0) ? 0 : position);
+  this->refresh = true;
+}
+
+void ReaderMode::display() {
+  if (this->state == Browsing) {
+    displayBrowser();
+    this->refresh = false;
+    this->lastRefreshTime = millis();
+    return;
+  }
+  MrktDisplay.setCursor(0, 0);
+  if (this->state == NoFile) {
+    MrktDisplay.writeString(STRING_READER_NO_FILE, DISPLAY_LCD_COLUMNS);
+  } else if (this->state == ResumeOffer) {
+    MrktDisplay.writeString(STRING_READER_RESUME_AT);
+    MrktDisplay.writeRightAligned(9, 0, this->resumeLine);
+  } else {
+    uint8_t length = MrktDisplay.print(this->fileName);
+    while (length < DISPLAY_LCD_COLUMNS) {
+      MrktDisplay.write(' ');
+      length++;
+    }
+    // the file name has at most 12 characters, leaving enough space for the progress
+    bool started = (this->state != Ready) && (this->state != Rebuilding) && (this->state != Error);
+    if (started && this->progress.isTotalKnown()) {
+      MrktDisplay.writePercent(12, 0, this->progress.getPercent());
+    } else if (started && this->compiled && (this->lineCount > 0)) {
+      MrktDisplay.writePercent(12, 0, this->linesAcknowledged * 100 / this->lineCount);
+    }
+  }
+
+  if (isOverrideAvailable() && MrktOverrideControl.isDisplayed()) {
+    // the override replaces the progress while it is being changed
+    MrktOverrideControl.display(1);
+    this->refresh = false;
+    this->lastRefreshTime = millis();
+    return;
+  }
+  MrktDisplay.setCursor(0, 1);
+  switch(this->state) {
+    case NoFile:
+    case Browsing:
+      MrktDisplay.writeString(STRING_EMPTY, DISPLAY_LCD_COLUMNS);
+      break;
+    case Ready:
+      displayInfoPage();
+      break;
+    case ResumeOffer:
+      if (this->lineLength > 0) {
+        // show the beginning of the line to resume from
+        for (uint8_t i = 0; i < DISPLAY_LCD_COLUMNS; i++) {
+          MrktDisplay.write((i < this->lineLength) ? this->lineBuffer[i] : ' ');
+        }
+      } else {
+        MrktDisplay.writeString(STRING_READER_RESUME_KEYS);
+      }
+      break;
+    case Rebuilding:
+      MrktDisplay.writeString(STRING_READER_SCAN);
+      MrktDisplay.writeRightAligned(5, 1, this->linesAcknowledged);
+      break;
+    case Streaming:
+    case Draining:
+      if (this->progress.isTotalKnown()) {
+        MrktDisplay.write('L');
+        uint8_t length = MrktDisplay.writeNumber(this->linesAcknowledged);
+        MrktDisplay.writeTime(length + 1, 1, this->progress.getRemainingTime() / 1000);
+      } else {
+        MrktDisplay.writeString(STRING_READER_LINE);
+        MrktDisplay.writeRightAligned(5, 1, this->linesAcknowledged);
+      }
+      break;
+    case Paused:
+      MrktDisplay.writeString(STRING_READER_PAUSED);
+      MrktDisplay.writeRightAligned(7, 1, this->linesAcknowledged);
+      break;
+    case Finished:
+      MrktDisplay.writeString(STRING_READER_DONE);
+      MrktDisplay.writeRightAligned(5, 1, this->linesAcknowledged);
+      break;
+    case Error:
+      switch(this->errorStatus) {
+        case READER_MODE_ERROR_LINE_TOO_LONG:
+          MrktDisplay.writeString(STRING_READER_LINE_TOO_LONG, DISPLAY_LCD_COLUMNS);
+          break;
+        case READER_MODE_ERROR_READ:
+          MrktDisplay.writeString(STRING_READER_READ_ERROR, DISPLAY_LCD_COLUMNS);
+          break;
+        case READER_MODE_ERROR_NOT_COMPACT:
+          MrktDisplay.writeString(STRING_READER_NEEDS_MINIFIER, DISPLAY_LCD_COLUMNS);
+          break;
+        default:
+          MrktDisplay.writeString(STRING_GRBL_ERROR, DISPLAY_LCD_COLUMNS);
+          MrktDisplay.setCursor(11, 1);
+          MrktDisplay.writeNumber(this->errorStatus);
+          break;
+      }
+      break;
+  }
+  this->refresh = false;
+  this->lastRefreshTime = millis();
+}
+
+void ReaderMode::displayInfoPage() {
+  if (!MrktJobScanner.isComplete()) {
+    MrktDisplay.writeString(STRING_READER_READY_SCAN);
+    MrktDisplay.writePercent(11, 1, MrktJobScanner.getProgress());
+    return;
+  }
+  const JobScanner::Result & result = MrktJobScanner.getResult();
+  switch(this->infoPage) {
+    case 0:
+      MrktDisplay.writeString(STRING_READY);
+      MrktDisplay.writeTime(5, 1, result.estimatedTime);
+      break;
+    case 1:
+    case 2:
+    case 3:
+      MrktDisplay.write('X' + this->infoPage - 1);
+      MrktDisplay.writeCoordinate(1, 1, 7, result.boundsMin[this->infoPage - 1]);
+      MrktDisplay.write(' ');
+      MrktDisplay.writeCoordinate(9, 1, 7, result.boundsMax[this->infoPage - 1]);
+      break;
+    case 4:
+      MrktDisplay.writeString(STRING_READER_FEED_MM);
+      MrktDisplay.writeRightAligned(7, 1, result.feedDistance);
+      break;
+    case 5:
+      MrktDisplay.writeString(STRING_READER_RAPID_MM);
+      MrktDisplay.writeRightAligned(8, 1, result.rapidDistance);
+      break;
+  }
+}
+
+void ReaderMode::displayBrowser() {
+  if (!MrktFileBrowser.isReady()) {
+    MrktDisplay.setCursor(0, 0);
+    MrktDisplay.writeString(STRING_READER_INDEXING, DISPLAY_LCD_COLUMNS);
+    MrktDisplay.writeProgressBar(0, 1, 11, MrktFileBrowser.getProgress());
+    MrktDisplay.writePercent(11, 1, MrktFileBrowser.getProgress());
+    return;
+  }
+  if (MrktFileBrowser.getCount() == 0) {
+    MrktDisplay.setCursor(0, 0);
+    MrktDisplay.writeString(STRING_READER_NO_FILES, DISPLAY_LCD_COLUMNS);
+    MrktDisplay.setCursor(0, 1);
+    MrktDisplay.writeString(STRING_EMPTY, DISPLAY_LCD_COLUMNS);
+    return;
+  }
+  // the selected file is shown in the first row, followed by the next one - only these two
+  // entries are read from the index
+  char name[FILE_BROWSER_NAME_SIZE];
+  for (uint8_t row = 0; row < DISPLAY_LCD_LINES; row++) {
+    if (!MrktFileBrowser.getName(this->browsePosition + row, name)) {
+      name[0] = '\0';
+    }
+    MrktDisplay.setCursor(0, row);
+    MrktDisplay.write((row == 0) ? '>' : ' ');
+    uint8_t length = MrktDisplay.print(name) + 1;
+    while (length < DISPLAY_LCD_COLUMNS) {
+      MrktDisplay.write(' ');
+      length++;
+    }
+  }
+}
+
+void ReaderMode::handleStreamResponse(int status) {
+  if ((status == COMMUNICATION_STATUS_OK) && (MrktReaderMode.previousPending > 0)) {
+    // the line belongs to the previous job of the playlist
+    MrktReaderMode.previousPending--;
+  } else if (status == COMMUNICATION_STATUS_OK) {
+    bool segment = (MrktReaderMode.segmentMask & 1) != 0;
+    MrktReaderMode.segmentMask >>= 1;
+    // the preamble and the segments have been passed to the progress estimator as well
+    MrktReaderMode.progress.acknowledgeLine(millis());
+    if (MrktReaderMode.preamblePending) {
+      // the line that re-established the modal state is not part of the job
+      MrktReaderMode.preamblePending = false;
+    } else if (!segment) {
+#if JOB_LOG_ENABLED == 1
+      MrktJobLog.logResponse(status, MrktReaderMode.linesAcknowledged);
+#endif
+      MrktReaderMode.linesAcknowledged++;
+    }
+  } else if (MrktReaderMode.state != Error) {
+#if JOB_LOG_ENABLED == 1
+    MrktJobLog.logResponse(status, MrktReaderMode.linesAcknowledged);
+#endif
+    // stop sending lines - the modal state known to the minifier is no longer reliable, 
+    // and the rest of the job might depend on the line that failed
+    MrktReaderMode.stopJob(status);
+  }
+}
+
+void ReaderMode::handleStatusReport(char * line) {
+#if JOB_LOG_ENABLED == 1
+  MrktJobLog.logStatus(MrktReaderMode.linesAcknowledged);
+#endif
+  // the sniffer has already evaluated the report and keeps the overrides Grbl only sends now and then
+  MrktReaderMode.progress.setFeedOverride(MrktCommunication.getSniffer().getStatus().overrides[0]);
+}
+
+#endif // SDCARD_AVAILABLE
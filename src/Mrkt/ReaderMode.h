@@ -0,0 +1,436 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_ReaderMode_h
+#define MRKT_ReaderMode_h
+
+#include "Configuration.h"
+
+#if SDCARD_AVAILABLE == 1
+
+#include "AbstractMode.h"
+#include "GCodeMinifier.h"
+#include "HeightCompensator.h"
+#include "JobFile.h"
+#include "MotionEstimator.h"
+#include "ProgressEstimator.h"
+#include "Storage.h"
+
+/**
+ * The size of the buffer for a single line of the job file. Longer lines cause the 
+ * job to be stopped - they cannot be sent to Grbl safely.
+ */
+#define READER_MODE_LINE_BUFFER_SIZE  96
+
+/**
+ * The size of the buffer for the name of the job file (8.3 format).
+ */
+#define READER_MODE_FILE_NAME_SIZE    13
+
+/**
+ * This class implements the SD card reader mode that streams a G-code file (the job) 
+ * from the SD card to the Grbl system. The mode can be entered from any other mode using 
+ * the key combination MODE + DOWN or the host command RUN. The lines are read from the file, passed through
+ * the G-code minifier (unless disabled by GCODE_MINIFIER_ENABLED) and sent using the 
+ * streaming mode of the communication system. Precompiled job files (see JobFile.h) are 
+ * detected automatically; their lines are sent as stored, and the progress and the 
+ * estimated runtime are displayed as well.
+ * 
+ * Unless a file has been selected by the host, the mode starts with a file browser that lists
+ * the files of the SD card in alphabetical order (see FileBrowser.h). The encoder or the up and
+ * down keys move the selection, the select key chooses the file. The left key returns to the
+ * browser while no job is running. An upload by the host (command PUT) deselects the file, 
+ * since the upload uses the job file of this mode, and the browser is not available until
+ * the upload is complete.
+ * 
+ *   ┌────────────────┐
+ *   │>JOB.NC         │
+ *   │ PART2.NC       │
+ *   └────────────────┘
+ * 
+ * While the job is ready to be started, the up and down keys show the information determined 
+ * by the JobScanner: the estimated runtime, the extents of the job and the distances travelled.
+ * 
+ *   ┌────────────────┐
+ *   │JOB.NC          │
+ *   │X -12.70   76.20│
+ *   └────────────────┘
+ * 
+ * The progress of a running job is stored in the EEPROM regularly (see Checkpoint.h). When
+ * a file is selected that has been interrupted (by an error, a reset or a power loss), the 
+ * mode offers to resume the job at the last line that had been acknowledged by Grbl. The 
+ * encoder moves the resume line back; for precompiled job files, the line itself is shown
+ * as well, located using the line index of the file.
+ * 
+ *   ┌────────────────┐
+ *   │Resume at   1234│
+ *   │G1X10.5Y20      │
+ *   └────────────────┘
+ * 
+ * The select key resumes the job, the left key discards the checkpoint and returns to the 
+ * normal start. Before the job is resumed, the preceding lines are scanned without sending
+ * them to determine the modal state (units, distance mode, work coordinate system, spindle, 
+ * coolant and feed rate), which is sent to Grbl as a single line. Note that the tool is not
+ * moved to the position of the resume line - the operator has to make sure that the next
+ * motion can be executed safely.
+ * 
+ * While the job is running, the progress and the remaining time are displayed. Both are 
+ * derived from the estimated time of the lines acknowledged by Grbl (see ProgressEstimator.h), 
+ * so they are available once the JobScanner has determined the runtime of the job. The scan
+ * uses the file and the buffers of this mode and is cancelled when the job is started - a job
+ * started before the scan is complete only displays the number of lines. The feed override 
+ * is taken from the status reports requested while streaming.
+ * 
+ *   ┌────────────────┐
+ *   │JOB.NC       42%│
+ *   │L1234    0:12:34│
+ *   └────────────────┘
+ * 
+ * A playlist (extension READER_MODE_PLAYLIST_EXTENSION) runs several jobs in sequence. It
+ * contains one file name per line; a line PAUSE stops before the next job so that the tool 
+ * can be changed, and text following a semicolon is ignored:
+ * 
+ *   DRILL.MJ
+ *   PAUSE      ; change to the 3 mm end mill
+ *   POCKET.MJ
+ *   PROFILE.MJ
+ * 
+ * Without a pause, the next job is opened as soon as the last line of the current job has
+ * been read, and its lines are sent while the end of the current job is still being executed,
+ * so that Grbl's planner does not run empty between the jobs. After a pause, the next job 
+ * is ready to be started with the select key. Checkpoints refer to the individual jobs.
+ * Since the JobScanner needs the file and the buffers of this mode, a job that is started 
+ * without a pause only has an estimated runtime if it is precompiled or has been scanned 
+ * before - otherwise, its progress is based on the number of lines.
+ * 
+ * If a height map has been recorded and activated (see ProbeMode.h), the lines are adapted to
+ * the surface of the stock while they are sent (see HeightCompensator.h). The compensation 
+ * requires the G-code minifier or a precompiled job file. The segments of a line that is 
+ * split count as a single line for the progress, the checkpoints and the job log.
+ * 
+ * The select key or the encoder button starts, pauses and resumes the job. Pausing only 
+ * stops sending further lines, the lines already sent will be executed by Grbl. If Grbl 
+ * reports an error, the job is stopped; the select key then resets the job. The mode button 
+ * returns to the previous mode unless a job is running. While the job is running, the 
+ * encoder and the left and right keys change the overrides (see OverrideControl.h).
+ */
+class ReaderMode : public AbstractMode {
+  
+  public:
+    /**
+     * The default constructor.
+     */
+    ReaderMode();
+
+    /**
+     * See AbstractMode for an explanation of these methods.
+     */
+    void activate();
+    void loop();
+    void deactivate();
+    bool isBusy();
+
+    /**
+     * Selects the job file or a playlist. The job is started as soon as the mode is active if 
+     * start is set. Returns false if the file cannot be opened or another job is running.
+     */
+    bool selectFile(const char * fileName, bool start);
+
+    /**
+     * Checks whether a job is running (including a paused job).
+     */
+    bool isRunning();
+
+    /**
+     * Deselects the job file (or leaves the file browser) and returns the SdFile to be used
+     * otherwise (see Uploader.h). No file can be selected while an upload is active. This 
+     * must not be called while a job is running.
+     */
+    SdFile & releaseFile();
+
+  private:
+    /**
+     * The enumeration to represent the internal state of the mode implementation.
+     */
+    enum InternalState { NoFile, Browsing, Ready, ResumeOffer, Rebuilding, Streaming, Paused, Draining, Finished, Error };
+    InternalState state;
+
+    /**
+     * The name of the job file and the file itself.
+     */
+    char fileName[READER_MODE_FILE_NAME_SIZE];
+    SdFile file;
+
+    /**
+     * The playlist (if a playlist has been selected), the name of the next job read from it,
+     * whether there is a next job and whether the playlist requests a pause before it.
+     */
+    SdFile playlist;
+    char nextName[READER_MODE_FILE_NAME_SIZE];
+    bool nextAvailable;
+    bool nextPause;
+
+    /**
+     * The number of lines of the previous job of the playlist that have not been acknowledged
+     * when the next job was started.
+     */
+    uint8_t previousPending;
+
+    /**
+     * Whether the job file is a precompiled job file, and the information taken from the 
+     * header of the job file in this case.
+     */
+    bool compiled;
+    uint32_t lineCount;
+    uint32_t dataOffset;
+    uint16_t indexStride;
+    uint32_t indexOffset;
+    uint32_t indexEntries;
+
+    /**
+     * The identification of the job file used to match the checkpoints (see Checkpoint.h), 
+     * the line stored in the last checkpoint and the line the job is to be resumed at 
+     * (0 to start at the beginning). Lines are counted as lines sent to Grbl, i.e. without 
+     * lines that only contain comments.
+     */
+    uint16_t fileId;
+    uint32_t checkpointLine;
+    uint32_t resumeLine;
+
+    /**
+     * Whether the response to the line that re-establishes the modal state is still pending
+     * and the arc motion mode that has to be added to the first resumed line (0 if none).
+     */
+    bool preamblePending;
+    uint8_t arcMode;
+
+    /**
+     * The time the last checkpoint was stored and the time the last status report was requested.
+     */
+    uint32_t lastCheckpointTime;
+    uint32_t lastStatusTime;
+
+    /**
+     * The position of the file selected in the file browser.
+     */
+    uint16_t browsePosition;
+
+    /**
+     * The page of job information displayed while the job is ready to be started.
+     */
+    uint8_t infoPage;
+
+    /**
+     * Whether the job is to be started as soon as the mode is active.
+     */
+    bool startRequested;
+
+    /**
+     * The buffer holding the next line to send.
+     */
+    char lineBuffer[READER_MODE_LINE_BUFFER_SIZE + 1];
+    uint8_t lineLength;
+
+    /**
+     * Whether the line buffer contains a line that is ready to be sent.
+     */
+    bool linePrepared;
+
+    /**
+     * The number of lines read from the file and the number of lines acknowledged by Grbl.
+     */
+    uint32_t linesRead;
+    uint32_t linesAcknowledged;
+
+    /**
+     * The status code of the error that stopped the job (see Communication.h, 
+     * COMMUNICATION_STATUS_*), or READER_MODE_ERROR_* (see ReaderMode.cpp).
+     */
+    int errorStatus;
+
+    /**
+     * The minifier that shortens the lines before they are sent (unless disabled by 
+     * GCODE_MINIFIER_ENABLED) and tracks the modal state required to resume a job.
+     */
+    GCodeMinifier minifier;
+
+    /**
+     * The compensation of the height map, and the segments of the lines split by it that have 
+     * been sent but not acknowledged: bit n is set if the n-th pending line of the job is a
+     * segment that does not complete its line (the queue of the communication system holds 
+     * at most 16 lines).
+     */
+    HeightCompensator compensator;
+    uint16_t segmentMask;
+
+    /**
+     * The estimator that determines the time required by each line sent (and tracks the modal
+     * state for the compensation), the time of the line or segment prepared, and the estimator
+     * that derives the progress and the remaining time of the job from it.
+     */
+    MotionEstimator estimator;
+    uint32_t lineTime;
+    ProgressEstimator progress;
+
+    /**
+     * Set whenever the display has to be updated, and the time of the last update.
+     */
+    bool refresh;
+    uint32_t lastRefreshTime;
+
+    /** 
+     * The handler method for the responses to the lines streamed.
+     */
+    static void handleStreamResponse(int status);
+
+    /** 
+     * The handler method for the status reports requested while streaming.
+     */
+    static void handleStatusReport(char * line);
+
+    /**
+     * The implementations called during the loop() processing for each internal state.
+     */
+    void loopRebuilding();
+    void loopStreaming();
+    void loopDraining();
+    void loopError();
+
+    /**
+     * Processes the pending user control events.
+     */
+    void handleEvents();
+
+    /**
+     * Enters the file browser (see FileBrowser.h).
+     */
+    void startBrowsing();
+
+    /**
+     * Requests the information about the job file from the JobScanner.
+     */
+    void requestScan();
+
+    /**
+     * Moves the selection of the file browser by the number of steps given.
+     */
+    void browse(int16_t steps);
+
+    /**
+     * Checks whether the overrides can be changed, i.e. whether lines have been sent.
+     */
+    bool isOverrideAvailable();
+
+    /**
+     * Starts the job from the beginning of the file or resumes it at resumeLine.
+     */
+    void startJob();
+
+    /**
+     * Resets the state of the job before the first line is sent.
+     */
+    void resetJob();
+
+    /**
+     * Opens the job file and reads the information about it. Returns false if the file
+     * cannot be opened.
+     */
+    bool openJob(const char * fileName);
+
+    /**
+     * Checks whether the file given is a playlist.
+     */
+    static bool isPlaylist(const char * fileName);
+
+    /**
+     * Reads the next job from the playlist into nextName. Returns false at the end of the playlist.
+     */
+    bool readPlaylistEntry();
+
+    /**
+     * Continues the stream with the next job of the playlist.
+     */
+    void startNextJob();
+
+    /**
+     * Stops the job with the error given.
+     */
+    void stopJob(int status);
+
+    /**
+     * Starts the progress estimation, taking into account the time of the lines that have 
+     * already been executed when resuming a job.
+     */
+    void startProgress();
+
+    /**
+     * Reads the next line of the file into the line buffer. Returns false if the end of the 
+     * file has been reached. linePrepared is set if the line has to be sent.
+     */
+    bool readLine();
+
+    /**
+     * Reads the next record of a precompiled job file into the line buffer (see readLine()).
+     */
+    bool readRecord();
+
+    /**
+     * Checks whether the job file is a precompiled job file and reads the header if so.
+     */
+    void readHeader();
+
+    /**
+     * Positions a precompiled job file at the line given using the index. Returns false if 
+     * the line does not exist.
+     */
+    bool seekLine(uint32_t line);
+
+    /**
+     * Reads the resume line into the line buffer to display it, if possible.
+     */
+    void loadPreview();
+
+    /**
+     * Adds the arc motion mode to the line buffer if required (see arcMode).
+     */
+    void restoreArcMode();
+
+    /**
+     * Updates the display.
+     */
+    void display();
+
+    /**
+     * Displays the current page of job information in the second row.
+     */
+    void displayInfoPage();
+
+    /**
+     * Displays the files around the selection of the file browser.
+     */
+    void displayBrowser();
+
+};
+
+/**
+ * Access to the "singleton" instance of the ReaderMode class.
+ */
+extern ReaderMode MrktReaderMode;
+
+#endif // SDCARD_AVAILABLE
+
+#endif
@@ -0,0 +1,143 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_StateMachine_h
+#define MRKT_StateMachine_h
+
+#include <inttypes.h>
+#include "Arduino.h"
+
+/**
+ * The next state of a state without a timed transition.
+ */
+#define STATE_MACHINE_NONE 0xFF
+
+/**
+ * This template implements the internal state handling of the modes: the states are the
+ * values 0 to StateCount - 1 of an enum, and their behaviour is defined by a table in the
+ * program memory with one entry per state, e.g.
+ *
+ *   const StateMachine<Example::InternalState, 3>::State Example_States[3] PROGMEM = {
+ *     // enter                 tick                  delay  next
+ *     { Example::enterIdle,    Example::tickIdle,       0,  STATE_MACHINE_NONE },  // Idle
+ *     { Example::enterBusy,    0,                     500,  Example::Idle },       // Busy
+ *     { Example::enterError,   0,                       0,  STATE_MACHINE_NONE }   // Error
+ *   };
+ *
+ * When a state is entered, its enter handler is called. The tick handler is called during
+ * every following loop() until the state is left. If the next state is not
+ * STATE_MACHINE_NONE, the state machine switches to it once the delay (in ms) has passed -
+ * a delay of 0 switches with the next call of loop(). The handlers are static methods of the
+ * mode (like the callbacks of the menus and the Grbl responses) and may switch to another
+ * state themselves. A state switched to is entered during the next call of loop(), so
+ * switchTo() can be called from the response handlers as well.
+ *
+ * The table is indexed by the state, so dispatching does not depend on the number of states,
+ * and the table size is checked against the number of states by the compiler. Only the
+ * current state and the time it was entered at are kept in RAM.
+ */
+template <typename StateType, uint8_t StateCount>
+class StateMachine {
+
+  public:
+    /**
+     * The signature of the enter and tick handlers.
+     */
+    typedef void (*Handler) ();
+
+    /**
+     * The definition of a state. The handlers may be 0.
+     */
+    struct State {
+      Handler enter;
+      Handler tick;
+      uint16_t delay;
+      uint8_t next;
+    };
+
+    /**
+     * The constructor - the table has to reside in the program memory.
+     */
+    StateMachine(const State (&states)[StateCount]) {
+      this->states = states;
+      this->state = 0;
+      this->entered = true;
+      this->enterTime = 0;
+    }
+
+    /**
+     * Switches to the state given, which is entered during the next call of loop().
+     */
+    void switchTo(StateType state) {
+      this->state = state;
+      this->entered = false;
+    }
+
+    /**
+     * Returns the current state.
+     */
+    StateType getState() {
+      return (StateType) this->state;
+    }
+
+    /**
+     * Enters the current state if it has just been switched to, performs the timed transition
+     * or calls the tick handler.
+     */
+    void loop() {
+      const State * definition = &this->states[this->state];
+      if (!this->entered) {
+        this->entered = true;
+        this->enterTime = millis();
+        Handler enter = (Handler) pgm_read_ptr(&definition->enter);
+        if (enter != 0) {
+          enter();
+        }
+        return;
+      }
+      uint8_t next = pgm_read_byte(&definition->next);
+      if ((next != STATE_MACHINE_NONE) &&
+          (millis() - this->enterTime >= pgm_read_word(&definition->delay))) {
+        switchTo((StateType) next);
+        return;
+      }
+      Handler tick = (Handler) pgm_read_ptr(&definition->tick);
+      if (tick != 0) {
+        tick();
+      }
+    }
+
+  private:
+    /**
+     * The state table in the program memory.
+     */
+    const State * states;
+
+    /**
+     * The current state and whether its enter handler has been called.
+     */
+    uint8_t state;
+    bool entered;
+
+    /**
+     * The time at which the current state was entered.
+     */
+    uint32_t enterTime;
+
+};
+
+#endif
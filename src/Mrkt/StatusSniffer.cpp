@@ -0,0 +1,281 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "StatusSniffer.h"
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#else
+#define PROGMEM
+#define PSTR(text) (text)
+#define pgm_read_byte(address) (*(const uint8_t *) (address))
+#define strcmp_P(text, flashText) strcmp(text, flashText)
+#define strcpy_P(target, flashText) strcpy(target, flashText)
+#endif
+
+/**
+ * The prefixes of the lines evaluated in addition to the status reports.
+ */
+static const char StatusSniffer_GCodePrefix[] PROGMEM = "[GC:";
+static const char StatusSniffer_AlarmPrefix[] PROGMEM = "ALARM:";
+
+StatusSniffer::StatusSniffer() {
+  reset();
+}
+
+void StatusSniffer::reset() {
+  memset(&this->status, 0, sizeof(Status));
+  for (uint8_t i = 0; i < 3; i++) {
+    this->status.overrides[i] = 100;
+  }
+  this->lineType = LineStart;
+}
+
+void StatusSniffer::process(char nextChar) {
+  if (nextChar == '\n') {
+    if (this->lineType == Alarm) {
+      storeValue();
+    }
+    this->lineType = LineStart;
+    return;
+  }
+  switch(this->lineType) {
+    case LineStart:
+      this->position = 1;
+      if (nextChar == '<') {
+        this->lineType = StatusReport;
+        this->field = MachineState;
+        memset(this->status.state, '\0', STATUS_SNIFFER_STATE_SIZE);
+      } else if (nextChar == (char) pgm_read_byte(&StatusSniffer_GCodePrefix[0])) {
+        this->lineType = GCodePrefix;
+      } else if (nextChar == (char) pgm_read_byte(&StatusSniffer_AlarmPrefix[0])) {
+        this->lineType = AlarmPrefix;
+      } else {
+        this->lineType = Ignore;
+      }
+      break;
+    case GCodePrefix:
+      if (nextChar != (char) pgm_read_byte(&StatusSniffer_GCodePrefix[this->position])) {
+        this->lineType = Ignore;
+      } else if (++this->position == sizeof(StatusSniffer_GCodePrefix) - 1) {
+        this->lineType = ParserState;
+        this->word = '\0';
+      }
+      break;
+    case AlarmPrefix:
+      if (nextChar != (char) pgm_read_byte(&StatusSniffer_AlarmPrefix[this->position])) {
+        this->lineType = Ignore;
+      } else if (++this->position == sizeof(StatusSniffer_AlarmPrefix) - 1) {
+        this->lineType = Alarm;
+        this->field = Unknown;
+        beginValue();
+      }
+      break;
+    case StatusReport:
+      processStatusReport(nextChar);
+      break;
+    case ParserState:
+      processParserState(nextChar);
+      break;
+    case Alarm:
+      if (nextChar == '\r') {
+        storeValue();
+        this->lineType = Ignore;
+      } else {
+        addToValue(nextChar);
+      }
+      break;
+    case Ignore:
+      break;
+  }
+}
+
+const StatusSniffer::Status & StatusSniffer::getStatus() {
+  return this->status;
+}
+
+Coordinate StatusSniffer::getMachinePosition(uint8_t axis) {
+  return this->status.workPosition ? this->status.position[axis] + this->status.workOffset[axis]
+                                   : this->status.position[axis];
+}
+
+Coordinate StatusSniffer::getWorkPosition(uint8_t axis) {
+  return this->status.workPosition ? this->status.position[axis]
+                                   : this->status.position[axis] - this->status.workOffset[axis];
+}
+
+void StatusSniffer::processStatusReport(char nextChar) {
+  if ((nextChar == '|') || (nextChar == '>')) {
+    if (this->field != MachineState) {
+      storeValue();
+    }
+    if (nextChar == '>') {
+      this->status.reports++;
+      this->lineType = Ignore;
+      return;
+    }
+    this->field = Unknown;
+    this->fieldName[0] = '\0';
+    this->skipField = false;
+    this->position = 0;
+  } else if (this->field == MachineState) {
+    // the state may contain a colon followed by the substate
+    if (this->position < STATUS_SNIFFER_STATE_SIZE) {
+      this->status.state[this->position - 1] = nextChar;
+      this->position++;
+    }
+  } else if (this->field != Unknown) {
+    if (nextChar == ',') {
+      storeValue();
+      this->valueIndex++;
+      beginValue();
+    } else {
+      addToValue(nextChar);
+    }
+  } else if (this->skipField) {
+    // fields that are not evaluated are skipped up to the next '|'
+  } else if (nextChar == ':') {
+    selectField();
+    this->skipField = (this->field == Unknown);
+    this->valueIndex = 0;
+    beginValue();
+  } else if (this->position < sizeof(this->fieldName) - 1) {
+    this->fieldName[this->position] = nextChar;
+    this->fieldName[this->position + 1] = '\0';
+    this->position++;
+  }
+}
+
+void StatusSniffer::processParserState(char nextChar) {
+  if ((nextChar == ' ') || (nextChar == ']')) {
+    if (this->word != '\0') {
+      storeValue();
+    }
+    this->word = '\0';
+    if (nextChar == ']') {
+      this->lineType = Ignore;
+    }
+  } else if ((nextChar >= 'A') && (nextChar <= 'Z')) {
+    this->word = nextChar;
+    this->field = Word;
+    beginValue();
+  } else if (this->word != '\0') {
+    addToValue(nextChar);
+  }
+}
+
+void StatusSniffer::beginValue() {
+  this->value = 0;
+  this->decimals = 0;
+  this->negative = false;
+  this->fraction = false;
+}
+
+void StatusSniffer::addToValue(char nextChar) {
+  if (nextChar == '-') {
+    this->negative = true;
+  } else if (nextChar == '.') {
+    this->fraction = true;
+  } else if ((nextChar >= '0') && (nextChar <= '9')) {
+    // decimal places beyond the third one are dropped
+    if (!this->fraction) {
+      this->value = this->value * 10 + (nextChar - '0');
+    } else if (this->decimals < 3) {
+      this->value = this->value * 10 + (nextChar - '0');
+      this->decimals++;
+    }
+  }
+}
+
+Coordinate StatusSniffer::getValue() {
+  Coordinate result = this->value;
+  for (uint8_t i = this->decimals; i < 3; i++) {
+    result *= 10;
+  }
+  return this->negative ? -result : result;
+}
+
+void StatusSniffer::storeValue() {
+  Coordinate result = getValue();
+  switch(this->field) {
+    case MPos:
+    case WPos:
+      if (this->valueIndex < STATUS_SNIFFER_AXES) {
+        this->status.position[this->valueIndex] = result;
+        this->status.workPosition = (this->field == WPos);
+      }
+      break;
+    case WCO:
+      if (this->valueIndex < STATUS_SNIFFER_AXES) {
+        this->status.workOffset[this->valueIndex] = result;
+      }
+      break;
+    case FS:
+      if (this->valueIndex == 0) {
+        this->status.feedRate = result / 1000;
+      } else if (this->valueIndex == 1) {
+        this->status.spindleSpeed = result / 1000;
+      }
+      break;
+    case F:
+      this->status.feedRate = result / 1000;
+      break;
+    case Ov:
+      if (this->valueIndex < 3) {
+        this->status.overrides[this->valueIndex] = result / 1000;
+      }
+      break;
+    case Word:
+      // G54 to G59 select the work coordinate system, G20 and G21 the units
+      if ((this->word == 'G') && (result >= 54000) && (result <= 59000) && (result % 1000 == 0)) {
+        this->status.coordinateSystem = result / 1000 - 54;
+      } else if ((this->word == 'G') && ((result == 20000) || (result == 21000))) {
+        this->status.inches = (result == 20000);
+      }
+      break;
+    case Unknown:
+      if (this->lineType == Alarm) {
+        this->status.alarm = result / 1000;
+        strcpy_P(this->status.state, PSTR("Alarm"));
+      }
+      break;
+    case MachineState:
+      break;
+  }
+}
+
+void StatusSniffer::selectField() {
+  if (strcmp_P(this->fieldName, PSTR("MPos")) == 0) {
+    this->field = MPos;
+  } else if (strcmp_P(this->fieldName, PSTR("WPos")) == 0) {
+    this->field = WPos;
+  } else if (strcmp_P(this->fieldName, PSTR("WCO")) == 0) {
+    this->field = WCO;
+  } else if (strcmp_P(this->fieldName, PSTR("FS")) == 0) {
+    this->field = FS;
+  } else if (strcmp_P(this->fieldName, PSTR("F")) == 0) {
+    this->field = F;
+  } else if (strcmp_P(this->fieldName, PSTR("Ov")) == 0) {
+    this->field = Ov;
+  } else {
+    this->field = Unknown;
+  }
+}
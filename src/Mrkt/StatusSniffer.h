@@ -0,0 +1,164 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_StatusSniffer_h
+#define MRKT_StatusSniffer_h
+
+#include <inttypes.h>
+
+#include "Coordinates.h"
+
+/**
+ * The number of axes tracked.
+ */
+#define STATUS_SNIFFER_AXES        3
+
+/**
+ * The size of the buffer for the machine state (e.g. "Hold:0"), including the terminating \0.
+ */
+#define STATUS_SNIFFER_STATE_SIZE  9
+
+/**
+ * This class extracts the machine status from the output of the Grbl system while it passes
+ * by, without storing the lines: every character is processed as it is received and the
+ * values are accumulated in fixed point. The following lines are evaluated:
+ *
+ *   <Idle|MPos:1.000,2.000,0.000|FS:0,0|WCO:0.000,0.000,0.000|Ov:100,100,100>
+ *   [GC:G0 G54 G17 G21 G90 G94 M5 M9 T0 F0 S0]
+ *   ALARM:9
+ *
+ * Everything else is ignored. Positions are stored in µm, either as machine (MPos) or as work
+ * position (WPos) depending on the Grbl setting $10; the other one is derived using the work
+ * coordinate offset (WCO) that Grbl sends with every few status reports. Grbl reports in mm
+ * unless $13 is set - values reported in inches are not converted.
+ *
+ * The class does not depend on the Arduino libraries so that it can be used by the host tools.
+ */
+class StatusSniffer {
+
+  public:
+    /**
+     * The machine status collected from the lines received.
+     */
+    struct Status {
+      char state[STATUS_SNIFFER_STATE_SIZE];
+      Coordinate position[STATUS_SNIFFER_AXES];
+      bool workPosition;
+      Coordinate workOffset[STATUS_SNIFFER_AXES];
+      uint32_t feedRate;
+      uint32_t spindleSpeed;
+      uint8_t overrides[3];
+      uint8_t alarm;
+      uint8_t coordinateSystem;
+      bool inches;
+      uint16_t reports;
+    };
+
+    /**
+     * The default constructor.
+     */
+    StatusSniffer();
+
+    /**
+     * Discards the status collected.
+     */
+    void reset();
+
+    /**
+     * Processes a single character received from the Grbl system.
+     */
+    void process(char nextChar);
+
+    /**
+     * Provides access to the status collected.
+     */
+    const Status & getStatus();
+
+    /**
+     * Returns the machine or work position of an axis in µm.
+     */
+    Coordinate getMachinePosition(uint8_t axis);
+    Coordinate getWorkPosition(uint8_t axis);
+
+  private:
+    /**
+     * The type of the line being received. The prefixes are matched character by character.
+     */
+    enum LineType { LineStart, GCodePrefix, AlarmPrefix, StatusReport, ParserState, Alarm, Ignore };
+    LineType lineType;
+
+    /**
+     * The fields of the status reports (and the words of the parser state) that are evaluated.
+     */
+    enum Field { Unknown, MachineState, MPos, WPos, WCO, FS, F, Ov, Word };
+    Field field;
+
+    /**
+     * The number of characters of the current part of the line, the name of the current field 
+     * of a status report, whether the field is skipped and the letter of the current word of 
+     * the parser state.
+     */
+    uint8_t position;
+    char fieldName[5];
+    bool skipField;
+    char word;
+
+    /**
+     * The number being received: the index within the field, the digits, the number of
+     * decimal places and whether the number is negative or has a fractional part.
+     */
+    uint8_t valueIndex;
+    int32_t value;
+    uint8_t decimals;
+    bool negative;
+    bool fraction;
+
+    /**
+     * The status collected.
+     */
+    Status status;
+
+    /**
+     * The processing for the individual line types.
+     */
+    void processStatusReport(char nextChar);
+    void processParserState(char nextChar);
+
+    /**
+     * Starts to accumulate a number and adds a character to it.
+     */
+    void beginValue();
+    void addToValue(char nextChar);
+
+    /**
+     * Returns the number received in units of 1/1000.
+     */
+    Coordinate getValue();
+
+    /**
+     * Stores the number received in the status.
+     */
+    void storeValue();
+
+    /**
+     * Determines the field from its name.
+     */
+    void selectField();
+
+};
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "Arduino.h"
+
+#include "Configuration.h"
+#include "Storage.h"
+
+#if SDCARD_AVAILABLE == 1
+
+/**
+ * The "singleton" instance of the Storage class.
+ */
+Storage MrktStorage;
+
+Storage::Storage() {
+  this->available = false;
+}
+
+bool Storage::begin() {
+  if (!this->available) {
+    this->available = this->fileSystem.begin(SDCARD_CS, SPI_HALF_SPEED);
+  }
+  return this->available;
+}
+
+bool Storage::isAvailable() {
+  return this->available;
+}
+
+SdFat & Storage::getFileSystem() {
+  return this->fileSystem;
+}
+
+bool Storage::openBlockRing(const char * fileName, const char * magic, uint16_t version, 
+                            uint32_t dataBlocks, uint8_t * buffer, uint32_t & firstBlock, uint16_t & run) {
+  if (!begin()) {
+    return false;
+  }
+  SdFile file;
+  uint32_t size = (dataBlocks + 1) * STORAGE_BLOCK_SIZE;
+  uint32_t lastBlock;
+  // a file of a previous run is reused as long as it is still in one piece
+  if (!file.open(fileName, O_READ) || (file.fileSize() != size) ||
+      !file.contiguousRange(&firstBlock, &lastBlock)) {
+    file.close();
+    this->fileSystem.remove(fileName);
+    if (!file.createContiguous(fileName, size) ||
+        !file.contiguousRange(&firstBlock, &lastBlock)) {
+      file.close();
+      return false;
+    }
+  }
+  file.close();
+
+  BlockRingHeader * header = (BlockRingHeader *) buffer;
+  if (!this->fileSystem.card()->readBlock(firstBlock, buffer)) {
+    return false;
+  }
+  bool valid = (memcmp_P(header->magic, magic, STORAGE_RING_MAGIC_SIZE) == 0) && 
+               (header->version == version);
+  run = valid ? header->run + 1 : 1;
+  memset(buffer, 0, STORAGE_BLOCK_SIZE);
+  memcpy_P(header->magic, magic, STORAGE_RING_MAGIC_SIZE);
+  header->version = version;
+  header->run = run;
+  header->dataBlocks = dataBlocks;
+  return this->fileSystem.card()->writeBlock(firstBlock, buffer);
+}
+
+#endif // SDCARD_AVAILABLE
@@ -0,0 +1,105 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_Storage_h
+#define MRKT_Storage_h
+
+#include "Configuration.h"
+
+#if SDCARD_AVAILABLE == 1
+
+#include <SdFat.h> // see https://github.com/greiman/SdFat
+
+/**
+ * The size of the blocks of the SD card and of the magic string of a block ring.
+ */
+#define STORAGE_BLOCK_SIZE       512
+#define STORAGE_RING_MAGIC_SIZE  8
+
+/**
+ * This class provides access to the SD card. The card is initialized on demand, so 
+ * that a card can be inserted after the system has been switched on.
+ */
+class Storage {
+
+  public:
+    /**
+     * The default constructor.
+     */
+    Storage();
+
+    /**
+     * Initializes the SD card if this has not been done yet. Returns false if no 
+     * usable card was found.
+     */
+    bool begin();
+
+    /**
+     * Checks whether the SD card has been initialized successfully.
+     */
+    bool isAvailable();
+
+    /**
+     * Provides access to the file system of the SD card.
+     */
+    SdFat & getFileSystem();
+
+    /**
+     * The header in the first block of a block ring (see openBlockRing()). The file formats
+     * that are organized as block rings (see JobLogFile.h and TraceFile.h) start with the 
+     * same fields.
+     */
+    struct BlockRingHeader {
+      char     magic[STORAGE_RING_MAGIC_SIZE];
+      uint16_t version;
+      uint16_t run;
+      uint32_t dataBlocks;
+    } __attribute__((packed));
+
+    /**
+     * Opens a block ring: a file of a header block and a number of data blocks that is 
+     * allocated in one piece so that the blocks can be written to the card directly, without
+     * the buffer of the file system. The file is created if it does not exist or is no longer
+     * in one piece. The run number in the header is incremented, starting at 1 if the magic
+     * string (in PROGMEM) or the version do not match. The buffer of STORAGE_BLOCK_SIZE bytes 
+     * is used to update the header; its contents are undefined afterwards. Returns false if
+     * the file cannot be used.
+     */
+    bool openBlockRing(const char * fileName, const char * magic, uint16_t version, 
+                       uint32_t dataBlocks, uint8_t * buffer, uint32_t & firstBlock, uint16_t & run);
+
+  private:
+    /**
+     * The file system object provided by the SdFat library.
+     */
+    SdFat fileSystem;
+
+    /**
+     * Whether the card has been initialized successfully.
+     */
+    bool available;
+
+};
+
+/**
+ * Access to the "singleton" instance of the Storage class.
+ */
+extern Storage MrktStorage;
+
+#endif // SDCARD_AVAILABLE
+
+#endif
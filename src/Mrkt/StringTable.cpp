@@ -0,0 +1,175 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+
+// This file is generated by tools/mrktstr from Strings.txt - do not edit it.
+// 95 strings (825 bytes of text): 12 bytes of anchors, 138 bytes of dictionary, 514 bytes of data.
+
+#include <inttypes.h>
+#include "Arduino.h"
+
+#include "StringTable.h"
+
+const uint16_t StringTable_Anchors[] PROGMEM = {
+     0, // STRING_EMPTY
+    89, // STRING_FEED_HOLD
+   180, // STRING_EVENT_MODE_BUTTON
+   241, // STRING_DIAG_LAT_ABOVE
+   310, // STRING_PROBE_START
+   414  // STRING_READER_NO_FILE
+};
+
+const uint8_t StringTable_Words[] PROGMEM = {
+   'L',  'a',  't', 0xA0, // 0x80 "Lat "
+   'i', 0xEE, // 0x81 "in"
+   ' ', 0xED, // 0x82 " m"
+   ' ',  'f',  'i',  'l', 0xE5, // 0x83 " file"
+   'F',  'e',  'e', 0xE4, // 0x84 "Feed"
+   'G',  'r',  'b', 0xEC, // 0x85 "Grbl"
+   'B',  'y',  't',  'e', 0xF3, // 0x86 "Bytes"
+   'K',  'P', 0xA0, // 0x87 "KP "
+   'O',  'v',  'e',  'r',  'f',  'l',  'o', 0xF7, // 0x88 "Overflow"
+   ' ',  'B',  'u',  't',  't',  'o', 0xEE, // 0x89 " Button"
+   'P',  'r',  'o', 0xE2, // 0x8A "Prob"
+   'Q',  'u',  'e',  'r',  'i',  'e', 0xF3, // 0x8B "Queries"
+   'R',  'e',  'a', 0xE4, // 0x8C "Read"
+   'T',  'i',  'm', 0xE5, // 0x8D "Time"
+   'i',  'g',  'h', 0xF4, // 0x8E "ight"
+   'l', 0xE5, // 0x8F "le"
+   'r',  'r',  'o', 0xF2, // 0x90 "rror"
+   'B',  'e',  'n',  'c', 0xE8, // 0x91 "Bench"
+   'R',  'a',  'p',  'i', 0xE4, // 0x92 "Rapid"
+   'S',  'i',  'z',  'e', 0xA0, // 0x93 "Size "
+   ' ',  'E',  'r', 0xF2, // 0x94 " Err"
+   ' ', 0xF3, // 0x95 " s"
+   'L',  'e',  'f', 0xF4, // 0x96 "Left"
+   'S', 0xE5, // 0x97 "Se"
+   'a', 0xF2, // 0x98 "ar"
+   'e', 0xE4, // 0x99 "ed"
+   't',  'o',  'p', 0xF0, // 0x9A "topp"
+   'C',  'm', 0xE4, // 0x9B "Cmd"
+   'C',  'o', 0xED, // 0x9C "Com"
+   'N', 0xEF, // 0x9D "No"
+   'P', 0xEF, // 0x9E "Po"
+   'R',  'u', 0xEE, // 0x9F "Run"
+   'a', 0xE3, // 0xA0 "ac"
+   'a', 0xE9, // 0xA1 "ai"
+   'a', 0xEE, // 0xA2 "an"
+   'e', 0xA0, // 0xA3 "e "
+   'm',  'a', 0xF8, // 0xA4 "max"
+   'o', 0xEE, // 0xA5 "on"
+   'o', 0xF5, // 0xA6 "ou"
+   't', 0xF3  // 0xA7 "ts"
+};
+
+const uint8_t StringTable_Data[] PROGMEM = {
+  0, // ""
+  0x85, 0, // "Grbl"
+  0x85, ' ', 'e', 0x90, 0, // "Grbl error"
+  0x8D, 0xA6, 't', 0, // "Timeout"
+  0x88, 0, // "Overflow"
+  0x8C, 'y', 0, // "Ready"
+  0x9F, 0x83, 0, // "Run file"
+  'M', 0xA0, 'h', 0x81, 'e', 0, // "Machine"
+  'H', 'e', 0x8E, 0x82, 'a', 'p', 0, // "Height map"
+  'P', 'a', 's', 's', 't', 'h', 'r', 0xA6, 'g', 'h', 0, // "Passthrough"
+  0x97, 't', 't', 0x81, 'g', 's', 0, // "Settings"
+  'D', 'i', 'a', 'g', 'n', 'o', 's', 't', 'i', 'c', 's', 0, // "Diagnostics"
+  0x91, 'm', 0x98, 'k', 0, // "Benchmark"
+  'H', 'o', 'm', 'e', 0, // "Home"
+  'U', 'n', 'l', 'o', 'c', 'k', 0, // "Unlock"
+  'C', 'y', 'c', 0x8F, 0x95, 't', 0x98, 't', 0, // "Cycle start"
+  0x84, ' ', 'h', 'o', 'l', 'd', 0, // "Feed hold"
+  'S', 'o', 'f', 't', ' ', 'r', 'e', 's', 'e', 't', 0, // "Soft reset"
+  'B', 0xA0, 'k', 'l', 0x8E, 0, // "Backlight"
+  'T', 'e', 0x8F, 'm', 'e', 't', 'r', 'y', ' ', 'H', 'z', 0, // "Telemetry Hz"
+  'B', 'u', 's', 'y', 0, // "Busy"
+  'W', 0xA1, 't', 0x81, 'g', 0, // "Waiting"
+  'o', 'k', 0, // "ok"
+  'M', 'r', 'k', 't', ' ', 0, // "Mrkt "
+  0, // ""
+  0x87, 0x96, 0, // "KP Left"
+  0x87, 'R', 0x8E, 0, // "KP Right"
+  0x87, 'U', 'p', 0, // "KP Up"
+  0x87, 'D', 'o', 'w', 'n', 0, // "KP Down"
+  0x87, 0x97, 0x8F, 'c', 't', 0, // "KP Select"
+  'E', ' ', 'W', 'h', 'e', 'e', 'l', 0, // "E Wheel"
+  'E', 0x89, 0, // "E Button"
+  'M', 0x89, 0, // "M Button"
+  0x85, ' ', 0x9C, 0x94, 0, // "Grbl Com Err"
+  0x85, ' ', 0x9B, 0x94, 0, // "Grbl Cmd Err"
+  'E', 'R', 'R', 0, // "ERR"
+  'O', 'K', 0, // "OK"
+  0x97, 'n', 't', 0, // "Sent"
+  'O', 'K', 0, // "OK"
+  'E', 0x90, 0, // "Error"
+  0x8D, 0xA6, 't', 0, // "Timeout"
+  0x88, 0, // "Overflow"
+  0x86, ' ', 'T', 'x', 0, // "Bytes Tx"
+  0x86, ' ', 'R', 'x', 0, // "Bytes Rx"
+  0x80, 'm', 0x81, 0, // "Lat min"
+  0x80, 'a', 'v', 'g', 0, // "Lat avg"
+  0x80, 0xA4, 0, // "Lat max"
+  0x80, '<', 0, // "Lat <"
+  0x80, '>', '=', 0, // "Lat >="
+  0x91, 0, // "Bench"
+  0x8B, 0, // "Queries"
+  0x9F, 'n', 0x81, 'g', ' ', 0, // "Running "
+  0x9B, '/', 's', 0, // "Cmd/s"
+  0x86, '/', 's', 0, // "Bytes/s"
+  0x80, 'p', '5', '0', 0x82, 's', 0, // "Lat p50 ms"
+  0x80, 'p', '9', '0', 0x82, 's', 0, // "Lat p90 ms"
+  0x80, 'p', '9', '9', 0x82, 's', 0, // "Lat p99 ms"
+  0x80, 0xA4, 0x82, 's', 0, // "Lat max ms"
+  0x8B, 0, // "Queries"
+  'F', 0xA1, 0x8F, 'd', 0, // "Failed"
+  0x8D, 0x82, 's', 0, // "Time ms"
+  0x84, 0, // "Feed"
+  0x92, 0, // "Rapid"
+  'S', 'p', 0x81, 'd', 0x8F, 0, // "Spindle"
+  'S', 't', 0x98, 't', 0, // "Start"
+  0x93, 'X', 0x82, 'm', 0, // "Size X mm"
+  0x93, 'Y', 0x82, 'm', 0, // "Size Y mm"
+  0x9E, 0x81, 0xA7, ' ', 'X', 0, // "Points X"
+  0x9E, 0x81, 0xA7, ' ', 'Y', 0, // "Points Y"
+  'C', 0x8F, 0x98, 0xA2, 'c', 'e', 0x82, 'm', 0, // "Clearance mm"
+  'D', 'e', 'p', 't', 'h', 0x82, 'm', 0, // "Depth mm"
+  0x84, 0x82, 'm', '/', 'm', 0x81, 0, // "Feed mm/min"
+  0x9C, 'p', 'e', 'n', 's', 'a', 't', 'e', 0, // "Compensate"
+  0x8A, 0xA3, 0, // "Probe "
+  0x9E, 0x81, 0xA7, 0, // "Points"
+  'S', 0x9A, 0x81, 'g', 0, // "Stopping"
+  'M', 'a', 'p', 0x95, 'a', 'v', 0x99, 0, // "Map saved"
+  0x8A, 0x81, 'g', 0x95, 0x9A, 0x99, 0, // "Probing stopped"
+  0x8A, 0x81, 'g', ' ', 'f', 0xA1, 0x8F, 'd', 0, // "Probing failed"
+  0x9D, ' ', 'c', 0xA5, 't', 0xA0, 't', 0, // "No contact"
+  0x9D, 0x83, 0, // "No file"
+  0x9D, 0x83, 's', 0, // "No files"
+  'I', 'n', 'd', 'e', 'x', 0x81, 'g', 0x83, 's', 0, // "Indexing files"
+  'R', 'e', 's', 'u', 'm', 0xA3, 'a', 't', 0, // "Resume at"
+  0x97, 'l', ':', 'g', 'o', ' ', ' ', 0x96, ':', 'n', 'e', 'w', 0, // "Sel:go  Left:new"
+  'S', 'c', 0xA2, 0, // "Scan"
+  'L', 0x81, 'e', 0, // "Line"
+  'P', 'a', 'u', 's', 0x99, 0, // "Paused"
+  'D', 0xA5, 'e', 0, // "Done"
+  'L', 0x81, 0xA3, 't', 'o', 'o', ' ', 'l', 0xA5, 'g', 0, // "Line too long"
+  0x8C, ' ', 'e', 0x90, 0, // "Read error"
+  'N', 'e', 0x99, 's', 0x82, 0x81, 'i', 'f', 'i', 'e', 'r', 0, // "Needs minifier"
+  0x8C, 'y', ' ', 0x95, 'c', 0xA2, 0, // "Ready  scan"
+  0x84, 0x82, 'm', 0, // "Feed mm"
+  0x92, 0x82, 'm', 0, // "Rapid mm"
+};
@@ -0,0 +1,147 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+
+// This file is generated by tools/mrktstr from Strings.txt - do not edit it.
+
+#ifndef MRKT_StringTable_h
+#define MRKT_StringTable_h
+
+#include <inttypes.h>
+#include <avr/pgmspace.h>
+
+/**
+ * The strings (see Strings.txt and Display::writeString()).
+ */
+#define STRING_EMPTY                      0
+#define STRING_GRBL                       1
+#define STRING_GRBL_ERROR                 2
+#define STRING_TIMEOUT                    3
+#define STRING_OVERFLOW                   4
+#define STRING_READY                      5
+#define STRING_RUN_FILE                   6
+#define STRING_MACHINE                    7
+#define STRING_HEIGHT_MAP                 8
+#define STRING_PASSTHROUGH                9
+#define STRING_SETTINGS                  10
+#define STRING_DIAGNOSTICS               11
+#define STRING_BENCHMARK                 12
+#define STRING_HOME                      13
+#define STRING_UNLOCK                    14
+#define STRING_CYCLE_START               15
+#define STRING_FEED_HOLD                 16
+#define STRING_SOFT_RESET                17
+#define STRING_BACKLIGHT                 18
+#define STRING_TELEMETRY_RATE            19
+#define STRING_BUSY                      20
+#define STRING_WAITING                   21
+#define STRING_RESPONSE_OK               22
+#define STRING_MRKT                      23
+#define STRING_EVENT_NONE                24
+#define STRING_EVENT_KEY_LEFT            25
+#define STRING_EVENT_KEY_RIGHT           26
+#define STRING_EVENT_KEY_UP              27
+#define STRING_EVENT_KEY_DOWN            28
+#define STRING_EVENT_KEY_SELECT          29
+#define STRING_EVENT_ENC_CHANGED         30
+#define STRING_EVENT_ENC_BUTTON          31
+#define STRING_EVENT_MODE_BUTTON         32
+#define STRING_GRBL_COM_ERR              33
+#define STRING_GRBL_CMD_ERR              34
+#define STRING_VERSION_ERR               35
+#define STRING_VERSION_OK                36
+#define STRING_DIAG_SENT                 37
+#define STRING_DIAG_OK                   38
+#define STRING_DIAG_ERROR                39
+#define STRING_DIAG_TIMEOUT              40
+#define STRING_DIAG_OVERFLOW             41
+#define STRING_DIAG_BYTES_TX             42
+#define STRING_DIAG_BYTES_RX             43
+#define STRING_DIAG_LAT_MIN              44
+#define STRING_DIAG_LAT_AVG              45
+#define STRING_DIAG_LAT_MAX              46
+#define STRING_DIAG_LAT_BELOW            47
+#define STRING_DIAG_LAT_ABOVE            48
+#define STRING_BENCH                     49
+#define STRING_BENCH_QUERIES             50
+#define STRING_BENCH_RUNNING             51
+#define STRING_BENCH_CMD_RATE            52
+#define STRING_BENCH_BYTE_RATE           53
+#define STRING_BENCH_LAT_P50             54
+#define STRING_BENCH_LAT_P90             55
+#define STRING_BENCH_LAT_P99             56
+#define STRING_BENCH_LAT_MAX             57
+#define STRING_BENCH_RESULT_QUERIES      58
+#define STRING_BENCH_FAILED              59
+#define STRING_BENCH_TIME                60
+#define STRING_OVERRIDE_FEED             61
+#define STRING_OVERRIDE_RAPID            62
+#define STRING_OVERRIDE_SPINDLE          63
+#define STRING_PROBE_START               64
+#define STRING_PROBE_SIZE_X              65
+#define STRING_PROBE_SIZE_Y              66
+#define STRING_PROBE_POINTS_X            67
+#define STRING_PROBE_POINTS_Y            68
+#define STRING_PROBE_CLEARANCE           69
+#define STRING_PROBE_DEPTH               70
+#define STRING_PROBE_FEED                71
+#define STRING_PROBE_COMPENSATE          72
+#define STRING_PROBE                     73
+#define STRING_PROBE_POINTS              74
+#define STRING_PROBE_STOPPING            75
+#define STRING_PROBE_MAP_SAVED           76
+#define STRING_PROBE_STOPPED             77
+#define STRING_PROBE_FAILED              78
+#define STRING_PROBE_NO_CONTACT          79
+#define STRING_READER_NO_FILE            80
+#define STRING_READER_NO_FILES           81
+#define STRING_READER_INDEXING           82
+#define STRING_READER_RESUME_AT          83
+#define STRING_READER_RESUME_KEYS        84
+#define STRING_READER_SCAN               85
+#define STRING_READER_LINE               86
+#define STRING_READER_PAUSED             87
+#define STRING_READER_DONE               88
+#define STRING_READER_LINE_TOO_LONG      89
+#define STRING_READER_READ_ERROR         90
+#define STRING_READER_NEEDS_MINIFIER     91
+#define STRING_READER_READY_SCAN         92
+#define STRING_READER_FEED_MM            93
+#define STRING_READER_RAPID_MM           94
+#define STRING_COUNT                     95
+
+/**
+ * The first code that refers to a word of the dictionary. The texts consist of the
+ * characters below this code and words, and they are terminated with a \0. The words
+ * are stored one after the other, the last character of each word has the highest bit set.
+ */
+#define STRING_TABLE_FIRST_WORD 0x80
+
+/**
+ * The texts are stored one after the other - StringTable_Anchors holds the offset of
+ * every STRING_TABLE_ANCHOR_INTERVAL-th text within StringTable_Data.
+ */
+#define STRING_TABLE_ANCHOR_INTERVAL 16
+
+/**
+ * The anchors, the dictionary and the texts.
+ */
+extern const uint16_t StringTable_Anchors[] PROGMEM;
+extern const uint8_t StringTable_Words[] PROGMEM;
+extern const uint8_t StringTable_Data[] PROGMEM;
+
+#endif
@@ -0,0 +1,179 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <util/crc16.h>
+#include "Arduino.h"
+
+#include "Configuration.h"
+#include "Telemetry.h"
+
+#include "Communication.h"
+#include "HostChannel.h"
+#include "IdleSleep.h"
+#include "Uploader.h"
+
+/**
+ * The names of the machine states, in the order of the TELEMETRY_STATE_* codes.
+ */
+const char Telemetry_StateNames[TELEMETRY_STATE_SLEEP][6] PROGMEM = {
+  "Idle",
+  "Run",
+  "Hold",
+  "Jog",
+  "Alarm",
+  "Door",
+  "Check",
+  "Home",
+  "Sleep"
+};
+
+/**
+ * The "singleton" instance of the Telemetry class.
+ */
+Telemetry MrktTelemetry;
+
+Telemetry::Telemetry() {
+  this->rate = 0;
+  this->interval = 0;
+  this->sequence = 0;
+  this->loopStartTime = 0;
+  this->loopCount = 0;
+  this->loopTimeMax = 0;
+#if IDLE_SLEEP_ENABLED == 1
+  this->loopSleepTime = 0;
+#endif
+}
+
+void Telemetry::setRate(uint8_t rate) {
+  this->rate = min(rate, TELEMETRY_MAX_RATE);
+  if (rate == 0) {
+    this->interval = 0;
+    return;
+  }
+  this->interval = 1000 / min(rate, TELEMETRY_MAX_RATE);
+  this->lastFrameTime = millis() - this->interval;
+  this->lastStatusTime = millis() - TELEMETRY_STATUS_INTERVAL;
+  this->loopCount = 0;
+  this->loopTimeMax = 0;
+}
+
+uint8_t Telemetry::getRate() {
+  return this->rate;
+}
+
+void Telemetry::loop() {
+  uint32_t now = micros();
+  uint32_t loopTime = now - this->loopStartTime;
+  this->loopStartTime = now;
+#if IDLE_SLEEP_ENABLED == 1
+  // the time spent sleeping at the end of the previous iteration does not count
+  uint32_t sleepTime = MrktIdleSleep.getSleepTime();
+  loopTime -= sleepTime - this->loopSleepTime;
+  this->loopSleepTime = sleepTime;
+#endif
+  if (this->interval == 0) {
+    return;
+  }
+  if (this->loopCount > 0) {
+    // the first iteration after a frame includes the time it took to send the frame
+    this->loopTimeMax = max(this->loopTimeMax, (uint16_t) min(loopTime, 0xFFFF));
+  }
+  if (this->loopCount < 0xFFFF) {
+    this->loopCount++;
+  }
+
+  if (millis() - this->lastStatusTime >= TELEMETRY_STATUS_INTERVAL) {
+    MrktCommunication.requestStatusReport();
+    this->lastStatusTime = millis();
+  }
+  if (millis() - this->lastFrameTime < this->interval) {
+    return;
+  }
+#if SDCARD_AVAILABLE == 1
+  if (MrktUploader.isActive()) {
+    // the connection is used by the binary transfer
+    return;
+  }
+#endif
+  if (!MrktCommunication.canSendToHost()) {
+    // wait for the end of the line of the Grbl output
+    return;
+  }
+  // keep the rate even if a frame has been delayed, without sending a burst of frames
+  this->lastFrameTime += this->interval;
+  if (millis() - this->lastFrameTime >= this->interval) {
+    this->lastFrameTime = millis();
+  }
+  sendFrame();
+  this->loopCount = 0;
+  this->loopTimeMax = 0;
+}
+
+void Telemetry::sendFrame() {
+  StatusSniffer & sniffer = MrktCommunication.getSniffer();
+  const StatusSniffer::Status & status = sniffer.getStatus();
+  const Communication::Statistics & statistics = MrktCommunication.getStatistics();
+
+  TelemetryFrame frame;
+  frame.version = TELEMETRY_FRAME_VERSION;
+  frame.sequence = this->sequence++;
+  frame.time = millis();
+  frame.state = getStateCode(status.state);
+  frame.alarm = status.alarm;
+  for (uint8_t axis = 0; axis < 3; axis++) {
+    frame.position[axis] = sniffer.getMachinePosition(axis);
+    frame.workOffset[axis] = status.workOffset[axis];
+  }
+  frame.feedRate = min(status.feedRate, 0xFFFF);
+  frame.spindleSpeed = min(status.spindleSpeed, 0xFFFF);
+  memcpy(frame.overrides, status.overrides, 3);
+  frame.bufferBytes = MrktCommunication.getPendingBytes();
+  frame.bufferLines = MrktCommunication.getPendingLines();
+  frame.statusReports = status.reports;
+  frame.commandsSent = statistics.commandsSent;
+  frame.errorCount = statistics.errorCount;
+  frame.timeoutCount = statistics.timeoutCount;
+  frame.averageLatency = MrktCommunication.getAverageLatency();
+  frame.loopCount = this->loopCount;
+  frame.loopTimeMax = this->loopTimeMax;
+
+  uint16_t crc = 0;
+  const uint8_t * data = (const uint8_t *) &frame;
+  for (uint8_t i = 0; i < sizeof(TelemetryFrame); i++) {
+    crc = _crc_xmodem_update(crc, data[i]);
+  }
+  Serial.write(HOST_CHANNEL_ESCAPE);
+  Serial.write(TELEMETRY_FRAME_MARKER);
+  Serial.write(data, sizeof(TelemetryFrame));
+  Serial.write(crc & 0xFF);
+  Serial.write(crc >> 8);
+}
+
+uint8_t Telemetry::getStateCode(const char * state) {
+  // the state may be followed by a colon and the substate (e.g. "Hold:0")
+  for (uint8_t i = 0; i < TELEMETRY_STATE_SLEEP; i++) {
+    uint8_t length = strlen_P(Telemetry_StateNames[i]);
+    if ((strncmp_P(state, Telemetry_StateNames[i], length) == 0) && 
+        ((state[length] == '\0') || (state[length] == ':'))) {
+      return i + 1;
+    }
+  }
+  return TELEMETRY_STATE_UNKNOWN;
+}
@@ -0,0 +1,117 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_Telemetry_h
+#define MRKT_Telemetry_h
+
+#include "Configuration.h"
+#include "TelemetryFrame.h"
+
+/**
+ * The maximum number of frames per second.
+ */
+#define TELEMETRY_MAX_RATE         50
+
+/**
+ * The minimum time in ms between two status reports requested for the telemetry. The frames 
+ * may be sent more often, they contain the state of the latest report.
+ */
+#define TELEMETRY_STATUS_INTERVAL 100
+
+/**
+ * This class sends the machine state to the host system as binary frames (see 
+ * TelemetryFrame.h) at a fixed rate, which is set using the host command TELE. The 
+ * machine state is taken from the status sniffer of the communication system, and status
+ * reports are requested from the Grbl system as required - except in passthrough mode,
+ * where the sender program on the host system has to request them. A frame is smaller than
+ * a typical status report of the Grbl system, although it carries more information.
+ */
+class Telemetry {
+
+  public:
+    /**
+     * The default constructor.
+     */
+    Telemetry();
+
+    /**
+     * This method has to be called from the main loop.
+     */
+    void loop();
+
+    /**
+     * Sets the number of frames per second (up to TELEMETRY_MAX_RATE), 0 stops the telemetry. 
+     */
+    void setRate(uint8_t rate);
+
+    /**
+     * Returns the number of frames per second, 0 if the telemetry is stopped.
+     */
+    uint8_t getRate();
+
+    /**
+     * Determines the state code (TELEMETRY_STATE_*) from the name of the state.
+     */
+    static uint8_t getStateCode(const char * state);
+
+  private:
+    /**
+     * The number of frames per second as requested.
+     */
+    uint8_t rate;
+
+    /**
+     * The time in ms between two frames (0 if the telemetry is stopped) and the time the 
+     * last frame was due.
+     */
+    uint16_t interval;
+    uint32_t lastFrameTime;
+
+    /**
+     * The time the last status report was requested.
+     */
+    uint32_t lastStatusTime;
+
+    /**
+     * The sequence number of the next frame.
+     */
+    uint16_t sequence;
+
+    /**
+     * The loop timing: the start of the current iteration in µs, the number of iterations
+     * and the longest one since the last frame.
+     */
+    uint32_t loopStartTime;
+    uint16_t loopCount;
+    uint16_t loopTimeMax;
+#if IDLE_SLEEP_ENABLED == 1
+    uint32_t loopSleepTime;
+#endif
+
+    /**
+     * Assembles and sends a frame.
+     */
+    void sendFrame();
+
+};
+
+/**
+ * Access to the "singleton" instance of the Telemetry class.
+ */
+extern Telemetry MrktTelemetry;
+
+#endif
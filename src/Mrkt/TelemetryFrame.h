@@ -0,0 +1,92 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_TelemetryFrame_h
+#define MRKT_TelemetryFrame_h
+
+#include <inttypes.h>
+
+/**
+ * The definition of the binary telemetry frames sent to the host system (see Telemetry and 
+ * the decoder tools/mrkttel.cpp). This file does not depend on the Arduino libraries because 
+ * it is shared with the host tools. All values are stored little-endian.
+ *
+ * A frame consists of 
+ *
+ *   HOST_CHANNEL_ESCAPE (0xFE)   marks data sent by Mrkt itself (see HostChannel)
+ *   TELEMETRY_FRAME_MARKER       tells the frame from an escaped reply line
+ *   TelemetryFrame               the payload
+ *   uint16_t                     the CRC-16/XMODEM of the payload
+ *
+ * Frames are only sent between two lines of the Grbl output, so the host can split the data
+ * received at every escape character at the start of a line. The payload may contain any
+ * byte value, including line terminators and the escape character itself.
+ */
+
+/**
+ * The second byte of a frame and the current format version.
+ */
+#define TELEMETRY_FRAME_MARKER   0x01
+#define TELEMETRY_FRAME_VERSION  1
+
+/**
+ * The machine states reported by the Grbl system.
+ */
+#define TELEMETRY_STATE_UNKNOWN  0
+#define TELEMETRY_STATE_IDLE     1
+#define TELEMETRY_STATE_RUN      2
+#define TELEMETRY_STATE_HOLD     3
+#define TELEMETRY_STATE_JOG      4
+#define TELEMETRY_STATE_ALARM    5
+#define TELEMETRY_STATE_DOOR     6
+#define TELEMETRY_STATE_CHECK    7
+#define TELEMETRY_STATE_HOME     8
+#define TELEMETRY_STATE_SLEEP    9
+
+/**
+ * The payload of a frame. The sequence number is incremented with every frame, so the host
+ * can detect lost frames. Positions are machine positions in µm (or 1/1000 inch if Grbl 
+ * reports in inches), the feed rate is given in mm/min, the spindle speed in rpm and the 
+ * overrides (feed, rapid, spindle) in percent. The buffer fill is the number of bytes and
+ * lines streamed but not yet acknowledged by the Grbl system. The link statistics are the
+ * lower 16 bits of the counters of Communication::Statistics. The loop timing covers the
+ * main loop iterations since the previous frame: the number of iterations and the longest 
+ * one in µs, not counting the time spent sleeping (see IdleSleep).
+ */
+struct TelemetryFrame {
+  uint8_t  version;
+  uint16_t sequence;
+  uint32_t time;
+  uint8_t  state;
+  uint8_t  alarm;
+  int32_t  position[3];
+  int32_t  workOffset[3];
+  uint16_t feedRate;
+  uint16_t spindleSpeed;
+  uint8_t  overrides[3];
+  uint8_t  bufferBytes;
+  uint8_t  bufferLines;
+  uint16_t statusReports;
+  uint16_t commandsSent;
+  uint16_t errorCount;
+  uint16_t timeoutCount;
+  uint16_t averageLatency;
+  uint16_t loopCount;
+  uint16_t loopTimeMax;
+} __attribute__((packed));
+
+#endif
@@ -0,0 +1,175 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "Arduino.h"
+
+#include "Configuration.h"
+#include "Trace.h"
+
+#if (SDCARD_AVAILABLE == 1) && (TRACE_ENABLED == 1)
+
+#if (TRACE_MAGIC_SIZE != STORAGE_RING_MAGIC_SIZE) || (TRACE_BLOCK_SIZE != STORAGE_BLOCK_SIZE)
+#error "The header of the trace does not match the header of a block ring (see Storage.h)."
+#endif
+
+/**
+ * The "singleton" instance of the Trace class.
+ */
+Trace MrktTrace;
+
+Trace::Trace() {
+  this->opened = false;
+  this->active = false;
+  this->full = false;
+  this->dropped = 0;
+}
+
+void Trace::recordByte(uint8_t type, uint8_t data) {
+  uint32_t time = millis();
+  if (!this->full && (this->block.length > 0) && (time == this->lastTime) &&
+      (this->block.length < TRACE_DATA_SIZE)) {
+    // append the byte to the last record if it has the same type and time
+    uint8_t tag = this->block.data[this->lastRecord];
+    if (((tag >> TRACE_TYPE_SHIFT) == type) && ((tag & TRACE_LENGTH_MASK) < TRACE_LENGTH_MASK)) {
+      this->block.data[this->lastRecord] = tag + 1;
+      this->block.data[this->block.length++] = data;
+      return;
+    }
+  }
+  uint8_t * payload = addRecord(type, 1, time);
+  if (payload != 0) {
+    payload[0] = data;
+  }
+}
+
+void Trace::recordBytes(uint8_t type, const uint8_t * data, uint16_t length) {
+  for (uint16_t i = 0; i < length; i++) {
+    recordByte(type, data[i]);
+  }
+}
+
+void Trace::recordEvent(uint8_t eventType, int8_t data) {
+  uint8_t * payload = addRecord(TRACE_EVENT, 2, millis());
+  if (payload != 0) {
+    payload[0] = eventType;
+    payload[1] = data;
+  }
+}
+
+void Trace::recordCombination(uint8_t eventType) {
+  uint8_t * payload = addRecord(TRACE_COMBINATION, 1, millis());
+  if (payload != 0) {
+    payload[0] = eventType;
+  }
+}
+
+void Trace::loop() {
+  if (!this->opened) {
+    // nothing has been recorded before the first main loop iteration, so the buffer is free
+    this->opened = true;
+    this->active = open();
+    return;
+  }
+  if (!this->active || (this->block.length == 0)) {
+    return;
+  }
+  if (this->full || (millis() - this->lastWriteTime > TRACE_FLUSH_INTERVAL)) {
+    writeBlock();
+  }
+}
+
+bool Trace::isFull() {
+  return this->active && this->full;
+}
+
+bool Trace::open() {
+  // the block buffer is not in use yet - it holds the header while the run number is updated
+  if (!MrktStorage.openBlockRing(TRACE_FILE_NAME, PSTR(TRACE_MAGIC), TRACE_VERSION,
+                                 TRACE_DATA_BLOCKS, (uint8_t *) &this->block,
+                                 this->firstBlock, this->run)) {
+    return false;
+  }
+  memset(&this->block, 0, sizeof(TraceBlock));
+  this->block.run = this->run;
+  this->full = false;
+  this->dropped = 0;
+  this->lastWriteTime = millis();
+  return true;
+}
+
+uint8_t * Trace::addRecord(uint8_t type, uint8_t length, uint32_t time) {
+  if (!this->active) {
+    return 0;
+  }
+  if (this->block.length == 0) {
+    this->block.time = time;
+    this->lastTime = time;
+  }
+  uint32_t delta = time - this->lastTime;
+  uint16_t size = 2 + length;
+  if (delta > TRACE_MAX_DELTA) {
+    // a time record with the absolute time has to precede the record
+    size += 2 + sizeof(uint32_t);
+  }
+  if (this->full || (this->block.length + size > TRACE_DATA_SIZE)) {
+    // the block has not been written yet
+    this->full = true;
+    if (this->dropped < 0xFFFF) {
+      this->dropped++;
+    }
+    return 0;
+  }
+  uint8_t * data = this->block.data;
+  if (delta > TRACE_MAX_DELTA) {
+    data[this->block.length++] = (TRACE_TIME << TRACE_TYPE_SHIFT) | (sizeof(uint32_t) - 1);
+    data[this->block.length++] = 0;
+    memcpy(&data[this->block.length], &time, sizeof(uint32_t));
+    this->block.length += sizeof(uint32_t);
+    delta = 0;
+  }
+  this->lastRecord = this->block.length;
+  this->lastTime = time;
+  data[this->block.length++] = (type << TRACE_TYPE_SHIFT) | (length - 1);
+  data[this->block.length++] = delta;
+  uint8_t * payload = &data[this->block.length];
+  this->block.length += length;
+  return payload;
+}
+
+void Trace::writeBlock() {
+  uint32_t position = this->firstBlock + 1 + this->block.number % TRACE_DATA_BLOCKS;
+  if (!MrktStorage.getFileSystem().card()->writeBlock(position, (const uint8_t *) &this->block)) {
+    // the card has probably been removed - the trace ends here
+    this->active = false;
+    return;
+  }
+  this->lastWriteTime = millis();
+  if (this->full) {
+    // a partially filled block is written again when it has been filled up
+    this->block.number++;
+    this->block.length = 0;
+    this->block.dropped = this->dropped;
+    this->dropped = 0;
+    this->full = false;
+    memset(this->block.data, 0, TRACE_DATA_SIZE);
+  }
+}
+
+#endif // SDCARD_AVAILABLE && TRACE_ENABLED
@@ -0,0 +1,156 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_Trace_h
+#define MRKT_Trace_h
+
+#include "Configuration.h"
+
+#if (SDCARD_AVAILABLE == 1) && (TRACE_ENABLED == 1)
+
+#if JOB_LOG_ENABLED == 1
+#error "The trace and the job log each require a block buffer - enable only one of them."
+#endif
+
+#include "TraceFile.h"
+#include "Storage.h"
+
+/**
+ * The number of data blocks of the trace file (the file is one block larger).
+ */
+#define TRACE_DATA_BLOCKS      4095
+
+/**
+ * The time in ms after which a block that is only partially filled is written.
+ */
+#define TRACE_FLUSH_INTERVAL   5000
+
+/**
+ * This class records the bytes exchanged with the host and the Grbl system and the user
+ * control events taken by the modes in a file on the SD card (see TraceFile.h), so that
+ * a session can be examined and replayed later on with the host tools mrkttrace and
+ * mrktreplay (see tools/mrkttrace.cpp and tools/mrktreplay.cpp).
+ *
+ * The trace is written like the job log (see JobLog): the records are collected in a
+ * buffer that holds a complete block, and the block is written directly to the contiguous
+ * file by loop() once it is full. Bytes that are transferred while the buffer is full are
+ * dropped and counted. Writing a block takes a few ms, which is short enough for the
+ * receive buffers of both serial ports at the default speed, but the timing of the session
+ * is not entirely unaffected by the trace.
+ *
+ * The recording methods are called through the TRACE_RECORD_* macros below, which are empty
+ * unless TRACE_ENABLED is set.
+ */
+class Trace {
+
+  public:
+    /**
+     * The default constructor.
+     */
+    Trace();
+
+    /**
+     * Records bytes transferred in the direction given (TRACE_HOST_RX to TRACE_GRBL_TX).
+     */
+    void recordByte(uint8_t type, uint8_t data);
+    void recordBytes(uint8_t type, const uint8_t * data, uint16_t length);
+
+    /**
+     * Records a user control event or a key combination (see UserControls).
+     */
+    void recordEvent(uint8_t eventType, int8_t data);
+    void recordCombination(uint8_t eventType);
+
+    /**
+     * Opens the trace file when called for the first time, writes the buffer if it is full
+     * or the flush interval has elapsed. This method has to be called at the start of the
+     * main loop iteration.
+     */
+    void loop();
+
+    /**
+     * Checks whether the buffer is full, so that it has to be written without waiting for
+     * the next interrupt (see IdleSleep).
+     */
+    bool isFull();
+
+  private:
+    /**
+     * Whether an attempt to open the trace file has been made, whether the file is in use,
+     * the first block of the file on the card and the run number.
+     */
+    bool opened;
+    bool active;
+    uint32_t firstBlock;
+    uint16_t run;
+
+    /**
+     * The block being filled, whether it is full, the position of the tag of its last record
+     * and the time the last record refers to.
+     */
+    TraceBlock block;
+    bool full;
+    uint16_t lastRecord;
+    uint32_t lastTime;
+
+    /**
+     * The time the block was last written.
+     */
+    uint32_t lastWriteTime;
+
+    /**
+     * The number of bytes dropped since the buffer has been filled up.
+     */
+    uint16_t dropped;
+
+    /**
+     * Opens or allocates the trace file and starts a new run.
+     */
+    bool open();
+
+    /**
+     * Returns the payload of a new record in the buffer, or 0 if the buffer is full.
+     */
+    uint8_t * addRecord(uint8_t type, uint8_t length, uint32_t time);
+
+    /**
+     * Writes the buffer to the card and starts the next block if it was full.
+     */
+    void writeBlock();
+
+};
+
+/**
+ * Access to the "singleton" instance of the Trace class.
+ */
+extern Trace MrktTrace;
+
+#define TRACE_RECORD_BYTE(type, data)           MrktTrace.recordByte(type, data)
+#define TRACE_RECORD_BYTES(type, data, length)  MrktTrace.recordBytes(type, (const uint8_t *) (data), length)
+#define TRACE_RECORD_EVENT(eventType, data)     MrktTrace.recordEvent(eventType, data)
+#define TRACE_RECORD_COMBINATION(eventType)     MrktTrace.recordCombination(eventType)
+
+#else
+
+#define TRACE_RECORD_BYTE(type, data)
+#define TRACE_RECORD_BYTES(type, data, length)
+#define TRACE_RECORD_EVENT(eventType, data)
+#define TRACE_RECORD_COMBINATION(eventType)
+
+#endif // SDCARD_AVAILABLE && TRACE_ENABLED
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_TraceFile_h
+#define MRKT_TraceFile_h
+
+#include <inttypes.h>
+
+/**
+ * The definition of the trace file written to the SD card (see Trace) and evaluated and
+ * replayed by the host tools mrkttrace and mrktreplay (see tools/TraceReader.h). This file
+ * does not depend on the Arduino libraries because it is shared with the host tools. All
+ * values are stored little-endian.
+ *
+ * The file is organized like the job log (see JobLogFile.h): it is allocated in one piece
+ * and consists of blocks of TRACE_BLOCK_SIZE bytes, matching the sectors of the SD card:
+ *
+ *   block 0         the header (TraceHeader), padded with zeros
+ *   blocks 1 to n   a ring of data blocks (TraceBlock)
+ *
+ * The data blocks are numbered consecutively; block number b is stored in block 1 + (b % n)
+ * of the file. Every power-up of Mrkt starts a new run.
+ *
+ * The data of a block is a sequence of records. Each record consists of
+ *
+ *   tag       the record type (bits 7 to 5) and the length of the payload minus one
+ *             (bits 4 to 0), so a record carries 1 to TRACE_MAX_PAYLOAD bytes
+ *   delta     the time in ms since the previous record of the block (or since the time
+ *             of the block for the first record)
+ *   payload   the bytes transferred, or the data of the event
+ *
+ * Bytes transferred in the same direction within the same ms are collected in one record.
+ * A delay of more than 255 ms is bridged by a TRACE_TIME record.
+ */
+
+/**
+ * The identification at the start of the trace file, including the \0 character, and the
+ * current format version.
+ */
+#define TRACE_MAGIC              "MRKTTRC"
+#define TRACE_MAGIC_SIZE         8
+#define TRACE_VERSION            1
+
+/**
+ * The name of the trace file on the SD card.
+ */
+#define TRACE_FILE_NAME          "MRKTTRC.DAT"
+
+/**
+ * The size of the blocks and of the data area of a data block.
+ */
+#define TRACE_BLOCK_SIZE         512
+#define TRACE_DATA_SIZE          (TRACE_BLOCK_SIZE - 14)
+
+/**
+ * The record types:
+ *   TRACE_HOST_RX      bytes received from the host
+ *   TRACE_HOST_TX      bytes sent to the host (except for the telemetry frames and the
+ *                      replies of the uploader)
+ *   TRACE_GRBL_RX      bytes received from the Grbl system
+ *   TRACE_GRBL_TX      bytes sent to the Grbl system
+ *   TRACE_EVENT        a user control event taken by the current mode: the event type
+ *                      (see UserControls::EventType) and the data
+ *   TRACE_COMBINATION  a key combination taken by the mode controller: the event type
+ *   TRACE_TIME         the time in ms since the power-up (four bytes)
+ */
+#define TRACE_HOST_RX            0
+#define TRACE_HOST_TX            1
+#define TRACE_GRBL_RX            2
+#define TRACE_GRBL_TX            3
+#define TRACE_EVENT              4
+#define TRACE_COMBINATION        5
+#define TRACE_TIME               7
+
+/**
+ * The layout of the tag of a record.
+ */
+#define TRACE_TYPE_SHIFT         5
+#define TRACE_LENGTH_MASK        0x1F
+#define TRACE_MAX_PAYLOAD        (TRACE_LENGTH_MASK + 1)
+#define TRACE_MAX_DELTA          0xFF
+
+/**
+ * The header in block 0. The run number is incremented with every run.
+ */
+struct TraceHeader {
+  char     magic[TRACE_MAGIC_SIZE];
+  uint16_t version;
+  uint16_t run;
+  uint32_t dataBlocks;
+} __attribute__((packed));
+
+/**
+ * A data block. The time is given in ms since the power-up; it is the time the first
+ * record refers to. The number of bytes dropped is the number of bytes (and events) that
+ * could not be recorded before this block because the previous block had not been written
+ * yet.
+ */
+struct TraceBlock {
+  uint16_t run;
+  uint16_t length;
+  uint32_t number;
+  uint32_t time;
+  uint16_t dropped;
+  uint8_t  data[TRACE_DATA_SIZE];
+} __attribute__((packed));
+
+#endif
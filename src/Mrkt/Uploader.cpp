@@ -0,0 +1,231 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <util/crc16.h>
+#include "Arduino.h"
+
+#include "Configuration.h"
+#include "Uploader.h"
+#include "Trace.h"
+#include "Workspace.h"
+
+#if SDCARD_AVAILABLE == 1
+
+/**
+ * The "singleton" instance of the Uploader class.
+ */
+Uploader MrktUploader;
+
+Uploader::Uploader() {
+  this->state = Idle;
+  this->file = NULL;
+}
+
+bool Uploader::start(SdFile & file, const char * fileName, uint32_t size, bool resume) {
+  if ((this->state != Idle) || !MrktStorage.begin() ||
+      !file.open(fileName, resume ? (O_RDWR | O_CREAT) : (O_RDWR | O_CREAT | O_TRUNC))) {
+    return false;
+  }
+  this->file = &file;
+  this->size = size;
+  this->blockCount = (size + UPLOADER_BLOCK_SIZE - 1) / UPLOADER_BLOCK_SIZE;
+  // only complete blocks are kept - the remainder of the file is sent again
+  this->nextBlock = this->file->fileSize() / UPLOADER_BLOCK_SIZE;
+  if (this->nextBlock > this->blockCount) {
+    this->nextBlock = 0;
+  }
+  if (!this->file->seekSet((uint32_t) this->nextBlock * UPLOADER_BLOCK_SIZE)) {
+    this->file->close();
+    return false;
+  }
+  this->nakSent = false;
+  this->lastReceiveTime = millis();
+
+  Serial.print(F("[PUT:"));
+  Serial.print(this->nextBlock);
+  Serial.println(']');
+  this->state = WaitFrame;
+  if (this->nextBlock == this->blockCount) {
+    finish();
+  }
+  return true;
+}
+
+bool Uploader::isActive() {
+  return (this->state != Idle);
+}
+
+void Uploader::loop() {
+  while ((this->state != Idle) && Serial.available()) {
+    uint8_t nextChar = Serial.read();
+    TRACE_RECORD_BYTE(TRACE_HOST_RX, nextChar);
+    receive(nextChar);
+    this->lastReceiveTime = millis();
+  }
+  if (this->state == Idle) {
+    return;
+  }
+  uint32_t idleTime = millis() - this->lastReceiveTime;
+  if (idleTime > UPLOADER_IDLE_TIMEOUT) {
+    cancel(F("Upload timeout"));
+  } else if ((this->state != WaitFrame) && (idleTime > UPLOADER_FRAME_TIMEOUT)) {
+    // the rest of the frame has been lost - request it again
+    this->file->seekSet((uint32_t) this->nextBlock * UPLOADER_BLOCK_SIZE);
+    reply(UPLOADER_NAK);
+    this->nakSent = true;
+    this->state = WaitFrame;
+  }
+}
+
+void Uploader::receive(uint8_t data) {
+  switch(this->state) {
+    case Idle:
+      break;
+    case WaitFrame:
+      // anything between the frames (e.g. the line terminator of the command) is ignored
+      if (data == UPLOADER_STX) {
+        this->position = 0;
+        this->frameBlock = 0;
+        this->crc = 0;
+        this->state = BlockNumber;
+      } else if (data == UPLOADER_CAN) {
+        cancel(F("Upload cancelled"));
+      }
+      break;
+    case BlockNumber:
+      this->crc = _crc_xmodem_update(this->crc, data);
+      this->frameBlock |= (uint16_t) data << (8 * this->position);
+      this->position++;
+      if (this->position == 2) {
+        if (this->frameBlock >= this->blockCount) {
+          // not a valid frame - wait for the next one
+          this->state = WaitFrame;
+          break;
+        }
+        this->length = (this->frameBlock == this->blockCount - 1) ?
+                       this->size - (uint32_t) this->frameBlock * UPLOADER_BLOCK_SIZE : UPLOADER_BLOCK_SIZE;
+        this->discard = (this->frameBlock != this->nextBlock);
+        this->position = 0;
+        this->chunkLength = 0;
+        this->state = Payload;
+      }
+      break;
+    case Payload:
+      this->crc = _crc_xmodem_update(this->crc, data);
+      if (!this->discard) {
+        MrktWorkspace.chunk[this->chunkLength++] = data;
+        if ((this->chunkLength == UPLOADER_CHUNK_SIZE) && !flushChunk()) {
+          break;
+        }
+      }
+      this->position++;
+      if (this->position == this->length) {
+        this->position = 0;
+        this->receivedCrc = 0;
+        this->state = Checksum;
+      }
+      break;
+    case Checksum:
+      this->receivedCrc |= (uint16_t) data << (8 * this->position);
+      this->position++;
+      if (this->position == 2) {
+        this->state = WaitFrame;
+        finishFrame();
+      }
+      break;
+  }
+}
+
+void Uploader::finishFrame() {
+  bool valid = (this->crc == this->receivedCrc);
+  if (this->discard) {
+    if (valid && (this->frameBlock < this->nextBlock)) {
+      // the acknowledgement has been lost - repeat it
+      reply(UPLOADER_ACK);
+    } else if (valid && !this->nakSent) {
+      // a block has been lost - the host has to go back
+      reply(UPLOADER_NAK);
+      this->nakSent = true;
+    }
+    return;
+  }
+  if (!valid || !flushChunk()) {
+    if (this->state == Idle) {
+      return;
+    }
+    // the block will be sent again and overwrite the data written
+    this->file->seekSet((uint32_t) this->nextBlock * UPLOADER_BLOCK_SIZE);
+    if (!this->nakSent) {
+      reply(UPLOADER_NAK);
+      this->nakSent = true;
+    }
+    return;
+  }
+  this->nextBlock++;
+  this->nakSent = false;
+  if (this->nextBlock == this->blockCount) {
+    reply(UPLOADER_ACK);
+    finish();
+    return;
+  }
+  if ((this->nextBlock % UPLOADER_SYNC_INTERVAL) == 0) {
+    this->file->sync();
+  }
+  reply(UPLOADER_ACK);
+}
+
+bool Uploader::flushChunk() {
+  if (this->chunkLength == 0) {
+    return true;
+  }
+  if (this->file->write(MrktWorkspace.chunk, this->chunkLength) != this->chunkLength) {
+    cancel(F("Write error"));
+    return false;
+  }
+  this->chunkLength = 0;
+  return true;
+}
+
+void Uploader::reply(uint8_t code) {
+  Serial.write(code);
+  Serial.write(this->nextBlock & 0xFF);
+  Serial.write(this->nextBlock >> 8);
+}
+
+void Uploader::finish() {
+  // a file that has been resumed might have been longer before
+  if (!this->file->truncate(this->size) || !this->file->close()) {
+    cancel(F("Write error"));
+    return;
+  }
+  this->state = Idle;
+  Serial.println(F("ok"));
+}
+
+void Uploader::cancel(const __FlashStringHelper * message) {
+  // keep the verified blocks so that the upload can be resumed
+  this->file->truncate((uint32_t) this->nextBlock * UPLOADER_BLOCK_SIZE);
+  this->file->close();
+  this->state = Idle;
+  Serial.print(F("error:"));
+  Serial.println(message);
+}
+
+#endif // SDCARD_AVAILABLE
@@ -0,0 +1,185 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_Uploader_h
+#define MRKT_Uploader_h
+
+#include "Configuration.h"
+
+#if SDCARD_AVAILABLE == 1
+
+#include "Storage.h"
+
+/**
+ * The size of the payload of a block. Blocks are aligned to the sectors of the SD card.
+ */
+#define UPLOADER_BLOCK_SIZE      512
+
+/**
+ * The number of bytes collected before they are passed to the file system.
+ */
+#define UPLOADER_CHUNK_SIZE       32
+
+/**
+ * The number of blocks after which the file is synchronized, so that the size stored in
+ * the directory always covers verified blocks only.
+ */
+#define UPLOADER_SYNC_INTERVAL     8
+
+/**
+ * The time in ms after which an incomplete block is discarded, and the time in ms after
+ * which the upload is cancelled if nothing is received.
+ */
+#define UPLOADER_FRAME_TIMEOUT  1000
+#define UPLOADER_IDLE_TIMEOUT  30000
+
+/**
+ * The control characters of the upload protocol.
+ */
+#define UPLOADER_STX            0x02
+#define UPLOADER_ACK            0x06
+#define UPLOADER_NAK            0x15
+#define UPLOADER_CAN            0x18
+
+/**
+ * This class receives a file from the host system and writes it to the SD card (host
+ * command PUT). The file is transferred in blocks of UPLOADER_BLOCK_SIZE bytes (the last one
+ * being shorter), each framed as
+ *
+ *   STX <block number, 2 bytes LE> <payload> <CRC, 2 bytes LE>
+ *
+ * with the CRC-16/XMODEM calculated over the block number and the payload. The host may send
+ * several blocks without waiting for the acknowledgement (sliding window). Every block received
+ * correctly is acknowledged by ACK <next block number, 2 bytes LE>; if a block is damaged or
+ * missing, NAK <next block number, 2 bytes LE> requests the host to go back to that block. Blocks
+ * that do not match the next block number are discarded. CAN instead of STX cancels the upload.
+ *
+ * The payload is written to the file as it arrives, without storing the block in RAM - a
+ * damaged block is simply overwritten when it is sent again. Since the file is synchronized
+ * only after verified blocks, an interrupted upload can be resumed at the block following
+ * the size of the file on the card. When the last block has been received, the file is
+ * closed and "ok" is sent to the host; if the upload fails, "error:<message>" is sent instead.
+ *
+ * See tools/mrktup.cpp for the matching uploader.
+ */
+class Uploader {
+
+  public:
+    /**
+     * The default constructor.
+     */
+    Uploader();
+
+    /**
+     * Opens the file in the SdFile given and starts to receive it. Unless resume is set, an 
+     * existing file is overwritten. The number of the first block expected is reported to 
+     * the host as [PUT:<block>]. The SdFile is used until the upload is complete (see 
+     * isActive()). Returns false if the file cannot be opened.
+     */
+    bool start(SdFile & file, const char * fileName, uint32_t size, bool resume);
+
+    /**
+     * Checks whether an upload is in progress. All data received from the host system
+     * belongs to the upload in this case.
+     */
+    bool isActive();
+
+    /**
+     * Processes the data received from the host system.
+     */
+    void loop();
+
+  private:
+    /**
+     * The enumeration to represent the internal state of the receiver.
+     */
+    enum InternalState { Idle, WaitFrame, BlockNumber, Payload, Checksum };
+    InternalState state;
+
+    /**
+     * The file being received (see start()), its size and the number of blocks.
+     */
+    SdFile * file;
+    uint32_t size;
+    uint16_t blockCount;
+
+    /**
+     * The number of the next block expected and whether it has already been requested
+     * again (to send only one NAK per error).
+     */
+    uint16_t nextBlock;
+    bool nakSent;
+
+    /**
+     * The frame being received: the block number, the number of bytes received in the
+     * current part, the length of the payload, the CRC calculated and the CRC received,
+     * and whether the payload is to be discarded.
+     */
+    uint16_t frameBlock;
+    uint16_t position;
+    uint16_t length;
+    uint16_t crc;
+    uint16_t receivedCrc;
+    bool discard;
+
+    /**
+     * The number of bytes of the payload not yet passed to the file system, which are 
+     * collected in the shared Workspace.
+     */
+    uint8_t chunkLength;
+
+    /**
+     * The time the last byte was received.
+     */
+    uint32_t lastReceiveTime;
+
+    /**
+     * Processes a single byte received.
+     */
+    void receive(uint8_t data);
+
+    /**
+     * Evaluates a complete frame.
+     */
+    void finishFrame();
+
+    /**
+     * Passes the collected payload bytes to the file system.
+     */
+    bool flushChunk();
+
+    /**
+     * Sends a response (ACK or NAK) with the next block number.
+     */
+    void reply(uint8_t code);
+
+    /**
+     * Completes the upload, or cancels it with the error message given.
+     */
+    void finish();
+    void cancel(const __FlashStringHelper * message);
+
+};
+
+/**
+ * Access to the "singleton" instance of the Uploader class.
+ */
+extern Uploader MrktUploader;
+
+#endif // SDCARD_AVAILABLE
+
+#endif
@@ -22,6 +22,7 @@
 
 #include "Configuration.h"
 #include "UserControls.h"
+#include "Trace.h"
 
 /**
  * The bit mask values used for the button state processing.
@@ -52,7 +53,26 @@ UserControls::UserControls() {
 }
 
 void UserControls::loop() {
+  // the buttons are polled at a fixed interval
+  if ((uint8_t) ((uint8_t) millis() - this->lastPollTime) >= USER_CONTROLS_POLL_INTERVAL) {
+    this->lastPollTime = millis();
+    pollButtons();
+  }
 
+  // check the encoder wheel
+  int32_t currentEncoderPosition = this->encoder->read() / RE_STEP_SIZE;
+  if (currentEncoderPosition != this->prevEncoderPosition) {
+#if RE_INVERT_DIRECTION == 1
+    int8_t encoderData = - (currentEncoderPosition - this->prevEncoderPosition);
+#else
+    int8_t encoderData =   (currentEncoderPosition - this->prevEncoderPosition);
+#endif
+    queueEvent(UserControls::EncChanged, encoderData);
+    this->prevEncoderPosition = currentEncoderPosition; 
+  }
+}
+
+void UserControls::pollButtons() {
   // this variable will contain a bit mask of the buttons that are currently pressed
   uint8_t currentButtonState = 0;
 
@@ -86,40 +106,34 @@ void UserControls::loop() {
     // were pressed during the previous pass
     uint8_t pressedButtons = currentButtonState & ~this->prevButtonState;
     if ((pressedButtons & USER_CONTROLS_BUTTON_UP) > 0) {
-      queueEvent(UserControls::KeyUp, 1);
+      queueKeypadEvent(UserControls::KeyUp, currentButtonState);
     } 
     if ((pressedButtons & USER_CONTROLS_BUTTON_DOWN) > 0) {
-      queueEvent(UserControls::KeyDown, 1);
+      queueKeypadEvent(UserControls::KeyDown, currentButtonState);
     } 
     if ((pressedButtons & USER_CONTROLS_BUTTON_LEFT) > 0) {
-      queueEvent(UserControls::KeyLeft, 1);
+      queueKeypadEvent(UserControls::KeyLeft, currentButtonState);
     } 
     if ((pressedButtons & USER_CONTROLS_BUTTON_RIGHT) > 0) {
-      queueEvent(UserControls::KeyRight, 1);
+      queueKeypadEvent(UserControls::KeyRight, currentButtonState);
     } 
     if ((pressedButtons & USER_CONTROLS_BUTTON_SELECT) > 0) {
-      queueEvent(UserControls::KeySelect, 1);
+      queueKeypadEvent(UserControls::KeySelect, currentButtonState);
     } 
     if ((pressedButtons & USER_CONTROLS_BUTTON_ENCODER) > 0) {
       queueEvent(UserControls::EncButton, 1);
     } 
     if ((pressedButtons & USER_CONTROLS_BUTTON_MODE) > 0) {
-      queueEvent(UserControls::ModeButton, 1);
+      this->combinationEntered = false;
     } 
 
+    // the mode button triggers on release because it might start a key combination
+    uint8_t releasedButtons = this->prevButtonState & ~currentButtonState;
+    if (((releasedButtons & USER_CONTROLS_BUTTON_MODE) > 0) && !this->combinationEntered) {
+      queueEvent(UserControls::ModeButton, 1);
+    }
+
     this->prevButtonState = currentButtonState;
-  } 
-  
-  // check the encoder wheel
-  int32_t currentEncoderPosition = this->encoder->read() / RE_STEP_SIZE;
-  if (currentEncoderPosition != this->prevEncoderPosition) {
-#if RE_INVERT_DIRECTION == 1
-    int8_t encoderData = - (currentEncoderPosition - this->prevEncoderPosition);
-#else
-    int8_t encoderData =   (currentEncoderPosition - this->prevEncoderPosition);
-#endif
-    queueEvent(UserControls::EncChanged, encoderData);
-    this->prevEncoderPosition = currentEncoderPosition; 
   }
 }
 
@@ -134,6 +148,15 @@ bool UserControls::isEventAvailable() {
   return (this->eventQueue[this->eventQueueStart].type != None);
 }
 
+UserControls::EventType UserControls::getCombination() {
+  EventType result = this->combination;
+  this->combination = UserControls::None;
+  if (result != UserControls::None) {
+    TRACE_RECORD_COMBINATION(result);
+  }
+  return result;
+}
+
 UserControls::Event UserControls::getEvent() {
   // get the event at the first position
   Event result = this->eventQueue[this->eventQueueStart];
@@ -149,6 +172,7 @@ UserControls::Event UserControls::getEvent() {
         this->eventQueueStart = 0;
       }
     }
+    TRACE_RECORD_EVENT(result.type, result.data);
   }
   return result;
 }
@@ -177,3 +201,11 @@ void UserControls::queueEvent(EventType type, int8_t data) {
   }
 }
 
+void UserControls::queueKeypadEvent(EventType type, uint8_t currentButtonState) {
+  if ((currentButtonState & USER_CONTROLS_BUTTON_MODE) > 0) {
+    this->combination = type;
+    this->combinationEntered = true;
+  } else {
+    queueEvent(type, 1);
+  }
+}
@@ -28,6 +28,12 @@
  */
 #define USER_CONTROLS_EVENT_BUFFER_SIZE 3
 
+/**
+ * The interval in ms at which the buttons are polled. Reading the analog inputs takes about
+ * 0.2 ms, so they are not read during every main loop iteration (see IdleSleep).
+ */
+#define USER_CONTROLS_POLL_INTERVAL     10
+
 /**
  * This class handles the user interactiouns through the various buttons and the
  * rotary encoder. It is integrated into the main loop and provides an event queue
@@ -77,6 +83,16 @@ class UserControls {
      */
     Event getEvent();
 
+    /**
+     * Returns and clears the last key combination entered. A key combination is entered 
+     * by pressing a keypad key while holding down the mode button. The keypad key is reported 
+     * as the event type (KeyLeft, KeyRight, KeyUp, KeyDown or KeySelect) and does not appear
+     * in the event queue. If no combination was entered, None is returned. The ModeButton
+     * event is therefore queued when the mode button is released, and only if no combination
+     * was entered while it was held down.
+     */
+    EventType getCombination();
+
   private:
 
     /**
@@ -96,6 +112,21 @@ class UserControls {
      */
     uint8_t prevButtonState = 0;
 
+    /**
+     * The lower eight bits of the system time at which the buttons were last polled.
+     */
+    uint8_t lastPollTime = 0;
+
+    /**
+     * The last key combination entered (see getCombination()).
+     */
+    EventType combination = None;
+
+    /**
+     * Whether a key combination has been entered since the mode button was pressed.
+     */
+    bool combinationEntered = false;
+
     /**
      * The encoder position encountered during the last loop iteration.
      */
@@ -107,12 +138,23 @@ class UserControls {
      */
     Encoder * encoder;
 
+    /**
+     * Reads the buttons and queues the events for the buttons that have been pressed.
+     */
+    void pollButtons();
+
     /**
      * Stores an event in the event queue. This method checks whether the last event
      * is of the same type and adds the data in this case. If the event queue is full,
      * the event is discarded silently.
      */
     void queueEvent(EventType type, int8_t data);
+
+    /**
+     * Either queues a keypad event or records it as a key combination, depending on 
+     * whether the mode button is being held down.
+     */
+    void queueKeypadEvent(EventType type, uint8_t currentButtonState);
     
 };
 
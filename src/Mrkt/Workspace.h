@@ -0,0 +1,58 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+#ifndef MRKT_Workspace_h
+#define MRKT_Workspace_h
+
+#include <inttypes.h>
+
+#include "Configuration.h"
+#include "BenchmarkMode.h"
+
+#if SDCARD_AVAILABLE == 1
+#include "FileBrowser.h"
+#include "Uploader.h"
+#endif
+
+/**
+ * The buffers that are only needed by one mode or for a short time share the same memory:
+ * 
+ *   - the latencies of a benchmark run, from the start of the run to its evaluation 
+ *     (see BenchmarkMode.h),
+ *   - the entries collected by the file browser during a single main loop iteration while
+ *     the index is built (see FileBrowser.h),
+ *   - the payload bytes received by the uploader that have not been written yet, while an
+ *     upload is active (see Uploader.h).
+ * 
+ * The benchmark and the file browser belong to different modes. A benchmark run is not 
+ * started while an upload is active, and the host command PUT is rejected during a run; the
+ * file browser does not build the index while an upload is active.
+ */
+union Workspace {
+  uint16_t latencies[BENCH_MODE_MAX_QUERIES];
+#if SDCARD_AVAILABLE == 1
+  FileBrowser::Candidate batch[FILE_BROWSER_BATCH_SIZE];
+  uint8_t chunk[UPLOADER_CHUNK_SIZE];
+#endif
+};
+
+/**
+ * Access to the shared memory.
+ */
+extern Workspace MrktWorkspace;
+
+#endif
@@ -0,0 +1,164 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+
+// The decoder of the trace that Mrkt writes to the SD card if TRACE_ENABLED is set (see
+// src/Mrkt/TraceFile.h) - shared by the host tools mrkttrace and mrktreplay.
+
+#ifndef MRKT_TraceReader_h
+#define MRKT_TraceReader_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "TraceFile.h"
+
+// the internal record types used for the gaps in the trace
+#define TRACE_MISSING  8
+#define TRACE_DROPPED  9
+
+static const char * EventNames[] = {
+  "None", "KeyLeft", "KeyRight", "KeyUp", "KeyDown", "KeySelect", "EncChanged", "EncButton",
+  "ModeButton"
+};
+
+/**
+ * A decoded record - the time is given in ms since the power-up of the pendant. The count
+ * is the number of blocks missing or bytes dropped for the internal record types.
+ */
+struct Record {
+  uint32_t time;
+  uint8_t type;
+  std::string data;
+  uint32_t count;
+};
+
+static bool compareBlocks(const TraceBlock & first, const TraceBlock & second) {
+  return first.number < second.number;
+}
+
+static bool readTrace(const char * fileName, long & run, std::vector<Record> & records) {
+  FILE * input = fopen(fileName, "rb");
+  if (input == NULL) {
+    perror(fileName);
+    return false;
+  }
+  uint8_t buffer[TRACE_BLOCK_SIZE];
+  TraceHeader header;
+  if (fread(buffer, 1, TRACE_BLOCK_SIZE, input) != TRACE_BLOCK_SIZE) {
+    fprintf(stderr, "%s: not a trace\n", fileName);
+    return false;
+  }
+  memcpy(&header, buffer, sizeof(header));
+  if ((memcmp(header.magic, TRACE_MAGIC, TRACE_MAGIC_SIZE) != 0) || (header.version != TRACE_VERSION)) {
+    fprintf(stderr, "%s: not a trace\n", fileName);
+    return false;
+  }
+  if (run < 0) {
+    run = header.run;
+  }
+
+  // the blocks of the run are ordered by their number - the ring may have wrapped around
+  std::vector<TraceBlock> blocks;
+  while (fread(buffer, 1, TRACE_BLOCK_SIZE, input) == TRACE_BLOCK_SIZE) {
+    TraceBlock block;
+    memcpy(&block, buffer, sizeof(block));
+    if ((block.run == run) && (block.length > 0) && (block.length <= TRACE_DATA_SIZE)) {
+      blocks.push_back(block);
+    }
+  }
+  fclose(input);
+  std::sort(blocks.begin(), blocks.end(), compareBlocks);
+
+  for (size_t i = 0; i < blocks.size(); i++) {
+    const TraceBlock & block = blocks[i];
+    if ((i > 0) && (block.number != blocks[i - 1].number + 1)) {
+      Record missing = { block.time, TRACE_MISSING, "", block.number - blocks[i - 1].number - 1 };
+      records.push_back(missing);
+    }
+    if (block.dropped > 0) {
+      Record dropped = { block.time, TRACE_DROPPED, "", block.dropped };
+      records.push_back(dropped);
+    }
+    uint32_t time = block.time;
+    uint16_t position = 0;
+    while (position + 2 <= block.length) {
+      uint8_t type = block.data[position] >> TRACE_TYPE_SHIFT;
+      uint8_t length = (block.data[position] & TRACE_LENGTH_MASK) + 1;
+      time += block.data[position + 1];
+      position += 2;
+      if (position + length > block.length) {
+        fprintf(stderr, "block %u: record exceeds the block\n", block.number);
+        break;
+      }
+      Record record = { time, type, std::string((const char *) &block.data[position], length), 0 };
+      position += length;
+      if (type == TRACE_TIME) {
+        if (length == sizeof(uint32_t)) {
+          memcpy(&time, record.data.data(), sizeof(uint32_t));
+        }
+        continue;
+      }
+      // the records of the same direction within the same ms are split up by the length only
+      if (!records.empty() && (records.back().type == type) && (records.back().time == time) &&
+          (type <= TRACE_GRBL_TX)) {
+        records.back().data += record.data;
+      } else {
+        records.push_back(record);
+      }
+    }
+  }
+  printf("run %ld, %zu blocks\n", run, blocks.size());
+  return true;
+}
+
+static std::string escape(const std::string & data) {
+  std::string result;
+  for (size_t i = 0; i < data.size(); i++) {
+    uint8_t c = data[i];
+    char text[8];
+    if (c == '\r') {
+      result += "\\r";
+    } else if (c == '\n') {
+      result += "\\n";
+    } else if (c == '\\') {
+      result += "\\\\";
+    } else if ((c < 0x20) || (c >= 0x7F)) {
+      snprintf(text, sizeof(text), "\\x%02X", c);
+      result += text;
+    } else {
+      result += (char) c;
+    }
+  }
+  return result;
+}
+
+static void printEvent(const Record & record) {
+  uint8_t eventType = record.data[0];
+  const char * name = (eventType < sizeof(EventNames) / sizeof(EventNames[0])) ? EventNames[eventType] : "?";
+  if (record.type == TRACE_EVENT) {
+    printf("%10.3f event %s %d\n", record.time / 1000.0, name, (record.data.size() > 1) ? (int8_t) record.data[1] : 0);
+  } else {
+    printf("%10.3f combination %s\n", record.time / 1000.0, name);
+  }
+}
+
+#endif
@@ -0,0 +1,380 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+
+// mrktc - the Mrkt job compiler
+//
+// This host tool converts a G-code file into a precompiled Mrkt job file (see 
+// src/Mrkt/JobFile.h) that can be streamed by the reader mode without any processing
+// on the device. The lines are minified using the same code as the device, the header
+// contains the bounding box and an estimated runtime and the file contains a sparse 
+// index to locate any line quickly.
+//
+// Build:  g++ -O2 -I../src/Mrkt -o mrktc mrktc.cpp ../src/Mrkt/GCodeMinifier.cpp
+// Usage:  mrktc [-r <x>,<y>,<z>] [-s <stride>] <input.nc> [<output.mj>]
+//
+//   -r   the maximum rates of the axes in mm/min (Grbl settings $110 to $112),
+//        used for the runtime estimate (default: 500,500,500)
+//   -s   the number of lines between two index entries (default: JOB_FILE_INDEX_STRIDE)
+//
+// If no output file is given, the extension of the input file is replaced by .MJ.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "GCodeMinifier.h"
+#include "JobFile.h"
+
+/**
+ * A simple model of the machine motion used to determine the bounding box and the runtime.
+ * Acceleration is not taken into account.
+ */
+class MotionEstimator {
+
+  public:
+    MotionEstimator(const double rates[3]) {
+      for (int axis = 0; axis < 3; axis++) {
+        this->rates[axis] = rates[axis];
+        this->position[axis] = 0.0;
+        this->boundsMin[axis] = 0.0;
+        this->boundsMax[axis] = 0.0;
+      }
+      this->motion = 0;
+      this->absolute = true;
+      this->unitFactor = 1.0;
+      this->feedRate = 0.0;
+      this->inverseTime = false;
+      this->time = 0.0;
+      this->moved = false;
+    }
+
+    /**
+     * Processes a minified line (upper case, no whitespace or comments).
+     */
+    void process(const char * line) {
+      double words[26];
+      bool present[26] = { false };
+      int nonModal = -1;
+      const char * input = line;
+      while (*input != '\0') {
+        char letter = *input++;
+        char * end;
+        double value = strtod(input, &end);
+        if ((letter < 'A') || (letter > 'Z') || (end == input)) {
+          // not a regular word (e.g. a $ line) - ignore the line
+          return;
+        }
+        input = end;
+        int code = (int) lround(value * 10);
+        if (letter == 'G') {
+          switch(code) {
+            case   0: case  10: case  20: case  30: motion = code / 10;  break;
+            case 200: unitFactor = 25.4;                                  break;
+            case 210: unitFactor = 1.0;                                   break;
+            case 900: absolute = true;                                    break;
+            case 910: absolute = false;                                   break;
+            case 930: inverseTime = true;                                 break;
+            case 940: inverseTime = false;                                break;
+            case 800: motion = -1;                                        break;
+            case 40: case 100: case 280: case 300: case 920: nonModal = code; break;
+            default:                                                      break;
+          }
+        } else {
+          words[letter - 'A'] = value;
+          present[letter - 'A'] = true;
+        }
+      }
+      if (present['F' - 'A']) {
+        feedRate = inverseTime ? words['F' - 'A'] : words['F' - 'A'] * unitFactor;
+      }
+      if (nonModal == 40) {
+        // dwell
+        if (present['P' - 'A']) {
+          time += words['P' - 'A'];
+        }
+        return;
+      }
+
+      // determine the target position
+      double target[3];
+      bool axisWords = false;
+      for (int axis = 0; axis < 3; axis++) {
+        target[axis] = position[axis];
+        if (present['X' - 'A' + axis]) {
+          double value = words['X' - 'A' + axis] * unitFactor;
+          target[axis] = absolute ? value : position[axis] + value;
+          axisWords = true;
+        }
+      }
+      if (!axisWords) {
+        return;
+      }
+      if ((nonModal == 920) || (nonModal == 100)) {
+        // coordinate system changes - no motion, the work coordinates are simply redefined
+        return;
+      }
+      if ((nonModal == 280) || (nonModal == 300)) {
+        // return to a predefined position - only the intermediate point is known
+        move(target, true, 0.0);
+        return;
+      }
+      if (motion == 0) {
+        move(target, true, 0.0);
+      } else if (motion == 1) {
+        move(target, false, 0.0);
+      } else if ((motion == 2) || (motion == 3)) {
+        // arcs in the XY plane, given by the center offsets or the radius
+        double startX = position[0], startY = position[1];
+        double centerX, centerY;
+        if (present['R' - 'A']) {
+          double r = words['R' - 'A'] * unitFactor;
+          double dx = target[0] - startX, dy = target[1] - startY;
+          double d = sqrt(dx * dx + dy * dy);
+          double h = (d < 2 * fabs(r)) ? sqrt(r * r - d * d / 4) : 0.0;
+          double sign = ((motion == 2) == (r > 0)) ? -1.0 : 1.0;
+          centerX = startX + dx / 2 - sign * h * dy / d;
+          centerY = startY + dy / 2 + sign * h * dx / d;
+        } else {
+          centerX = startX + (present['I' - 'A'] ? words['I' - 'A'] * unitFactor : 0.0);
+          centerY = startY + (present['J' - 'A'] ? words['J' - 'A'] * unitFactor : 0.0);
+        }
+        double radius = hypot(startX - centerX, startY - centerY);
+        double startAngle = atan2(startY - centerY, startX - centerX);
+        double endAngle = atan2(target[1] - centerY, target[0] - centerX);
+        double sweep = endAngle - startAngle;
+        if (motion == 2) {
+          if (sweep >= 0) sweep -= 2 * M_PI;
+        } else {
+          if (sweep <= 0) sweep += 2 * M_PI;
+        }
+        // approximate the arc by short segments
+        int segments = (int) ceil(fabs(sweep) * radius / 0.5) + 1;
+        double startZ = position[2];
+        for (int i = 1; i <= segments; i++) {
+          double angle = startAngle + sweep * i / segments;
+          double point[3] = {
+            centerX + radius * cos(angle),
+            centerY + radius * sin(angle),
+            startZ + (target[2] - startZ) * i / segments
+          };
+          if (i == segments) {
+            memcpy(point, target, sizeof(point));
+          }
+          move(point, false, inverseTime ? 1.0 / segments : 0.0);
+        }
+      }
+    }
+
+    double rates[3];
+    double position[3];
+    double boundsMin[3];
+    double boundsMax[3];
+    int motion;
+    bool absolute;
+    double unitFactor;
+    double feedRate;
+    bool inverseTime;
+    double time;       // in minutes
+    bool moved;
+
+  private:
+    /**
+     * Moves to the target position, at rapid rate or the feed rate. For arc segments in 
+     * inverse time mode, fraction is the part of the total time of the arc.
+     */
+    void move(const double target[3], bool rapid, double fraction) {
+      double distance = 0.0;
+      double minimumTime = 0.0;
+      for (int axis = 0; axis < 3; axis++) {
+        double delta = fabs(target[axis] - position[axis]);
+        distance += delta * delta;
+        if (rates[axis] > 0) {
+          minimumTime = fmax(minimumTime, delta / rates[axis]);
+        }
+      }
+      distance = sqrt(distance);
+      double moveTime = minimumTime;
+      if (!rapid && (feedRate > 0)) {
+        if (inverseTime) {
+          moveTime = fmax(minimumTime, (fraction > 0 ? fraction : 1.0) / feedRate);
+        } else {
+          moveTime = fmax(minimumTime, distance / feedRate);
+        }
+      }
+      time += moveTime;
+      for (int axis = 0; axis < 3; axis++) {
+        position[axis] = target[axis];
+        if (!moved) {
+          boundsMin[axis] = boundsMax[axis] = position[axis];
+        }
+        boundsMin[axis] = fmin(boundsMin[axis], position[axis]);
+        boundsMax[axis] = fmax(boundsMax[axis], position[axis]);
+      }
+      moved = true;
+    }
+};
+
+static void usage() {
+  fprintf(stderr, "usage: mrktc [-r <x>,<y>,<z>] [-s <stride>] <input.nc> [<output.mj>]\n");
+  exit(2);
+}
+
+int main(int argc, char ** argv) {
+  double rates[3] = { 500.0, 500.0, 500.0 };
+  unsigned stride = JOB_FILE_INDEX_STRIDE;
+  const char * inputName = NULL;
+  const char * outputName = NULL;
+  for (int i = 1; i < argc; i++) {
+    if ((strcmp(argv[i], "-r") == 0) && (i + 1 < argc)) {
+      if (sscanf(argv[++i], "%lf,%lf,%lf", &rates[0], &rates[1], &rates[2]) != 3) {
+        usage();
+      }
+    } else if ((strcmp(argv[i], "-s") == 0) && (i + 1 < argc)) {
+      stride = atoi(argv[++i]);
+      if ((stride == 0) || (stride > 0xFFFF)) {
+        usage();
+      }
+    } else if (argv[i][0] == '-') {
+      usage();
+    } else if (inputName == NULL) {
+      inputName = argv[i];
+    } else if (outputName == NULL) {
+      outputName = argv[i];
+    } else {
+      usage();
+    }
+  }
+  if (inputName == NULL) {
+    usage();
+  }
+  std::string output;
+  if (outputName == NULL) {
+    output = inputName;
+    size_t dot = output.find_last_of('.');
+    size_t slash = output.find_last_of('/');
+    if ((dot != std::string::npos) && ((slash == std::string::npos) || (dot > slash))) {
+      output.erase(dot);
+    }
+    output += ".MJ";
+    outputName = output.c_str();
+  }
+
+  FILE * input = fopen(inputName, "rb");
+  if (input == NULL) {
+    perror(inputName);
+    return 1;
+  }
+
+  // minify the lines, pack them into blocks and record the index
+  GCodeMinifier minifier;
+  MotionEstimator estimator(rates);
+  std::vector<uint8_t> data;
+  std::vector<uint32_t> index;
+  uint32_t lineCount = 0;
+  uint32_t sourceLine = 0;
+  uint32_t sourceSize = 0;
+  char line[256];
+  while (fgets(line, sizeof(line), input) != NULL) {
+    sourceLine++;
+    size_t length = strlen(line);
+    sourceSize += length;
+    if ((length == sizeof(line) - 1) && (line[length - 1] != '\n') && !feof(input)) {
+      fprintf(stderr, "%s:%u: line too long\n", inputName, sourceLine);
+      return 1;
+    }
+    line[strcspn(line, "\r\n")] = '\0';
+    uint8_t minified = minifier.minify(line);
+    if (minified == 0) {
+      continue;
+    }
+    if (minified > JOB_FILE_MAX_LINE_LENGTH) {
+      fprintf(stderr, "%s:%u: line exceeds %d characters after minification\n", 
+              inputName, sourceLine, JOB_FILE_MAX_LINE_LENGTH);
+      return 1;
+    }
+    estimator.process(line);
+
+    // start a new block if the record does not fit into the current one
+    size_t blockRemaining = JOB_FILE_BLOCK_SIZE - (data.size() % JOB_FILE_BLOCK_SIZE);
+    if (minified + 1u > blockRemaining) {
+      data.insert(data.end(), blockRemaining, 0);
+    }
+    if (lineCount % stride == 0) {
+      index.push_back(data.size());
+    }
+    data.push_back(minified);
+    data.insert(data.end(), line, line + minified);
+    lineCount++;
+  }
+  fclose(input);
+
+  // assemble the header - the offsets of the index entries are relative to the data blocks
+  size_t indexBlocks = (index.size() * sizeof(uint32_t) + JOB_FILE_BLOCK_SIZE - 1) / JOB_FILE_BLOCK_SIZE;
+  JobFileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, JOB_FILE_MAGIC, JOB_FILE_MAGIC_SIZE);
+  header.version = JOB_FILE_VERSION;
+  header.indexStride = stride;
+  header.lineCount = lineCount;
+  header.indexOffset = JOB_FILE_BLOCK_SIZE;
+  header.indexEntries = index.size();
+  header.dataOffset = JOB_FILE_BLOCK_SIZE * (1 + indexBlocks);
+  header.dataSize = data.size();
+  for (int axis = 0; axis < 3; axis++) {
+    header.boundsMin[axis] = (int32_t) lround(estimator.boundsMin[axis] * 1000.0);
+    header.boundsMax[axis] = (int32_t) lround(estimator.boundsMax[axis] * 1000.0);
+  }
+  header.estimatedTime = (uint32_t) lround(estimator.time * 60.0);
+  header.sourceSize = sourceSize;
+  for (size_t i = 0; i < index.size(); i++) {
+    index[i] += header.dataOffset;
+  }
+
+  // write the file
+  FILE * out = fopen(outputName, "wb");
+  if (out == NULL) {
+    perror(outputName);
+    return 1;
+  }
+  std::vector<uint8_t> block(JOB_FILE_BLOCK_SIZE * (1 + indexBlocks), 0);
+  memcpy(&block[0], &header, sizeof(header));
+  if (!index.empty()) {
+    memcpy(&block[JOB_FILE_BLOCK_SIZE], &index[0], index.size() * sizeof(uint32_t));
+  }
+  bool ok = (fwrite(&block[0], 1, block.size(), out) == block.size());
+  if (!data.empty()) {
+    ok = ok && (fwrite(&data[0], 1, data.size(), out) == data.size());
+  }
+  ok = (fclose(out) == 0) && ok;
+  if (!ok) {
+    perror(outputName);
+    return 1;
+  }
+
+  uint32_t minutes = header.estimatedTime / 60;
+  printf("%s: %u of %u lines, %u -> %zu bytes of G-code (%.0f%%)\n", outputName, lineCount, sourceLine,
+         sourceSize, data.size(), sourceSize ? 100.0 * data.size() / sourceSize : 0.0);
+  printf("bounds X %.3f..%.3f  Y %.3f..%.3f  Z %.3f..%.3f\n",
+         estimator.boundsMin[0], estimator.boundsMax[0], estimator.boundsMin[1],
+         estimator.boundsMax[1], estimator.boundsMin[2], estimator.boundsMax[2]);
+  printf("estimated runtime %u:%02u:%02u\n", minutes / 60, minutes % 60, header.estimatedTime % 60);
+  return 0;
+}
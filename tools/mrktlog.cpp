@@ -0,0 +1,144 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+
+// mrktlog - the Mrkt job log decoder
+//
+// This host tool prints the records of the job log that Mrkt writes to the SD card if 
+// JOB_LOG_ENABLED is set (see src/Mrkt/JobLog.h and src/Mrkt/JobLogFile.h), one line per 
+// record. Only the most recent run is printed unless another one is selected.
+//
+// Build:  g++ -O2 -I../src/Mrkt -o mrktlog mrktlog.cpp
+// Usage:  mrktlog [-r <run>] [<MRKTLOG.DAT>]
+//
+// Output columns: time (s), type, line, and depending on the type the state, the machine 
+// position X Y Z (mm) and the feed rate, or the error code. Dropped records are reported
+// in the output as well.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "JobLogFile.h"
+
+static const char * StateNames[] = {
+  "?", "Idle", "Run", "Hold", "Jog", "Alarm", "Door", "Check", "Home", "Sleep"
+};
+
+static void usage() {
+  fprintf(stderr, "usage: mrktlog [-r <run>] [<MRKTLOG.DAT>]\n");
+  exit(2);
+}
+
+static bool compareBlocks(const JobLogBlock & first, const JobLogBlock & second) {
+  return first.number < second.number;
+}
+
+static void printMillimeters(int32_t value) {
+  printf(" %s%d.%03d", (value < 0) ? "-" : "", abs(value) / 1000, abs(value) % 1000);
+}
+
+static void printRecord(const JobLogRecord & record) {
+  printf("%10.3f ", record.time / 1000.0);
+  switch (record.type) {
+    case JOB_LOG_START:
+      printf("START  %7u file %04X%s\n", record.line, record.feedRate, record.code ? " resumed" : "");
+      break;
+    case JOB_LOG_STATUS:
+      printf("STATUS %7u %-5s", record.line, StateNames[(record.code <= 9) ? record.code : 0]);
+      for (int axis = 0; axis < 3; axis++) {
+        printMillimeters(record.position[axis]);
+      }
+      printf(" F%u\n", record.feedRate);
+      break;
+    case JOB_LOG_OK:
+      printf("OK     %7u\n", record.line);
+      break;
+    case JOB_LOG_ERROR:
+      printf("ERROR  %7u error %d\n", record.line, record.code);
+      break;
+    case JOB_LOG_END:
+      printf("END            %s %d\n", record.code ? "error" : "completed", record.code);
+      break;
+    default:
+      printf("?      type %u\n", record.type);
+      break;
+  }
+}
+
+int main(int argc, char ** argv) {
+  const char * fileName = JOB_LOG_FILE_NAME;
+  long run = -1;
+  for (int i = 1; i < argc; i++) {
+    if ((strcmp(argv[i], "-r") == 0) && (i + 1 < argc)) {
+      run = atol(argv[++i]);
+    } else if (argv[i][0] == '-') {
+      usage();
+    } else {
+      fileName = argv[i];
+    }
+  }
+
+  FILE * input = fopen(fileName, "rb");
+  if (input == NULL) {
+    perror(fileName);
+    return 1;
+  }
+  uint8_t buffer[JOB_LOG_BLOCK_SIZE];
+  JobLogHeader header;
+  if (fread(buffer, 1, JOB_LOG_BLOCK_SIZE, input) != JOB_LOG_BLOCK_SIZE) {
+    fprintf(stderr, "%s: not a job log\n", fileName);
+    return 1;
+  }
+  memcpy(&header, buffer, sizeof(header));
+  if ((memcmp(header.magic, JOB_LOG_MAGIC, JOB_LOG_MAGIC_SIZE) != 0) || (header.version != JOB_LOG_VERSION)) {
+    fprintf(stderr, "%s: not a job log\n", fileName);
+    return 1;
+  }
+  if (run < 0) {
+    run = header.run;
+  }
+
+  // the blocks of the run are ordered by their number - the ring may have wrapped around
+  std::vector<JobLogBlock> blocks;
+  while (fread(buffer, 1, JOB_LOG_BLOCK_SIZE, input) == JOB_LOG_BLOCK_SIZE) {
+    JobLogBlock block;
+    memcpy(&block, buffer, sizeof(block));
+    if ((block.run == run) && (block.count > 0) && (block.count <= JOB_LOG_RECORDS_PER_BLOCK)) {
+      blocks.push_back(block);
+    }
+  }
+  fclose(input);
+  std::sort(blocks.begin(), blocks.end(), compareBlocks);
+
+  printf("run %ld, %zu blocks\n", run, blocks.size());
+  for (size_t i = 0; i < blocks.size(); i++) {
+    if ((i > 0) && (blocks[i].number != blocks[i - 1].number + 1)) {
+      printf("--- %u blocks overwritten or missing\n", blocks[i].number - blocks[i - 1].number - 1);
+    }
+    if (blocks[i].dropped > 0) {
+      printf("--- %u records dropped\n", blocks[i].dropped);
+    }
+    for (int record = 0; record < blocks[i].count; record++) {
+      printRecord(blocks[i].records[record]);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,1061 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+
+// mrktreplay - the Mrkt trace replayer for the host
+//
+// This host tool replays a trace that Mrkt writes to the SD card if TRACE_ENABLED is set
+// (see src/Mrkt/Trace.h and src/Mrkt/TraceFile.h) on the firmware itself. The firmware is
+// compiled for the host against the thin stubs of the Arduino core and the libraries in
+// tools/replay, and ModeController::loop() is run on a simulated clock. In contrast to
+// mrkttrace -g, no hardware is involved and the replay runs as fast as the host allows.
+//
+// The bytes recorded from the host and the Grbl system are queued at the serial ports at
+// the recorded times, but the Grbl responses never before the firmware has sent as many
+// bytes to the Grbl system as it had sent at that point of the recording (see mrkttrace).
+// The user control events are entered through the simulated keypad, buttons and encoder
+// slightly ahead of the time they were taken from the event queue, so they pass through
+// UserControls like the real ones. The bytes sent to the Grbl system are compared to the
+// recording, and the first difference is printed.
+//
+// The simulated clock advances by the loop time given per main loop iteration, to the next
+// timer interrupt when the processor sleeps (see IdleSleep.h), by the transmission time of
+// the bytes sent to the Grbl system and by the time of the SD card and display accesses.
+// The SD card holds a copy of the files of the directory given (default: the directory of
+// the trace) in memory, so the replay does not change them, and the EEPROM is erased.
+// Note that int has 32 bits on the host.
+//
+// Build:  g++ -O2 -Ireplay -I../src/Mrkt -o mrktreplay mrktreplay.cpp -x c++ ../src/Mrkt/*.cpp ../src/Mrkt/Mrkt.ino
+// Usage:  mrktreplay [-r <run>] [-d <directory>] [-l <us>] [-v] [<MRKTTRC.DAT>]
+//
+//   -r   the run to replay (default: the most recent one)
+//   -d   the directory holding the files of the SD card
+//   -l   the time of a main loop iteration in us (default: 200)
+//   -v   print the display whenever it has changed
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "TraceReader.h"
+
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "Encoder.h"
+#include "LiquidCrystal.h"
+#include "SdFat.h"
+#include "SoftwareSerial.h"
+#include <avr/sleep.h>
+
+#include "Configuration.h"
+#include "UserControls.h"
+
+// the macros of the Arduino core would replace std::min() and std::max()
+#undef min
+#undef max
+
+/**
+ * The timing of the simulated hardware in us.
+ */
+#define REPLAY_ANALOG_READ_TIME    100
+#define REPLAY_CARD_BLOCK_TIME    1000
+#define REPLAY_LCD_WRITE_TIME       40
+#define REPLAY_LCD_CLEAR_TIME     1600
+#define REPLAY_TIMER_INTERVAL     1000
+
+/**
+ * The size of the transmit buffer of the host connection.
+ */
+#define REPLAY_SERIAL_TX_BUFFER_SIZE 64
+
+/**
+ * The size of the EEPROM of the ATmega328P.
+ */
+#define REPLAY_EEPROM_SIZE 1024
+
+/**
+ * The time in ms a recorded response waits for the commands it responds to before the rest
+ * of the run is replayed by time only, and the time the replay continues after the last
+ * record.
+ */
+#define REPLAY_STALL_TIMEOUT  5000
+#define REPLAY_FINISH_TIME    2000
+
+/**
+ * The analog values of the keypad and the mode and encoder buttons (see UserControls).
+ */
+#define REPLAY_KEYPAD_RIGHT      0
+#define REPLAY_KEYPAD_UP       150
+#define REPLAY_KEYPAD_DOWN     350
+#define REPLAY_KEYPAD_LEFT     550
+#define REPLAY_KEYPAD_SELECT   750
+#define REPLAY_BUTTON_MODE       0
+#define REPLAY_BUTTON_ENCODER  500
+#define REPLAY_RELEASED       1023
+
+/**
+ * The entry points of the sketch (see Mrkt.ino).
+ */
+void setup();
+void loop();
+
+// -----------------------------------------------------------------------------
+//   SIMULATED HARDWARE
+// -----------------------------------------------------------------------------
+
+// The firmware constructors run before main() and call some of the functions below, so the
+// state they touch is initialized statically.
+
+/**
+ * The simulated clock in us since the power-up.
+ */
+static uint64_t Clock = 0;
+
+/**
+ * The time of a byte on the serial connections in us.
+ */
+static uint32_t HostByteTime = 0;
+static uint32_t GrblByteTime = 0;
+
+/**
+ * The time at which the transmit buffer of the host connection is empty.
+ */
+static uint64_t HostTransmitEnd = 0;
+
+/**
+ * The state of the user controls.
+ */
+static int KeypadValue = REPLAY_RELEASED;
+static int ButtonValue = REPLAY_RELEASED;
+static int32_t EncoderPosition = 0;
+
+/**
+ * The display memory - the rows are indexed directly, whatever the geometry passed to begin().
+ */
+static char Lcd[LIQUID_CRYSTAL_ROWS][LIQUID_CRYSTAL_COLUMNS];
+static bool LcdChanged = false;
+
+static std::string HostInput;
+static std::string GrblInput;
+static std::string GrblOutput;
+
+/**
+ * A file of the simulated SD card - the position in the directory is the index of the file.
+ */
+struct CardFile {
+  std::string name;
+  std::vector<uint8_t> data;
+  uint16_t date;
+  uint16_t time;
+  bool removed;
+};
+
+static std::vector<CardFile> Card;
+
+/**
+ * The block last accessed - like SdFat, only the access of another block takes time.
+ */
+static int32_t CachedFile = -1;
+static uint32_t CachedBlock = 0;
+
+unsigned long millis() {
+  return Clock / 1000;
+}
+
+unsigned long micros() {
+  return Clock;
+}
+
+void delay(unsigned long ms) {
+  Clock += (uint64_t) ms * 1000;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+}
+
+int digitalRead(uint8_t pin) {
+  return LOW;
+}
+
+int analogRead(uint8_t pin) {
+  Clock += REPLAY_ANALOG_READ_TIME;
+  if (pin == KEYPAD_BUTTONS) {
+    return KeypadValue;
+  }
+  if (pin == RE_MODE_ENC_BUTTONS) {
+    return ButtonValue;
+  }
+  return 0;
+}
+
+void analogWrite(uint8_t pin, int value) {
+}
+
+void sleep_cpu() {
+  // the timer interrupt wakes the processor up - the data received is queued at the ticks
+  Clock = (Clock / REPLAY_TIMER_INTERVAL + 1) * REPLAY_TIMER_INTERVAL;
+}
+
+String::String(const char * text) {
+  this->text = strdup(text);
+}
+
+String::String(const __FlashStringHelper * text) {
+  this->text = strdup((const char *) text);
+}
+
+String::String(const String & other) {
+  this->text = strdup(other.text);
+}
+
+String::~String() {
+  free(this->text);
+}
+
+String & String::operator=(const String & other) {
+  if (this != &other) {
+    free(this->text);
+    this->text = strdup(other.text);
+  }
+  return *this;
+}
+
+const char * String::c_str() const {
+  return this->text;
+}
+
+unsigned int String::length() const {
+  return strlen(this->text);
+}
+
+size_t Print::write(const uint8_t * data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    write(data[i]);
+  }
+  return length;
+}
+
+size_t Print::write(const char * text) {
+  return write((const uint8_t *) text, strlen(text));
+}
+
+int Print::availableForWrite() {
+  return 0;
+}
+
+size_t Print::print(const __FlashStringHelper * text) {
+  return write((const char *) text);
+}
+
+size_t Print::print(const String & text) {
+  return write(text.c_str());
+}
+
+size_t Print::print(const char * text) {
+  return write(text);
+}
+
+size_t Print::print(char value) {
+  return write((uint8_t) value);
+}
+
+size_t Print::print(unsigned char value, int base) {
+  return printNumber(value, base);
+}
+
+size_t Print::print(int value, int base) {
+  return print((long) value, base);
+}
+
+size_t Print::print(unsigned int value, int base) {
+  return printNumber(value, base);
+}
+
+size_t Print::print(long value, int base) {
+  if ((value < 0) && (base == DEC)) {
+    return write('-') + printNumber(-value, base);
+  }
+  return printNumber(value, base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+  return printNumber(value, base);
+}
+
+size_t Print::println(const __FlashStringHelper * text) {
+  return print(text) + println();
+}
+
+size_t Print::println(const String & text) {
+  return print(text) + println();
+}
+
+size_t Print::println(const char * text) {
+  return print(text) + println();
+}
+
+size_t Print::println(char value) {
+  return print(value) + println();
+}
+
+size_t Print::println(unsigned char value, int base) {
+  return print(value, base) + println();
+}
+
+size_t Print::println(int value, int base) {
+  return print(value, base) + println();
+}
+
+size_t Print::println(unsigned int value, int base) {
+  return print(value, base) + println();
+}
+
+size_t Print::println(long value, int base) {
+  return print(value, base) + println();
+}
+
+size_t Print::println(unsigned long value, int base) {
+  return print(value, base) + println();
+}
+
+size_t Print::println() {
+  return write("\r\n");
+}
+
+size_t Print::printNumber(unsigned long value, int base) {
+  char text[8 * sizeof(long) + 1];
+  char * digit = &text[sizeof(text) - 1];
+  *digit = '\0';
+  do {
+    uint8_t remainder = value % base;
+    value /= base;
+    *--digit = (remainder < 10) ? '0' + remainder : 'A' + remainder - 10;
+  } while (value > 0);
+  return write(digit);
+}
+
+HardwareSerial Serial;
+
+void HardwareSerial::begin(unsigned long baud) {
+  HostByteTime = 10000000 / baud;
+}
+
+HardwareSerial::operator bool() {
+  return true;
+}
+
+int HardwareSerial::available() {
+  return HostInput.size();
+}
+
+int HardwareSerial::read() {
+  if (HostInput.empty()) {
+    return -1;
+  }
+  uint8_t data = HostInput[0];
+  HostInput.erase(0, 1);
+  return data;
+}
+
+int HardwareSerial::peek() {
+  return HostInput.empty() ? -1 : (uint8_t) HostInput[0];
+}
+
+int HardwareSerial::availableForWrite() {
+  if (HostTransmitEnd <= Clock) {
+    return REPLAY_SERIAL_TX_BUFFER_SIZE - 1;
+  }
+  uint32_t pending = (HostTransmitEnd - Clock + HostByteTime - 1) / HostByteTime;
+  return (pending < REPLAY_SERIAL_TX_BUFFER_SIZE - 1) ? REPLAY_SERIAL_TX_BUFFER_SIZE - 1 - pending : 0;
+}
+
+size_t HardwareSerial::write(uint8_t data) {
+  // the data is not kept - the host output is not part of the comparison
+  HostTransmitEnd = std::max(HostTransmitEnd, Clock) + HostByteTime;
+  uint64_t bufferTime = (uint64_t) (REPLAY_SERIAL_TX_BUFFER_SIZE - 1) * HostByteTime;
+  if (HostTransmitEnd > Clock + bufferTime) {
+    // the buffer is full - write() waits for the next byte to be sent
+    Clock = HostTransmitEnd - bufferTime;
+  }
+  return 1;
+}
+
+void HardwareSerial::flush() {
+  Clock = std::max(Clock, HostTransmitEnd);
+}
+
+SoftwareSerial::SoftwareSerial(uint8_t receivePin, uint8_t transmitPin) {
+}
+
+void SoftwareSerial::begin(long baud) {
+  GrblByteTime = 10000000 / baud;
+}
+
+bool SoftwareSerial::listen() {
+  return false;
+}
+
+int SoftwareSerial::available() {
+  return GrblInput.size();
+}
+
+int SoftwareSerial::read() {
+  if (GrblInput.empty()) {
+    return -1;
+  }
+  uint8_t data = GrblInput[0];
+  GrblInput.erase(0, 1);
+  return data;
+}
+
+int SoftwareSerial::peek() {
+  return GrblInput.empty() ? -1 : (uint8_t) GrblInput[0];
+}
+
+size_t SoftwareSerial::write(uint8_t data) {
+  // the bits are sent with the interrupts disabled
+  GrblOutput += (char) data;
+  Clock += GrblByteTime;
+  return 1;
+}
+
+LiquidCrystal::LiquidCrystal(uint8_t rs, uint8_t enable, uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3) {
+  this->column = 0;
+  this->row = 0;
+}
+
+void LiquidCrystal::begin(uint8_t columns, uint8_t rows) {
+  clear();
+}
+
+void LiquidCrystal::clear() {
+  memset(Lcd, ' ', sizeof(Lcd));
+  LcdChanged = true;
+  home();
+}
+
+void LiquidCrystal::home() {
+  Clock += REPLAY_LCD_CLEAR_TIME;
+  this->column = 0;
+  this->row = 0;
+}
+
+void LiquidCrystal::setCursor(uint8_t column, uint8_t row) {
+  Clock += REPLAY_LCD_WRITE_TIME;
+  this->column = column;
+  this->row = row;
+}
+
+void LiquidCrystal::createChar(uint8_t location, uint8_t charmap[]) {
+  Clock += 9 * REPLAY_LCD_WRITE_TIME;
+}
+
+size_t LiquidCrystal::write(uint8_t value) {
+  Clock += REPLAY_LCD_WRITE_TIME;
+  if ((this->row < LIQUID_CRYSTAL_ROWS) && (this->column < LIQUID_CRYSTAL_COLUMNS)) {
+    // the custom characters are shown as '#'
+    Lcd[this->row][this->column] = ((value < 0x20) || (value >= 0x7F)) ? '#' : value;
+    LcdChanged = true;
+  }
+  this->column++;
+  return 1;
+}
+
+Encoder::Encoder(uint8_t pin1, uint8_t pin2) {
+}
+
+int32_t Encoder::read() {
+  return EncoderPosition;
+}
+
+EEPROMClass EEPROM;
+
+static uint8_t * eepromData() {
+  static uint8_t * data = NULL;
+  if (data == NULL) {
+    // an erased EEPROM
+    data = (uint8_t *) malloc(REPLAY_EEPROM_SIZE);
+    memset(data, 0xFF, REPLAY_EEPROM_SIZE);
+  }
+  return data;
+}
+
+uint8_t EEPROMClass::read(int address) {
+  return eepromData()[address % REPLAY_EEPROM_SIZE];
+}
+
+void EEPROMClass::write(int address, uint8_t value) {
+  eepromData()[address % REPLAY_EEPROM_SIZE] = value;
+}
+
+// -----------------------------------------------------------------------------
+//   SIMULATED SD CARD
+// -----------------------------------------------------------------------------
+
+static void accessBlock(int32_t file, uint32_t block) {
+  if ((file != CachedFile) || (block != CachedBlock)) {
+    Clock += REPLAY_CARD_BLOCK_TIME;
+    CachedFile = file;
+    CachedBlock = block;
+  }
+}
+
+static int16_t findFile(const char * path) {
+  if (*path == '/') {
+    path++;
+  }
+  for (size_t i = 0; i < Card.size(); i++) {
+    if (!Card[i].removed && (strcasecmp(Card[i].name.c_str(), path) == 0)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool Sd2Card::readBlock(uint32_t block, uint8_t * data) {
+  // each file occupies a range of 65536 blocks (see FatFile::contiguousRange())
+  uint32_t file = (block >> 16) - 1;
+  if (file >= Card.size()) {
+    return false;
+  }
+  std::vector<uint8_t> & content = Card[file].data;
+  uint32_t offset = (block & 0xFFFF) * 512;
+  accessBlock(-1, block);
+  for (uint16_t i = 0; i < 512; i++) {
+    data[i] = (offset + i < content.size()) ? content[offset + i] : 0;
+  }
+  return true;
+}
+
+bool Sd2Card::writeBlock(uint32_t block, const uint8_t * data) {
+  uint32_t file = (block >> 16) - 1;
+  if (file >= Card.size()) {
+    return false;
+  }
+  std::vector<uint8_t> & content = Card[file].data;
+  uint32_t offset = (block & 0xFFFF) * 512;
+  accessBlock(-1, block);
+  if (content.size() < offset + 512) {
+    content.resize(offset + 512);
+  }
+  memcpy(&content[offset], data, 512);
+  return true;
+}
+
+FatFile::FatFile() {
+  this->index = -1;
+  this->position = 0;
+  this->flags = 0;
+}
+
+bool FatFile::open(const char * path, uint8_t flags) {
+  if (isOpen()) {
+    return false;
+  }
+  int16_t index = findFile(path);
+  if ((index < 0) && ((flags & O_CREAT) != 0)) {
+    CardFile file = { path, std::vector<uint8_t>(), 0, 0, false };
+    for (size_t i = 0; i < file.name.size(); i++) {
+      file.name[i] = toupper(file.name[i]);
+    }
+    Card.push_back(file);
+    index = Card.size() - 1;
+  }
+  if (index < 0) {
+    return false;
+  }
+  accessBlock(-2, index / 16);
+  this->index = index;
+  this->position = 0;
+  this->flags = flags;
+  if ((flags & O_TRUNC) != 0) {
+    Card[index].data.clear();
+  }
+  return true;
+}
+
+bool FatFile::open(FatFile * directory, uint16_t index, uint8_t flags) {
+  if (isOpen() || (index >= Card.size()) || Card[index].removed) {
+    return false;
+  }
+  accessBlock(-2, index / 16);
+  this->index = index;
+  this->position = 0;
+  this->flags = flags;
+  return true;
+}
+
+bool FatFile::openNext(FatFile * directory, uint8_t flags) {
+  while (directory->position < Card.size()) {
+    uint16_t index = directory->position++;
+    if (!Card[index].removed) {
+      return open(directory, index, flags);
+    }
+  }
+  return false;
+}
+
+bool FatFile::close() {
+  this->index = -1;
+  return true;
+}
+
+bool FatFile::isOpen() const {
+  return (this->index != -1);
+}
+
+bool FatFile::isFile() const {
+  return (this->index >= 0);
+}
+
+bool FatFile::isHidden() const {
+  return false;
+}
+
+int FatFile::read() {
+  uint8_t data;
+  return (read(&data, 1) == 1) ? data : -1;
+}
+
+int FatFile::read(void * data, size_t length) {
+  if (!isFile() || ((this->flags & O_READ) == 0)) {
+    return -1;
+  }
+  const std::vector<uint8_t> & content = Card[this->index].data;
+  size_t count = 0;
+  while ((count < length) && (this->position < content.size())) {
+    accessBlock(this->index, this->position / 512);
+    ((uint8_t *) data)[count++] = content[this->position++];
+  }
+  return count;
+}
+
+size_t FatFile::write(const void * data, size_t length) {
+  if (!isFile() || ((this->flags & O_WRITE) == 0)) {
+    return 0;
+  }
+  std::vector<uint8_t> & content = Card[this->index].data;
+  for (size_t i = 0; i < length; i++) {
+    accessBlock(this->index, this->position / 512);
+    if (this->position == content.size()) {
+      content.push_back(0);
+    }
+    content[this->position++] = ((const uint8_t *) data)[i];
+  }
+  return length;
+}
+
+bool FatFile::seekSet(uint32_t position) {
+  if (!isOpen() || (isFile() && (position > Card[this->index].data.size()))) {
+    return false;
+  }
+  this->position = position;
+  return true;
+}
+
+uint32_t FatFile::curPosition() const {
+  return this->position;
+}
+
+uint32_t FatFile::fileSize() const {
+  return isFile() ? Card[this->index].data.size() : 0;
+}
+
+bool FatFile::rewind() {
+  return seekSet(0);
+}
+
+bool FatFile::sync() {
+  return isOpen();
+}
+
+bool FatFile::truncate(uint32_t length) {
+  if (!isFile() || ((this->flags & O_WRITE) == 0) || (length > Card[this->index].data.size())) {
+    return false;
+  }
+  Card[this->index].data.resize(length);
+  this->position = std::min(this->position, length);
+  return true;
+}
+
+bool FatFile::getSFN(char * name) {
+  if (!isFile()) {
+    return false;
+  }
+  strcpy(name, Card[this->index].name.c_str());
+  return true;
+}
+
+bool FatFile::dirEntry(dir_t * entry) {
+  if (!isFile()) {
+    return false;
+  }
+  const CardFile & file = Card[this->index];
+  memset(entry, 0, sizeof(dir_t));
+  memset(entry->name, ' ', sizeof(entry->name));
+  size_t dot = file.name.find('.');
+  memcpy(entry->name, file.name.data(), std::min(dot, (size_t) 8));
+  if (dot != std::string::npos) {
+    memcpy(&entry->name[8], &file.name[dot + 1], std::min(file.name.size() - dot - 1, (size_t) 3));
+  }
+  entry->attributes = 0x20;
+  entry->firstClusterLow = firstCluster();
+  entry->lastWriteDate = file.date;
+  entry->lastWriteTime = file.time;
+  entry->fileSize = file.data.size();
+  return true;
+}
+
+uint16_t FatFile::dirIndex() {
+  return isFile() ? this->index : 0;
+}
+
+uint32_t FatFile::firstCluster() const {
+  return isFile() ? this->index + 2 : 0;
+}
+
+bool FatFile::getModifyDateTime(uint16_t * date, uint16_t * time) {
+  if (!isFile()) {
+    return false;
+  }
+  *date = Card[this->index].date;
+  *time = Card[this->index].time;
+  return true;
+}
+
+bool FatFile::createContiguous(const char * path, uint32_t size) {
+  if (!open(path, O_RDWR | O_CREAT | O_TRUNC)) {
+    return false;
+  }
+  Card[this->index].data.resize(size);
+  return true;
+}
+
+bool FatFile::contiguousRange(uint32_t * firstBlock, uint32_t * lastBlock) {
+  if (!isFile()) {
+    return false;
+  }
+  *firstBlock = (uint32_t) (this->index + 1) << 16;
+  *lastBlock = *firstBlock + (Card[this->index].data.size() + 511) / 512 - 1;
+  return true;
+}
+
+bool SdFat::begin(uint8_t csPin, uint8_t speed) {
+  return true;
+}
+
+bool SdFat::remove(const char * path) {
+  int16_t index = findFile(path);
+  if (index < 0) {
+    return false;
+  }
+  Card[index].removed = true;
+  Card[index].data.clear();
+  return true;
+}
+
+Sd2Card * SdFat::card() {
+  static Sd2Card card;
+  return &card;
+}
+
+FatFile * SdFat::vwd() {
+  static FatFile root;
+  root.index = -2;
+  return &root;
+}
+
+/**
+ * Copies the files of the directory given to the simulated card. Only the files with a
+ * valid 8.3 name are copied.
+ */
+static bool loadCard(const char * directoryName) {
+  DIR * directory = opendir(directoryName);
+  if (directory == NULL) {
+    perror(directoryName);
+    return false;
+  }
+  std::vector<std::string> names;
+  struct dirent * entry;
+  while ((entry = readdir(directory)) != NULL) {
+    std::string name = entry->d_name;
+    size_t dot = name.find('.');
+    if ((dot == 0) || (dot > 8) || ((dot == std::string::npos) && (name.size() > 8)) ||
+        ((dot != std::string::npos) && ((name.size() - dot - 1 > 3) || (name.find('.', dot + 1) != std::string::npos)))) {
+      continue;
+    }
+    names.push_back(name);
+  }
+  closedir(directory);
+  std::sort(names.begin(), names.end());
+
+  for (size_t i = 0; i < names.size(); i++) {
+    std::string path = std::string(directoryName) + "/" + names[i];
+    struct stat status;
+    FILE * input = fopen(path.c_str(), "rb");
+    if ((input == NULL) || (stat(path.c_str(), &status) != 0) || !S_ISREG(status.st_mode)) {
+      if (input != NULL) {
+        fclose(input);
+      }
+      continue;
+    }
+    CardFile file = { names[i], std::vector<uint8_t>(status.st_size), 0, 0, false };
+    for (size_t j = 0; j < file.name.size(); j++) {
+      file.name[j] = toupper(file.name[j]);
+    }
+    if ((status.st_size > 0) && (fread(file.data.data(), status.st_size, 1, input) != 1)) {
+      perror(path.c_str());
+      fclose(input);
+      return false;
+    }
+    fclose(input);
+    struct tm * modified = localtime(&status.st_mtime);
+    file.date = ((modified->tm_year - 80) << 9) | ((modified->tm_mon + 1) << 5) | modified->tm_mday;
+    file.time = (modified->tm_hour << 11) | (modified->tm_min << 5) | (modified->tm_sec / 2);
+    Card.push_back(file);
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+//   REPLAY
+// -----------------------------------------------------------------------------
+
+/**
+ * A change of the user controls, due at the given time in us.
+ */
+struct Input {
+  uint64_t time;
+  int keypad;
+  int button;
+  int32_t encoderSteps;
+};
+
+static std::deque<Input> Inputs;
+
+/**
+ * The time at which the user controls are free for the next event.
+ */
+static uint64_t InputEnd = 0;
+
+static void usage() {
+  fprintf(stderr, "usage: mrktreplay [-r <run>] [-d <directory>] [-l <us>] [-v] [<MRKTTRC.DAT>]\n");
+  exit(2);
+}
+
+/**
+ * Queues a change of the user controls and keeps it until the controls have been polled.
+ */
+static void addInput(int keypad, int button, int32_t encoderSteps) {
+  Input input = { InputEnd, keypad, button, encoderSteps };
+  Inputs.push_back(input);
+  InputEnd += 2 * USER_CONTROLS_POLL_INTERVAL * 1000;
+}
+
+/**
+ * Enters the user control event or key combination recorded by pressing and releasing the
+ * buttons or turning the encoder (see UserControls).
+ */
+static void enterEvent(const Record & record) {
+  static const int KeypadValues[] = {
+    REPLAY_RELEASED, REPLAY_KEYPAD_LEFT, REPLAY_KEYPAD_RIGHT, REPLAY_KEYPAD_UP, REPLAY_KEYPAD_DOWN,
+    REPLAY_KEYPAD_SELECT
+  };
+  uint8_t eventType = record.data[0];
+  int8_t data = (record.data.size() > 1) ? record.data[1] : 0;
+  InputEnd = std::max(InputEnd, Clock);
+  if (record.type == TRACE_COMBINATION) {
+    if ((eventType >= UserControls::KeyLeft) && (eventType <= UserControls::KeySelect)) {
+      addInput(REPLAY_RELEASED, REPLAY_BUTTON_MODE, 0);
+      addInput(KeypadValues[eventType], REPLAY_BUTTON_MODE, 0);
+      addInput(REPLAY_RELEASED, REPLAY_BUTTON_MODE, 0);
+      addInput(REPLAY_RELEASED, REPLAY_RELEASED, 0);
+    }
+    return;
+  }
+  if (eventType == UserControls::EncChanged) {
+#if RE_INVERT_DIRECTION == 1
+    addInput(REPLAY_RELEASED, REPLAY_RELEASED, -data);
+#else
+    addInput(REPLAY_RELEASED, REPLAY_RELEASED, data);
+#endif
+    return;
+  }
+  // the repetitions are entered one by one
+  for (int8_t i = 0; i < std::max(data, (int8_t) 1); i++) {
+    if ((eventType >= UserControls::KeyLeft) && (eventType <= UserControls::KeySelect)) {
+      addInput(KeypadValues[eventType], REPLAY_RELEASED, 0);
+    } else if (eventType == UserControls::EncButton) {
+      addInput(REPLAY_RELEASED, REPLAY_BUTTON_ENCODER, 0);
+    } else if (eventType == UserControls::ModeButton) {
+      addInput(REPLAY_RELEASED, REPLAY_BUTTON_MODE, 0);
+    } else {
+      return;
+    }
+    addInput(REPLAY_RELEASED, REPLAY_RELEASED, 0);
+  }
+}
+
+static void applyInputs() {
+  while (!Inputs.empty() && (Inputs.front().time <= Clock)) {
+    KeypadValue = Inputs.front().keypad;
+    ButtonValue = Inputs.front().button;
+    EncoderPosition += Inputs.front().encoderSteps * RE_STEP_SIZE;
+    Inputs.pop_front();
+  }
+}
+
+static void printDisplay() {
+  static std::string shown;
+  std::string rows;
+  for (uint8_t row = 0; row < LIQUID_CRYSTAL_ROWS; row++) {
+    std::string text(Lcd[row], LIQUID_CRYSTAL_COLUMNS);
+    text.erase(text.find_last_not_of(' ') + 1);
+    rows += "|" + text;
+  }
+  rows.erase(rows.find_last_not_of('|') + 1);
+  if (rows != shown) {
+    printf("%10.3f display %s|\n", Clock / 1000000.0, rows.c_str());
+    shown = rows;
+  }
+  LcdChanged = false;
+}
+
+static int replay(const std::vector<Record> & records, uint32_t loopTime, bool verbose) {
+  std::string recordedData;
+  bool synchronized = true;
+  uint64_t stallTime = 0;
+  uint64_t endTime = records.empty() ? 0 : (uint64_t) (records.back().time + REPLAY_FINISH_TIME) * 1000;
+  size_t next = 0;
+  setup();
+  while ((next < records.size()) || !Inputs.empty() || (Clock < endTime)) {
+    while (next < records.size()) {
+      const Record & record = records[next];
+      if (record.type == TRACE_GRBL_TX) {
+        recordedData += record.data;
+        next++;
+        continue;
+      }
+      if ((record.type != TRACE_GRBL_RX) && (record.type != TRACE_HOST_RX) &&
+          (record.type != TRACE_EVENT) && (record.type != TRACE_COMBINATION)) {
+        next++;
+        continue;
+      }
+      // the events are entered ahead of time because they are recorded when they are taken
+      bool event = (record.type == TRACE_EVENT) || (record.type == TRACE_COMBINATION);
+      uint64_t due = (uint64_t) record.time * 1000;
+      if (event) {
+        due -= std::min(due, (uint64_t) USER_CONTROLS_POLL_INTERVAL * 1000);
+      }
+      if (Clock < due) {
+        break;
+      }
+      if (synchronized && (GrblOutput.size() < recordedData.size())) {
+        if (stallTime == 0) {
+          stallTime = Clock;
+        }
+        if (Clock - stallTime <= (uint64_t) REPLAY_STALL_TIMEOUT * 1000) {
+          break;
+        }
+        // the firmware has taken another course, the rest is replayed by time only
+        printf("%10.3f the firmware has sent %zu of %zu bytes to Grbl - continuing by time\n",
+               Clock / 1000000.0, GrblOutput.size(), recordedData.size());
+        synchronized = false;
+      }
+      stallTime = 0;
+      if (record.type == TRACE_GRBL_RX) {
+        GrblInput += record.data;
+      } else if (record.type == TRACE_HOST_RX) {
+        HostInput += record.data;
+      } else {
+        Record entered = record;
+        entered.time = Clock / 1000;
+        printEvent(entered);
+        enterEvent(record);
+      }
+      next++;
+    }
+    applyInputs();
+    loop();
+    Clock += loopTime;
+    if (verbose && LcdChanged) {
+      printDisplay();
+    }
+  }
+
+  size_t position = 0;
+  while ((position < recordedData.size()) && (position < GrblOutput.size()) &&
+         (recordedData[position] == GrblOutput[position])) {
+    position++;
+  }
+  if ((position == recordedData.size()) && (position == GrblOutput.size())) {
+    printf("the %zu bytes sent to Grbl match the recording\n", recordedData.size());
+    return 0;
+  }
+  size_t context = (position > 20) ? position - 20 : 0;
+  printf("the bytes sent to Grbl differ at byte %zu of %zu (%zu replayed)\n",
+         position, recordedData.size(), GrblOutput.size());
+  printf("  recorded: %s\n", escape(recordedData.substr(context, 60)).c_str());
+  printf("  replayed: %s\n", escape(GrblOutput.substr(std::min(context, GrblOutput.size()), 60)).c_str());
+  return 1;
+}
+
+int main(int argc, char ** argv) {
+  const char * fileName = TRACE_FILE_NAME;
+  const char * directoryName = NULL;
+  uint32_t loopTime = 200;
+  bool verbose = false;
+  long run = -1;
+  for (int i = 1; i < argc; i++) {
+    if ((strcmp(argv[i], "-r") == 0) && (i + 1 < argc)) {
+      run = atol(argv[++i]);
+    } else if ((strcmp(argv[i], "-d") == 0) && (i + 1 < argc)) {
+      directoryName = argv[++i];
+    } else if ((strcmp(argv[i], "-l") == 0) && (i + 1 < argc)) {
+      loopTime = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-v") == 0) {
+      verbose = true;
+    } else if (argv[i][0] == '-') {
+      usage();
+    } else {
+      fileName = argv[i];
+    }
+  }
+
+  std::vector<Record> records;
+  if (!readTrace(fileName, run, records)) {
+    return 1;
+  }
+  std::string directory = fileName;
+  size_t slash = directory.rfind('/');
+  directory = (slash == std::string::npos) ? "." : directory.substr(0, slash + 1);
+  if (!loadCard((directoryName != NULL) ? directoryName : directory.c_str())) {
+    return 1;
+  }
+  return replay(records, loopTime, verbose);
+}
@@ -0,0 +1,397 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+
+// mrktstr - the Mrkt string table generator
+//
+// This host tool converts the texts displayed on the LCD (src/Mrkt/Strings.txt) into the
+// string table of the firmware (src/Mrkt/StringTable.h and StringTable.cpp), which is 
+// decoded by Display::writeString() while the text is written to the display. The table
+// is smaller than the individual F("...") literals it replaces:
+//
+//   - the texts are stored without padding, which is generated by the decoder,
+//   - substrings that occur several times (like "Lat " or "mm") are replaced by a single
+//     byte that refers to a dictionary of up to STRING_TABLE_MAX_WORDS words,
+//   - the texts and the words are stored one after the other without a table of offsets;
+//     the decoder locates a text by skipping the texts before it, starting from the
+//     nearest of the anchors stored for every STRING_TABLE_ANCHOR_INTERVAL-th text.
+//
+// Without the offsets, identical texts cannot be stored only once, but a table of offsets
+// would take more space than these duplicates.
+//
+// The generated files are part of the source tree so that the firmware can be built with
+// the Arduino IDE alone; run this tool whenever Strings.txt has been changed.
+//
+// Build:  g++ -O2 -o mrktstr mrktstr.cpp
+// Usage:  mrktstr <Strings.txt> <output directory>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/**
+ * The first code that refers to a dictionary word - the texts are restricted to printable
+ * ASCII characters below this code.
+ */
+#define STRING_TABLE_FIRST_WORD   0x80
+
+/**
+ * The maximum number of dictionary words.
+ */
+#define STRING_TABLE_MAX_WORDS     (256 - STRING_TABLE_FIRST_WORD)
+
+/**
+ * The longest word considered for the dictionary.
+ */
+#define STRING_TABLE_MAX_WORD_LENGTH 16
+
+/**
+ * The number of texts per anchor - a power of two so that the decoder can use shifts.
+ */
+#define STRING_TABLE_ANCHOR_INTERVAL 16
+
+/**
+ * The license header of the generated files.
+ */
+static const char * License = 
+  "/*\n"
+  " *  This file is part of Mrkt, a hardware frontend for Grbl.\n"
+  " *\n"
+  " *  Mrkt is free software: you can redistribute it and/or modify\n"
+  " *  it under the terms of the GNU General Public License as published by\n"
+  " *  the Free Software Foundation, either version 3 of the License, or\n"
+  " *  (at your option) any later version.\n"
+  " *\n"
+  " *  Foobar is distributed in the hope that it will be useful,\n"
+  " *  but WITHOUT ANY WARRANTY; without even the implied warranty of\n"
+  " *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the\n"
+  " *  GNU General Public License for more details.\n"
+  " *\n"
+  " *  You should have received a copy of the GNU General Public License\n"
+  " *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.\n"
+  " *  \n"
+  " */ \n";
+
+/**
+ * A string as defined in Strings.txt.
+ */
+struct Definition {
+  std::string name;
+  std::string text;
+};
+
+/**
+ * A text as a sequence of codes: characters below STRING_TABLE_FIRST_WORD and dictionary words.
+ */
+typedef std::vector<int> Codes;
+
+/**
+ * Reads the definitions. Returns false (after printing a message) if the file is invalid.
+ */
+static bool readDefinitions(const char * fileName, std::vector<Definition> & definitions) {
+  FILE * file = fopen(fileName, "r");
+  if (file == NULL) {
+    perror(fileName);
+    return false;
+  }
+  char line[256];
+  int lineNumber = 0;
+  bool valid = true;
+  while (fgets(line, sizeof(line), file) != NULL) {
+    lineNumber++;
+    char * start = line + strspn(line, " \t");
+    if ((*start == '#') || (*start == '\n') || (*start == '\r') || (*start == '\0')) {
+      continue;
+    }
+    Definition definition;
+    size_t nameLength = strcspn(start, " \t\"");
+    definition.name.assign(start, nameLength);
+    char * text = strchr(start + nameLength, '"');
+    char * end = (text != NULL) ? strrchr(text + 1, '"') : NULL;
+    if ((nameLength == 0) || (end == NULL)) {
+      fprintf(stderr, "%s:%d: expected NAME \"text\"\n", fileName, lineNumber);
+      valid = false;
+      continue;
+    }
+    for (char * c = text + 1; c < end; c++) {
+      if ((*c == '\\') && (c + 1 < end)) {
+        c++;
+      }
+      if ((*c < ' ') || (*c >= STRING_TABLE_FIRST_WORD - 1)) {
+        fprintf(stderr, "%s:%d: only printable ASCII characters are allowed\n", fileName, lineNumber);
+        valid = false;
+      }
+      definition.text += *c;
+    }
+    for (size_t i = 0; i < definitions.size(); i++) {
+      if (definitions[i].name == definition.name) {
+        fprintf(stderr, "%s:%d: duplicate name %s\n", fileName, lineNumber, definition.name.c_str());
+        valid = false;
+      }
+    }
+    definitions.push_back(definition);
+  }
+  fclose(file);
+  if (definitions.empty() || (definitions.size() > 255)) {
+    fprintf(stderr, "%s: 1 to 255 strings have to be defined\n", fileName);
+    valid = false;
+  }
+  return valid;
+}
+
+/**
+ * Counts the non-overlapping occurrences of a word in the texts.
+ */
+static int countOccurrences(const std::vector<Codes> & texts, const Codes & word) {
+  int count = 0;
+  for (size_t t = 0; t < texts.size(); t++) {
+    const Codes & text = texts[t];
+    for (size_t i = 0; i + word.size() <= text.size();) {
+      if (std::equal(word.begin(), word.end(), text.begin() + i)) {
+        count++;
+        i += word.size();
+      } else {
+        i++;
+      }
+    }
+  }
+  return count;
+}
+
+/**
+ * Replaces the occurrences of a word in the texts by its code.
+ */
+static void replaceOccurrences(std::vector<Codes> & texts, const Codes & word, int code) {
+  for (size_t t = 0; t < texts.size(); t++) {
+    Codes replaced;
+    const Codes & text = texts[t];
+    for (size_t i = 0; i < text.size();) {
+      if ((i + word.size() <= text.size()) && std::equal(word.begin(), word.end(), text.begin() + i)) {
+        replaced.push_back(code);
+        i += word.size();
+      } else {
+        replaced.push_back(text[i]);
+        i++;
+      }
+    }
+    texts[t] = replaced;
+  }
+}
+
+/**
+ * Builds the dictionary: the word that saves the most bytes is added until no word saves 
+ * anything any more. A word occupies its characters, and each occurrence saves all but
+ * one byte.
+ */
+static void buildDictionary(std::vector<Codes> & texts, std::vector<Codes> & words) {
+  while (words.size() < STRING_TABLE_MAX_WORDS) {
+    Codes best;
+    int bestGain = 0;
+    for (size_t t = 0; t < texts.size(); t++) {
+      const Codes & text = texts[t];
+      for (size_t start = 0; start < text.size(); start++) {
+        for (size_t length = 1; (length <= STRING_TABLE_MAX_WORD_LENGTH) && (start + length <= text.size()); length++) {
+          if (text[start + length - 1] >= STRING_TABLE_FIRST_WORD) {
+            // words do not contain other words
+            break;
+          }
+          if (length < 2) {
+            continue;
+          }
+          Codes word(text.begin() + start, text.begin() + start + length);
+          int gain = countOccurrences(texts, word) * ((int) length - 1) - (int) length;
+          if ((gain > bestGain) || ((gain == bestGain) && (gain > 0) && (word < best))) {
+            best = word;
+            bestGain = gain;
+          }
+        }
+      }
+    }
+    if (bestGain <= 0) {
+      break;
+    }
+    replaceOccurrences(texts, best, STRING_TABLE_FIRST_WORD + (int) words.size());
+    words.push_back(best);
+  }
+}
+
+/**
+ * Returns a text in a form that can be placed in a C comment.
+ */
+static std::string quote(const std::string & text) {
+  std::string result = "\"";
+  for (size_t i = 0; i < text.size(); i++) {
+    if ((text[i] == '*') && (i + 1 < text.size()) && (text[i + 1] == '/')) {
+      result += "*\\";
+    } else {
+      result += text[i];
+    }
+  }
+  return result + "\"";
+}
+
+/**
+ * Writes the bytes of a code sequence as an initializer list.
+ */
+static void writeBytes(FILE * file, const Codes & codes, bool terminated) {
+  fprintf(file, " ");
+  for (size_t i = 0; i < codes.size(); i++) {
+    if (codes[i] >= STRING_TABLE_FIRST_WORD) {
+      fprintf(file, " 0x%02X,", codes[i]);
+    } else if ((codes[i] == '\'') || (codes[i] == '\\')) {
+      fprintf(file, " '\\%c',", codes[i]);
+    } else {
+      fprintf(file, " '%c',", codes[i]);
+    }
+  }
+  if (terminated) {
+    fprintf(file, " 0,");
+  }
+}
+
+static void usage() {
+  fprintf(stderr, "usage: mrktstr <Strings.txt> <output directory>\n");
+  exit(2);
+}
+
+int main(int argc, char ** argv) {
+  if (argc != 3) {
+    usage();
+  }
+  std::vector<Definition> definitions;
+  if (!readDefinitions(argv[1], definitions)) {
+    return 1;
+  }
+
+  size_t plainSize = 0;
+  std::vector<Codes> texts;
+  for (size_t i = 0; i < definitions.size(); i++) {
+    plainSize += definitions[i].text.size() + 1;
+    texts.push_back(Codes(definitions[i].text.begin(), definitions[i].text.end()));
+  }
+
+  std::vector<Codes> words;
+  buildDictionary(texts, words);
+
+  // the texts are stored in the order of their definition
+  std::vector<size_t> anchors;
+  size_t dataSize = 0;
+  for (size_t i = 0; i < texts.size(); i++) {
+    if (i % STRING_TABLE_ANCHOR_INTERVAL == 0) {
+      anchors.push_back(dataSize);
+    }
+    dataSize += texts[i].size() + 1;
+  }
+  if (dataSize > 0xFFFF) {
+    fprintf(stderr, "mrktstr: the texts exceed 64 KB\n");
+    return 1;
+  }
+  size_t dictionarySize = 0;
+  for (size_t w = 0; w < words.size(); w++) {
+    dictionarySize += words[w].size();
+  }
+
+  // the header with the names of the strings
+  std::string headerName = std::string(argv[2]) + "/StringTable.h";
+  FILE * header = fopen(headerName.c_str(), "w");
+  if (header == NULL) {
+    perror(headerName.c_str());
+    return 1;
+  }
+  fprintf(header, "%s", License);
+  fprintf(header, "\n// This file is generated by tools/mrktstr from Strings.txt - do not edit it.\n\n");
+  fprintf(header, "#ifndef MRKT_StringTable_h\n#define MRKT_StringTable_h\n\n");
+  fprintf(header, "#include <inttypes.h>\n#include <avr/pgmspace.h>\n\n");
+  fprintf(header, "/**\n * The strings (see Strings.txt and Display::writeString()).\n */\n");
+  for (size_t i = 0; i < definitions.size(); i++) {
+    fprintf(header, "#define STRING_%-24s %3zu\n", definitions[i].name.c_str(), i);
+  }
+  fprintf(header, "#define STRING_%-24s %3zu\n\n", "COUNT", definitions.size());
+  fprintf(header, "/**\n"
+                  " * The first code that refers to a word of the dictionary. The texts consist of the\n"
+                  " * characters below this code and words, and they are terminated with a \\0. The words\n"
+                  " * are stored one after the other, the last character of each word has the highest bit set.\n"
+                  " */\n");
+  fprintf(header, "#define STRING_TABLE_FIRST_WORD 0x%02X\n\n", STRING_TABLE_FIRST_WORD);
+  fprintf(header, "/**\n"
+                  " * The texts are stored one after the other - StringTable_Anchors holds the offset of\n"
+                  " * every STRING_TABLE_ANCHOR_INTERVAL-th text within StringTable_Data.\n"
+                  " */\n");
+  fprintf(header, "#define STRING_TABLE_ANCHOR_INTERVAL %d\n\n", STRING_TABLE_ANCHOR_INTERVAL);
+  fprintf(header, "/**\n"
+                  " * The anchors, the dictionary and the texts.\n"
+                  " */\n");
+  fprintf(header, "extern const uint16_t StringTable_Anchors[] PROGMEM;\n");
+  fprintf(header, "extern const uint8_t StringTable_Words[] PROGMEM;\n");
+  fprintf(header, "extern const uint8_t StringTable_Data[] PROGMEM;\n\n");
+  fprintf(header, "#endif\n");
+  fclose(header);
+
+  // the tables
+  std::string sourceName = std::string(argv[2]) + "/StringTable.cpp";
+  FILE * source = fopen(sourceName.c_str(), "w");
+  if (source == NULL) {
+    perror(sourceName.c_str());
+    return 1;
+  }
+  fprintf(source, "%s", License);
+  fprintf(source, "\n// This file is generated by tools/mrktstr from Strings.txt - do not edit it.\n");
+  fprintf(source, "// %zu strings (%zu bytes of text): %zu bytes of anchors, %zu bytes of dictionary, %zu bytes of data.\n\n", 
+          definitions.size(), plainSize, 2 * anchors.size(), dictionarySize, dataSize);
+  fprintf(source, "#include <inttypes.h>\n#include \"Arduino.h\"\n\n#include \"StringTable.h\"\n\n");
+
+  fprintf(source, "const uint16_t StringTable_Anchors[] PROGMEM = {\n");
+  for (size_t a = 0; a < anchors.size(); a++) {
+    fprintf(source, "  %4zu%s // STRING_%s\n", anchors[a], (a + 1 < anchors.size()) ? "," : " ", 
+            definitions[a * STRING_TABLE_ANCHOR_INTERVAL].name.c_str());
+  }
+  fprintf(source, "};\n\n");
+
+  fprintf(source, "const uint8_t StringTable_Words[] PROGMEM = {\n");
+  for (size_t w = 0; w < words.size(); w++) {
+    Codes word = words[w];
+    fprintf(source, " ");
+    for (size_t i = 0; i < word.size(); i++) {
+      if (i + 1 == word.size()) {
+        fprintf(source, " 0x%02X%s", word[i] | 0x80, (w + 1 < words.size()) ? "," : " ");
+      } else {
+        writeBytes(source, Codes(1, word[i]), false);
+      }
+    }
+    fprintf(source, " // 0x%02X %s\n", (unsigned) (STRING_TABLE_FIRST_WORD + w), 
+            quote(std::string(word.begin(), word.end())).c_str());
+  }
+  if (words.empty()) {
+    fprintf(source, "  0\n");
+  }
+  fprintf(source, "};\n\n");
+
+  fprintf(source, "const uint8_t StringTable_Data[] PROGMEM = {\n");
+  for (size_t i = 0; i < texts.size(); i++) {
+    writeBytes(source, texts[i], true);
+    fprintf(source, " // %s\n", quote(definitions[i].text).c_str());
+  }
+  fprintf(source, "};\n");
+  fclose(source);
+
+  printf("%zu strings (%zu bytes of text): %zu bytes of anchors, %zu words in %zu bytes of dictionary, "
+         "%zu bytes of data\n", definitions.size(), plainSize, 2 * anchors.size(), words.size(), 
+         dictionarySize, dataSize);
+  return 0;
+}
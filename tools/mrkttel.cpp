@@ -0,0 +1,287 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+
+// mrkttel - the Mrkt telemetry decoder
+//
+// This host tool enables the binary telemetry of the pendant (host command TELE, see 
+// src/Mrkt/Telemetry.h) and prints the decoded frames, one line per frame. The frames are
+// separated from the output of the Grbl system and the replies of Mrkt as described in 
+// src/Mrkt/HostChannel.h, so the tool can also be used while a sender program on the same 
+// connection streams in passthrough mode.
+//
+// Build:  g++ -O2 -I../src/Mrkt -o mrkttel mrkttel.cpp
+// Usage:  mrkttel [-p <port>] [-b <baud>] [-r <rate>] [-c <count>] [-g] [-n]
+//
+//   -p   the serial port (default: /dev/ttyUSB0)
+//   -b   the baud rate, see HOST_SERIAL_SPEED (default: 57600)
+//   -r   the number of frames per second (default: 20)
+//   -c   stop after the given number of frames (default: run until interrupted)
+//   -g   print the output of the Grbl system as well
+//   -n   do not wait for the board to restart after the port has been opened
+//
+// Output columns: sequence, time (s), state, alarm, machine position X Y Z (mm), work 
+// offset X Y Z (mm), feed rate, spindle speed, overrides, buffered bytes and lines, status 
+// reports, commands, errors, timeouts, average latency (ms), loop iterations, longest 
+// loop iteration (µs). Lost and damaged frames are reported on stderr.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <termios.h>
+#include <unistd.h>
+#include <string>
+
+#include "TelemetryFrame.h"
+
+// the escape character, see src/Mrkt/HostChannel.h
+#define ESCAPE  0xFE
+
+static const char * StateNames[] = {
+  "?", "Idle", "Run", "Hold", "Jog", "Alarm", "Door", "Check", "Home", "Sleep"
+};
+
+static int port = -1;
+static volatile bool stopped = false;
+
+static void usage() {
+  fprintf(stderr, "usage: mrkttel [-p <port>] [-b <baud>] [-r <rate>] [-c <count>] [-g] [-n]\n");
+  exit(2);
+}
+
+static void stop(int) {
+  stopped = true;
+}
+
+static bool openPort(const char * name, int baud) {
+  speed_t speed;
+  switch (baud) {
+    case 9600:   speed = B9600;   break;
+    case 19200:  speed = B19200;  break;
+    case 38400:  speed = B38400;  break;
+    case 57600:  speed = B57600;  break;
+    case 115200: speed = B115200; break;
+    default:
+      fprintf(stderr, "unsupported baud rate %d\n", baud);
+      return false;
+  }
+  port = open(name, O_RDWR | O_NOCTTY);
+  if (port < 0) {
+    perror(name);
+    return false;
+  }
+  struct termios settings;
+  if (tcgetattr(port, &settings) != 0) {
+    perror(name);
+    return false;
+  }
+  cfmakeraw(&settings);
+  cfsetispeed(&settings, speed);
+  cfsetospeed(&settings, speed);
+  settings.c_cflag |= CLOCAL | CREAD;
+  settings.c_cc[VMIN] = 0;
+  settings.c_cc[VTIME] = 0;
+  if (tcsetattr(port, TCSANOW, &settings) != 0) {
+    perror(name);
+    return false;
+  }
+  return true;
+}
+
+static void sendCommand(const char * command) {
+  std::string line;
+  line += (char) ESCAPE;
+  line += command;
+  line += '\n';
+  if (write(port, line.data(), line.size()) != (ssize_t) line.size()) {
+    perror("write");
+    exit(1);
+  }
+}
+
+/**
+ * Reads a single byte, returns -1 if nothing has been received within the timeout (in ms).
+ * Exits if the connection has been closed.
+ */
+static int readByte(int timeout) {
+  fd_set set;
+  FD_ZERO(&set);
+  FD_SET(port, &set);
+  struct timeval time = { timeout / 1000, (timeout % 1000) * 1000 };
+  if (select(port + 1, &set, NULL, NULL, &time) <= 0) {
+    return -1;
+  }
+  uint8_t data;
+  if (read(port, &data, 1) != 1) {
+    if (stopped || (errno == EINTR)) {
+      return -1;
+    }
+    fprintf(stderr, "connection closed\n");
+    exit(1);
+  }
+  return data;
+}
+
+static uint16_t crc16(uint16_t crc, uint8_t data) {
+  // CRC-16/XMODEM, see _crc_xmodem_update() in avr-libc
+  crc ^= (uint16_t) data << 8;
+  for (int i = 0; i < 8; i++) {
+    crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+static void printMillimeters(int32_t value) {
+  printf(" %s%d.%03d", (value < 0) ? "-" : "", abs(value) / 1000, abs(value) % 1000);
+}
+
+static void printFrame(const TelemetryFrame & frame) {
+  printf("%5u %9.3f %-5s %2u", frame.sequence, frame.time / 1000.0,
+         StateNames[(frame.state <= TELEMETRY_STATE_SLEEP) ? frame.state : 0], frame.alarm);
+  for (int axis = 0; axis < 3; axis++) {
+    printMillimeters(frame.position[axis]);
+  }
+  for (int axis = 0; axis < 3; axis++) {
+    printMillimeters(frame.workOffset[axis]);
+  }
+  printf(" %5u %5u %3u/%3u/%3u %3u %2u %5u %5u %5u %5u %4u %5u %5u\n", 
+         frame.feedRate, frame.spindleSpeed, 
+         frame.overrides[0], frame.overrides[1], frame.overrides[2],
+         frame.bufferBytes, frame.bufferLines, frame.statusReports, frame.commandsSent, 
+         frame.errorCount, frame.timeoutCount, frame.averageLatency, 
+         frame.loopCount, frame.loopTimeMax);
+  fflush(stdout);
+}
+
+int main(int argc, char ** argv) {
+  const char * portName = "/dev/ttyUSB0";
+  int baud = 57600;
+  int rate = 20;
+  long count = -1;
+  bool grblOutput = false;
+  bool wait = true;
+  for (int i = 1; i < argc; i++) {
+    if ((strcmp(argv[i], "-p") == 0) && (i + 1 < argc)) {
+      portName = argv[++i];
+    } else if ((strcmp(argv[i], "-b") == 0) && (i + 1 < argc)) {
+      baud = atoi(argv[++i]);
+    } else if ((strcmp(argv[i], "-r") == 0) && (i + 1 < argc)) {
+      rate = atoi(argv[++i]);
+      if (rate <= 0) {
+        usage();
+      }
+    } else if ((strcmp(argv[i], "-c") == 0) && (i + 1 < argc)) {
+      count = atol(argv[++i]);
+    } else if (strcmp(argv[i], "-g") == 0) {
+      grblOutput = true;
+    } else if (strcmp(argv[i], "-n") == 0) {
+      wait = false;
+    } else {
+      usage();
+    }
+  }
+
+  if (!openPort(portName, baud)) {
+    return 1;
+  }
+  if (wait) {
+    // most boards are reset when the port is opened
+    sleep(2);
+  }
+  tcflush(port, TCIOFLUSH);
+  signal(SIGINT, stop);
+  signal(SIGTERM, stop);
+
+  char command[16];
+  snprintf(command, sizeof(command), "TELE %d", rate);
+  sendCommand(command);
+
+  // the data received is split at the escape characters at the start of a line
+  bool lineStart = true;
+  bool escaped = false;
+  bool sequenceKnown = false;
+  uint16_t nextSequence = 0;
+  std::string line;
+  while (!stopped && (count != 0)) {
+    int data = readByte(1000);
+    if (data < 0) {
+      fprintf(stderr, "no data received\n");
+      continue;
+    }
+    if (lineStart && (data == ESCAPE)) {
+      int marker = readByte(1000);
+      if (marker == TELEMETRY_FRAME_MARKER) {
+        uint8_t buffer[sizeof(TelemetryFrame) + 2];
+        size_t length = 0;
+        while ((length < sizeof(buffer)) && ((data = readByte(1000)) >= 0)) {
+          buffer[length++] = data;
+        }
+        uint16_t crc = 0;
+        for (size_t i = 0; i < sizeof(TelemetryFrame); i++) {
+          crc = crc16(crc, buffer[i]);
+        }
+        TelemetryFrame frame;
+        memcpy(&frame, buffer, sizeof(TelemetryFrame));
+        if ((length < sizeof(buffer)) || 
+            (crc != (buffer[sizeof(TelemetryFrame)] | (buffer[sizeof(TelemetryFrame) + 1] << 8)))) {
+          fprintf(stderr, "damaged frame\n");
+          continue;
+        }
+        if (frame.version != TELEMETRY_FRAME_VERSION) {
+          fprintf(stderr, "unsupported frame version %u\n", frame.version);
+          continue;
+        }
+        if (sequenceKnown && (frame.sequence != nextSequence)) {
+          fprintf(stderr, "%u frame(s) lost\n", (uint16_t) (frame.sequence - nextSequence));
+        }
+        sequenceKnown = true;
+        nextSequence = frame.sequence + 1;
+        printFrame(frame);
+        if (count > 0) {
+          count--;
+        }
+        continue;
+      }
+      // an escaped reply line of Mrkt
+      escaped = true;
+      data = marker;
+      if (data < 0) {
+        continue;
+      }
+    }
+    if ((data == '\n') || (data == '\r')) {
+      if (!line.empty() && (escaped || grblOutput)) {
+        fprintf(stderr, "%s%s\n", escaped ? "mrkt: " : "grbl: ", line.c_str());
+      }
+      line.clear();
+      escaped = false;
+      lineStart = true;
+    } else {
+      line += (char) data;
+      lineStart = false;
+    }
+  }
+
+  sendCommand("TELE 0");
+  close(port);
+  return 0;
+}
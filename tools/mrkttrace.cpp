@@ -0,0 +1,437 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+
+// mrkttrace - the Mrkt trace decoder and replayer
+//
+// This host tool evaluates the trace that Mrkt writes to the SD card if TRACE_ENABLED is
+// set (see src/Mrkt/Trace.h and src/Mrkt/TraceFile.h). Only the most recent run is used
+// unless another one is selected. By default, the bytes exchanged with the host and the
+// Grbl system are printed line by line together with the user control events.
+//
+// With -s, the number of bytes and the throughput per direction and the latency of the
+// Grbl commands (from the end of the line sent to the ok or error received) are printed.
+//
+// With -g, the run is replayed: the tool takes the place of the Grbl system at the serial
+// port given (and of the host if -p is given as well) and sends the bytes recorded at the
+// recorded times, but never before the pendant has sent as many bytes to the Grbl system
+// as it had sent at that point of the recording, so the responses do not overtake the
+// commands. The bytes sent by the pendant are compared to the recording, and the first
+// difference and the latency statistics of both are printed. The user control events can
+// not be injected - they are printed when they are due and have to be entered on the
+// pendant by hand. mrktreplay replays the run including the events on the firmware
+// compiled for the host instead (see tools/mrktreplay.cpp).
+//
+// Build:  g++ -O2 -I../src/Mrkt -o mrkttrace mrkttrace.cpp
+// Usage:  mrkttrace [-r <run>] [-s] [-g <port> [-p <port>] [-b <baud>] [-n]] [<MRKTTRC.DAT>]
+//
+//   -r   the run to evaluate (default: the most recent one)
+//   -s   print statistics instead of the bytes
+//   -g   replay the run with the pendant connected to the serial port given instead of Grbl
+//   -p   the serial port of the host connection of the pendant (default: no host data)
+//   -b   the baud rate, see GRBL_SERIAL_SPEED and HOST_SERIAL_SPEED (default: 57600)
+//   -n   do not wait for the board to restart after the host port has been opened
+//
+// Output columns: time (s), direction (host>, >host, grbl>, >grbl as seen from the
+// pendant) and the bytes, or the user control event. Missing blocks and dropped bytes are
+// reported in the output as well.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <termios.h>
+#include <unistd.h>
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "TraceReader.h"
+
+static const char * DirectionNames[] = {
+  "host>", ">host", "grbl>", ">grbl"
+};
+
+static void usage() {
+  fprintf(stderr, "usage: mrkttrace [-r <run>] [-s] [-g <port> [-p <port>] [-b <baud>] [-n]] [<MRKTTRC.DAT>]\n");
+  exit(2);
+}
+
+static void printRecords(const std::vector<Record> & records) {
+  // the bytes are collected per direction up to the end of the line
+  std::string line[TRACE_GRBL_TX + 1];
+  uint32_t lineTime[TRACE_GRBL_TX + 1];
+  for (size_t i = 0; i < records.size(); i++) {
+    const Record & record = records[i];
+    switch (record.type) {
+      case TRACE_HOST_RX:
+      case TRACE_HOST_TX:
+      case TRACE_GRBL_RX:
+      case TRACE_GRBL_TX:
+        for (size_t j = 0; j < record.data.size(); j++) {
+          if (line[record.type].empty()) {
+            lineTime[record.type] = record.time;
+          }
+          line[record.type] += record.data[j];
+          if (record.data[j] == '\n') {
+            printf("%10.3f %s %s\n", lineTime[record.type] / 1000.0, DirectionNames[record.type],
+                   escape(line[record.type]).c_str());
+            line[record.type].clear();
+          }
+        }
+        break;
+      case TRACE_EVENT:
+      case TRACE_COMBINATION:
+        printEvent(record);
+        break;
+      case TRACE_MISSING:
+        printf("--- %u blocks overwritten or missing\n", record.count);
+        break;
+      case TRACE_DROPPED:
+        printf("--- %u bytes dropped\n", record.count);
+        break;
+      default:
+        printf("%10.3f ? type %u\n", record.time / 1000.0, record.type);
+        break;
+    }
+  }
+  for (int type = TRACE_HOST_RX; type <= TRACE_GRBL_TX; type++) {
+    if (!line[type].empty()) {
+      printf("%10.3f %s %s\n", lineTime[type] / 1000.0, DirectionNames[type], escape(line[type]).c_str());
+    }
+  }
+}
+
+/**
+ * Pairs the command lines sent to the Grbl system with the responses and collects the
+ * latencies. The real-time commands are not part of the lines.
+ */
+class LatencyTracker {
+
+  public:
+    std::vector<uint32_t> latencies;
+
+    void sent(uint8_t data, uint32_t time) {
+      if ((data == '?') || (data == '~') || (data == '!') || (data == 0x18) || (data >= 0x80)) {
+        return;
+      }
+      if ((data == '\n') || (data == '\r')) {
+        if (this->lineOpen) {
+          this->pending.push_back(time);
+        }
+        this->lineOpen = false;
+      } else {
+        this->lineOpen = true;
+      }
+    }
+
+    void received(uint8_t data, uint32_t time) {
+      if ((data != '\n') && (data != '\r')) {
+        this->line += (char) data;
+        return;
+      }
+      bool response = (this->line == "ok") || (this->line.compare(0, 6, "error:") == 0);
+      if (response && !this->pending.empty()) {
+        this->latencies.push_back(time - this->pending.front());
+        this->pending.pop_front();
+      }
+      this->line.clear();
+    }
+
+    void print(const char * title) {
+      if (this->latencies.empty()) {
+        printf("%s: no responses\n", title);
+        return;
+      }
+      std::vector<uint32_t> sorted = this->latencies;
+      std::sort(sorted.begin(), sorted.end());
+      uint64_t sum = 0;
+      for (size_t i = 0; i < sorted.size(); i++) {
+        sum += sorted[i];
+      }
+      printf("%s: %zu responses, min %u avg %.1f p50 %u p90 %u p99 %u max %u ms\n", title,
+             sorted.size(), sorted.front(), (double) sum / sorted.size(),
+             sorted[sorted.size() * 50 / 100], sorted[sorted.size() * 90 / 100],
+             sorted[sorted.size() * 99 / 100], sorted.back());
+    }
+
+  private:
+    std::deque<uint32_t> pending;
+    bool lineOpen = false;
+    std::string line;
+
+};
+
+static void printStatistics(const std::vector<Record> & records) {
+  uint64_t bytes[TRACE_GRBL_TX + 1] = { 0 };
+  uint32_t events = 0;
+  uint32_t dropped = 0;
+  uint32_t missing = 0;
+  LatencyTracker latency;
+  for (size_t i = 0; i < records.size(); i++) {
+    const Record & record = records[i];
+    if (record.type <= TRACE_GRBL_TX) {
+      bytes[record.type] += record.data.size();
+    } else if ((record.type == TRACE_EVENT) || (record.type == TRACE_COMBINATION)) {
+      events++;
+    } else if (record.type == TRACE_DROPPED) {
+      dropped += record.count;
+    } else if (record.type == TRACE_MISSING) {
+      missing += record.count;
+    }
+    for (size_t j = 0; j < record.data.size(); j++) {
+      if (record.type == TRACE_GRBL_TX) {
+        latency.sent(record.data[j], record.time);
+      } else if (record.type == TRACE_GRBL_RX) {
+        latency.received(record.data[j], record.time);
+      }
+    }
+  }
+  double duration = records.empty() ? 0 : (records.back().time - records.front().time) / 1000.0;
+  printf("duration %.3f s, %u user control events, %u bytes dropped, %u blocks missing\n",
+         duration, events, dropped, missing);
+  for (int type = TRACE_HOST_RX; type <= TRACE_GRBL_TX; type++) {
+    printf("%s %10llu bytes %8.1f bytes/s\n", DirectionNames[type], (unsigned long long) bytes[type],
+           (duration > 0) ? bytes[type] / duration : 0.0);
+  }
+  latency.print("latency");
+}
+
+static int openPort(const char * name, int baud) {
+  speed_t speed;
+  switch (baud) {
+    case 9600:   speed = B9600;   break;
+    case 19200:  speed = B19200;  break;
+    case 38400:  speed = B38400;  break;
+    case 57600:  speed = B57600;  break;
+    case 115200: speed = B115200; break;
+    default:
+      fprintf(stderr, "unsupported baud rate %d\n", baud);
+      return -1;
+  }
+  int port = open(name, O_RDWR | O_NOCTTY);
+  if (port < 0) {
+    perror(name);
+    return -1;
+  }
+  struct termios settings;
+  if (tcgetattr(port, &settings) != 0) {
+    perror(name);
+    return -1;
+  }
+  cfmakeraw(&settings);
+  cfsetispeed(&settings, speed);
+  cfsetospeed(&settings, speed);
+  settings.c_cflag |= CLOCAL | CREAD;
+  settings.c_cc[VMIN] = 0;
+  settings.c_cc[VTIME] = 0;
+  if (tcsetattr(port, TCSANOW, &settings) != 0) {
+    perror(name);
+    return -1;
+  }
+  return port;
+}
+
+static uint32_t now() {
+  struct timeval time;
+  gettimeofday(&time, NULL);
+  return time.tv_sec * 1000 + time.tv_usec / 1000;
+}
+
+/**
+ * Waits up to the timeout given (in ms) for data from the pendant and collects it.
+ */
+static void receive(int grblPort, int hostPort, uint32_t timeout, uint32_t start,
+                    std::string & grblData, LatencyTracker & latency) {
+  fd_set set;
+  FD_ZERO(&set);
+  FD_SET(grblPort, &set);
+  if (hostPort >= 0) {
+    FD_SET(hostPort, &set);
+  }
+  struct timeval time = { (time_t) (timeout / 1000), (suseconds_t) ((timeout % 1000) * 1000) };
+  if (select(std::max(grblPort, hostPort) + 1, &set, NULL, NULL, &time) <= 0) {
+    return;
+  }
+  uint8_t buffer[256];
+  if (FD_ISSET(grblPort, &set)) {
+    ssize_t length = read(grblPort, buffer, sizeof(buffer));
+    for (ssize_t i = 0; i < length; i++) {
+      grblData += (char) buffer[i];
+      latency.sent(buffer[i], now() - start);
+    }
+  }
+  if ((hostPort >= 0) && FD_ISSET(hostPort, &set)) {
+    // the host output is not compared, it only has to be taken off the port
+    if (read(hostPort, buffer, sizeof(buffer)) < 0) {
+      perror("read");
+      exit(1);
+    }
+  }
+}
+
+static void send(int port, const std::string & data) {
+  if (write(port, data.data(), data.size()) != (ssize_t) data.size()) {
+    perror("write");
+    exit(1);
+  }
+}
+
+static int replay(const std::vector<Record> & records, const char * grblPortName,
+                  const char * hostPortName, int baud, bool wait) {
+  int grblPort = openPort(grblPortName, baud);
+  int hostPort = -1;
+  if ((grblPort < 0) || ((hostPortName != NULL) && ((hostPort = openPort(hostPortName, baud)) < 0))) {
+    return 1;
+  }
+  if ((hostPort >= 0) && wait) {
+    // most boards are reset when the port is opened
+    sleep(2);
+  }
+  tcflush(grblPort, TCIOFLUSH);
+  if (hostPort >= 0) {
+    tcflush(hostPort, TCIOFLUSH);
+  }
+
+  std::string recordedData;
+  LatencyTracker recordedLatency;
+  std::string replayedData;
+  LatencyTracker replayedLatency;
+  bool synchronized = true;
+  uint32_t firstTime = records.empty() ? 0 : records.front().time;
+  uint32_t start = now();
+  for (size_t i = 0; i < records.size(); i++) {
+    const Record & record = records[i];
+    uint32_t due = record.time - firstTime;
+    if (record.type == TRACE_GRBL_TX) {
+      recordedData += record.data;
+      for (size_t j = 0; j < record.data.size(); j++) {
+        recordedLatency.sent(record.data[j], due);
+      }
+      continue;
+    }
+    if ((record.type != TRACE_GRBL_RX) && (record.type != TRACE_HOST_RX) &&
+        (record.type != TRACE_EVENT) && (record.type != TRACE_COMBINATION)) {
+      continue;
+    }
+    // wait for the time of the record and for the commands the record responds to
+    uint32_t stallTime = 0;
+    while ((now() - start < due) || (synchronized && (replayedData.size() < recordedData.size()))) {
+      uint32_t elapsed = now() - start;
+      if ((elapsed >= due) && (stallTime == 0)) {
+        stallTime = elapsed;
+      } else if ((stallTime != 0) && (elapsed - stallTime > 5000)) {
+        // the pendant has taken another course, the rest is replayed by time only
+        printf("%10.3f the pendant has sent %zu of %zu bytes to Grbl - continuing by time\n",
+               elapsed / 1000.0, replayedData.size(), recordedData.size());
+        synchronized = false;
+        break;
+      }
+      receive(grblPort, hostPort, (elapsed < due) ? due - elapsed : 10, start, replayedData, replayedLatency);
+    }
+    if (record.type == TRACE_GRBL_RX) {
+      send(grblPort, record.data);
+      for (size_t j = 0; j < record.data.size(); j++) {
+        recordedLatency.received(record.data[j], due);
+        replayedLatency.received(record.data[j], now() - start);
+      }
+    } else if (record.type == TRACE_HOST_RX) {
+      if (hostPort >= 0) {
+        send(hostPort, record.data);
+      }
+    } else {
+      Record event = record;
+      event.time = due;
+      printEvent(event);
+      fflush(stdout);
+    }
+  }
+  // collect the rest of the output
+  uint32_t end = now();
+  while (now() - end < 2000) {
+    receive(grblPort, hostPort, 100, start, replayedData, replayedLatency);
+  }
+
+  size_t position = 0;
+  while ((position < recordedData.size()) && (position < replayedData.size()) &&
+         (recordedData[position] == replayedData[position])) {
+    position++;
+  }
+  if ((position == recordedData.size()) && (position == replayedData.size())) {
+    printf("the %zu bytes sent to Grbl match the recording\n", recordedData.size());
+  } else {
+    size_t context = (position > 20) ? position - 20 : 0;
+    printf("the bytes sent to Grbl differ at byte %zu of %zu (%zu replayed)\n",
+           position, recordedData.size(), replayedData.size());
+    printf("  recorded: %s\n", escape(recordedData.substr(context, 60)).c_str());
+    printf("  replayed: %s\n", escape(replayedData.substr(std::min(context, replayedData.size()), 60)).c_str());
+  }
+  recordedLatency.print("recorded latency");
+  replayedLatency.print("replayed latency");
+  return (position == recordedData.size()) && (position == replayedData.size()) ? 0 : 1;
+}
+
+int main(int argc, char ** argv) {
+  const char * fileName = TRACE_FILE_NAME;
+  const char * grblPortName = NULL;
+  const char * hostPortName = NULL;
+  int baud = 57600;
+  bool wait = true;
+  bool statistics = false;
+  long run = -1;
+  for (int i = 1; i < argc; i++) {
+    if ((strcmp(argv[i], "-r") == 0) && (i + 1 < argc)) {
+      run = atol(argv[++i]);
+    } else if ((strcmp(argv[i], "-g") == 0) && (i + 1 < argc)) {
+      grblPortName = argv[++i];
+    } else if ((strcmp(argv[i], "-p") == 0) && (i + 1 < argc)) {
+      hostPortName = argv[++i];
+    } else if ((strcmp(argv[i], "-b") == 0) && (i + 1 < argc)) {
+      baud = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-n") == 0) {
+      wait = false;
+    } else if (strcmp(argv[i], "-s") == 0) {
+      statistics = true;
+    } else if (argv[i][0] == '-') {
+      usage();
+    } else {
+      fileName = argv[i];
+    }
+  }
+  if ((hostPortName != NULL) && (grblPortName == NULL)) {
+    usage();
+  }
+
+  std::vector<Record> records;
+  if (!readTrace(fileName, run, records)) {
+    return 1;
+  }
+  if (grblPortName != NULL) {
+    return replay(records, grblPortName, hostPortName, baud, wait);
+  }
+  if (statistics) {
+    printStatistics(records);
+  } else {
+    printRecords(records);
+  }
+  return 0;
+}
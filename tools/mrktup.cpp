@@ -0,0 +1,348 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+
+// mrktup - the Mrkt SD card uploader
+//
+// This host tool uploads a file to the SD card of the pendant through the USB serial
+// port, using the block protocol of the PUT host command (see src/Mrkt/Uploader.h).
+// Several blocks are sent without waiting for the acknowledgements, so the transfer
+// runs at nearly the full speed of the serial connection.
+//
+// Build:  g++ -O2 -o mrktup mrktup.cpp
+// Usage:  mrktup [-p <port>] [-b <baud>] [-w <window>] [-r] [-n] <file> [<name>]
+//
+//   -p   the serial port (default: /dev/ttyUSB0)
+//   -b   the baud rate, see HOST_SERIAL_SPEED (default: 57600)
+//   -w   the number of blocks sent ahead of the acknowledgements (default: 4)
+//   -r   resume an interrupted upload of the same file
+//   -n   do not wait for the board to restart after the port has been opened
+//
+// If no name is given, the name of the file is used - it has to be a valid 8.3 name.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <termios.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// the protocol constants, see src/Mrkt/Uploader.h
+#define BLOCK_SIZE   512
+#define STX          0x02
+#define ACK          0x06
+#define NAK          0x15
+
+// the time in ms to wait for a response, and the number of attempts before giving up
+#define RESPONSE_TIMEOUT  3000
+#define RETRIES           5
+
+static int port = -1;
+
+static void usage() {
+  fprintf(stderr, "usage: mrktup [-p <port>] [-b <baud>] [-w <window>] [-r] [-n] <file> [<name>]\n");
+  exit(2);
+}
+
+static double now() {
+  struct timeval time;
+  gettimeofday(&time, NULL);
+  return time.tv_sec + time.tv_usec / 1e6;
+}
+
+static bool openPort(const char * name, int baud) {
+  speed_t speed;
+  switch (baud) {
+    case 9600:   speed = B9600;   break;
+    case 19200:  speed = B19200;  break;
+    case 38400:  speed = B38400;  break;
+    case 57600:  speed = B57600;  break;
+    case 115200: speed = B115200; break;
+    default:
+      fprintf(stderr, "unsupported baud rate %d\n", baud);
+      return false;
+  }
+  port = open(name, O_RDWR | O_NOCTTY);
+  if (port < 0) {
+    perror(name);
+    return false;
+  }
+  struct termios settings;
+  if (tcgetattr(port, &settings) != 0) {
+    perror(name);
+    return false;
+  }
+  cfmakeraw(&settings);
+  cfsetispeed(&settings, speed);
+  cfsetospeed(&settings, speed);
+  settings.c_cflag |= CLOCAL | CREAD;
+  settings.c_cc[VMIN] = 0;
+  settings.c_cc[VTIME] = 0;
+  if (tcsetattr(port, TCSANOW, &settings) != 0) {
+    perror(name);
+    return false;
+  }
+  return true;
+}
+
+static void writeAll(const uint8_t * data, size_t length) {
+  while (length > 0) {
+    ssize_t written = write(port, data, length);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("write");
+      exit(1);
+    }
+    data += written;
+    length -= written;
+  }
+}
+
+/**
+ * Reads a single byte, returns -1 if nothing has been received within the timeout (in ms).
+ */
+static int readByte(int timeout) {
+  fd_set set;
+  FD_ZERO(&set);
+  FD_SET(port, &set);
+  struct timeval time = { timeout / 1000, (timeout % 1000) * 1000 };
+  if (select(port + 1, &set, NULL, NULL, &time) <= 0) {
+    return -1;
+  }
+  uint8_t data;
+  return (read(port, &data, 1) == 1) ? data : -1;
+}
+
+/**
+ * Reads a line of text, returns false if nothing has been received within the timeout (in ms).
+ */
+static bool readLine(std::string & line, int timeout) {
+  line.clear();
+  while (true) {
+    int data = readByte(timeout);
+    if (data < 0) {
+      return false;
+    }
+    if ((data == '\n') || (data == '\r')) {
+      if (!line.empty()) {
+        return true;
+      }
+    } else {
+      line += (char) data;
+    }
+  }
+}
+
+static uint16_t crc16(uint16_t crc, uint8_t data) {
+  // CRC-16/XMODEM, see _crc_xmodem_update() in avr-libc
+  crc ^= (uint16_t) data << 8;
+  for (int i = 0; i < 8; i++) {
+    crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+static void sendBlock(const std::vector<uint8_t> & data, unsigned block) {
+  size_t offset = (size_t) block * BLOCK_SIZE;
+  size_t length = std::min((size_t) BLOCK_SIZE, data.size() - offset);
+  std::vector<uint8_t> frame;
+  frame.push_back(STX);
+  frame.push_back(block & 0xFF);
+  frame.push_back(block >> 8);
+  frame.insert(frame.end(), data.begin() + offset, data.begin() + offset + length);
+  uint16_t crc = 0;
+  for (size_t i = 1; i < frame.size(); i++) {
+    crc = crc16(crc, frame[i]);
+  }
+  frame.push_back(crc & 0xFF);
+  frame.push_back(crc >> 8);
+  writeAll(&frame[0], frame.size());
+}
+
+int main(int argc, char ** argv) {
+  const char * portName = "/dev/ttyUSB0";
+  int baud = 57600;
+  unsigned window = 4;
+  bool resume = false;
+  bool wait = true;
+  const char * fileName = NULL;
+  const char * targetName = NULL;
+  for (int i = 1; i < argc; i++) {
+    if ((strcmp(argv[i], "-p") == 0) && (i + 1 < argc)) {
+      portName = argv[++i];
+    } else if ((strcmp(argv[i], "-b") == 0) && (i + 1 < argc)) {
+      baud = atoi(argv[++i]);
+    } else if ((strcmp(argv[i], "-w") == 0) && (i + 1 < argc)) {
+      window = atoi(argv[++i]);
+      if (window == 0) {
+        usage();
+      }
+    } else if (strcmp(argv[i], "-r") == 0) {
+      resume = true;
+    } else if (strcmp(argv[i], "-n") == 0) {
+      wait = false;
+    } else if (argv[i][0] == '-') {
+      usage();
+    } else if (fileName == NULL) {
+      fileName = argv[i];
+    } else if (targetName == NULL) {
+      targetName = argv[i];
+    } else {
+      usage();
+    }
+  }
+  if (fileName == NULL) {
+    usage();
+  }
+  if (targetName == NULL) {
+    const char * slash = strrchr(fileName, '/');
+    targetName = (slash == NULL) ? fileName : slash + 1;
+  }
+
+  FILE * input = fopen(fileName, "rb");
+  if (input == NULL) {
+    perror(fileName);
+    return 1;
+  }
+  std::vector<uint8_t> data;
+  uint8_t buffer[4096];
+  size_t length;
+  while ((length = fread(buffer, 1, sizeof(buffer), input)) > 0) {
+    data.insert(data.end(), buffer, buffer + length);
+  }
+  fclose(input);
+  unsigned blockCount = (data.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  if (blockCount > 0xFFFF) {
+    fprintf(stderr, "%s: file too large\n", fileName);
+    return 1;
+  }
+
+  if (!openPort(portName, baud)) {
+    return 1;
+  }
+  if (wait) {
+    // most boards are reset when the port is opened
+    sleep(2);
+  }
+  tcflush(port, TCIOFLUSH);
+
+  // request the upload and determine the first block to send
+  char command[64];
+  snprintf(command, sizeof(command), "PUT %s %zu%s\n", targetName, data.size(), resume ? " R" : "");
+  writeAll((const uint8_t *) command, strlen(command));
+  std::string line;
+  unsigned base = 0;
+  while (true) {
+    if (!readLine(line, RESPONSE_TIMEOUT)) {
+      fprintf(stderr, "no response from %s\n", portName);
+      return 1;
+    }
+    if (line.compare(0, 6, "error:") == 0) {
+      fprintf(stderr, "%s\n", line.c_str());
+      return 1;
+    }
+    if (sscanf(line.c_str(), "[PUT:%u]", &base) == 1) {
+      break;
+    }
+  }
+  if (base > 0) {
+    printf("resuming at block %u of %u\n", base, blockCount);
+  }
+
+  // go-back-N: keep up to window blocks in flight, restart at the block requested by NAK
+  double startTime = now();
+  unsigned firstBlock = base;
+  unsigned next = base;
+  unsigned retries = 0;
+  line.clear();
+  while (base < blockCount) {
+    while ((next < blockCount) && (next < base + window)) {
+      sendBlock(data, next);
+      next++;
+    }
+    int code = readByte(RESPONSE_TIMEOUT);
+    if (code < 0) {
+      if (++retries > RETRIES) {
+        fprintf(stderr, "\nconnection lost at block %u - use -r to resume\n", base);
+        return 1;
+      }
+      next = base;
+      continue;
+    }
+    if ((code != ACK) && (code != NAK)) {
+      // a text reply ends the transfer
+      if ((code == '\n') || (code == '\r')) {
+        if (!line.empty()) {
+          fprintf(stderr, "\n%s\n", line.c_str());
+          return 1;
+        }
+      } else {
+        line += (char) code;
+      }
+      continue;
+    }
+    int low = readByte(RESPONSE_TIMEOUT);
+    int high = readByte(RESPONSE_TIMEOUT);
+    if ((low < 0) || (high < 0)) {
+      continue;
+    }
+    unsigned block = low | (high << 8);
+    retries = 0;
+    if (code == ACK) {
+      if (block > base) {
+        base = block;
+      }
+    } else {
+      base = block;
+      next = block;
+    }
+    printf("\r%u/%u blocks", base, blockCount);
+    fflush(stdout);
+  }
+
+  // the device closes the file and confirms the upload
+  while (true) {
+    if (!readLine(line, RESPONSE_TIMEOUT)) {
+      fprintf(stderr, "\nno confirmation received\n");
+      return 1;
+    }
+    // repeated acknowledgements may precede the reply
+    if ((line.size() >= 2) && (line.compare(line.size() - 2, 2, "ok") == 0)) {
+      break;
+    }
+    size_t error = line.find("error:");
+    if (error != std::string::npos) {
+      fprintf(stderr, "\n%s\n", line.c_str() + error);
+      return 1;
+    }
+  }
+  double duration = now() - startTime;
+  size_t bytes = data.size() - std::min(data.size(), (size_t) firstBlock * BLOCK_SIZE);
+  printf("\r%s: %zu bytes in %.1f s (%.0f bytes/s)\n", targetName, bytes, duration,
+         (duration > 0) ? bytes / duration : 0.0);
+  close(port);
+  return 0;
+}
@@ -0,0 +1,140 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+
+// The Arduino core as far as Mrkt uses it, for the host build of mrktreplay (see
+// tools/mrktreplay.cpp). The program memory is ordinary memory on the host, and the clock,
+// the pins and the serial ports are simulated by the replayer.
+
+#ifndef MRKT_REPLAY_Arduino_h
+#define MRKT_REPLAY_Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <avr/pgmspace.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH    1
+#define LOW     0
+#define INPUT   0
+#define OUTPUT  1
+
+#define A0     14
+#define A1     15
+#define A2     16
+#define A3     17
+#define A4     18
+#define A5     19
+
+#define DEC    10
+#define HEX    16
+
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define constrain(value, low, high) ((value) < (low) ? (low) : ((value) > (high) ? (high) : (value)))
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(PSTR(s)))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+
+/**
+ * Only the construction from a string and the access to the characters are supported.
+ */
+class String {
+  public:
+    String(const char * text = "");
+    String(const __FlashStringHelper * text);
+    String(const String & other);
+    ~String();
+    String & operator=(const String & other);
+    const char * c_str() const;
+    unsigned int length() const;
+  private:
+    char * text;
+};
+
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t data) = 0;
+    size_t write(const uint8_t * data, size_t length);
+    size_t write(const char * text);
+    virtual int availableForWrite();
+    size_t print(const __FlashStringHelper * text);
+    size_t print(const String & text);
+    size_t print(const char * text);
+    size_t print(char value);
+    size_t print(unsigned char value, int base = DEC);
+    size_t print(int value, int base = DEC);
+    size_t print(unsigned int value, int base = DEC);
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t println(const __FlashStringHelper * text);
+    size_t println(const String & text);
+    size_t println(const char * text);
+    size_t println(char value);
+    size_t println(unsigned char value, int base = DEC);
+    size_t println(int value, int base = DEC);
+    size_t println(unsigned int value, int base = DEC);
+    size_t println(long value, int base = DEC);
+    size_t println(unsigned long value, int base = DEC);
+    size_t println();
+  private:
+    size_t printNumber(unsigned long value, int base);
+};
+
+class Stream : public Print {
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+};
+
+/**
+ * The host connection. The bytes received are queued by the replayer, the bytes sent leave 
+ * the transmit buffer at the baud rate.
+ */
+class HardwareSerial : public Stream {
+  public:
+    void begin(unsigned long baud);
+    operator bool();
+    int available();
+    int read();
+    int peek();
+    int availableForWrite();
+    size_t write(uint8_t data);
+    using Print::write;
+    void flush();
+};
+
+extern HardwareSerial Serial;
+
+#endif
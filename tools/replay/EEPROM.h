@@ -0,0 +1,46 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+
+// The EEPROM in the host build of mrktreplay - it is erased when the replay starts.
+
+#ifndef MRKT_REPLAY_EEPROM_h
+#define MRKT_REPLAY_EEPROM_h
+
+#include <stdint.h>
+
+class EEPROMClass {
+  public:
+    uint8_t read(int address);
+    void write(int address, uint8_t value);
+    template <typename T> T & get(int address, T & value) {
+      for (unsigned int i = 0; i < sizeof(T); i++) {
+        ((uint8_t *) &value)[i] = read(address + i);
+      }
+      return value;
+    }
+    template <typename T> const T & put(int address, const T & value) {
+      for (unsigned int i = 0; i < sizeof(T); i++) {
+        write(address + i, ((const uint8_t *) &value)[i]);
+      }
+      return value;
+    }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,33 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+
+// The rotary encoder in the host build of mrktreplay - the position is set by the replayer
+// to inject the EncChanged events (see tools/mrktreplay.cpp).
+
+#ifndef MRKT_REPLAY_Encoder_h
+#define MRKT_REPLAY_Encoder_h
+
+#include <stdint.h>
+
+class Encoder {
+  public:
+    Encoder(uint8_t pin1, uint8_t pin2);
+    int32_t read();
+};
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+
+// The display in the host build of mrktreplay (see tools/mrktreplay.cpp) - the characters
+// written are kept so that the replayer can print them.
+
+#ifndef MRKT_REPLAY_LiquidCrystal_h
+#define MRKT_REPLAY_LiquidCrystal_h
+
+#include "Arduino.h"
+
+#define LIQUID_CRYSTAL_ROWS     4
+#define LIQUID_CRYSTAL_COLUMNS 20
+
+class LiquidCrystal : public Print {
+  public:
+    LiquidCrystal(uint8_t rs, uint8_t enable, uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3);
+    void begin(uint8_t columns, uint8_t rows);
+    void clear();
+    void home();
+    void setCursor(uint8_t column, uint8_t row);
+    void createChar(uint8_t location, uint8_t charmap[]);
+    size_t write(uint8_t value);
+    using Print::write;
+  private:
+    uint8_t column;
+    uint8_t row;
+};
+
+#endif
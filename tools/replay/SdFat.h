@@ -0,0 +1,110 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+
+// The SdFat library as far as Mrkt uses it, for the host build of mrktreplay (see
+// tools/mrktreplay.cpp). The card holds a copy of the files of a host directory in memory,
+// so the replay does not change them. The files have no subdirectories and each of them is
+// contiguous.
+
+#ifndef MRKT_REPLAY_SdFat_h
+#define MRKT_REPLAY_SdFat_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define O_READ   0x01
+#define O_WRITE  0x02
+#define O_RDWR   (O_READ | O_WRITE)
+#define O_CREAT  0x10
+#define O_TRUNC  0x20
+
+#define SPI_FULL_SPEED 2
+#define SPI_HALF_SPEED 4
+
+struct dir_t {
+  uint8_t name[11];
+  uint8_t attributes;
+  uint8_t reservedNT;
+  uint8_t creationTimeTenths;
+  uint16_t creationTime;
+  uint16_t creationDate;
+  uint16_t lastAccessDate;
+  uint16_t firstClusterHigh;
+  uint16_t lastWriteTime;
+  uint16_t lastWriteDate;
+  uint16_t firstClusterLow;
+  uint32_t fileSize;
+};
+
+class Sd2Card {
+  public:
+    bool readBlock(uint32_t block, uint8_t * data);
+    bool writeBlock(uint32_t block, const uint8_t * data);
+};
+
+class FatFile {
+  public:
+    FatFile();
+    bool open(const char * path, uint8_t flags = O_READ);
+    bool open(FatFile * directory, uint16_t index, uint8_t flags);
+    bool openNext(FatFile * directory, uint8_t flags = O_READ);
+    bool close();
+    bool isOpen() const;
+    bool isFile() const;
+    bool isHidden() const;
+    int read();
+    int read(void * data, size_t length);
+    size_t write(const void * data, size_t length);
+    bool seekSet(uint32_t position);
+    uint32_t curPosition() const;
+    uint32_t fileSize() const;
+    bool rewind();
+    bool sync();
+    bool truncate(uint32_t length);
+    bool getSFN(char * name);
+    bool dirEntry(dir_t * entry);
+    uint16_t dirIndex();
+    uint32_t firstCluster() const;
+    bool getModifyDateTime(uint16_t * date, uint16_t * time);
+    bool createContiguous(const char * path, uint32_t size);
+    bool contiguousRange(uint32_t * firstBlock, uint32_t * lastBlock);
+  private:
+    friend class SdFat;
+    /**
+     * The directory index of the file, -1 if the file is closed and -2 for the root directory.
+     */
+    int16_t index;
+    /**
+     * The position in the file, or the next directory index for the root directory.
+     */
+    uint32_t position;
+    uint8_t flags;
+};
+
+class SdFile : public FatFile {
+};
+
+class SdFat {
+  public:
+    bool begin(uint8_t csPin, uint8_t speed = SPI_FULL_SPEED);
+    bool remove(const char * path);
+    Sd2Card * card();
+    FatFile * vwd();
+};
+
+#endif
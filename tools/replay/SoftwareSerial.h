@@ -0,0 +1,41 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+
+// The connection to the Grbl system in the host build of mrktreplay (see
+// tools/mrktreplay.cpp). The bytes received are queued by the replayer, and sending a byte
+// takes the time of its transmission at the baud rate, as the transmission blocks the 
+// processor.
+
+#ifndef MRKT_REPLAY_SoftwareSerial_h
+#define MRKT_REPLAY_SoftwareSerial_h
+
+#include "Arduino.h"
+
+class SoftwareSerial : public Stream {
+  public:
+    SoftwareSerial(uint8_t receivePin, uint8_t transmitPin);
+    void begin(long baud);
+    bool listen();
+    int available();
+    int read();
+    int peek();
+    size_t write(uint8_t data);
+    using Print::write;
+};
+
+#endif
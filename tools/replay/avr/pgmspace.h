@@ -0,0 +1,44 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+
+// The program memory is ordinary memory on the host (see tools/replay/Arduino.h).
+
+#ifndef MRKT_REPLAY_pgmspace_h
+#define MRKT_REPLAY_pgmspace_h
+
+#include <string.h>
+#include <strings.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+
+#define pgm_read_byte(address)  (*(const uint8_t *) (address))
+#define pgm_read_word(address)  (*(const uint16_t *) (address))
+#define pgm_read_dword(address) (*(const uint32_t *) (address))
+#define pgm_read_ptr(address)   (*(void * const *) (address))
+
+#define memcmp_P     memcmp
+#define memcpy_P     memcpy
+#define strcasecmp_P strcasecmp
+#define strcmp_P     strcmp
+#define strcpy_P     strcpy
+#define strlen_P     strlen
+#define strncmp_P    strncmp
+
+#endif
@@ -0,0 +1,32 @@
+/*
+ *  This file is part of Mrkt, a hardware frontend for Grbl.
+ *
+ *  Mrkt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Mrkt.  If not, see <http://www.gnu.org/licenses/>.
+ *  
+ */ 
+
+// The idle sleep of the host build of mrktreplay - sleep_cpu() advances the simulated clock
+// to the next timer interrupt (see tools/mrktreplay.cpp).
+
+#ifndef MRKT_REPLAY_sleep_h
+#define MRKT_REPLAY_sleep_h
+
+#define SLEEP_MODE_IDLE 0
+
+inline void set_sleep_mode(int mode) {}
+inline void sleep_enable() {}
+inline void sleep_disable() {}
+void sleep_cpu();
+
+#endif